@@ -224,6 +224,12 @@ typedef size_t (*curl_write_callback)(char *buffer,
                                       size_t nitems,
                                       void *outstream);
 
+/* This callback returns the memory that libcurl writes received data to
+   before it passes it to the write callback, and stores the size of it in
+   *size. Returning NULL makes libcurl use its own buffer. */
+typedef char *(*curl_writebuffer_callback)(size_t *size,
+                                           void *userdata);
+
 
 
 /* enumeration of file types */
@@ -1778,6 +1784,29 @@ typedef enum {
   /* Path to an abstract Unix domain socket */
   CINIT(ABSTRACT_UNIX_SOCKET, STRINGPOINT, 264),
 
+  /* Seconds past the DNS cache timeout that a cached name may still be used
+     while it is resolved again in the background */
+  CINIT(DNS_STALE_WHILE_REVALIDATE, LONG, 265),
+
+  /* File descriptor to read the data to upload from, instead of calling
+     the read callback */
+  CINIT(UPLOAD_FD, LONG, 266),
+
+  /* Offset in the upload file descriptor to start reading at */
+  CINIT(UPLOAD_FD_OFFSET, OFF_T, 267),
+
+  /* Function that gives the memory to write received data to, and the
+     pointer passed to it */
+  CINIT(WRITEBUFFERFUNCTION, FUNCTIONPOINT, 268),
+  CINIT(WRITEBUFFERDATA, OBJECTPOINT, 269),
+
+  /* Number of connections to download an HTTP resource over, in ranges */
+  CINIT(RANGE_CONNECTIONS, LONG, 270),
+
+  /* File descriptor to write the ranges of a download in parts to, at their
+     offsets, instead of calling the write callback */
+  CINIT(RANGE_FD, LONG, 271),
+
   CURLOPT_LASTENTRY /* the last unused */
 } CURLoption;
 
@@ -2290,9 +2319,12 @@ typedef enum {
   CURLINFO_PROXY_SSL_VERIFYRESULT = CURLINFO_LONG + 47,
   CURLINFO_PROTOCOL         = CURLINFO_LONG   + 48,
   CURLINFO_SCHEME           = CURLINFO_STRING + 49,
+  CURLINFO_DNS_CACHE_HITS   = CURLINFO_LONG   + 50,
+  CURLINFO_DNS_CACHE_MISSES = CURLINFO_LONG   + 51,
+  CURLINFO_DNS_CACHE_STALE  = CURLINFO_LONG   + 52,
   /* Fill in new entries below here! */
 
-  CURLINFO_LASTONE          = 49
+  CURLINFO_LASTONE          = 52
 } CURLINFO;
 
 /* CURLINFO_RESPONSE_CODE is the new name for the option previously known as
@@ -2373,6 +2405,7 @@ typedef enum {
   CURLSHOPT_UNLOCKFUNC, /* pass in a 'curl_unlock_function' pointer */
   CURLSHOPT_USERDATA,   /* pass in a user data pointer used in the lock/unlock
                            callback functions */
+  CURLSHOPT_BUILTIN_LOCKS, /* 1L to have libcurl do the locking itself */
   CURLSHOPT_LAST  /* never use */
 } CURLSHoption;
 
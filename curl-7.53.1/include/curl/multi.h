@@ -432,6 +432,23 @@ typedef int (*curl_push_callback)(CURL *parent,
                                   struct curl_pushheaders *headers,
                                   void *userp);
 
+/*
+ * Name:     curl_multi_wait_perform()
+ *
+ * Desc:     Wait for activity on the sockets of the transfers in a CURLM set,
+ *           or for a timeout, and then act on the transfers that need it.
+ *           Where the system provides epoll, the sockets are kept in a set
+ *           that is updated as the transfers change, so that a call costs in
+ *           proportion to the number of ready sockets rather than the number
+ *           of transfers. It returns the number of handles that still
+ *           transfer data in the third argument's integer-pointer.
+ *
+ * Returns:  CURLMcode type, general multi error code.
+ */
+CURL_EXTERN CURLMcode curl_multi_wait_perform(CURLM *multi_handle,
+                                              int timeout_ms,
+                                              int *running_handles);
+
 #ifdef __cplusplus
 } /* end of extern "C" */
 #endif
@@ -69,6 +69,7 @@
 #include "inet_ntop.h"
 #include "curl_threads.h"
 #include "connect.h"
+#include "select.h"
 /* The last 3 #include files should be in this order */
 #include "curl_printf.h"
 #include "curl_memory.h"
@@ -79,23 +80,116 @@
  **********************************************************************/
 #ifdef CURLRES_THREADED
 
+/*
+ * Name resolves are done by a pool of at most RESOLVER_THREADS threads that
+ * all handles in the process share. A resolve is queued as a job and a
+ * thread is started for it if there is room for one more. Each thread takes
+ * jobs off the queue until it is empty, and then exits.
+ *
+ * Resolves of the same host name and port that are wanted at the same time
+ * share a job, found by the DNS cache id of the name and the kind of address
+ * asked for. The first connection to see it done stores the result in its
+ * DNS cache, and the others find it there or get a copy of it.
+ */
+#define RESOLVER_THREADS 8    /* threads resolving at once */
+#define RESOLVER_QUEUE   1000 /* jobs waiting for a thread */
+
+#define JOB_QUEUED  0
+#define JOB_RUNNING 1
+#define JOB_DONE    2
+
+struct resolve_job {
+  struct resolve_job *next; /* next in the queue */
+  char *key;                /* key in the pool's hash of jobs */
+  size_t keylen;
+  char *hostname;
+  int port;
+#ifdef HAVE_GETADDRINFO
+  struct addrinfo hints;
+#endif
+  int state;                /* JOB_* */
+  int refs;                 /* connections waiting for it */
+  int sock_error;
+  Curl_addrinfo *res;
+};
+
+/* Data for each connection waiting for a job */
+struct thread_data {
+  struct resolve_job *job;
+  unsigned int poll_interval;
+  time_t interval_end;
+};
+
+static struct resolver_pool {
+  curl_mutex_t mtx;         /* protects this and all jobs */
+  struct curl_hash jobs;    /* queued and running jobs, by key */
+  struct resolve_job *head; /* the queue */
+  struct resolve_job *tail;
+  size_t queued;
+  curl_thread_t threads[RESOLVER_THREADS];
+  int busy[RESOLVER_THREADS]; /* the thread is taking jobs off the queue */
+  int shutdown;
+} pool;
+
+static void job_hash_dtor(void *job)
+{
+  /* the job is freed when nobody is waiting for it anymore */
+  (void)job;
+}
+
 /*
  * Curl_resolver_global_init()
  * Called from curl_global_init() to initialize global resolver environment.
- * Does nothing here.
+ * Sets up the resolver thread pool; threads are started when needed.
  */
 int Curl_resolver_global_init(void)
 {
+  memset(&pool, 0, sizeof(pool));
+  Curl_mutex_init(&pool.mtx);
+  if(Curl_hash_init(&pool.jobs, 31, Curl_hash_str, Curl_str_key_compare,
+                    job_hash_dtor)) {
+    Curl_mutex_destroy(&pool.mtx);
+    return CURLE_OUT_OF_MEMORY;
+  }
   return CURLE_OK;
 }
 
+static void free_job(struct resolve_job *job)
+{
+  free(job->key);
+  free(job->hostname);
+  if(job->res)
+    Curl_freeaddrinfo(job->res);
+  free(job);
+}
+
 /*
  * Curl_resolver_global_cleanup()
  * Called from curl_global_cleanup() to destroy global resolver environment.
- * Does nothing here.
+ * Waits for the resolves in progress to finish and stops the threads.
  */
 void Curl_resolver_global_cleanup(void)
 {
+  int i;
+
+  Curl_mutex_acquire(&pool.mtx);
+  pool.shutdown = 1;
+  Curl_mutex_release(&pool.mtx);
+
+  for(i = 0; i < RESOLVER_THREADS; i++) {
+    if(pool.threads[i] != curl_thread_t_null)
+      Curl_thread_join(&pool.threads[i]);
+  }
+
+  /* the jobs still queued have nobody waiting for them by now */
+  while(pool.head) {
+    struct resolve_job *job = pool.head;
+    pool.head = job->next;
+    free_job(job);
+  }
+
+  Curl_hash_destroy(&pool.jobs);
+  Curl_mutex_destroy(&pool.mtx);
 }
 
 /*
@@ -149,219 +243,252 @@ static bool init_resolve_thread(struct connectdata *conn,
                                 const char *hostname, int port,
                                 const struct addrinfo *hints);
 
+/* Resolves the name of a job. Called without the pool locked. */
+static void resolve_job(struct resolve_job *job)
+{
+#ifdef HAVE_GETADDRINFO
+  char service[12];
+  int rc;
 
-/* Data for synchronization between resolver thread and its parent */
-struct thread_sync_data {
-  curl_mutex_t * mtx;
-  int done;
+  snprintf(service, sizeof(service), "%d", job->port);
 
-  char *hostname;        /* hostname to resolve, Curl_async.hostname
-                            duplicate */
-  int port;
-  int sock_error;
-  Curl_addrinfo *res;
-#ifdef HAVE_GETADDRINFO
-  struct addrinfo hints;
-#endif
-  struct thread_data *td; /* for thread-self cleanup */
-};
+  rc = Curl_getaddrinfo_ex(job->hostname, service, &job->hints, &job->res);
 
-struct thread_data {
-  curl_thread_t thread_hnd;
-  unsigned int poll_interval;
-  time_t interval_end;
-  struct thread_sync_data tsd;
-};
+  if(rc != 0) {
+    job->sock_error = SOCKERRNO?SOCKERRNO:rc;
+    if(job->sock_error == 0)
+      job->sock_error = RESOLVER_ENOMEM;
+  }
+  else {
+    Curl_addrinfo_set_port(job->res, job->port);
+  }
+#else
+  job->res = Curl_ipv4_resolve_r(job->hostname, job->port);
 
-static struct thread_sync_data *conn_thread_sync_data(struct connectdata *conn)
-{
-  return &(((struct thread_data *)conn->async.os_specific)->tsd);
+  if(!job->res) {
+    job->sock_error = SOCKERRNO;
+    if(job->sock_error == 0)
+      job->sock_error = RESOLVER_ENOMEM;
+  }
+#endif
 }
 
-#define CONN_THREAD_SYNC_DATA(conn) &(((conn)->async.os_specific)->tsd);
-
-/* Destroy resolver thread synchronization data */
-static
-void destroy_thread_sync_data(struct thread_sync_data * tsd)
+/*
+ * resolver_thread() takes jobs off the queue and resolves them until the
+ * queue is empty, and then exits.
+ */
+static unsigned int CURL_STDCALL resolver_thread(void *arg)
 {
-  if(tsd->mtx) {
-    Curl_mutex_destroy(tsd->mtx);
-    free(tsd->mtx);
+  int *busy = (int *)arg;
+
+  Curl_mutex_acquire(&pool.mtx);
+  while(pool.head && !pool.shutdown) {
+    struct resolve_job *job = pool.head;
+
+    pool.head = job->next;
+    if(!pool.head)
+      pool.tail = NULL;
+    pool.queued--;
+    job->next = NULL;
+    job->state = JOB_RUNNING;
+    Curl_mutex_release(&pool.mtx);
+
+    resolve_job(job);
+
+    Curl_mutex_acquire(&pool.mtx);
+    job->state = JOB_DONE;
+    /* resolves wanted from now on get a job of their own */
+    Curl_hash_delete(&pool.jobs, job->key, job->keylen);
+    if(!job->refs)
+      free_job(job);
   }
+  *busy = 0;
+  Curl_mutex_release(&pool.mtx);
 
-  free(tsd->hostname);
+  return 0;
+}
 
-  if(tsd->res)
-    Curl_freeaddrinfo(tsd->res);
+/* Takes a job off the queue and frees it. Called with the pool locked. */
+static void unqueue_job(struct resolve_job *job)
+{
+  struct resolve_job **jp = &pool.head;
+  struct resolve_job *prev = NULL;
 
-  memset(tsd, 0, sizeof(*tsd));
+  while(*jp != job) {
+    prev = *jp;
+    jp = &prev->next;
+  }
+  *jp = job->next;
+  if(pool.tail == job)
+    pool.tail = prev;
+  pool.queued--;
+  Curl_hash_delete(&pool.jobs, job->key, job->keylen);
+  free_job(job);
 }
 
-/* Initialize resolver thread synchronization data */
-static
-int init_thread_sync_data(struct thread_data * td,
-                           const char *hostname,
-                           int port,
-                           const struct addrinfo *hints)
+/*
+ * queue_job() adds a new job to the queue and starts a thread for it if
+ * there is room for one. Called with the pool locked. It takes over 'key'.
+ *
+ * Returns the job or NULL with 'err' set.
+ */
+static struct resolve_job *queue_job(char *key, const char *hostname,
+                                     int port, const struct addrinfo *hints,
+                                     int *err)
 {
-  struct thread_sync_data *tsd = &td->tsd;
+  struct resolve_job *job;
+  int running = 0;
+  int i;
 
-  memset(tsd, 0, sizeof(*tsd));
+  if(pool.shutdown || (pool.queued >= RESOLVER_QUEUE)) {
+    free(key);
+    return NULL;
+  }
 
-  tsd->td = td;
-  tsd->port = port;
+  job = calloc(1, sizeof(struct resolve_job));
+  if(!job) {
+    free(key);
+    return NULL;
+  }
+  job->key = key;
+  job->keylen = strlen(key);
+  job->port = port;
+  job->state = JOB_QUEUED;
+  job->sock_error = CURL_ASYNC_SUCCESS;
 #ifdef HAVE_GETADDRINFO
   DEBUGASSERT(hints);
-  tsd->hints = *hints;
+  job->hints = *hints;
 #else
   (void) hints;
 #endif
 
-  tsd->mtx = malloc(sizeof(curl_mutex_t));
-  if(tsd->mtx == NULL)
-    goto err_exit;
-
-  Curl_mutex_init(tsd->mtx);
-
-  tsd->sock_error = CURL_ASYNC_SUCCESS;
-
   /* Copying hostname string because original can be destroyed by parent
-   * thread during gethostbyname execution.
+   * thread during the resolve.
    */
-  tsd->hostname = strdup(hostname);
-  if(!tsd->hostname)
-    goto err_exit;
-
-  return 1;
-
- err_exit:
-  /* Memory allocation failed */
-  destroy_thread_sync_data(tsd);
-  return 0;
-}
-
-static int getaddrinfo_complete(struct connectdata *conn)
-{
-  struct thread_sync_data *tsd = conn_thread_sync_data(conn);
-  int rc;
-
-  rc = Curl_addrinfo_callback(conn, tsd->sock_error, tsd->res);
-  /* The tsd->res structure has been copied to async.dns and perhaps the DNS
-     cache.  Set our copy to NULL so destroy_thread_sync_data doesn't free it.
-  */
-  tsd->res = NULL;
-
-  return rc;
-}
-
-
-#ifdef HAVE_GETADDRINFO
-
-/*
- * getaddrinfo_thread() resolves a name and then exits.
- *
- * For builds without ARES, but with ENABLE_IPV6, create a resolver thread
- * and wait on it.
- */
-static unsigned int CURL_STDCALL getaddrinfo_thread(void *arg)
-{
-  struct thread_sync_data *tsd = (struct thread_sync_data*)arg;
-  struct thread_data *td = tsd->td;
-  char service[12];
-  int rc;
-
-  snprintf(service, sizeof(service), "%d", tsd->port);
+  job->hostname = strdup(hostname);
+  if(!job->hostname ||
+     !Curl_hash_add(&pool.jobs, job->key, job->keylen, job)) {
+    free_job(job);
+    return NULL;
+  }
 
-  rc = Curl_getaddrinfo_ex(tsd->hostname, service, &tsd->hints, &tsd->res);
+  if(pool.tail)
+    pool.tail->next = job;
+  else
+    pool.head = job;
+  pool.tail = job;
+  pool.queued++;
 
-  if(rc != 0) {
-    tsd->sock_error = SOCKERRNO?SOCKERRNO:rc;
-    if(tsd->sock_error == 0)
-      tsd->sock_error = RESOLVER_ENOMEM;
+  for(i = 0; i < RESOLVER_THREADS; i++) {
+    if(pool.busy[i])
+      running++;
   }
-  else {
-    Curl_addrinfo_set_port(tsd->res, tsd->port);
+  for(i = 0; (running < (int)pool.queued) && (i < RESOLVER_THREADS); i++) {
+    if(pool.busy[i])
+      continue;
+    if(pool.threads[i] != curl_thread_t_null)
+      /* it has taken its last job, let it go */
+      Curl_thread_join(&pool.threads[i]);
+    pool.busy[i] = 1;
+    pool.threads[i] = Curl_thread_create(resolver_thread, &pool.busy[i]);
+    if(!pool.threads[i]) {
+      pool.busy[i] = 0;
+#ifndef _WIN32_WCE
+      *err = errno;
+#endif
+      break;
+    }
+    running++;
   }
 
-  Curl_mutex_acquire(tsd->mtx);
-  if(tsd->done) {
-    /* too late, gotta clean up the mess */
-    Curl_mutex_release(tsd->mtx);
-    destroy_thread_sync_data(tsd);
-    free(td);
-  }
-  else {
-    tsd->done = 1;
-    Curl_mutex_release(tsd->mtx);
+  if(!running) {
+    /* no thread will ever take it */
+    unqueue_job(job);
+    return NULL;
   }
 
-  return 0;
+  return job;
 }
 
-#else /* HAVE_GETADDRINFO */
+/* Stop waiting for a job. Called with the pool locked. */
+static void release_job(struct resolve_job *job)
+{
+  if(--job->refs)
+    return;
+
+  if(job->state == JOB_QUEUED)
+    /* nobody wants it anymore */
+    unqueue_job(job);
+  else if(job->state == JOB_DONE)
+    free_job(job);
+  /* a running job is freed by its thread */
+}
 
-/*
- * gethostbyname_thread() resolves a name and then exits.
- */
-static unsigned int CURL_STDCALL gethostbyname_thread(void *arg)
+static int job_done(struct thread_data *td)
 {
-  struct thread_sync_data *tsd = (struct thread_sync_data *)arg;
-  struct thread_data *td = tsd->td;
+  int done;
 
-  tsd->res = Curl_ipv4_resolve_r(tsd->hostname, tsd->port);
+  Curl_mutex_acquire(&pool.mtx);
+  done = (td->job->state == JOB_DONE);
+  Curl_mutex_release(&pool.mtx);
 
-  if(!tsd->res) {
-    tsd->sock_error = SOCKERRNO;
-    if(tsd->sock_error == 0)
-      tsd->sock_error = RESOLVER_ENOMEM;
-  }
+  return done;
+}
 
-  Curl_mutex_acquire(tsd->mtx);
-  if(tsd->done) {
-    /* too late, gotta clean up the mess */
-    Curl_mutex_release(tsd->mtx);
-    destroy_thread_sync_data(tsd);
-    free(td);
-  }
-  else {
-    tsd->done = 1;
-    Curl_mutex_release(tsd->mtx);
+static int getaddrinfo_complete(struct connectdata *conn)
+{
+  struct thread_data *td = (struct thread_data *)conn->async.os_specific;
+  struct resolve_job *job = td->job;
+  Curl_addrinfo *res = NULL;
+  int status;
+
+  Curl_mutex_acquire(&pool.mtx);
+  status = job->sock_error;
+  Curl_mutex_release(&pool.mtx);
+
+  if(status == CURL_ASYNC_SUCCESS) {
+    /* another connection that waited for the same job may have stored the
+       result in the DNS cache we use already */
+    struct Curl_dns_entry *dns = Curl_fetch_addr(conn, conn->async.hostname,
+                                                 conn->async.port);
+    if(dns) {
+      conn->async.status = status;
+      conn->async.dns = dns;
+      conn->async.done = TRUE;
+      return CURLE_OK;
+    }
+
+    Curl_mutex_acquire(&pool.mtx);
+    if(job->refs == 1) {
+      /* the last one to wait for it gets the result itself */
+      res = job->res;
+      job->res = NULL;
+    }
+    else if(job->res)
+      res = Curl_addrinfo_dup(job->res);
+    Curl_mutex_release(&pool.mtx);
   }
 
-  return 0;
+  /* The result has been copied to async.dns and perhaps the DNS cache */
+  return Curl_addrinfo_callback(conn, status, res);
 }
 
-#endif /* HAVE_GETADDRINFO */
-
 /*
- * destroy_async_data() cleans up async resolver data and thread handle.
+ * destroy_async_data() cleans up async resolver data and stops waiting for
+ * the job.
  */
 static void destroy_async_data(struct Curl_async *async)
 {
   if(async->os_specific) {
     struct thread_data *td = (struct thread_data*) async->os_specific;
-    int done;
-
-    /*
-     * if the thread is still blocking in the resolve syscall, detach it and
-     * let the thread do the cleanup...
-     */
-    Curl_mutex_acquire(td->tsd.mtx);
-    done = td->tsd.done;
-    td->tsd.done = 1;
-    Curl_mutex_release(td->tsd.mtx);
-
-    if(!done) {
-      Curl_thread_destroy(td->thread_hnd);
-    }
-    else {
-      if(td->thread_hnd != curl_thread_t_null)
-        Curl_thread_join(&td->thread_hnd);
-
-      destroy_thread_sync_data(&td->tsd);
 
-      free(async->os_specific);
+    if(td->job) {
+      Curl_mutex_acquire(&pool.mtx);
+      release_job(td->job);
+      Curl_mutex_release(&pool.mtx);
     }
+
+    free(async->os_specific);
   }
   async->os_specific = NULL;
 
@@ -370,8 +497,54 @@ static void destroy_async_data(struct Curl_async *async)
 }
 
 /*
- * init_resolve_thread() starts a new thread that performs the actual
- * resolve. This function returns before the resolve is done.
+ * get_job() finds the job queued or in progress for the same name and kind
+ * of addresses, or queues a new one, and takes a reference to it.
+ *
+ * Returns the job or NULL with 'err' set.
+ */
+static struct resolve_job *get_job(struct connectdata *conn,
+                                   const char *hostname, int port,
+                                   const struct addrinfo *hints, int *err)
+{
+  char id_buf[HOSTCACHE_ID_SIZE];
+  char *id;
+  char *key;
+  struct resolve_job *job;
+
+  /* the DNS cache id and the kind of addresses to get */
+  id = Curl_hostcache_id(hostname, port, id_buf);
+  if(!id)
+    return NULL;
+#ifdef HAVE_GETADDRINFO
+  key = aprintf("%s/%d/%d", id, hints->ai_family, hints->ai_socktype);
+#else
+  key = strdup(id);
+#endif
+  if(id != id_buf)
+    free(id);
+  if(!key)
+    return NULL;
+
+  Curl_mutex_acquire(&pool.mtx);
+  job = Curl_hash_pick(&pool.jobs, key, strlen(key));
+  if(job) {
+    free(key);
+    infof(conn->data, "Waiting for a resolve of %s already in progress\n",
+          hostname);
+  }
+  else
+    job = queue_job(key, hostname, port, hints, err);
+  if(job)
+    job->refs++;
+  Curl_mutex_release(&pool.mtx);
+
+  return job;
+}
+
+/*
+ * init_resolve_thread() queues a resolve for the pool of resolver threads,
+ * or finds one for the same name already queued or in progress. This
+ * function returns before the resolve is done.
  *
  * Returns FALSE in case of failure, otherwise TRUE.
  */
@@ -390,28 +563,15 @@ static bool init_resolve_thread(struct connectdata *conn,
   conn->async.done = FALSE;
   conn->async.status = 0;
   conn->async.dns = NULL;
-  td->thread_hnd = curl_thread_t_null;
-
-  if(!init_thread_sync_data(td, hostname, port, hints))
-    goto err_exit;
 
   free(conn->async.hostname);
   conn->async.hostname = strdup(hostname);
   if(!conn->async.hostname)
     goto err_exit;
 
-#ifdef HAVE_GETADDRINFO
-  td->thread_hnd = Curl_thread_create(getaddrinfo_thread, &td->tsd);
-#else
-  td->thread_hnd = Curl_thread_create(gethostbyname_thread, &td->tsd);
-#endif
-
-  if(!td->thread_hnd) {
-#ifndef _WIN32_WCE
-    err = errno;
-#endif
+  td->job = get_job(conn, hostname, port, hints, &err);
+  if(!td->job)
     goto err_exit;
-  }
 
   return TRUE;
 
@@ -463,14 +623,17 @@ CURLcode Curl_resolver_wait_resolv(struct connectdata *conn,
 {
   struct thread_data   *td = (struct thread_data*) conn->async.os_specific;
   CURLcode result = CURLE_OK;
+  int wait_ms = 1;
 
   DEBUGASSERT(conn && td);
 
-  /* wait for the thread to resolve the name */
-  if(Curl_thread_join(&td->thread_hnd))
-    result = getaddrinfo_complete(conn);
-  else
-    DEBUGASSERT(0);
+  /* wait for a resolver thread to resolve the name */
+  while(!job_done(td)) {
+    Curl_wait_ms(wait_ms);
+    if(wait_ms < 64)
+      wait_ms *= 2;
+  }
+  result = getaddrinfo_complete(conn);
 
   conn->async.done = TRUE;
 
@@ -499,7 +662,6 @@ CURLcode Curl_resolver_is_resolved(struct connectdata *conn,
 {
   struct Curl_easy *data = conn->data;
   struct thread_data   *td = (struct thread_data*) conn->async.os_specific;
-  int done = 0;
 
   *entry = NULL;
 
@@ -508,11 +670,7 @@ CURLcode Curl_resolver_is_resolved(struct connectdata *conn,
     return CURLE_COULDNT_RESOLVE_HOST;
   }
 
-  Curl_mutex_acquire(td->tsd.mtx);
-  done = td->tsd.done;
-  Curl_mutex_release(td->tsd.mtx);
-
-  if(done) {
+  if(job_done(td)) {
     getaddrinfo_complete(conn);
 
     if(!conn->async.dns) {
@@ -585,6 +743,37 @@ Curl_addrinfo *Curl_resolver_getaddrinfo(struct connectdata *conn,
 
 #else /* !HAVE_GETADDRINFO */
 
+/* the hints for resolving a name for this connection */
+static void init_hints(struct connectdata *conn, struct addrinfo *hints)
+{
+  int pf = PF_INET;
+
+#ifdef CURLRES_IPV6
+  /*
+   * Check if a limited name resolve has been requested.
+   */
+  switch(conn->ip_version) {
+  case CURL_IPRESOLVE_V4:
+    pf = PF_INET;
+    break;
+  case CURL_IPRESOLVE_V6:
+    pf = PF_INET6;
+    break;
+  default:
+    pf = PF_UNSPEC;
+    break;
+  }
+
+  if((pf != PF_INET) && !Curl_ipv6works())
+    /* The stack seems to be a non-IPv6 one */
+    pf = PF_INET;
+#endif /* CURLRES_IPV6 */
+
+  memset(hints, 0, sizeof(*hints));
+  hints->ai_family = pf;
+  hints->ai_socktype = conn->socktype;
+}
+
 /*
  * Curl_resolver_getaddrinfo() - for getaddrinfo
  */
@@ -598,7 +787,6 @@ Curl_addrinfo *Curl_resolver_getaddrinfo(struct connectdata *conn,
   Curl_addrinfo *res;
   int error;
   char sbuf[12];
-  int pf = PF_INET;
 #ifdef CURLRES_IPV6
   struct in6_addr in6;
 #endif /* CURLRES_IPV6 */
@@ -619,30 +807,7 @@ Curl_addrinfo *Curl_resolver_getaddrinfo(struct connectdata *conn,
 #endif /* CURLRES_IPV6 */
 #endif /* !USE_RESOLVE_ON_IPS */
 
-#ifdef CURLRES_IPV6
-  /*
-   * Check if a limited name resolve has been requested.
-   */
-  switch(conn->ip_version) {
-  case CURL_IPRESOLVE_V4:
-    pf = PF_INET;
-    break;
-  case CURL_IPRESOLVE_V6:
-    pf = PF_INET6;
-    break;
-  default:
-    pf = PF_UNSPEC;
-    break;
-  }
-
-  if((pf != PF_INET) && !Curl_ipv6works())
-    /* The stack seems to be a non-IPv6 one */
-    pf = PF_INET;
-#endif /* CURLRES_IPV6 */
-
-  memset(&hints, 0, sizeof(hints));
-  hints.ai_family = pf;
-  hints.ai_socktype = conn->socktype;
+  init_hints(conn, &hints);
 
   snprintf(sbuf, sizeof(sbuf), "%d", port);
 
@@ -671,6 +836,56 @@ Curl_addrinfo *Curl_resolver_getaddrinfo(struct connectdata *conn,
 
 #endif /* !HAVE_GETADDRINFO */
 
+/*
+ * Curl_resolver_refresh() resolves a name again for the DNS cache, with no
+ * transfer waiting for it. The handle returned is the job.
+ */
+void *Curl_resolver_refresh(struct connectdata *conn, const char *hostname,
+                            int port)
+{
+  int err = RESOLVER_ENOMEM;
+#ifdef HAVE_GETADDRINFO
+  struct addrinfo hints;
+
+  init_hints(conn, &hints);
+  return get_job(conn, hostname, port, &hints, &err);
+#else
+  return get_job(conn, hostname, port, NULL, &err);
+#endif
+}
+
+int Curl_resolver_refresh_done(void *refresh, Curl_addrinfo **addr)
+{
+  struct resolve_job *job = (struct resolve_job *)refresh;
+  int done;
+
+  *addr = NULL;
+
+  Curl_mutex_acquire(&pool.mtx);
+  done = (job->state == JOB_DONE);
+  if(done) {
+    if(job->sock_error == CURL_ASYNC_SUCCESS) {
+      if(job->refs == 1) {
+        *addr = job->res;
+        job->res = NULL;
+      }
+      else if(job->res)
+        *addr = Curl_addrinfo_dup(job->res);
+    }
+    release_job(job);
+  }
+  Curl_mutex_release(&pool.mtx);
+
+  return done;
+}
+
+void Curl_resolver_refresh_cancel(void *refresh)
+{
+  Curl_mutex_acquire(&pool.mtx);
+  release_job((struct resolve_job *)refresh);
+  Curl_mutex_release(&pool.mtx);
+}
+
 CURLcode Curl_set_dns_servers(struct Curl_easy *data,
                               char *servers)
 {
@@ -144,6 +144,39 @@ Curl_addrinfo *Curl_resolver_getaddrinfo(struct connectdata *conn,
                                          int port,
                                          int *waitp);
 
+/*
+ * Curl_resolver_refresh()
+ *
+ * Starts resolving a name in the background, for the DNS cache, with no
+ * transfer waiting for it. Returns a handle for the resolve, or NULL if it
+ * could not be started.
+ */
+void *Curl_resolver_refresh(struct connectdata *conn, const char *hostname,
+                            int port);
+
+/*
+ * Curl_resolver_refresh_done()
+ *
+ * Returns non-zero when a resolve started with Curl_resolver_refresh() is
+ * done, and the handle is gone. Then '*addr' is the result, to be freed by
+ * the caller, or NULL if the resolve failed.
+ */
+int Curl_resolver_refresh_done(void *refresh, Curl_addrinfo **addr);
+
+/*
+ * Curl_resolver_refresh_cancel()
+ *
+ * Stops waiting for a resolve started with Curl_resolver_refresh().
+ */
+void Curl_resolver_refresh_cancel(void *refresh);
+
+#ifndef CURLRES_THREADED
+/* only the threaded resolver refreshes names in the background */
+#define Curl_resolver_refresh(x,y,z) ((void)(y), (void)(z), NULL)
+#define Curl_resolver_refresh_done(x,y) ((void)(x), *(y) = NULL, 1)
+#define Curl_resolver_refresh_cancel(x) Curl_nop_stmt
+#endif
+
 #ifndef CURLRES_ASYNCH
 /* convert these functions if an asynch resolver isn't used */
 #define Curl_resolver_cancel(x) Curl_nop_stmt
@@ -56,11 +56,7 @@ static CURLcode bundle_create(struct Curl_easy *data,
   (*cb_ptr)->num_connections = 0;
   (*cb_ptr)->multiuse = BUNDLE_UNKNOWN;
 
-  (*cb_ptr)->conn_list = Curl_llist_alloc((curl_llist_dtor) conn_llist_dtor);
-  if(!(*cb_ptr)->conn_list) {
-    Curl_safefree(*cb_ptr);
-    return CURLE_OUT_OF_MEMORY;
-  }
+  Curl_llist_init(&(*cb_ptr)->conn_list, (curl_llist_dtor) conn_llist_dtor);
   return CURLE_OK;
 }
 
@@ -69,10 +65,7 @@ static void bundle_destroy(struct connectbundle *cb_ptr)
   if(!cb_ptr)
     return;
 
-  if(cb_ptr->conn_list) {
-    Curl_llist_destroy(cb_ptr->conn_list, NULL);
-    cb_ptr->conn_list = NULL;
-  }
+  Curl_llist_destroy(&cb_ptr->conn_list, NULL);
   free(cb_ptr);
 }
 
@@ -80,9 +73,8 @@ static void bundle_destroy(struct connectbundle *cb_ptr)
 static CURLcode bundle_add_conn(struct connectbundle *cb_ptr,
                               struct connectdata *conn)
 {
-  if(!Curl_llist_insert_next(cb_ptr->conn_list, cb_ptr->conn_list->tail, conn))
-    return CURLE_OUT_OF_MEMORY;
-
+  Curl_llist_insert_next(&cb_ptr->conn_list, cb_ptr->conn_list.tail, conn,
+                         &conn->bundle_node);
   conn->bundle = cb_ptr;
 
   cb_ptr->num_connections++;
@@ -93,19 +85,14 @@ static CURLcode bundle_add_conn(struct connectbundle *cb_ptr,
 static int bundle_remove_conn(struct connectbundle *cb_ptr,
                               struct connectdata *conn)
 {
-  struct curl_llist_element *curr;
-
-  curr = cb_ptr->conn_list->head;
-  while(curr) {
-    if(curr->ptr == conn) {
-      Curl_llist_remove(cb_ptr->conn_list, curr, NULL);
-      cb_ptr->num_connections--;
-      conn->bundle = NULL;
-      return 1; /* we removed a handle */
-    }
-    curr = curr->next;
-  }
-  return 0;
+  if(conn->bundle != cb_ptr)
+    return 0;
+
+  /* the connection's own list element is the one in the bundle */
+  Curl_llist_remove(&cb_ptr->conn_list, &conn->bundle_node, NULL);
+  cb_ptr->num_connections--;
+  conn->bundle = NULL;
+  return 1; /* we removed a handle */
 }
 
 static void free_bundle_hash_entry(void *freethis)
@@ -127,10 +114,20 @@ void Curl_conncache_destroy(struct conncache *connc)
     Curl_hash_destroy(&connc->hash);
 }
 
-/* returns an allocated key to find a bundle for this connection */
-static char *hashkey(struct connectdata *conn)
+/* The key to find a bundle is "hostname:port". It is built in a buffer on
+   the stack of this size, or allocated if the host name is too long. */
+#define HASHKEY_SIZE 128
+
+/* the colon, the longest port number and the zero */
+#define HASHKEY_EXTRA 23
+
+/* Returns the key to find a bundle for this connection, in 'buf' or
+   allocated, and its hash value. Returns NULL on out of memory. */
+static char *hashkey(struct connectdata *conn, struct conncache *connc,
+                     char *buf, size_t *hash)
 {
   const char *hostname;
+  char *key = buf;
 
   if(conn->bits.socksproxy)
     hostname = conn->socks_proxy.host.name;
@@ -141,7 +138,22 @@ static char *hashkey(struct connectdata *conn)
   else
     hostname = conn->host.name;
 
-  return aprintf("%s:%ld", hostname, conn->port);
+  if(strlen(hostname) + HASHKEY_EXTRA > HASHKEY_SIZE) {
+    key = aprintf("%s:%ld", hostname, conn->port);
+    if(!key)
+      return NULL;
+  }
+  else
+    snprintf(buf, HASHKEY_SIZE, "%s:%ld", hostname, conn->port);
+
+  /* the host and port are set before the connection is first looked up and
+     do not change after that */
+  if(!conn->bundle_hashed) {
+    conn->bundle_hash = Curl_hash_key(&connc->hash, key, strlen(key));
+    conn->bundle_hashed = TRUE;
+  }
+  *hash = conn->bundle_hash;
+  return key;
 }
 
 /* Look up the bundle with all the connections to the same host this
@@ -151,42 +163,54 @@ struct connectbundle *Curl_conncache_find_bundle(struct connectdata *conn,
 {
   struct connectbundle *bundle = NULL;
   if(connc) {
-    char *key = hashkey(conn);
+    char buf[HASHKEY_SIZE];
+    size_t hash;
+    char *key = hashkey(conn, connc, buf, &hash);
     if(key) {
-      bundle = Curl_hash_pick(&connc->hash, key, strlen(key));
-      free(key);
+      bundle = Curl_hash_pick_hashed(&connc->hash, key, strlen(key), hash);
+      if(key != buf)
+        free(key);
     }
   }
 
   return bundle;
 }
 
-static bool conncache_add_bundle(struct conncache *connc,
-                                 char *key,
-                                 struct connectbundle *bundle)
-{
-  void *p = Curl_hash_add(&connc->hash, key, strlen(key), bundle);
-
-  return p?TRUE:FALSE;
-}
-
 static void conncache_remove_bundle(struct conncache *connc,
+                                    struct connectdata *conn,
                                     struct connectbundle *bundle)
 {
   struct curl_hash_iterator iter;
   struct curl_hash_element *he;
+  char buf[HASHKEY_SIZE];
+  size_t hash;
+  char *key;
 
   if(!connc)
     return;
 
+  key = hashkey(conn, connc, buf, &hash);
+  if(key) {
+    size_t len = strlen(key);
+    int found = (Curl_hash_pick_hashed(&connc->hash, key, len, hash) ==
+                 bundle);
+    /* The bundle is destroyed by the hash destructor function,
+       free_bundle_hash_entry() */
+    if(found)
+      Curl_hash_delete_hashed(&connc->hash, key, len, hash);
+    if(key != buf)
+      free(key);
+    if(found)
+      return;
+  }
+
+  /* not found by its key, look through them all */
   Curl_hash_start_iterate(&connc->hash, &iter);
 
   he = Curl_hash_next_element(&iter);
   while(he) {
     if(he->ptr == bundle) {
-      /* The bundle is destroyed by the hash destructor function,
-         free_bundle_hash_entry() */
-      Curl_hash_delete(&connc->hash, he->key, he->key_len);
+      Curl_hash_delete_hashed(&connc->hash, he->key, he->key_len, he->hash);
       return;
     }
 
@@ -204,22 +228,26 @@ CURLcode Curl_conncache_add_conn(struct conncache *connc,
 
   bundle = Curl_conncache_find_bundle(conn, data->state.conn_cache);
   if(!bundle) {
+    char buf[HASHKEY_SIZE];
+    size_t hash;
     char *key;
-    int rc;
+    void *p;
 
     result = bundle_create(data, &new_bundle);
     if(result)
       return result;
 
-    key = hashkey(conn);
+    key = hashkey(conn, data->state.conn_cache, buf, &hash);
     if(!key) {
       bundle_destroy(new_bundle);
       return CURLE_OUT_OF_MEMORY;
     }
 
-    rc = conncache_add_bundle(data->state.conn_cache, key, new_bundle);
-    free(key);
-    if(!rc) {
+    p = Curl_hash_add_hashed(&data->state.conn_cache->hash, key, strlen(key),
+                             hash, new_bundle);
+    if(key != buf)
+      free(key);
+    if(!p) {
       bundle_destroy(new_bundle);
       return CURLE_OUT_OF_MEMORY;
     }
@@ -229,7 +257,7 @@ CURLcode Curl_conncache_add_conn(struct conncache *connc,
   result = bundle_add_conn(bundle, conn);
   if(result) {
     if(new_bundle)
-      conncache_remove_bundle(data->state.conn_cache, new_bundle);
+      conncache_remove_bundle(data->state.conn_cache, conn, new_bundle);
     return result;
   }
 
@@ -253,7 +281,7 @@ void Curl_conncache_remove_conn(struct conncache *connc,
   if(bundle) {
     bundle_remove_conn(bundle, conn);
     if(bundle->num_connections == 0) {
-      conncache_remove_bundle(connc, bundle);
+      conncache_remove_bundle(connc, conn, bundle);
     }
 
     if(connc) {
@@ -292,7 +320,7 @@ void Curl_conncache_foreach(struct conncache *connc,
     bundle = he->ptr;
     he = Curl_hash_next_element(&iter);
 
-    curr = bundle->conn_list->head;
+    curr = bundle->conn_list.head;
     while(curr) {
       /* Yes, we need to update curr before calling func(), because func()
          might decide to remove the connection */
@@ -321,7 +349,7 @@ Curl_conncache_find_first_connection(struct conncache *connc)
     struct curl_llist_element *curr;
     bundle = he->ptr;
 
-    curr = bundle->conn_list->head;
+    curr = bundle->conn_list.head;
     if(curr) {
       return curr->ptr;
     }
@@ -356,7 +384,7 @@ void Curl_conncache_print(struct conncache *connc)
     bundle = he->ptr;
 
     fprintf(stderr, "%s -", he->key);
-    curr = bundle->conn_list->head;
+    curr = bundle->conn_list.head;
     while(curr) {
       conn = curr->ptr;
 
@@ -5,7 +5,7 @@
  *                            | (__| |_| |  _ <| |___
  *                             \___|\___/|_| \_\_____|
  *
- * Copyright (C) 1998 - 2016, Daniel Stenberg, <daniel@haxx.se>, et al.
+ * Copyright (C) 1998 - 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
  *
  * This software is licensed as described in the file COPYING, which
  * you should have received as part of this distribution. The terms
@@ -28,6 +28,7 @@
 #include <curl/curl.h>
 #include "sendf.h"
 #include "content_encoding.h"
+#include "multiif.h"
 #include "strdup.h"
 #include "curl_memory.h"
 #include "memdebug.h"
@@ -37,6 +38,7 @@
 #define OLD_ZLIB_SUPPORT 1
 
 #define DSIZ CURL_MAX_WRITE_SIZE /* buffer size for decompressed data */
+#define DSIZ_MAX 0x40000000 /* most of an application buffer used at once */
 
 #define GZIP_MAGIC_0 0x1f
 #define GZIP_MAGIC_1 0x8b
@@ -79,86 +81,133 @@ process_zlib_error(struct connectdata *conn, z_stream *z)
 }
 
 static CURLcode
-exit_zlib(z_stream *z, zlibInitState *zlib_init, CURLcode result)
+exit_zlib(zlibInitState *zlib_init, CURLcode result)
 {
-  inflateEnd(z);
+  /* the stream itself is kept in the handle and reset for the next
+     response */
   *zlib_init = ZLIB_UNINIT;
   return result;
 }
 
+/*
+ * Get the zlib stream of the handle ready to inflate a new response. A stream
+ * left from an earlier response is reset and used again if it was initialized
+ * with the same window bits.
+ */
+static CURLcode
+init_zlib(struct connectdata *conn, int wbits)
+{
+  struct Curl_easy *data = conn->data;
+  z_stream *z = &data->state.z;
+
+  if(data->state.zlib_wbits == wbits && inflateReset(z) == Z_OK)
+    return CURLE_OK;
+
+  if(data->state.zlib_wbits) {
+    (void) inflateEnd(z);
+    data->state.zlib_wbits = 0;
+  }
+
+  memset(z, 0, sizeof(z_stream));
+  z->zalloc = (alloc_func)zalloc_cb;
+  z->zfree = (free_func)zfree_cb;
+
+  if(inflateInit2(z, wbits) != Z_OK)
+    return process_zlib_error(conn, z);
+
+  data->state.zlib_wbits = wbits;
+  return CURLE_OK;
+}
+
+/*
+ * Get the memory to put decompressed data in: what the write buffer callback
+ * gives, or else the buffer of the handle.
+ */
+static char *
+decomp_buffer(struct Curl_easy *data, uInt *size)
+{
+  if(data->set.fwritebuffer && !data->req.ignorebody) {
+    size_t len = 0;
+    char *buf = data->set.fwritebuffer(&len, data->set.writebuffer_data);
+    if(buf && len) {
+      *size = (len > DSIZ_MAX) ? DSIZ_MAX : (uInt)len;
+      return buf;
+    }
+  }
+
+  if(!data->state.unencode_buf) {
+    /* a pooled transfer buffer, given back when the transfer is over */
+    data->state.unencode_buf = Curl_multi_getbuf(data);
+    if(!data->state.unencode_buf)
+      return NULL;
+  }
+  *size = DSIZ;
+  return data->state.unencode_buf;
+}
+
 static CURLcode
 inflate_stream(struct connectdata *conn,
                struct SingleRequest *k)
 {
   int allow_restart = 1;
-  z_stream *z = &k->z;          /* zlib state structure */
+  z_stream *z = &conn->data->state.z; /* zlib state structure */
   uInt nread = z->avail_in;
   Bytef *orig_in = z->next_in;
   int status;                   /* zlib status */
   CURLcode result = CURLE_OK;   /* Curl_client_write status */
   char *decomp;                 /* Put the decompressed data here. */
+  uInt size;                    /* room in 'decomp' */
 
-  /* Dynamically allocate a buffer for decompression because it's uncommonly
-     large to hold on the stack */
-  decomp = malloc(DSIZ);
-  if(decomp == NULL) {
-    return exit_zlib(z, &k->zlib_init, CURLE_OUT_OF_MEMORY);
-  }
-
-  /* because the buffer size is fixed, iteratively decompress and transfer to
-     the client via client_write. */
+  /* because the buffer size is limited, iteratively decompress and transfer
+     to the client via client_write. */
   for(;;) {
     /* (re)set buffer for decompressed output for every iteration */
+    decomp = decomp_buffer(conn->data, &size);
+    if(!decomp)
+      return exit_zlib(&k->zlib_init, CURLE_OUT_OF_MEMORY);
     z->next_out = (Bytef *)decomp;
-    z->avail_out = DSIZ;
+    z->avail_out = size;
 
     status = inflate(z, Z_SYNC_FLUSH);
     if(status == Z_OK || status == Z_STREAM_END) {
       allow_restart = 0;
-      if((DSIZ - z->avail_out) && (!k->ignorebody)) {
+      if((size - z->avail_out) && (!k->ignorebody)) {
         result = Curl_client_write(conn, CLIENTWRITE_BODY, decomp,
-                                   DSIZ - z->avail_out);
+                                   size - z->avail_out);
         /* if !CURLE_OK, clean up, return */
-        if(result) {
-          free(decomp);
-          return exit_zlib(z, &k->zlib_init, result);
-        }
+        if(result)
+          return exit_zlib(&k->zlib_init, result);
       }
 
       /* Done? clean up, return */
-      if(status == Z_STREAM_END) {
-        free(decomp);
-        if(inflateEnd(z) == Z_OK)
-          return exit_zlib(z, &k->zlib_init, result);
-        else
-          return exit_zlib(z, &k->zlib_init, process_zlib_error(conn, z));
-      }
+      if(status == Z_STREAM_END)
+        return exit_zlib(&k->zlib_init, result);
 
-      /* Done with these bytes, exit */
+      /* Done with these bytes, exit. With the output buffer filled up there
+         may be more output pending although all input is used. */
 
       /* status is always Z_OK at this point! */
-      if(z->avail_in == 0) {
-        free(decomp);
+      if(z->avail_in == 0 && z->avail_out)
         return result;
-      }
     }
+    else if(status == Z_BUF_ERROR && z->avail_in == 0)
+      /* the output buffer was filled up last time, but nothing more was
+         pending */
+      return result;
     else if(allow_restart && status == Z_DATA_ERROR) {
       /* some servers seem to not generate zlib headers, so this is an attempt
          to fix and continue anyway */
 
-      (void) inflateEnd(z);     /* don't care about the return code */
-      if(inflateInit2(z, -MAX_WBITS) != Z_OK) {
-        free(decomp);
-        return exit_zlib(z, &k->zlib_init, process_zlib_error(conn, z));
-      }
+      result = init_zlib(conn, -MAX_WBITS);
+      if(result)
+        return exit_zlib(&k->zlib_init, result);
       z->next_in = orig_in;
       z->avail_in = nread;
       allow_restart = 0;
       continue;
     }
     else {                      /* Error; exit loop, handle below */
-      free(decomp);
-      return exit_zlib(z, &k->zlib_init, process_zlib_error(conn, z));
+      return exit_zlib(&k->zlib_init, process_zlib_error(conn, z));
     }
   }
   /* Will never get here */
@@ -169,16 +218,13 @@ Curl_unencode_deflate_write(struct connectdata *conn,
                             struct SingleRequest *k,
                             ssize_t nread)
 {
-  z_stream *z = &k->z;          /* zlib state structure */
+  z_stream *z = &conn->data->state.z; /* zlib state structure */
 
   /* Initialize zlib? */
   if(k->zlib_init == ZLIB_UNINIT) {
-    memset(z, 0, sizeof(z_stream));
-    z->zalloc = (alloc_func)zalloc_cb;
-    z->zfree = (free_func)zfree_cb;
-
-    if(inflateInit(z) != Z_OK)
-      return process_zlib_error(conn, z);
+    CURLcode result = init_zlib(conn, MAX_WBITS);
+    if(result)
+      return result;
     k->zlib_init = ZLIB_INIT;
   }
 
@@ -279,26 +325,24 @@ Curl_unencode_gzip_write(struct connectdata *conn,
                          struct SingleRequest *k,
                          ssize_t nread)
 {
-  z_stream *z = &k->z;          /* zlib state structure */
+  z_stream *z = &conn->data->state.z; /* zlib state structure */
 
   /* Initialize zlib? */
   if(k->zlib_init == ZLIB_UNINIT) {
-    memset(z, 0, sizeof(z_stream));
-    z->zalloc = (alloc_func)zalloc_cb;
-    z->zfree = (free_func)zfree_cb;
+    CURLcode result;
 
     if(strcmp(zlibVersion(), "1.2.0.4") >= 0) {
       /* zlib ver. >= 1.2.0.4 supports transparent gzip decompressing */
-      if(inflateInit2(z, MAX_WBITS+32) != Z_OK) {
-        return process_zlib_error(conn, z);
-      }
+      result = init_zlib(conn, MAX_WBITS+32);
+      if(result)
+        return result;
       k->zlib_init = ZLIB_INIT_GZIP; /* Transparent gzip decompress state */
     }
     else {
       /* we must parse the gzip header ourselves */
-      if(inflateInit2(z, -MAX_WBITS) != Z_OK) {
-        return process_zlib_error(conn, z);
-      }
+      result = init_zlib(conn, -MAX_WBITS);
+      if(result)
+        return result;
       k->zlib_init = ZLIB_INIT;   /* Initial call state */
     }
   }
@@ -314,7 +358,7 @@ Curl_unencode_gzip_write(struct connectdata *conn,
 #ifndef OLD_ZLIB_SUPPORT
   /* Support for old zlib versions is compiled away and we are running with
      an old version, so return an error. */
-  return exit_zlib(z, &k->zlib_init, CURLE_WRITE_ERROR);
+  return exit_zlib(&k->zlib_init, CURLE_WRITE_ERROR);
 
 #else
   /* This next mess is to get around the potential case where there isn't
@@ -352,7 +396,7 @@ Curl_unencode_gzip_write(struct connectdata *conn,
       z->avail_in = (uInt)nread;
       z->next_in = malloc(z->avail_in);
       if(z->next_in == NULL) {
-        return exit_zlib(z, &k->zlib_init, CURLE_OUT_OF_MEMORY);
+        return exit_zlib(&k->zlib_init, CURLE_OUT_OF_MEMORY);
       }
       memcpy(z->next_in, k->str, z->avail_in);
       k->zlib_init = ZLIB_GZIP_HEADER;   /* Need more gzip header data state */
@@ -361,7 +405,7 @@ Curl_unencode_gzip_write(struct connectdata *conn,
 
     case GZIP_BAD:
     default:
-      return exit_zlib(z, &k->zlib_init, process_zlib_error(conn, z));
+      return exit_zlib(&k->zlib_init, process_zlib_error(conn, z));
     }
 
   }
@@ -374,7 +418,7 @@ Curl_unencode_gzip_write(struct connectdata *conn,
     z->avail_in += (uInt)nread;
     z->next_in = Curl_saferealloc(z->next_in, z->avail_in);
     if(z->next_in == NULL) {
-      return exit_zlib(z, &k->zlib_init, CURLE_OUT_OF_MEMORY);
+      return exit_zlib(&k->zlib_init, CURLE_OUT_OF_MEMORY);
     }
     /* Append the new block of data to the previous one */
     memcpy(z->next_in + z->avail_in - nread, k->str, nread);
@@ -396,7 +440,7 @@ Curl_unencode_gzip_write(struct connectdata *conn,
     case GZIP_BAD:
     default:
       free(z->next_in);
-      return exit_zlib(z, &k->zlib_init, process_zlib_error(conn, z));
+      return exit_zlib(&k->zlib_init, process_zlib_error(conn, z));
     }
 
   }
@@ -424,9 +468,17 @@ void Curl_unencode_cleanup(struct connectdata *conn)
 {
   struct Curl_easy *data = conn->data;
   struct SingleRequest *k = &data->req;
-  z_stream *z = &k->z;
   if(k->zlib_init != ZLIB_UNINIT)
-    (void) exit_zlib(z, &k->zlib_init, CURLE_OK);
+    (void) exit_zlib(&k->zlib_init, CURLE_OK);
+}
+
+void Curl_unencode_close(struct Curl_easy *data)
+{
+  if(data->state.zlib_wbits) {
+    (void) inflateEnd(&data->state.z);
+    data->state.zlib_wbits = 0;
+  }
+  Curl_safefree(data->state.unencode_buf);
 }
 
 #endif /* HAVE_LIBZ */
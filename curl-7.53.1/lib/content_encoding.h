@@ -7,7 +7,7 @@
  *                            | (__| |_| |  _ <| |___
  *                             \___|\___/|_| \_\_____|
  *
- * Copyright (C) 1998 - 2011, Daniel Stenberg, <daniel@haxx.se>, et al.
+ * Copyright (C) 1998 - 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
  *
  * This software is licensed as described in the file COPYING, which
  * you should have received as part of this distribution. The terms
@@ -30,9 +30,12 @@
 #define ALL_CONTENT_ENCODINGS "deflate, gzip"
 /* force a cleanup */
 void Curl_unencode_cleanup(struct connectdata *conn);
+/* free the decoding state kept in the handle */
+void Curl_unencode_close(struct Curl_easy *data);
 #else
 #define ALL_CONTENT_ENCODINGS "identity"
 #define Curl_unencode_cleanup(x) Curl_nop_stmt
+#define Curl_unencode_close(x) Curl_nop_stmt
 #endif
 
 CURLcode Curl_unencode_deflate_write(struct connectdata *conn,
@@ -142,6 +142,56 @@ static bool tailmatch(const char *cooke_domain, const char *hostname)
   return FALSE;
 }
 
+/*
+ * Returns a pointer to the last 'labels' labels of a domain name, or the
+ * whole name if it has no more labels than that.
+ */
+static const char *label_tail(const char *name, int labels)
+{
+  const char *p = name + strlen(name);
+
+  while(p > name) {
+    if(('.' == p[-1]) && !--labels)
+      break;
+    p--;
+  }
+  return p;
+}
+
+/*
+ * The slot in the jar for the cookies of a domain. It only depends on the
+ * last two labels of the domain, so a cookie is found in the slot of every
+ * host name it tail-matches. The exception is a domain with only one label,
+ * which Curl_cookie_getlist() takes care of. Cookies without a domain get a
+ * slot of their own.
+ */
+static size_t cookiehash(const char *domain)
+{
+  size_t h = 5381;
+
+  if(!domain)
+    return COOKIE_HASH_SIZE;
+
+  for(domain = label_tail(domain, 2); *domain; domain++)
+    h = (h << 5) + h + (unsigned char)Curl_raw_toupper(*domain);
+
+  return h % COOKIE_HASH_SIZE;
+}
+
+/*
+ * Adds a cookie to its slot, after the cookies with a longer path.
+ */
+static void cookie_link(struct CookieInfo *c, struct Cookie *co)
+{
+  struct Cookie **nextp = &c->cookies[cookiehash(co->domain)];
+  size_t len = co->path ? strlen(co->path) : 0;
+
+  while(*nextp && (((*nextp)->path ? strlen((*nextp)->path) : 0) >= len))
+    nextp = &(*nextp)->next;
+  co->next = *nextp;
+  *nextp = co;
+}
+
 /*
  * matching cookie path and url path
  * RFC6265 5.1.4 Paths and Path-Match
@@ -303,26 +353,37 @@ static void remove_expired(struct CookieInfo *cookies)
 {
   struct Cookie *co, *nx, *pv;
   curl_off_t now = (curl_off_t)time(NULL);
+  curl_off_t next = CURL_OFF_T_MAX;
+  size_t i;
 
-  co = cookies->cookies;
-  pv = NULL;
-  while(co) {
-    nx = co->next;
-    if(co->expires && co->expires < now) {
-      if(co == cookies->cookies) {
-        cookies->cookies = co->next;
+  /* no need to look through the jar while nothing has expired */
+  if(cookies->next_expiration && (cookies->next_expiration >= now))
+    return;
+
+  for(i = 0; i <= COOKIE_HASH_SIZE; i++) {
+    co = cookies->cookies[i];
+    pv = NULL;
+    while(co) {
+      nx = co->next;
+      if(co->expires && co->expires < now) {
+        if(co == cookies->cookies[i]) {
+          cookies->cookies[i] = co->next;
+        }
+        else {
+          pv->next = co->next;
+        }
+        cookies->numcookies--;
+        freecookie(co);
       }
       else {
-        pv->next = co->next;
+        if(co->expires && (co->expires < next))
+          next = co->expires;
+        pv = co;
       }
-      cookies->numcookies--;
-      freecookie(co);
+      co = nx;
     }
-    else {
-      pv = co;
-    }
-    co = nx;
   }
+  cookies->next_expiration = next;
 }
 
 /*
@@ -375,9 +436,9 @@ Curl_cookie_add(struct Curl_easy *data,
                                        unless set */
 {
   struct Cookie *clist;
+  struct Cookie **clistp;
   char name[MAX_NAME];
   struct Cookie *co;
-  struct Cookie *lastc=NULL;
   time_t now = time(NULL);
   bool replace_old = FALSE;
   bool badcookie = FALSE; /* cookies are good by default. mmmmm yummy */
@@ -818,9 +879,11 @@ Curl_cookie_add(struct Curl_easy *data,
   }
 #endif
 
-  clist = c->cookies;
+  /* a cookie it replaces has the same domain and is in the same slot */
+  clistp = &c->cookies[cookiehash(co->domain)];
   replace_old = FALSE;
-  while(clist) {
+  while(*clistp) {
+    clist = *clistp;
     if(strcasecompare(clist->name, co->name)) {
       /* the names are identical */
 
@@ -861,35 +924,10 @@ Curl_cookie_add(struct Curl_easy *data,
         return NULL;
       }
 
-      if(replace_old) {
-        co->next = clist->next; /* get the next-pointer first */
-
-        /* then free all the old pointers */
-        free(clist->name);
-        free(clist->value);
-        free(clist->domain);
-        free(clist->path);
-        free(clist->spath);
-        free(clist->expirestr);
-        free(clist->version);
-        free(clist->maxage);
-
-        *clist = *co;  /* then store all the new data */
-
-        free(co);   /* free the newly alloced memory */
-        co = clist; /* point to the previous struct instead */
-
-        /* We have replaced a cookie, now skip the rest of the list but
-           make sure the 'lastc' pointer is properly set */
-        do {
-          lastc = clist;
-          clist = clist->next;
-        } while(clist);
+      if(replace_old)
         break;
-      }
     }
-    lastc = clist;
-    clist = clist->next;
+    clistp = &clist->next;
   }
 
   if(c->running)
@@ -899,14 +937,21 @@ Curl_cookie_add(struct Curl_easy *data,
           replace_old?"Replaced":"Added", co->name, co->value,
           co->domain, co->path, co->expires);
 
-  if(!replace_old) {
-    /* then make the last item point on this new one */
-    if(lastc)
-      lastc->next = co;
-    else
-      c->cookies = co;
+  if(replace_old) {
+    /* the new cookie takes the place of the old one in the order of the
+       jar, and maybe a new place in the slot if the path changed */
+    co->creationtime = clist->creationtime;
+    *clistp = clist->next;
+    freecookie(clist);
+  }
+  else {
+    co->creationtime = ++c->lastct;
     c->numcookies++; /* one more cookie in the jar */
   }
+  cookie_link(c, co);
+
+  if(co->expires && (co->expires < c->next_expiration))
+    c->next_expiration = co->expires;
 
   return co;
 }
@@ -1054,13 +1099,57 @@ static int cookie_sort(const void *p1, const void *p2)
     return (l2 > l1) ? 1 : -1 ;  /* avoid size_t <=> int conversions */
 
   /* 3 - compare cookie names */
-  if(c1->name && c2->name)
-    return strcmp(c1->name, c2->name);
+  if(c1->name && c2->name) {
+    int rc = strcmp(c1->name, c2->name);
+    if(rc)
+      return rc;
+  }
+
+  /* 4 - the cookie added last goes first */
+  if(c1->creationtime != c2->creationtime)
+    return (c2->creationtime > c1->creationtime) ? 1 : -1;
 
-  /* sorry, can't be more deterministic */
   return 0;
 }
 
+/* sort the cookies in the order they were added to the jar */
+static int cookie_sort_ct(const void *p1, const void *p2)
+{
+  struct Cookie *c1 = *(struct Cookie **)p1;
+  struct Cookie *c2 = *(struct Cookie **)p2;
+
+  if(c1->creationtime == c2->creationtime)
+    return 0;
+
+  return (c2->creationtime > c1->creationtime) ? -1 : 1;
+}
+
+/*
+ * Returns an array of the cookies in the jar that have a domain, in the order
+ * they were added, or NULL if out of memory. The number of them is stored in
+ * 'num'.
+ */
+static struct Cookie **cookie_array(struct CookieInfo *c, size_t *num)
+{
+  struct Cookie **array;
+  struct Cookie *co;
+  size_t i;
+  size_t n = 0;
+
+  /* one more to never ask for zero bytes */
+  array = malloc(sizeof(struct Cookie *) * (c->numcookies + 1));
+  if(!array)
+    return NULL;
+
+  for(i = 0; i < COOKIE_HASH_SIZE; i++)
+    for(co = c->cookies[i]; co; co = co->next)
+      array[n++] = co;
+
+  qsort(array, n, sizeof(struct Cookie *), cookie_sort_ct);
+  *num = n;
+  return array;
+}
+
 #define CLONE(field)                     \
   do {                                   \
     if(src->field) {                     \
@@ -1087,6 +1176,7 @@ static struct Cookie *dup_cookie(struct Cookie *src)
     d->secure = src->secure;
     d->livecookie = src->livecookie;
     d->httponly = src->httponly;
+    d->creationtime = src->creationtime;
   }
   return d;
 
@@ -1117,8 +1207,11 @@ struct Cookie *Curl_cookie_getlist(struct CookieInfo *c,
   struct Cookie *mainco=NULL;
   size_t matches = 0;
   bool is_ip;
+  size_t slots[3];
+  size_t nslots = 0;
+  size_t i;
 
-  if(!c || !c->cookies)
+  if(!c || !c->numcookies)
     return NULL; /* no cookie struct or no cookies in the struct */
 
   /* at first, remove expired cookies */
@@ -1127,49 +1220,59 @@ struct Cookie *Curl_cookie_getlist(struct CookieInfo *c,
   /* check if host is an IP(v4|v6) address */
   is_ip = isip(host);
 
-  co = c->cookies;
-
-  while(co) {
-    /* only process this cookie if it is not expired or had no expire
-       date AND that if the cookie requires we're secure we must only
-       continue if we are! */
-    if((!co->expires || (co->expires > now)) &&
-       (co->secure?secure:TRUE)) {
-
-      /* now check if the domain is correct */
-      if(!co->domain ||
-         (co->tailmatch && !is_ip && tailmatch(co->domain, host)) ||
-         ((!co->tailmatch || is_ip) && strcasecompare(host, co->domain)) ) {
-        /* the right part of the host matches the domain stuff in the
-           cookie data */
-
-        /* now check the left part of the path with the cookies path
-           requirement */
-        if(!co->spath || pathmatch(co->spath, path) ) {
-
-          /* and now, we know this is a match and we should create an
-             entry for the return-linked-list */
-
-          newco = dup_cookie(co);
-          if(newco) {
-            /* then modify our next */
-            newco->next = mainco;
-
-            /* point the main to us */
-            mainco = newco;
-
-            matches++;
-          }
-          else {
-            fail:
-            /* failure, clear up the allocated chain and return NULL */
-            Curl_cookie_freelist(mainco);
-            return NULL;
+  /* The cookies that may match are the ones in the slot of the host name,
+     the ones for the last label of the host name alone, such as "localhost"
+     or a top level domain, and the ones without a domain */
+  slots[nslots++] = cookiehash(host);
+  if(strchr(host, '.')) {
+    size_t tld = cookiehash(label_tail(host, 1));
+    if(tld != slots[0])
+      slots[nslots++] = tld;
+  }
+  slots[nslots++] = COOKIE_HASH_SIZE;
+
+  for(i = 0; i < nslots; i++) {
+    for(co = c->cookies[slots[i]]; co; co = co->next) {
+      /* only process this cookie if it is not expired or had no expire
+         date AND that if the cookie requires we're secure we must only
+         continue if we are! */
+      if((!co->expires || (co->expires > now)) &&
+         (co->secure?secure:TRUE)) {
+
+        /* now check if the domain is correct */
+        if(!co->domain ||
+           (co->tailmatch && !is_ip && tailmatch(co->domain, host)) ||
+           ((!co->tailmatch || is_ip) && strcasecompare(host, co->domain)) ) {
+          /* the right part of the host matches the domain stuff in the
+             cookie data */
+
+          /* now check the left part of the path with the cookies path
+             requirement */
+          if(!co->spath || pathmatch(co->spath, path) ) {
+
+            /* and now, we know this is a match and we should create an
+               entry for the return-linked-list */
+
+            newco = dup_cookie(co);
+            if(newco) {
+              /* then modify our next */
+              newco->next = mainco;
+
+              /* point the main to us */
+              mainco = newco;
+
+              matches++;
+            }
+            else {
+              fail:
+              /* failure, clear up the allocated chain and return NULL */
+              Curl_cookie_freelist(mainco);
+              return NULL;
+            }
           }
         }
       }
     }
-    co = co->next;
   }
 
   if(matches) {
@@ -1177,7 +1280,6 @@ struct Cookie *Curl_cookie_getlist(struct CookieInfo *c,
        once, the longest specified path version comes first. To make this
        the swiftest way, we just sort them all based on path length. */
     struct Cookie **array;
-    size_t i;
 
     /* alloc an array and store all cookie pointers */
     array = malloc(sizeof(struct Cookie *) * matches);
@@ -1215,8 +1317,11 @@ struct Cookie *Curl_cookie_getlist(struct CookieInfo *c,
 void Curl_cookie_clearall(struct CookieInfo *cookies)
 {
   if(cookies) {
-    Curl_cookie_freelist(cookies->cookies);
-    cookies->cookies = NULL;
+    size_t i;
+    for(i = 0; i <= COOKIE_HASH_SIZE; i++) {
+      Curl_cookie_freelist(cookies->cookies[i]);
+      cookies->cookies[i] = NULL;
+    }
     cookies->numcookies = 0;
   }
 }
@@ -1249,32 +1354,25 @@ void Curl_cookie_freelist(struct Cookie *co)
  ****************************************************************************/
 void Curl_cookie_clearsess(struct CookieInfo *cookies)
 {
-  struct Cookie *first, *curr, *next, *prev = NULL;
+  struct Cookie **nextp, *curr;
+  size_t i;
 
-  if(!cookies || !cookies->cookies)
+  if(!cookies)
     return;
 
-  first = curr = prev = cookies->cookies;
-
-  for(; curr; curr = next) {
-    next = curr->next;
-    if(!curr->expires) {
-      if(first == curr)
-        first = next;
-
-      if(prev == curr)
-        prev = next;
+  for(i = 0; i <= COOKIE_HASH_SIZE; i++) {
+    nextp = &cookies->cookies[i];
+    while(*nextp) {
+      curr = *nextp;
+      if(!curr->expires) {
+        *nextp = curr->next;
+        freecookie(curr);
+        cookies->numcookies--;
+      }
       else
-        prev->next = next;
-
-      freecookie(curr);
-      cookies->numcookies--;
+        nextp = &curr->next;
     }
-    else
-      prev = curr;
   }
-
-  cookies->cookies = first;
 }
 
 
@@ -1289,7 +1387,7 @@ void Curl_cookie_cleanup(struct CookieInfo *c)
 {
   if(c) {
     free(c->filename);
-    Curl_cookie_freelist(c->cookies);
+    Curl_cookie_clearall(c);
     free(c); /* free the base struct as well */
   }
 }
@@ -1334,7 +1432,9 @@ static char *get_netscape_format(const struct Cookie *co)
  */
 static int cookie_output(struct CookieInfo *c, const char *dumphere)
 {
-  struct Cookie *co;
+  struct Cookie **array;
+  size_t num;
+  size_t i;
   FILE *out;
   bool use_stdout=FALSE;
   char *format_ptr;
@@ -1347,6 +1447,10 @@ static int cookie_output(struct CookieInfo *c, const char *dumphere)
   /* at first, remove expired cookies */
   remove_expired(c);
 
+  array = cookie_array(c, &num);
+  if(!array)
+    return 1;
+
   if(!strcmp("-", dumphere)) {
     /* use stdout */
     out = stdout;
@@ -1354,8 +1458,10 @@ static int cookie_output(struct CookieInfo *c, const char *dumphere)
   }
   else {
     out = fopen(dumphere, FOPEN_WRITETEXT);
-    if(!out)
+    if(!out) {
+      free(array);
       return 1; /* failure */
+    }
   }
 
   fputs("# Netscape HTTP Cookie File\n"
@@ -1363,14 +1469,13 @@ static int cookie_output(struct CookieInfo *c, const char *dumphere)
         "# This file was generated by libcurl! Edit at your own risk.\n\n",
         out);
 
-  for(co = c->cookies; co; co = co->next) {
-    if(!co->domain)
-      continue;
-    format_ptr = get_netscape_format(co);
+  for(i = 0; i < num; i++) {
+    format_ptr = get_netscape_format(array[i]);
     if(format_ptr == NULL) {
       fprintf(out, "#\n# Fatal libcurl error\n");
       if(!use_stdout)
         fclose(out);
+      free(array);
       return 1;
     }
     fprintf(out, "%s\n", format_ptr);
@@ -1379,6 +1484,7 @@ static int cookie_output(struct CookieInfo *c, const char *dumphere)
 
   if(!use_stdout)
     fclose(out);
+  free(array);
 
   return 0;
 }
@@ -1387,30 +1493,37 @@ struct curl_slist *Curl_cookie_list(struct Curl_easy *data)
 {
   struct curl_slist *list = NULL;
   struct curl_slist *beg;
-  struct Cookie *c;
+  struct Cookie **array;
+  size_t num;
+  size_t i;
   char *line;
 
   if((data->cookies == NULL) ||
       (data->cookies->numcookies == 0))
     return NULL;
 
-  for(c = data->cookies->cookies; c; c = c->next) {
-    if(!c->domain)
-      continue;
-    line = get_netscape_format(c);
+  array = cookie_array(data->cookies, &num);
+  if(!array)
+    return NULL;
+
+  for(i = 0; i < num; i++) {
+    line = get_netscape_format(array[i]);
     if(!line) {
       curl_slist_free_all(list);
-      return NULL;
+      list = NULL;
+      break;
     }
     beg = Curl_slist_append_nodup(list, line);
     if(!beg) {
       free(line);
       curl_slist_free_all(list);
-      return NULL;
+      list = NULL;
+      break;
     }
     list = beg;
   }
 
+  free(array);
   return list;
 }
 
@@ -27,6 +27,7 @@
 
 struct Cookie {
   struct Cookie *next; /* next in the chain */
+  long creationtime; /* when the cookie was first added to the jar */
   char *name;        /* <this> = value */
   char *value;       /* name = <this> */
   char *path;         /* path = <this> which is in Set-Cookie: */
@@ -45,14 +46,22 @@ struct Cookie {
   bool httponly;     /* true if the httponly directive is present */
 };
 
+/* The number of hash slots the cookies of a jar are spread over by domain.
+   There is one more slot for cookies without a domain. */
+#define COOKIE_HASH_SIZE 256
+
 struct CookieInfo {
-  /* linked list of cookies we know of */
-  struct Cookie *cookies;
+  /* linked lists of cookies we know of, one per hash slot, each sorted with
+     the longest path first */
+  struct Cookie *cookies[COOKIE_HASH_SIZE + 1];
 
   char *filename;  /* file we read from/write to */
   bool running;    /* state info, for cookie adding information */
   long numcookies; /* number of cookies in the "jar" */
   bool newsession; /* new session, discard session cookies on load */
+  long lastct;     /* the creationtime of the cookie added last */
+  curl_off_t next_expiration; /* no cookie expires before this, 0 if not
+                                 known */
 };
 
 /* This is the maximum line length we accept for a cookie line. RFC 2109
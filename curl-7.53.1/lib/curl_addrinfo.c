@@ -89,6 +89,61 @@ Curl_freeaddrinfo(Curl_addrinfo *cahead)
   }
 }
 
+/*
+ * Curl_addrinfo_dup()
+ *
+ * Returns an allocated copy of a linked list of Curl_addrinfo structs, to be
+ * free'd with Curl_freeaddrinfo(), or NULL on out of memory.
+ */
+
+Curl_addrinfo *
+Curl_addrinfo_dup(const Curl_addrinfo *orig)
+{
+  Curl_addrinfo *cafirst = NULL;
+  Curl_addrinfo *calast = NULL;
+  Curl_addrinfo *ca;
+
+  for(; orig; orig = orig->ai_next) {
+    ca = calloc(1, sizeof(Curl_addrinfo));
+    if(!ca)
+      break;
+
+    /* link it in first, so that it is freed along with the rest on error */
+    if(!cafirst)
+      cafirst = ca;
+    if(calast)
+      calast->ai_next = ca;
+    calast = ca;
+
+    ca->ai_flags     = orig->ai_flags;
+    ca->ai_family    = orig->ai_family;
+    ca->ai_socktype  = orig->ai_socktype;
+    ca->ai_protocol  = orig->ai_protocol;
+    ca->ai_addrlen   = orig->ai_addrlen;
+
+    if(orig->ai_addr) {
+      ca->ai_addr = malloc(orig->ai_addrlen);
+      if(!ca->ai_addr)
+        break;
+      memcpy(ca->ai_addr, orig->ai_addr, orig->ai_addrlen);
+    }
+
+    if(orig->ai_canonname) {
+      ca->ai_canonname = strdup(orig->ai_canonname);
+      if(!ca->ai_canonname)
+        break;
+    }
+  }
+
+  if(orig) {
+    /* we stopped early, out of memory */
+    Curl_freeaddrinfo(cafirst);
+    return NULL;
+  }
+
+  return cafirst;
+}
+
 
 #ifdef HAVE_GETADDRINFO
 /*
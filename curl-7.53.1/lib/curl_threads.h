@@ -48,6 +48,48 @@
 #  define Curl_mutex_destroy(m)  DeleteCriticalSection(m)
 #endif
 
+/* locks that many can hold for reading at the same time, or one for
+   writing */
+#if defined(USE_THREADS_POSIX)
+#  define curl_rwlock_t                 pthread_rwlock_t
+#  define Curl_rwlock_init(l)           pthread_rwlock_init(l, NULL)
+#  define Curl_rwlock_read(l)           pthread_rwlock_rdlock(l)
+#  define Curl_rwlock_read_release(l)   pthread_rwlock_unlock(l)
+#  define Curl_rwlock_write(l)          pthread_rwlock_wrlock(l)
+#  define Curl_rwlock_write_release(l)  pthread_rwlock_unlock(l)
+#  define Curl_rwlock_destroy(l)        pthread_rwlock_destroy(l)
+#elif defined(USE_THREADS_WIN32)
+#  if !defined(_WIN32_WINNT) || !defined(_WIN32_WINNT_VISTA) || \
+      (_WIN32_WINNT < _WIN32_WINNT_VISTA)
+/* no slim reader/writer locks, readers take turns */
+#    define curl_rwlock_t               CRITICAL_SECTION
+#    define Curl_rwlock_init(l)         InitializeCriticalSection(l)
+#    define Curl_rwlock_read(l)         EnterCriticalSection(l)
+#    define Curl_rwlock_read_release(l) LeaveCriticalSection(l)
+#    define Curl_rwlock_write(l)        EnterCriticalSection(l)
+#    define Curl_rwlock_write_release(l) LeaveCriticalSection(l)
+#    define Curl_rwlock_destroy(l)      DeleteCriticalSection(l)
+#  else
+#    define curl_rwlock_t               SRWLOCK
+#    define Curl_rwlock_init(l)         InitializeSRWLock(l)
+#    define Curl_rwlock_read(l)         AcquireSRWLockShared(l)
+#    define Curl_rwlock_read_release(l) ReleaseSRWLockShared(l)
+#    define Curl_rwlock_write(l)        AcquireSRWLockExclusive(l)
+#    define Curl_rwlock_write_release(l) ReleaseSRWLockExclusive(l)
+#    define Curl_rwlock_destroy(l)      Curl_nop_stmt
+#  endif
+#endif
+
+/* adding to and subtracting from a long that other threads change at the
+   same time, returning the new value */
+#if defined(__ATOMIC_RELAXED)
+#  define Curl_atomic_inc(p)  __atomic_add_fetch(p, 1, __ATOMIC_RELAXED)
+#  define Curl_atomic_dec(p)  __atomic_sub_fetch(p, 1, __ATOMIC_ACQ_REL)
+#elif defined(USE_THREADS_WIN32)
+#  define Curl_atomic_inc(p)  InterlockedIncrement(p)
+#  define Curl_atomic_dec(p)  InterlockedDecrement(p)
+#endif
+
 #if defined(USE_THREADS_POSIX) || defined(USE_THREADS_WIN32)
 
 /* !checksrc! disable SPACEBEFOREPAREN 1 */
@@ -71,6 +71,7 @@
 #include "conncache.h"
 #include "multiif.h"
 #include "sigpipe.h"
+#include "parallel.h"
 #include "ssh.h"
 /* The last 3 #include files should be in this order */
 #include "curl_printf.h"
@@ -768,6 +769,10 @@ static CURLcode easy_perform(struct Curl_easy *data, bool events)
   /* Copy the MAXCONNECTS option to the multi handle */
   curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, data->set.maxconnects);
 
+  if(Curl_parallel_wanted(data))
+    /* in parts, over several connections */
+    return Curl_parallel_perform(data, multi);
+
   mcode = curl_multi_add_handle(multi, data);
   if(mcode) {
     curl_multi_cleanup(multi);
@@ -865,20 +870,7 @@ struct Curl_easy *curl_easy_duphandle(struct Curl_easy *data)
   if(NULL == outcurl)
     goto fail;
 
-  /*
-   * We setup a few buffers we need. We should probably make them
-   * get setup on-demand in the code, as that would probably decrease
-   * the likeliness of us forgetting to init a buffer here in the future.
-   */
-  outcurl->set.buffer_size = data->set.buffer_size;
-  outcurl->state.buffer = malloc(CURL_BUFSIZE(outcurl->set.buffer_size) + 1);
-  if(!outcurl->state.buffer)
-    goto fail;
-
-  outcurl->state.headerbuff = malloc(HEADERSIZE);
-  if(!outcurl->state.headerbuff)
-    goto fail;
-  outcurl->state.headersize = HEADERSIZE;
+  /* the buffers are set up on demand, when a transfer starts */
 
   /* copy all userdefined values */
   if(Curl_dupset(outcurl, data))
@@ -945,8 +937,6 @@ struct Curl_easy *curl_easy_duphandle(struct Curl_easy *data)
   if(outcurl) {
     curl_slist_free_all(outcurl->change.cookielist);
     outcurl->change.cookielist = NULL;
-    Curl_safefree(outcurl->state.buffer);
-    Curl_safefree(outcurl->state.headerbuff);
     Curl_safefree(outcurl->change.url);
     Curl_safefree(outcurl->change.referer);
     Curl_freeset(outcurl);
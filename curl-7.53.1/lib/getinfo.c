@@ -66,6 +66,9 @@ CURLcode Curl_initinfo(struct Curl_easy *data)
   info->proxyauthavail = 0;
   info->httpauthavail = 0;
   info->numconnects = 0;
+  info->dns_cache_hits = 0;
+  info->dns_cache_misses = 0;
+  info->dns_cache_stale = 0;
 
   free(info->contenttype);
   info->contenttype = NULL;
@@ -186,6 +189,15 @@ static CURLcode getinfo_long(struct Curl_easy *data, CURLINFO info,
   case CURLINFO_NUM_CONNECTS:
     *param_longp = data->info.numconnects;
     break;
+  case CURLINFO_DNS_CACHE_HITS:
+    *param_longp = data->info.dns_cache_hits;
+    break;
+  case CURLINFO_DNS_CACHE_MISSES:
+    *param_longp = data->info.dns_cache_misses;
+    break;
+  case CURLINFO_DNS_CACHE_STALE:
+    *param_longp = data->info.dns_cache_stale;
+    break;
   case CURLINFO_LASTSOCKET:
     sockfd = Curl_getconnectinfo(data, NULL);
 
@@ -25,31 +25,22 @@
 #include <curl/curl.h>
 
 #include "hash.h"
-#include "llist.h"
 #include "curl_memory.h"
 
 /* The last #include file should be: */
 #include "memdebug.h"
 
-static void
-hash_element_dtor(void *user, void *element)
-{
-  struct curl_hash *h = (struct curl_hash *) user;
-  struct curl_hash_element *e = (struct curl_hash_element *) element;
-
-  Curl_safefree(e->key);
+/* the smallest table, all tables have a power of two number of slots */
+#define HASH_MIN_SLOTS 8
 
-  if(e->ptr) {
-    h->dtor(e->ptr);
-    e->ptr = NULL;
-  }
+/* the key of a slot whose entry was deleted; the probe goes on past it */
+static char deleted_key[1];
 
-  e->key_len = 0;
-
-  free(e);
-}
+#define SLOT_DELETED(e) ((e)->key == deleted_key)
+#define SLOT_TAKEN(e) ((e)->key && !SLOT_DELETED(e))
 
-/* Initializes a hash structure.
+/* Initializes a hash structure. 'slots' is the number of entries to expect
+ * to begin with; the table grows as needed.
  * Return 1 on error, 0 is fine.
  *
  * @unittest: 1602
@@ -62,66 +53,112 @@ Curl_hash_init(struct curl_hash *h,
                comp_function comparator,
                curl_hash_dtor dtor)
 {
-  int i;
+  int size = HASH_MIN_SLOTS;
 
   if(!slots || !hfunc || !comparator ||!dtor) {
     return 1; /* failure */
   }
 
+  while(size < slots)
+    size *= 2;
+
   h->hash_func = hfunc;
   h->comp_func = comparator;
   h->dtor = dtor;
   h->size = 0;
-  h->slots = slots;
-
-  h->table = malloc(slots * sizeof(struct curl_llist *));
-  if(h->table) {
-    for(i = 0; i < slots; ++i) {
-      h->table[i] = Curl_llist_alloc((curl_llist_dtor) hash_element_dtor);
-      if(!h->table[i]) {
-        while(i--) {
-          Curl_llist_destroy(h->table[i], NULL);
-          h->table[i] = NULL;
-        }
-        free(h->table);
-        h->table = NULL;
-        h->slots = 0;
-        return 1; /* failure */
-      }
-    }
-    return 0; /* fine */
-  }
-  else {
+  h->used = 0;
+  h->slots = size;
+
+  h->table = calloc(size, sizeof(struct curl_hash_element));
+  if(!h->table) {
     h->slots = 0;
     return 1; /* failure */
   }
+  return 0; /* fine */
 }
 
+/* Returns the slot holding the key, or NULL if there is none. */
 static struct curl_hash_element *
-mk_hash_element(const void *key, size_t key_len, const void *p)
+hash_find(struct curl_hash *h, void *key, size_t key_len, size_t hash)
 {
-  struct curl_hash_element *he = malloc(sizeof(struct curl_hash_element));
+  size_t mask = (size_t)h->slots - 1;
+  size_t i;
 
-  if(he) {
-    void *dupkey = malloc(key_len);
-    if(dupkey) {
-      /* copy the key */
-      memcpy(dupkey, key, key_len);
-
-      he->key = dupkey;
-      he->key_len = key_len;
-      he->ptr = (void *) p;
-    }
-    else {
-      /* failed to duplicate the key, free memory and fail */
-      free(he);
-      he = NULL;
+  if(!h->table)
+    return NULL;
+
+  /* there is always at least one empty slot, which ends the probe */
+  for(i = hash & mask;; i = (i + 1) & mask) {
+    struct curl_hash_element *he = &h->table[i];
+    if(!he->key)
+      return NULL;
+    if(!SLOT_DELETED(he) && (he->hash == hash) &&
+       h->comp_func(he->key, he->key_len, key, key_len))
+      return he;
+  }
+}
+
+/* Moves all entries into a new table of 'slots' slots, dropping the markers
+   of deleted entries on the way. Returns non-zero on failure, leaving the
+   table as it was. */
+static int hash_resize(struct curl_hash *h, size_t slots)
+{
+  struct curl_hash_element *table;
+  size_t mask = slots - 1;
+  int i;
+
+  table = calloc(slots, sizeof(struct curl_hash_element));
+  if(!table)
+    return 1;
+
+  for(i = 0; i < h->slots; ++i) {
+    struct curl_hash_element *he = &h->table[i];
+    if(SLOT_TAKEN(he)) {
+      size_t n = he->hash & mask;
+      while(table[n].key)
+        n = (n + 1) & mask;
+      table[n] = *he;
     }
   }
-  return he;
+
+  free(h->table);
+  h->table = table;
+  h->slots = (int)slots;
+  h->used = h->size;
+  return 0;
+}
+
+/* Empties a taken slot and calls the destructor for its data. */
+static void hash_clear_slot(struct curl_hash *h, struct curl_hash_element *he)
+{
+  size_t next = (size_t)(he - h->table + 1) & ((size_t)h->slots - 1);
+  void *ptr = he->ptr;
+
+  free(he->key);
+  he->ptr = NULL;
+  he->key_len = 0;
+  if(!h->table[next].key) {
+    /* no probe goes past this slot, so it can be empty again */
+    he->key = NULL;
+    --h->used;
+  }
+  else
+    he->key = deleted_key;
+  --h->size;
+
+  /* the slot is settled before the destructor gets to run */
+  if(ptr)
+    h->dtor(ptr);
 }
 
-#define FETCH_LIST(x,y,z) x->table[x->hash_func(y, z, x->slots)]
+/* Returns the hash value of the key, as kept with the entries. Callers that
+ * look up the same key many times can keep it and use the *_hashed
+ * functions.
+ */
+size_t Curl_hash_key(struct curl_hash *h, void *key, size_t key_len)
+{
+  return h->hash_func(key, key_len, CURL_HASH_FULL);
+}
 
 /* Insert the data in the hash. If there already was a match in the hash,
  * that data is replaced.
@@ -133,36 +170,58 @@ mk_hash_element(const void *key, size_t key_len, const void *p)
 void *
 Curl_hash_add(struct curl_hash *h, void *key, size_t key_len, void *p)
 {
-  struct curl_hash_element  *he;
-  struct curl_llist_element *le;
-  struct curl_llist *l = FETCH_LIST(h, key, key_len);
-
-  for(le = l->head; le; le = le->next) {
-    he = (struct curl_hash_element *) le->ptr;
-    if(h->comp_func(he->key, he->key_len, key, key_len)) {
-      Curl_llist_remove(l, le, (void *)h);
-      --h->size;
-      break;
-    }
-  }
+  return Curl_hash_add_hashed(h, key, key_len, Curl_hash_key(h, key, key_len),
+                              p);
+}
+
+/* Curl_hash_add() with the hash of the key already computed. */
+void *
+Curl_hash_add_hashed(struct curl_hash *h, void *key, size_t key_len,
+                     size_t hash, void *p)
+{
+  struct curl_hash_element *he = hash_find(h, key, key_len, hash);
+  size_t mask;
+  size_t i;
+  char *dupkey;
 
-  he = mk_hash_element(key, key_len, p);
   if(he) {
-    if(Curl_llist_insert_next(l, l->tail, he)) {
-      ++h->size;
-      return p; /* return the new entry */
-    }
-    /*
-     * Couldn't insert it, destroy the 'he' element and the key again. We
-     * don't call hash_element_dtor() since that would also call the
-     * "destructor" for the actual data 'p'. When we fail, we shall not touch
-     * that data.
-     */
-    free(he->key);
-    free(he);
+    /* keep the key, replace the data */
+    void *old = he->ptr;
+    he->ptr = p;
+    if(old)
+      h->dtor(old);
+    return p; /* return the new entry */
   }
 
-  return NULL; /* failure */
+  if((h->used + 1) * 4 > (size_t)h->slots * 3) {
+    size_t slots = h->slots ? (size_t)h->slots : HASH_MIN_SLOTS;
+
+    /* grow so that the table is at most half full again; when it is mostly
+       deleted markers the same size is enough */
+    while((h->size + 1) * 2 > slots)
+      slots *= 2;
+    if(hash_resize(h, slots))
+      return NULL; /* failure */
+  }
+
+  dupkey = malloc(key_len);
+  if(!dupkey)
+    return NULL; /* failure */
+  memcpy(dupkey, key, key_len);
+
+  mask = (size_t)h->slots - 1;
+  for(i = hash & mask; SLOT_TAKEN(&h->table[i]); i = (i + 1) & mask)
+    ;
+  he = &h->table[i];
+  if(!he->key)
+    ++h->used;
+  he->key = dupkey;
+  he->key_len = key_len;
+  he->hash = hash;
+  he->ptr = p;
+  ++h->size;
+
+  return p; /* return the new entry */
 }
 
 /* Remove the identified hash entry.
@@ -172,17 +231,19 @@ Curl_hash_add(struct curl_hash *h, void *key, size_t key_len, void *p)
  */
 int Curl_hash_delete(struct curl_hash *h, void *key, size_t key_len)
 {
-  struct curl_llist_element *le;
-  struct curl_hash_element  *he;
-  struct curl_llist *l = FETCH_LIST(h, key, key_len);
-
-  for(le = l->head; le; le = le->next) {
-    he = le->ptr;
-    if(h->comp_func(he->key, he->key_len, key, key_len)) {
-      Curl_llist_remove(l, le, (void *) h);
-      --h->size;
-      return 0;
-    }
+  return Curl_hash_delete_hashed(h, key, key_len,
+                                 Curl_hash_key(h, key, key_len));
+}
+
+/* Curl_hash_delete() with the hash of the key already computed. */
+int Curl_hash_delete_hashed(struct curl_hash *h, void *key, size_t key_len,
+                            size_t hash)
+{
+  struct curl_hash_element *he = hash_find(h, key, key_len, hash);
+
+  if(he) {
+    hash_clear_slot(h, he);
+    return 0;
   }
   return 1;
 }
@@ -194,18 +255,24 @@ int Curl_hash_delete(struct curl_hash *h, void *key, size_t key_len)
 void *
 Curl_hash_pick(struct curl_hash *h, void *key, size_t key_len)
 {
-  struct curl_llist_element *le;
-  struct curl_hash_element  *he;
-  struct curl_llist *l;
+  if(h)
+    return Curl_hash_pick_hashed(h, key, key_len,
+                                 Curl_hash_key(h, key, key_len));
+
+  return NULL;
+}
+
+/* Curl_hash_pick() with the hash of the key already computed. */
+void *
+Curl_hash_pick_hashed(struct curl_hash *h, void *key, size_t key_len,
+                      size_t hash)
+{
+  struct curl_hash_element *he;
 
   if(h) {
-    l = FETCH_LIST(h, key, key_len);
-    for(le = l->head; le; le = le->next) {
-      he = le->ptr;
-      if(h->comp_func(he->key, he->key_len, key, key_len)) {
-        return he->ptr;
-      }
-    }
+    he = hash_find(h, key, key_len, hash);
+    if(he)
+      return he->ptr;
   }
 
   return NULL;
@@ -213,19 +280,14 @@ Curl_hash_pick(struct curl_hash *h, void *key, size_t key_len)
 
 #if defined(DEBUGBUILD) && defined(AGGRESIVE_TEST)
 void
-Curl_hash_apply(curl_hash *h, void *user,
+Curl_hash_apply(struct curl_hash *h, void *user,
                 void (*cb)(void *user, void *ptr))
 {
-  struct curl_llist_element  *le;
-  int                  i;
+  int i;
 
   for(i = 0; i < h->slots; ++i) {
-    for(le = (h->table[i])->head;
-        le;
-        le = le->next) {
-      curl_hash_element *el = le->ptr;
-      cb(user, el->ptr);
-    }
+    if(SLOT_TAKEN(&h->table[i]))
+      cb(user, h->table[i].ptr);
   }
 }
 #endif
@@ -243,12 +305,18 @@ Curl_hash_destroy(struct curl_hash *h)
   int i;
 
   for(i = 0; i < h->slots; ++i) {
-    Curl_llist_destroy(h->table[i], (void *) h);
-    h->table[i] = NULL;
+    struct curl_hash_element *he = &h->table[i];
+    if(SLOT_TAKEN(he)) {
+      free(he->key);
+      he->key = NULL;
+      if(he->ptr)
+        h->dtor(he->ptr);
+    }
   }
 
   Curl_safefree(h->table);
   h->size = 0;
+  h->used = 0;
   h->slots = 0;
 }
 
@@ -267,27 +335,22 @@ void
 Curl_hash_clean_with_criterium(struct curl_hash *h, void *user,
                                int (*comp)(void *, void *))
 {
-  struct curl_llist_element *le;
-  struct curl_llist_element *lnext;
-  struct curl_llist *list;
   int i;
 
   if(!h)
     return;
 
   for(i = 0; i < h->slots; ++i) {
-    list = h->table[i];
-    le = list->head; /* get first list entry */
-    while(le) {
-      struct curl_hash_element *he = le->ptr;
-      lnext = le->next;
-      /* ask the callback function if we shall remove this entry or not */
-      if(comp == NULL || comp(user, he->ptr)) {
-        Curl_llist_remove(list, le, (void *) h);
-        --h->size; /* one less entry in the hash now */
-      }
-      le = lnext;
-    }
+    struct curl_hash_element *he = &h->table[i];
+    /* ask the callback function if we shall remove this entry or not */
+    if(SLOT_TAKEN(he) && (comp == NULL || comp(user, he->ptr)))
+      hash_clear_slot(h, he);
+  }
+
+  if(!h->size && h->used) {
+    /* only deleted markers are left, start over with an empty table */
+    memset(h->table, 0, h->slots * sizeof(struct curl_hash_element));
+    h->used = 0;
   }
 }
 
@@ -328,29 +391,18 @@ Curl_hash_next_element(struct curl_hash_iterator *iter)
   int i;
   struct curl_hash *h = iter->hash;
 
-  /* Get the next element in the current list, if any */
-  if(iter->current_element)
-    iter->current_element = iter->current_element->next;
-
-  /* If we have reached the end of the list, find the next one */
-  if(!iter->current_element) {
-    for(i = iter->slot_index;i < h->slots;i++) {
-      if(h->table[i]->head) {
-        iter->current_element = h->table[i]->head;
-        iter->slot_index = i+1;
-        break;
-      }
+  /* Find the next taken slot, if any */
+  for(i = iter->slot_index; i < h->slots; i++) {
+    if(SLOT_TAKEN(&h->table[i])) {
+      iter->current_element = &h->table[i];
+      iter->slot_index = i + 1;
+      return iter->current_element;
     }
   }
 
-  if(iter->current_element) {
-    struct curl_hash_element *he = iter->current_element->ptr;
-    return he;
-  }
-  else {
-    iter->current_element = NULL;
-    return NULL;
-  }
+  iter->slot_index = h->slots;
+  iter->current_element = NULL;
+  return NULL;
 }
 
 #if 0 /* useful function for debugging hashes and their contents */
@@ -28,11 +28,14 @@
 
 #include "llist.h"
 
-/* Hash function prototype */
+/* Hash function prototype. Tables pass CURL_HASH_FULL as 'slots_num' to get
+   the whole hash value, which they keep with each entry. */
 typedef size_t (*hash_function) (void *key,
                                  size_t key_length,
                                  size_t slots_num);
 
+#define CURL_HASH_FULL ((size_t)-1)
+
 /*
    Comparator function prototype. Compares two keys.
 */
@@ -43,8 +46,19 @@ typedef size_t (*comp_function) (void *key1,
 
 typedef void (*curl_hash_dtor)(void *);
 
+struct curl_hash_element {
+  void   *ptr;
+  char   *key;  /* NULL for an empty slot */
+  size_t key_len;
+  size_t hash;  /* hash_func(key, key_len, CURL_HASH_FULL) */
+};
+
+/* An open addressing table with linear probing. 'slots' is always a power of
+   two and the table grows when more than three quarters of it is taken by
+   entries or by the markers left behind by deleted ones. Deleting never moves
+   other entries, so it is safe to delete while iterating. */
 struct curl_hash {
-  struct curl_llist **table;
+  struct curl_hash_element *table;
 
   /* Hash function to be used for this hash table */
   hash_function hash_func;
@@ -53,19 +67,14 @@ struct curl_hash {
   comp_function comp_func;
   curl_hash_dtor   dtor;
   int slots;
-  size_t size;
-};
-
-struct curl_hash_element {
-  void   *ptr;
-  char   *key;
-  size_t key_len;
+  size_t size;  /* number of entries */
+  size_t used;  /* number of entries and deleted markers */
 };
 
 struct curl_hash_iterator {
   struct curl_hash *hash;
   int slot_index;
-  struct curl_llist_element *current_element;
+  struct curl_hash_element *current_element;
 };
 
 int Curl_hash_init(struct curl_hash *h,
@@ -77,6 +86,13 @@ int Curl_hash_init(struct curl_hash *h,
 void *Curl_hash_add(struct curl_hash *h, void *key, size_t key_len, void *p);
 int Curl_hash_delete(struct curl_hash *h, void *key, size_t key_len);
 void *Curl_hash_pick(struct curl_hash *, void *key, size_t key_len);
+size_t Curl_hash_key(struct curl_hash *h, void *key, size_t key_len);
+void *Curl_hash_add_hashed(struct curl_hash *h, void *key, size_t key_len,
+                           size_t hash, void *p);
+int Curl_hash_delete_hashed(struct curl_hash *h, void *key, size_t key_len,
+                            size_t hash);
+void *Curl_hash_pick_hashed(struct curl_hash *h, void *key, size_t key_len,
+                            size_t hash);
 void Curl_hash_apply(struct curl_hash *h, void *user,
                      void (*cb)(void *user, void *ptr));
 int Curl_hash_count(struct curl_hash *h);
@@ -107,7 +107,7 @@
  */
 
 /* These two symbols are for the global DNS cache */
-static struct curl_hash hostname_cache;
+static struct Curl_dnscache hostname_cache;
 static int host_cache_initialized;
 
 static void freednsentry(void *freethis);
@@ -117,14 +117,13 @@ static void freednsentry(void *freethis);
  * Global DNS cache is general badness. Do not use. This will be removed in
  * a future version. Use the share interface instead!
  *
- * Returns a struct curl_hash pointer on success, NULL on failure.
+ * Returns a struct Curl_dnscache pointer on success, NULL on failure.
  */
-struct curl_hash *Curl_global_host_cache_init(void)
+struct Curl_dnscache *Curl_global_host_cache_init(void)
 {
   int rc = 0;
   if(!host_cache_initialized) {
-    rc = Curl_hash_init(&hostname_cache, 7, Curl_hash_str,
-                        Curl_str_key_compare, freednsentry);
+    rc = Curl_mk_dnscache(&hostname_cache);
     if(!rc)
       host_cache_initialized = 1;
   }
@@ -137,7 +136,7 @@ struct curl_hash *Curl_global_host_cache_init(void)
 void Curl_global_host_cache_dtor(void)
 {
   if(host_cache_initialized) {
-    Curl_hash_destroy(&hostname_cache);
+    Curl_dnscache_destroy(&hostname_cache);
     host_cache_initialized = 0;
   }
 }
@@ -191,63 +190,182 @@ Curl_printable_address(const Curl_addrinfo *ai, char *buf, size_t bufsize)
   return NULL;
 }
 
+/* the colon, the longest port number and the zero */
+#define HOSTCACHE_ID_EXTRA 13
+
 /*
- * Return a hostcache id string for the provided host + port, to be used by
- * the DNS caching.
+ * Curl_hostcache_id() returns a hostcache id string for the provided host +
+ * port, to be used by the DNS caching. It is stored in 'buf' when it fits,
+ * which must then have room for HOSTCACHE_ID_SIZE bytes, or else it is
+ * allocated.
  */
-static char *
-create_hostcache_id(const char *name, int port)
-{
-  /* create and return the new allocated entry */
-  char *id = aprintf("%s:%d", name, port);
-  char *ptr = id;
-  if(ptr) {
-    /* lower case the name part */
-    while(*ptr && (*ptr != ':')) {
-      *ptr = (char)TOLOWER(*ptr);
-      ptr++;
-    }
+char *
+Curl_hostcache_id(const char *name, int port, char *buf)
+{
+  char *id = buf;
+  char *ptr;
+
+  if(strlen(name) + HOSTCACHE_ID_EXTRA > HOSTCACHE_ID_SIZE) {
+    id = aprintf("%s:%d", name, port);
+    if(!id)
+      return NULL;
   }
+  else
+    snprintf(buf, HOSTCACHE_ID_SIZE, "%s:%d", name, port);
+
+  /* lower case the name part */
+  for(ptr = id; *ptr && (*ptr != ':'); ptr++)
+    *ptr = (char)TOLOWER(*ptr);
+
   return id;
 }
 
-struct hostcache_prune_data {
-  long cache_timeout;
-  time_t now;
-};
+/* free an id from Curl_hostcache_id() unless it is in 'buf' */
+#define free_hostcache_id(id, buf) \
+  do { if((id) != (buf)) free(id); } WHILE_FALSE
 
 /*
- * This function is set as a callback to be called for every entry in the DNS
- * cache when we want to prune old unused entries.
- *
- * Returning non-zero means remove the entry, return 0 to keep it in the
- * cache.
+ * A DNS cache that is shared is locked with the share's DNS lock. When the
+ * share locks itself, its cache is split in parts that are locked one by one
+ * instead, and that many threads can hold for reading at the same time. The
+ * part of an entry is found from its id, and 'write' tells if the cache is
+ * changed while it is locked.
  */
-static int
-hostcache_timestamp_remove(void *datap, void *hc)
+#ifdef USE_SHARE_LOCKS
+#define split_cache(data) ((data)->share && (data)->share->dnsparts && \
+                           ((data)->dns.hostcachetype == HCACHE_SHARED))
+#endif
+
+static int cache_part(struct Curl_easy *data, const char *id, size_t idlen)
+{
+#ifdef USE_SHARE_LOCKS
+  if(split_cache(data))
+    return Curl_share_dns_part(id, idlen);
+#else
+  (void)data;
+  (void)id;
+  (void)idlen;
+#endif
+  return 0;
+}
+
+static struct Curl_dnscache *cache_lock(struct Curl_easy *data, int part,
+                                        bool write)
 {
-  struct hostcache_prune_data *data =
-    (struct hostcache_prune_data *) datap;
-  struct Curl_dns_entry *c = (struct Curl_dns_entry *) hc;
+#ifdef USE_SHARE_LOCKS
+  if(split_cache(data))
+    return Curl_share_dns_lock(data->share, part, write);
+#endif
+  (void)part;
+  (void)write;
+  if(data->share)
+    Curl_share_lock(data, CURL_LOCK_DATA_DNS, CURL_LOCK_ACCESS_SINGLE);
+  return data->dns.hostcache;
+}
 
-  return (0 != c->timestamp)
-    && (data->now - c->timestamp >= data->cache_timeout);
+static void cache_unlock(struct Curl_easy *data, int part, bool write)
+{
+#ifdef USE_SHARE_LOCKS
+  if(split_cache(data)) {
+    Curl_share_dns_unlock(data->share, part, write);
+    return;
+  }
+#endif
+  (void)part;
+  (void)write;
+  if(data->share)
+    Curl_share_unlock(data, CURL_LOCK_DATA_DNS);
+}
+
+/*
+ * The expiry heap. It holds the entries of a cache that time out, with the
+ * oldest at the top. An entry's timestamp must not change while it is in the
+ * heap. Entry 'i' of the heap knows it is there with expiry_index == i + 1.
+ */
+
+#define EXPIRY_PARENT(i) (((i) - 1) / 2)
+
+static void expiry_set(struct Curl_dnscache *cache, size_t i,
+                       struct Curl_dns_entry *dns)
+{
+  cache->expiry[i] = dns;
+  dns->expiry_index = i + 1;
+}
+
+/* move the entry at 'i' up or down to where it belongs */
+static void expiry_fix(struct Curl_dnscache *cache, size_t i)
+{
+  struct Curl_dns_entry *dns = cache->expiry[i];
+
+  while(i && (cache->expiry[EXPIRY_PARENT(i)]->timestamp > dns->timestamp)) {
+    expiry_set(cache, i, cache->expiry[EXPIRY_PARENT(i)]);
+    i = EXPIRY_PARENT(i);
+  }
+  for(;;) {
+    size_t child = i * 2 + 1;
+    if(child >= cache->expiry_num)
+      break;
+    if((child + 1 < cache->expiry_num) &&
+       (cache->expiry[child + 1]->timestamp <
+        cache->expiry[child]->timestamp))
+      child++;
+    if(cache->expiry[child]->timestamp >= dns->timestamp)
+      break;
+    expiry_set(cache, i, cache->expiry[child]);
+    i = child;
+  }
+  expiry_set(cache, i, dns);
+}
+
+static int expiry_add(struct Curl_dnscache *cache, struct Curl_dns_entry *dns)
+{
+  if(cache->expiry_num == cache->expiry_size) {
+    size_t size = cache->expiry_size ? cache->expiry_size * 2 : 16;
+    struct Curl_dns_entry **expiry =
+      realloc(cache->expiry, size * sizeof(struct Curl_dns_entry *));
+    if(!expiry)
+      return 1;
+    cache->expiry = expiry;
+    cache->expiry_size = size;
+  }
+  expiry_set(cache, cache->expiry_num++, dns);
+  expiry_fix(cache, cache->expiry_num - 1);
+  return 0;
+}
+
+static void expiry_remove(struct Curl_dnscache *cache,
+                          struct Curl_dns_entry *dns)
+{
+  size_t i = dns->expiry_index - 1;
+
+  DEBUGASSERT(dns->expiry_index && (cache->expiry[i] == dns));
+  dns->expiry_index = 0;
+  if(i != --cache->expiry_num) {
+    expiry_set(cache, i, cache->expiry[cache->expiry_num]);
+    expiry_fix(cache, i);
+  }
+}
+
+/* TRUE if the entry is older than 'age' seconds */
+static bool dns_older(struct Curl_dns_entry *dns, time_t now, long age)
+{
+  return (0 != dns->timestamp) && (now - dns->timestamp >= age);
 }
 
 /*
  * Prune the DNS cache. This assumes that a lock has already been taken.
+ * Only the entries that have expired are looked at.
  */
 static void
-hostcache_prune(struct curl_hash *hostcache, long cache_timeout, time_t now)
+hostcache_prune(struct Curl_dnscache *cache, long cache_timeout, time_t now)
 {
-  struct hostcache_prune_data user;
-
-  user.cache_timeout = cache_timeout;
-  user.now = now;
+  while(cache->expiry_num && dns_older(cache->expiry[0], now, cache_timeout)) {
+    struct Curl_dns_entry *dns = cache->expiry[0];
 
-  Curl_hash_clean_with_criterium(hostcache,
-                                 (void *) &user,
-                                 hostcache_timestamp_remove);
+    /* the hash destructor takes it out of the heap */
+    if(Curl_hash_delete(&cache->hash, dns->id, dns->idlen))
+      expiry_remove(cache, dns);
+  }
 }
 
 /*
@@ -257,21 +375,48 @@ hostcache_prune(struct curl_hash *hostcache, long cache_timeout, time_t now)
 void Curl_hostcache_prune(struct Curl_easy *data)
 {
   time_t now;
+  long timeout;
 
   if((data->set.dns_cache_timeout == -1) || !data->dns.hostcache)
     /* cache forever means never prune, and NULL hostcache means
        we can't do it */
     return;
 
+  time(&now);
+
+  /* Remove outdated entries from the hostcache. Entries that are stale may
+     still be used for a while if the application allows it. */
+  timeout = data->set.dns_cache_timeout;
+  if(data->set.dns_stale_while_revalidate > 0)
+    timeout += data->set.dns_stale_while_revalidate;
+
+#ifdef USE_SHARE_LOCKS
+  if(split_cache(data)) {
+    /* a split cache is pruned one part per call, and the write lock is only
+       taken when there is something to remove */
+    int part = data->state.dns_prune_part;
+    struct Curl_dnscache *cache;
+    bool expired;
+
+    data->state.dns_prune_part = (part + 1) % SHARE_DNS_PARTS;
+
+    cache = Curl_share_dns_lock(data->share, part, FALSE);
+    expired = cache->expiry_num && dns_older(cache->expiry[0], now, timeout);
+    Curl_share_dns_unlock(data->share, part, FALSE);
+
+    if(expired) {
+      cache = Curl_share_dns_lock(data->share, part, TRUE);
+      hostcache_prune(cache, timeout, now);
+      Curl_share_dns_unlock(data->share, part, TRUE);
+    }
+    return;
+  }
+#endif
+
   if(data->share)
     Curl_share_lock(data, CURL_LOCK_DATA_DNS, CURL_LOCK_ACCESS_SINGLE);
 
-  time(&now);
-
-  /* Remove outdated and unused entries from the hostcache */
-  hostcache_prune(data->dns.hostcache,
-                  data->set.dns_cache_timeout,
-                  now);
+  hostcache_prune(data->dns.hostcache, timeout, now);
 
   if(data->share)
     Curl_share_unlock(data, CURL_LOCK_DATA_DNS);
@@ -284,44 +429,164 @@ void Curl_hostcache_prune(struct Curl_easy *data)
 sigjmp_buf curl_jmpenv;
 #endif
 
-/* lookup address, returns entry if found and not stale */
+static struct Curl_dns_entry *
+cache_addr(struct Curl_dnscache *cache, Curl_addrinfo *addr,
+           char *id, size_t idlen);
+
+/*
+ * Replaces a cache entry with the result of its refresh, if that is done. A
+ * failed refresh leaves the entry as it is. Returns the entry to use.
+ */
+static struct Curl_dns_entry *
+refresh_done(struct Curl_easy *data, struct Curl_dnscache *cache,
+             struct Curl_dns_entry *dns, const char *hostname)
+{
+  Curl_addrinfo *addr;
+  struct Curl_dns_entry *fresh;
+
+  if(!Curl_resolver_refresh_done(dns->refresh, &addr))
+    return dns;
+
+  dns->refresh = NULL;
+  if(!addr) {
+    infof(data, "Refreshing %s in the DNS cache failed\n", hostname);
+    return dns;
+  }
+
+  /* this replaces 'dns' in the cache */
+  fresh = cache_addr(cache, addr, dns->id, dns->idlen);
+  if(!fresh) {
+    Curl_freeaddrinfo(addr);
+    return dns;
+  }
+  fresh->inuse--; /* only the cache keeps it */
+
+  return fresh;
+}
+
+/* TRUE if the entry is older than the cache timeout */
+static bool dns_stale(struct Curl_easy *data, struct Curl_dns_entry *dns)
+{
+  return (data->set.dns_cache_timeout != -1) &&
+    dns_older(dns, time(NULL), data->set.dns_cache_timeout);
+}
+
+/* lookup address in the locked cache, returns entry if found and not stale,
+   or stale but still usable while it is refreshed, which sets 'stale' */
 static struct Curl_dns_entry *
 fetch_addr(struct connectdata *conn,
-                const char *hostname,
-                int port)
+           struct Curl_dnscache *cache,
+           char *id,
+           size_t idlen,
+           const char *hostname,
+           int port,
+           bool *stale)
 {
-  char *entry_id = NULL;
   struct Curl_dns_entry *dns = NULL;
+  struct Curl_easy *data = conn->data;
+
+  /* See if its already in our dns cache */
+  dns = Curl_hash_pick(&cache->hash, id, idlen);
+
+  if(dns && dns->refresh)
+    dns = refresh_done(data, cache, dns, hostname);
+
+  if(dns && (data->set.dns_cache_timeout != -1))  {
+    /* See whether the returned entry is stale. Done before we release lock */
+    time_t now;
+
+    time(&now);
+
+    if(dns_older(dns, now, data->set.dns_cache_timeout)) {
+      long window = data->set.dns_stale_while_revalidate;
+
+      if((window > 0) &&
+         !dns_older(dns, now, data->set.dns_cache_timeout + window)) {
+        /* use it while it is resolved again in the background */
+        if(!dns->refresh)
+          dns->refresh = Curl_resolver_refresh(conn, hostname, port);
+        if(dns->refresh) {
+          infof(data, "Hostname in DNS cache was stale, refreshing\n");
+          *stale = TRUE;
+        }
+      }
+
+      if(!*stale) {
+        infof(data, "Hostname in DNS cache was stale, zapped\n");
+        dns = NULL; /* the memory deallocation is being handled by the hash */
+        Curl_hash_delete(&cache->hash, id, idlen);
+      }
+    }
+  }
+
+  return dns;
+}
+
+/*
+ * Looks up an entry in the DNS cache with fetch_addr() and takes a reference
+ * to it. In a split cache, an entry that needs nothing done to it is taken
+ * with only a read lock.
+ */
+static struct Curl_dns_entry *
+cache_fetch(struct connectdata *conn,
+            const char *hostname,
+            int port,
+            bool *stale)
+{
+  char id_buf[HOSTCACHE_ID_SIZE];
+  char *entry_id;
   size_t entry_len;
+  struct Curl_dns_entry *dns;
+  struct Curl_dnscache *cache;
   struct Curl_easy *data = conn->data;
+  int part;
+
+  *stale = FALSE;
 
   /* Create an entry id, based upon the hostname and port */
-  entry_id = create_hostcache_id(hostname, port);
+  entry_id = Curl_hostcache_id(hostname, port, id_buf);
   /* If we can't create the entry id, fail */
   if(!entry_id)
-    return dns;
+    return NULL;
 
   entry_len = strlen(entry_id);
+  part = cache_part(data, entry_id, entry_len+1);
+
+#ifdef USE_SHARE_LOCKS
+  if(split_cache(data)) {
+    bool done = TRUE;
+
+    cache = Curl_share_dns_lock(data->share, part, FALSE);
+    dns = Curl_hash_pick(&cache->hash, entry_id, entry_len+1);
+    if(dns) {
+      if(dns->refresh || dns_stale(data, dns)) {
+        /* this needs the write lock */
+        dns = NULL;
+        done = FALSE;
+      }
+      else
+        Curl_atomic_inc(&dns->inuse); /* we use it! */
+    }
+    Curl_share_dns_unlock(data->share, part, FALSE);
 
-  /* See if its already in our dns cache */
-  dns = Curl_hash_pick(data->dns.hostcache, entry_id, entry_len+1);
+    if(done) {
+      free_hostcache_id(entry_id, id_buf);
+      return dns;
+    }
+  }
+#endif
 
-  if(dns && (data->set.dns_cache_timeout != -1))  {
-    /* See whether the returned entry is stale. Done before we release lock */
-    struct hostcache_prune_data user;
+  cache = cache_lock(data, part, TRUE);
 
-    time(&user.now);
-    user.cache_timeout = data->set.dns_cache_timeout;
+  dns = fetch_addr(conn, cache, entry_id, entry_len+1, hostname, port,
+                   stale);
+  if(dns)
+    dns->inuse++; /* we use it! */
 
-    if(hostcache_timestamp_remove(&user, dns)) {
-      infof(data, "Hostname in DNS cache was stale, zapped\n");
-      dns = NULL; /* the memory deallocation is being handled by the hash */
-      Curl_hash_delete(data->dns.hostcache, entry_id, entry_len+1);
-    }
-  }
+  cache_unlock(data, part, TRUE);
 
   /* free the allocated entry_id again */
-  free(entry_id);
+  free_hostcache_id(entry_id, id_buf);
 
   return dns;
 }
@@ -345,25 +610,62 @@ Curl_fetch_addr(struct connectdata *conn,
                 const char *hostname,
                 int port)
 {
-  struct Curl_easy *data = conn->data;
-  struct Curl_dns_entry *dns = NULL;
+  bool stale;
 
-  if(data->share)
-    Curl_share_lock(data, CURL_LOCK_DATA_DNS, CURL_LOCK_ACCESS_SINGLE);
+  return cache_fetch(conn, hostname, port, &stale);
+}
+
+/*
+ * Stores a 'Curl_addrinfo' struct in the locked cache with the given id.
+ *
+ * Returns the Curl_dns_entry entry pointer or NULL if the storage failed.
+ */
+static struct Curl_dns_entry *
+cache_addr(struct Curl_dnscache *cache,
+           Curl_addrinfo *addr,
+           char *id,
+           size_t idlen)
+{
+  struct Curl_dns_entry *dns;
+  struct Curl_dns_entry *dns2;
 
-  dns = fetch_addr(conn, hostname, port);
+  /* Create a new cache entry, with room for its id */
+  dns = calloc(1, sizeof(struct Curl_dns_entry) + idlen);
+  if(!dns)
+    return NULL;
 
-  if(dns)
-    dns->inuse++; /* we use it! */
+  dns->inuse = 1;   /* the cache has the first reference */
+  dns->addr = addr; /* this is the address(es) */
+  dns->cache = cache;
+  dns->id = (char *)(dns + 1);
+  dns->idlen = idlen;
+  memcpy(dns->id, id, idlen);
+  time(&dns->timestamp);
+  if(dns->timestamp == 0)
+    dns->timestamp = 1;   /* zero indicates CURLOPT_RESOLVE entry */
 
-  if(data->share)
-    Curl_share_unlock(data, CURL_LOCK_DATA_DNS);
+  if(expiry_add(cache, dns)) {
+    free(dns);
+    return NULL;
+  }
+
+  /* Store the resolved data in our DNS cache. */
+  dns2 = Curl_hash_add(&cache->hash, dns->id, idlen, (void *)dns);
+  if(!dns2) {
+    expiry_remove(cache, dns);
+    free(dns);
+    return NULL;
+  }
+
+  dns = dns2;
+  dns->inuse++;         /* mark entry as in-use */
 
   return dns;
 }
 
 /*
- * Curl_cache_addr() stores a 'Curl_addrinfo' struct in the DNS cache.
+ * Curl_cache_addr() stores a 'Curl_addrinfo' struct in the DNS cache. It
+ * takes and returns the appropriate locks.
  *
  * When calling Curl_resolv() has resulted in a response with a returned
  * address, we call this function to store the information in the dns
@@ -377,45 +679,27 @@ Curl_cache_addr(struct Curl_easy *data,
                 const char *hostname,
                 int port)
 {
+  char id_buf[HOSTCACHE_ID_SIZE];
   char *entry_id;
   size_t entry_len;
   struct Curl_dns_entry *dns;
-  struct Curl_dns_entry *dns2;
+  struct Curl_dnscache *cache;
+  int part;
 
   /* Create an entry id, based upon the hostname and port */
-  entry_id = create_hostcache_id(hostname, port);
+  entry_id = Curl_hostcache_id(hostname, port, id_buf);
   /* If we can't create the entry id, fail */
   if(!entry_id)
     return NULL;
   entry_len = strlen(entry_id);
 
-  /* Create a new cache entry */
-  dns = calloc(1, sizeof(struct Curl_dns_entry));
-  if(!dns) {
-    free(entry_id);
-    return NULL;
-  }
-
-  dns->inuse = 1;   /* the cache has the first reference */
-  dns->addr = addr; /* this is the address(es) */
-  time(&dns->timestamp);
-  if(dns->timestamp == 0)
-    dns->timestamp = 1;   /* zero indicates CURLOPT_RESOLVE entry */
-
-  /* Store the resolved data in our DNS cache. */
-  dns2 = Curl_hash_add(data->dns.hostcache, entry_id, entry_len+1,
-                       (void *)dns);
-  if(!dns2) {
-    free(dns);
-    free(entry_id);
-    return NULL;
-  }
-
-  dns = dns2;
-  dns->inuse++;         /* mark entry as in-use */
+  part = cache_part(data, entry_id, entry_len+1);
+  cache = cache_lock(data, part, TRUE);
+  dns = cache_addr(cache, addr, entry_id, entry_len+1);
+  cache_unlock(data, part, TRUE);
 
   /* free the allocated entry_id */
-  free(entry_id);
+  free_hostcache_id(entry_id, id_buf);
 
   return dns;
 }
@@ -450,22 +734,22 @@ int Curl_resolv(struct connectdata *conn,
   struct Curl_easy *data = conn->data;
   CURLcode result;
   int rc = CURLRESOLV_ERROR; /* default to failure */
+  bool stale;
 
   *entry = NULL;
 
-  if(data->share)
-    Curl_share_lock(data, CURL_LOCK_DATA_DNS, CURL_LOCK_ACCESS_SINGLE);
-
-  dns = fetch_addr(conn, hostname, port);
+  dns = cache_fetch(conn, hostname, port, &stale);
 
   if(dns) {
     infof(data, "Hostname %s was found in DNS cache\n", hostname);
-    dns->inuse++; /* we use it! */
     rc = CURLRESOLV_RESOLVED;
+    if(stale)
+      data->info.dns_cache_stale++;
+    else
+      data->info.dns_cache_hits++;
   }
-
-  if(data->share)
-    Curl_share_unlock(data, CURL_LOCK_DATA_DNS);
+  else
+    data->info.dns_cache_misses++;
 
   if(!dns) {
     /* The entry was not in the cache. Resolve it to IP address */
@@ -504,15 +788,9 @@ int Curl_resolv(struct connectdata *conn,
       }
     }
     else {
-      if(data->share)
-        Curl_share_lock(data, CURL_LOCK_DATA_DNS, CURL_LOCK_ACCESS_SINGLE);
-
       /* we got a response, store it in the cache */
       dns = Curl_cache_addr(data, addr, hostname, port);
 
-      if(data->share)
-        Curl_share_unlock(data, CURL_LOCK_DATA_DNS);
-
       if(!dns)
         /* returned failure, bail out nicely */
         Curl_freeaddrinfo(addr);
@@ -721,6 +999,26 @@ clean_up:
  */
 void Curl_resolv_unlock(struct Curl_easy *data, struct Curl_dns_entry *dns)
 {
+#ifdef USE_SHARE_LOCKS
+  if(data && split_cache(data)) {
+    /* other threads may take or drop references with the read lock too. An
+       entry only gets its last one dropped here when it has left the cache,
+       and nothing else can reach it then. */
+    int part = Curl_share_dns_part(dns->id, dns->idlen);
+    long inuse;
+
+    Curl_share_dns_lock(data->share, part, FALSE);
+    inuse = Curl_atomic_dec(&dns->inuse);
+    Curl_share_dns_unlock(data->share, part, FALSE);
+
+    if(!inuse) {
+      Curl_freeaddrinfo(dns->addr);
+      free(dns);
+    }
+    return;
+  }
+#endif
+
   if(data && data->share)
     Curl_share_lock(data, CURL_LOCK_DATA_DNS, CURL_LOCK_ACCESS_SINGLE);
 
@@ -745,13 +1043,44 @@ static void freednsentry(void *freethis)
   }
 }
 
+/*
+ * File-internal: the hash destructor, called when an entry leaves the cache
+ */
+static void hostcache_dtor(void *freethis)
+{
+  struct Curl_dns_entry *dns = (struct Curl_dns_entry *) freethis;
+
+  if(dns->expiry_index)
+    expiry_remove(dns->cache, dns);
+  if(dns->refresh) {
+    Curl_resolver_refresh_cancel(dns->refresh);
+    dns->refresh = NULL;
+  }
+  freednsentry(dns);
+}
+
 /*
  * Curl_mk_dnscache() inits a new DNS cache and returns success/failure.
  */
-int Curl_mk_dnscache(struct curl_hash *hash)
+int Curl_mk_dnscache(struct Curl_dnscache *cache)
 {
-  return Curl_hash_init(hash, 7, Curl_hash_str, Curl_str_key_compare,
-                        freednsentry);
+  cache->expiry = NULL;
+  cache->expiry_num = 0;
+  cache->expiry_size = 0;
+  return Curl_hash_init(&cache->hash, 7, Curl_hash_str, Curl_str_key_compare,
+                        hostcache_dtor);
+}
+
+/*
+ * Curl_dnscache_destroy() removes all entries from a DNS cache and frees it.
+ */
+void Curl_dnscache_destroy(struct Curl_dnscache *cache)
+{
+  Curl_hash_destroy(&cache->hash);
+  DEBUGASSERT(!cache->expiry_num);
+  Curl_safefree(cache->expiry);
+  cache->expiry_num = 0;
+  cache->expiry_size = 0;
 }
 
 /*
@@ -762,12 +1091,12 @@ int Curl_mk_dnscache(struct curl_hash *hash)
  */
 
 void Curl_hostcache_clean(struct Curl_easy *data,
-                          struct curl_hash *hash)
+                          struct Curl_dnscache *cache)
 {
   if(data && data->share)
     Curl_share_lock(data, CURL_LOCK_DATA_DNS, CURL_LOCK_ACCESS_SINGLE);
 
-  Curl_hash_clean(hash);
+  Curl_hash_clean(&cache->hash);
 
   if(data && data->share)
     Curl_share_unlock(data, CURL_LOCK_DATA_DNS);
@@ -785,8 +1114,11 @@ CURLcode Curl_loadhostpairs(struct Curl_easy *data)
     if(!hostp->data)
       continue;
     if(hostp->data[0] == '-') {
+      char id_buf[HOSTCACHE_ID_SIZE];
       char *entry_id;
       size_t entry_len;
+      struct Curl_dnscache *cache;
+      int part;
 
       if(2 != sscanf(hostp->data + 1, "%255[^:]:%d", hostname, &port)) {
         infof(data, "Couldn't parse CURLOPT_RESOLVE removal entry '%s'!\n",
@@ -795,31 +1127,33 @@ CURLcode Curl_loadhostpairs(struct Curl_easy *data)
       }
 
       /* Create an entry id, based upon the hostname and port */
-      entry_id = create_hostcache_id(hostname, port);
+      entry_id = Curl_hostcache_id(hostname, port, id_buf);
       /* If we can't create the entry id, fail */
       if(!entry_id) {
         return CURLE_OUT_OF_MEMORY;
       }
 
       entry_len = strlen(entry_id);
+      part = cache_part(data, entry_id, entry_len+1);
 
-      if(data->share)
-        Curl_share_lock(data, CURL_LOCK_DATA_DNS, CURL_LOCK_ACCESS_SINGLE);
+      cache = cache_lock(data, part, TRUE);
 
       /* delete entry, ignore if it didn't exist */
-      Curl_hash_delete(data->dns.hostcache, entry_id, entry_len+1);
+      Curl_hash_delete(&cache->hash, entry_id, entry_len+1);
 
-      if(data->share)
-        Curl_share_unlock(data, CURL_LOCK_DATA_DNS);
+      cache_unlock(data, part, TRUE);
 
       /* free the allocated entry_id again */
-      free(entry_id);
+      free_hostcache_id(entry_id, id_buf);
     }
     else {
       struct Curl_dns_entry *dns;
       Curl_addrinfo *addr;
+      char id_buf[HOSTCACHE_ID_SIZE];
       char *entry_id;
       size_t entry_len;
+      struct Curl_dnscache *cache;
+      int part;
 
       if(3 != sscanf(hostp->data, "%255[^:]:%d:%255s", hostname, &port,
                      address)) {
@@ -835,7 +1169,7 @@ CURLcode Curl_loadhostpairs(struct Curl_easy *data)
       }
 
       /* Create an entry id, based upon the hostname and port */
-      entry_id = create_hostcache_id(hostname, port);
+      entry_id = Curl_hostcache_id(hostname, port, id_buf);
       /* If we can't create the entry id, fail */
       if(!entry_id) {
         Curl_freeaddrinfo(addr);
@@ -843,21 +1177,20 @@ CURLcode Curl_loadhostpairs(struct Curl_easy *data)
       }
 
       entry_len = strlen(entry_id);
+      part = cache_part(data, entry_id, entry_len+1);
 
-      if(data->share)
-        Curl_share_lock(data, CURL_LOCK_DATA_DNS, CURL_LOCK_ACCESS_SINGLE);
+      cache = cache_lock(data, part, TRUE);
 
       /* See if its already in our dns cache */
-      dns = Curl_hash_pick(data->dns.hostcache, entry_id, entry_len+1);
-
-      /* free the allocated entry_id again */
-      free(entry_id);
+      dns = Curl_hash_pick(&cache->hash, entry_id, entry_len+1);
 
       if(!dns) {
         /* if not in the cache already, put this host in the cache */
-        dns = Curl_cache_addr(data, addr, hostname, port);
+        dns = cache_addr(cache, addr, entry_id, entry_len+1);
         if(dns) {
-          dns->timestamp = 0; /* mark as added by CURLOPT_RESOLVE */
+          /* mark as added by CURLOPT_RESOLVE, it never expires */
+          expiry_remove(dns->cache, dns);
+          dns->timestamp = 0;
           /* release the returned reference; the cache itself will keep the
            * entry alive: */
           dns->inuse--;
@@ -867,8 +1200,10 @@ CURLcode Curl_loadhostpairs(struct Curl_easy *data)
         /* this is a duplicate, free it again */
         Curl_freeaddrinfo(addr);
 
-      if(data->share)
-        Curl_share_unlock(data, CURL_LOCK_DATA_DNS);
+      cache_unlock(data, part, TRUE);
+
+      /* free the allocated entry_id again */
+      free_hostcache_id(entry_id, id_buf);
 
       if(!dns) {
         Curl_freeaddrinfo(addr);
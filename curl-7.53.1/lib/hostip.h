@@ -58,9 +58,9 @@ struct connectdata;
  * Global DNS cache is general badness. Do not use. This will be removed in
  * a future version. Use the share interface instead!
  *
- * Returns a struct curl_hash pointer on success, NULL on failure.
+ * Returns a struct Curl_dnscache pointer on success, NULL on failure.
  */
-struct curl_hash *Curl_global_host_cache_init(void);
+struct Curl_dnscache *Curl_global_host_cache_init(void);
 void Curl_global_host_cache_dtor(void);
 
 struct Curl_dns_entry {
@@ -69,6 +69,27 @@ struct Curl_dns_entry {
   time_t timestamp;
   /* use-counter, use Curl_resolv_unlock to release reference */
   long inuse;
+  /* the cache it is in, and its place in the expiry heap plus one or zero
+     when it is not in the heap */
+  struct Curl_dnscache *cache;
+  size_t expiry_index;
+  /* a resolve of the same name in the background, or NULL */
+  void *refresh;
+  /* the id it is stored with in the cache, and its length with the zero */
+  char *id;
+  size_t idlen;
+};
+
+/*
+ * A DNS cache. The entries are stored by their Curl_hostcache_id() in the
+ * hash, and the ones that expire are also kept in a heap ordered by their
+ * timestamps, so that pruning only needs to look at the expired ones.
+ */
+struct Curl_dnscache {
+  struct curl_hash hash;
+  struct Curl_dns_entry **expiry; /* the heap */
+  size_t expiry_num;              /* entries in the heap */
+  size_t expiry_size;             /* allocated size of the heap */
 };
 
 /*
@@ -125,7 +146,10 @@ void Curl_resolv_unlock(struct Curl_easy *data,
 void Curl_scan_cache_used(void *user, void *ptr);
 
 /* init a new dns cache and return success */
-int Curl_mk_dnscache(struct curl_hash *hash);
+int Curl_mk_dnscache(struct Curl_dnscache *cache);
+
+/* destroy a dns cache made with Curl_mk_dnscache() */
+void Curl_dnscache_destroy(struct Curl_dnscache *cache);
 
 /* prune old entries from the DNS cache */
 void Curl_hostcache_prune(struct Curl_easy *data);
@@ -182,6 +206,17 @@ struct Curl_dns_entry *
 Curl_fetch_addr(struct connectdata *conn,
                 const char *hostname,
                 int port);
+/* Curl_hostcache_id() builds its id in a buffer of this size when it fits */
+#define HOSTCACHE_ID_SIZE 128
+
+/*
+ * Curl_hostcache_id() returns the id that the DNS cache stores the host name
+ * and port with, in 'buf' or allocated if it is too long for it.
+ *
+ * Returns NULL on out of memory.
+ */
+char *Curl_hostcache_id(const char *name, int port, char *buf);
+
 /*
  * Curl_cache_addr() stores a 'Curl_addrinfo' struct in the DNS cache.
  *
@@ -235,7 +270,7 @@ CURLcode Curl_set_dns_local_ip6(struct Curl_easy *data,
 /*
  * Clean off entries from the cache
  */
-void Curl_hostcache_clean(struct Curl_easy *data, struct curl_hash *hash);
+void Curl_hostcache_clean(struct Curl_easy *data, struct Curl_dnscache *cache);
 
 /*
  * Destroy the hostcache of this handle.
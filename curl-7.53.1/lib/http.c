@@ -1119,6 +1119,11 @@ CURLcode Curl_add_buffer_send(Curl_send_buffer *in,
        must copy the data to the uploadbuffer first, since that is the buffer
        we will be using if this send is retried later.
     */
+    result = Curl_multi_uploadbuffer(conn->data);
+    if(result) {
+      Curl_add_buffer_free(in);
+      return result;
+    }
     memcpy(conn->data->state.uploadbuffer, ptr, sendsize);
     ptr = conn->data->state.uploadbuffer;
   }
@@ -1560,9 +1565,31 @@ enum proxy_use {
   HEADER_CONNECT  /* sending CONNECT to a proxy */
 };
 
-CURLcode Curl_add_custom_headers(struct connectdata *conn,
-                                 bool is_connect,
-                                 Curl_send_buffer *req_buffer)
+/*
+ * add_strings() appends the zero terminated strings given, up to a NULL, to
+ * the buffer. It is what Curl_add_bufferf() does with a "%s%s..." format,
+ * without the printf engine.
+ */
+static CURLcode add_strings(Curl_send_buffer *in, ...)
+{
+  CURLcode result = CURLE_OK;
+  const char *str;
+  va_list ap;
+
+  va_start(ap, in);
+  while(!result && ((str = va_arg(ap, const char *)) != NULL)) {
+    if(*str)
+      result = Curl_add_buffer(in, str, strlen(str));
+  }
+  va_end(ap);
+
+  return result;
+}
+
+static CURLcode add_custom_headers(struct connectdata *conn,
+                                   enum proxy_use proxy,
+                                   bool te, /* sending TE: and Connection: */
+                                   Curl_send_buffer *req_buffer)
 {
   char *ptr;
   struct curl_slist *h[2];
@@ -1570,14 +1597,7 @@ CURLcode Curl_add_custom_headers(struct connectdata *conn,
   int numlists=1; /* by default */
   struct Curl_easy *data = conn->data;
   int i;
-
-  enum proxy_use proxy;
-
-  if(is_connect)
-    proxy = HEADER_CONNECT;
-  else
-    proxy = conn->bits.httpproxy && !conn->bits.tunnel_proxy?
-      HEADER_PROXY:HEADER_SERVER;
+  CURLcode result;
 
   switch(proxy) {
   case HEADER_SERVER:
@@ -1628,7 +1648,7 @@ CURLcode Curl_add_custom_headers(struct connectdata *conn,
                      we will force length zero then */
                   checkprefix("Content-Length", headers->data))
             ;
-          else if(conn->allocptr.te &&
+          else if(te &&
                   /* when asking for Transfer-Encoding, don't pass on a custom
                      Connection: */
                   checkprefix("Connection", headers->data))
@@ -1638,8 +1658,7 @@ CURLcode Curl_add_custom_headers(struct connectdata *conn,
             /* HTTP/2 doesn't support chunked requests */
             ;
           else {
-            CURLcode result = Curl_add_bufferf(req_buffer, "%s\r\n",
-                                               headers->data);
+            result = add_strings(req_buffer, headers->data, "\r\n", NULL);
             if(result)
               return result;
           }
@@ -1658,12 +1677,13 @@ CURLcode Curl_add_custom_headers(struct connectdata *conn,
           }
           else {
             if(*(--ptr) == ';') {
-              CURLcode result;
-
-              /* send no-value custom header if terminated by semicolon */
-              *ptr = ':';
-              result = Curl_add_bufferf(req_buffer, "%s\r\n",
-                                        headers->data);
+              /* send no-value custom header if terminated by semicolon, with
+                 a colon in its place. The list is the application's, so it
+                 is left as it is. */
+              result = Curl_add_buffer(req_buffer, headers->data,
+                                       (size_t)(ptr - headers->data));
+              if(!result)
+                result = Curl_add_buffer(req_buffer, ":\r\n", 3);
               if(result)
                 return result;
             }
@@ -1677,6 +1697,160 @@ CURLcode Curl_add_custom_headers(struct connectdata *conn,
   return CURLE_OK;
 }
 
+CURLcode Curl_add_custom_headers(struct connectdata *conn,
+                                 bool is_connect,
+                                 Curl_send_buffer *req_buffer)
+{
+  enum proxy_use proxy;
+
+  if(is_connect)
+    proxy = HEADER_CONNECT;
+  else
+    proxy = conn->bits.httpproxy && !conn->bits.tunnel_proxy?
+      HEADER_PROXY:HEADER_SERVER;
+
+  return add_custom_headers(conn, proxy, FALSE, req_buffer);
+}
+
+/* the properties of a request, besides the options, that the request
+   template depends on */
+#define TMPL_PROXY    (1<<0) /* plain request to a HTTP proxy */
+#define TMPL_HOST     (1<<1) /* conn->allocptr.host is set */
+#define TMPL_POSTFORM (1<<2) /* multipart formpost */
+#define TMPL_AUTHNEG  (1<<3) /* auth negotiation with an empty body */
+#define TMPL_HTTP2    (1<<4) /* over HTTP/2 */
+
+static int reqtmpl_props(struct connectdata *conn)
+{
+  int props = 0;
+
+  if(conn->bits.httpproxy && !conn->bits.tunnel_proxy)
+    props |= TMPL_PROXY;
+  if(conn->allocptr.host)
+    props |= TMPL_HOST;
+  if(conn->data->set.httpreq == HTTPREQ_POST_FORM)
+    props |= TMPL_POSTFORM;
+  if(conn->bits.authneg)
+    props |= TMPL_AUTHNEG;
+  if(conn->httpversion == 20)
+    props |= TMPL_HTTP2;
+  return props;
+}
+
+/* What a header list looks like now. An application may have appended to
+   it since it was set, but then either the count or the last entry differ. */
+static void reqtmpl_list(struct reqtmpl_list *shape, struct curl_slist *list)
+{
+  shape->head = list;
+  shape->last = NULL;
+  shape->count = 0;
+  for(; list; list = list->next) {
+    shape->last = list;
+    shape->count++;
+  }
+}
+
+static bool reqtmpl_list_same(const struct reqtmpl_list *shape,
+                              struct curl_slist *list)
+{
+  struct reqtmpl_list now;
+  if(shape->head != list)
+    return FALSE;
+  reqtmpl_list(&now, list);
+  return (now.count == shape->count) && (now.last == shape->last);
+}
+
+/*
+ * reqtmpl_get() returns the template for a request with the given
+ * properties, rendering it again when the one kept from a previous request
+ * doesn't fit. The template holds the User-Agent:, Accept:, TE: and
+ * Accept-Encoding: headers and then the custom headers, which are the parts
+ * of a request that are the same every time the handle is used.
+ */
+static CURLcode reqtmpl_get(struct connectdata *conn, int props,
+                            struct http_reqtmpl **tmplp)
+{
+  struct Curl_easy *data = conn->data;
+  struct http_reqtmpl *tmpl = &data->state.reqtmpl;
+  Curl_send_buffer *buf;
+  CURLcode result = CURLE_OK;
+  bool te = FALSE;
+
+  *tmplp = tmpl;
+  if(tmpl->valid && (tmpl->props == props) &&
+     reqtmpl_list_same(&tmpl->headers, data->set.headers) &&
+     reqtmpl_list_same(&tmpl->proxyheaders, data->set.proxyheaders))
+    return CURLE_OK;
+
+  Curl_http_reqtmpl_reset(data);
+
+  buf = Curl_add_buffer_init();
+  if(!buf)
+    return CURLE_OUT_OF_MEMORY;
+
+  if(data->set.str[STRING_USERAGENT] && *data->set.str[STRING_USERAGENT] &&
+     !Curl_checkheaders(conn, "User-Agent:"))
+    result = Curl_add_bufferf(buf, "User-Agent: %s\r\n",
+                              data->set.str[STRING_USERAGENT]);
+
+  if(!result && !Curl_checkheaders(conn, "Accept:"))
+    result = Curl_add_buffer(buf, "Accept: */*\r\n", 13);
+
+#ifdef HAVE_LIBZ
+  /* we only consider transfer-encoding magic if libz support is built-in */
+
+  if(!result && !Curl_checkheaders(conn, "TE:") &&
+     data->set.http_transfer_encoding) {
+    /* When we are to insert a TE: header in the request, we must also insert
+       TE in a Connection: header, so we need to merge the custom provided
+       Connection: header and prevent the original to get sent. Note that if
+       the user has inserted his/hers own TE: header we don't do this magic
+       but then assume that the user will handle it all! */
+    char *cptr = Curl_checkheaders(conn, "Connection:");
+#define TE_HEADER "TE: gzip\r\n"
+
+    /* Create the (updated) Connection: header */
+    result = cptr? Curl_add_bufferf(buf, "%s, TE\r\n" TE_HEADER, cptr):
+      add_strings(buf, "Connection: TE\r\n" TE_HEADER, NULL);
+    te = TRUE;
+  }
+#endif
+
+  if(!result && data->set.str[STRING_ENCODING] &&
+     *data->set.str[STRING_ENCODING] &&
+     !Curl_checkheaders(conn, "Accept-Encoding:"))
+    result = Curl_add_bufferf(buf, "Accept-Encoding: %s\r\n",
+                              data->set.str[STRING_ENCODING]);
+
+  /* the add_buffer functions free the buffer when they fail */
+  if(result)
+    return result;
+
+  tmpl->custom = buf->size_used;
+  result = add_custom_headers(conn, (props & TMPL_PROXY)?
+                              HEADER_PROXY:HEADER_SERVER, te, buf);
+  if(result)
+    return result;
+
+  /* keep the rendered lines, not the buffer struct around them */
+  tmpl->lines = buf->buffer;
+  tmpl->len = buf->size_used;
+  free(buf);
+
+  tmpl->props = props;
+  reqtmpl_list(&tmpl->headers, data->set.headers);
+  reqtmpl_list(&tmpl->proxyheaders, data->set.proxyheaders);
+  tmpl->valid = TRUE;
+
+  return CURLE_OK;
+}
+
+void Curl_http_reqtmpl_reset(struct Curl_easy *data)
+{
+  Curl_safefree(data->state.reqtmpl.lines);
+  data->state.reqtmpl.valid = FALSE;
+}
+
 CURLcode Curl_add_timecondition(struct Curl_easy *data,
                                 Curl_send_buffer *req_buffer)
 {
@@ -1758,6 +1932,7 @@ CURLcode Curl_http(struct connectdata *conn, bool *done)
   curl_off_t included_body = 0;
   const char *httpstring;
   Curl_send_buffer *req_buffer;
+  struct http_reqtmpl *tmpl;
   curl_off_t postsize = 0; /* curl_off_t to handle large file sizes */
   int seekerr = CURL_SEEKFUNC_OK;
 
@@ -1886,43 +2061,6 @@ CURLcode Curl_http(struct connectdata *conn, bool *done)
     addcookies = data->set.str[STRING_COOKIE];
 #endif
 
-  if(!Curl_checkheaders(conn, "Accept-Encoding:") &&
-     data->set.str[STRING_ENCODING]) {
-    Curl_safefree(conn->allocptr.accept_encoding);
-    conn->allocptr.accept_encoding =
-      aprintf("Accept-Encoding: %s\r\n", data->set.str[STRING_ENCODING]);
-    if(!conn->allocptr.accept_encoding)
-      return CURLE_OUT_OF_MEMORY;
-  }
-  else {
-    Curl_safefree(conn->allocptr.accept_encoding);
-    conn->allocptr.accept_encoding = NULL;
-  }
-
-#ifdef HAVE_LIBZ
-  /* we only consider transfer-encoding magic if libz support is built-in */
-
-  if(!Curl_checkheaders(conn, "TE:") &&
-     data->set.http_transfer_encoding) {
-    /* When we are to insert a TE: header in the request, we must also insert
-       TE in a Connection: header, so we need to merge the custom provided
-       Connection: header and prevent the original to get sent. Note that if
-       the user has inserted his/hers own TE: header we don't do this magic
-       but then assume that the user will handle it all! */
-    char *cptr = Curl_checkheaders(conn, "Connection:");
-#define TE_HEADER "TE: gzip\r\n"
-
-    Curl_safefree(conn->allocptr.te);
-
-    /* Create the (updated) Connection: header */
-    conn->allocptr.te = cptr? aprintf("%s, TE\r\n" TE_HEADER, cptr):
-      strdup("Connection: TE\r\n" TE_HEADER);
-
-    if(!conn->allocptr.te)
-      return CURLE_OUT_OF_MEMORY;
-  }
-#endif
-
   ptr = Curl_checkheaders(conn, "Transfer-Encoding:");
   if(ptr) {
     /* Some kind of TE is requested, check if 'chunked' is chosen */
@@ -2114,8 +2252,6 @@ CURLcode Curl_http(struct connectdata *conn, bool *done)
       return result;
   }
 
-  http->p_accept = Curl_checkheaders(conn, "Accept:")?NULL:"Accept: */*\r\n";
-
   if(( (HTTPREQ_POST == httpreq) ||
        (HTTPREQ_POST_FORM == httpreq) ||
        (HTTPREQ_PUT == httpreq) ) &&
@@ -2240,6 +2376,11 @@ CURLcode Curl_http(struct connectdata *conn, bool *done)
 
   httpstring = get_http_string(data, conn);
 
+  /* the headers that are the same every time */
+  result = reqtmpl_get(conn, reqtmpl_props(conn), &tmpl);
+  if(result)
+    return result;
+
   /* initialize a dynamic send-buffer */
   req_buffer = Curl_add_buffer_init();
 
@@ -2248,7 +2389,7 @@ CURLcode Curl_http(struct connectdata *conn, bool *done)
 
   /* add the main request stuff */
   /* GET/HEAD/POST/PUT */
-  result = Curl_add_bufferf(req_buffer, "%s ", request);
+  result = add_strings(req_buffer, request, " ", NULL);
   if(result)
     return result;
 
@@ -2263,47 +2404,32 @@ CURLcode Curl_http(struct connectdata *conn, bool *done)
     return result;
 
   result =
-    Curl_add_bufferf(req_buffer,
-                     "%s" /* ftp typecode (;type=x) */
-                     " HTTP/%s\r\n" /* HTTP version */
-                     "%s" /* host */
-                     "%s" /* proxyuserpwd */
-                     "%s" /* userpwd */
-                     "%s" /* range */
-                     "%s" /* user agent */
-                     "%s" /* accept */
-                     "%s" /* TE: */
-                     "%s" /* accept-encoding */
-                     "%s" /* referer */
-                     "%s" /* Proxy-Connection */
-                     "%s",/* transfer-encoding */
-
-                     ftp_typecode,
-                     httpstring,
-                     (conn->allocptr.host?conn->allocptr.host:""),
-                     conn->allocptr.proxyuserpwd?
-                     conn->allocptr.proxyuserpwd:"",
-                     conn->allocptr.userpwd?conn->allocptr.userpwd:"",
-                     (data->state.use_range && conn->allocptr.rangeline)?
-                     conn->allocptr.rangeline:"",
-                     (data->set.str[STRING_USERAGENT] &&
-                      *data->set.str[STRING_USERAGENT] &&
-                      conn->allocptr.uagent)?
-                     conn->allocptr.uagent:"",
-                     http->p_accept?http->p_accept:"",
-                     conn->allocptr.te?conn->allocptr.te:"",
-                     (data->set.str[STRING_ENCODING] &&
-                      *data->set.str[STRING_ENCODING] &&
-                      conn->allocptr.accept_encoding)?
-                     conn->allocptr.accept_encoding:"",
-                     (data->change.referer && conn->allocptr.ref)?
-                     conn->allocptr.ref:"" /* Referer: <data> */,
-                     (conn->bits.httpproxy &&
-                      !conn->bits.tunnel_proxy &&
-                      !Curl_checkProxyheaders(conn, "Proxy-Connection:"))?
-                     "Proxy-Connection: Keep-Alive\r\n":"",
-                     te
-      );
+    add_strings(req_buffer,
+                ftp_typecode, /* ;type=x */
+                " HTTP/", httpstring, "\r\n", /* HTTP version */
+                (conn->allocptr.host?conn->allocptr.host:""),
+                conn->allocptr.proxyuserpwd?
+                conn->allocptr.proxyuserpwd:"",
+                conn->allocptr.userpwd?conn->allocptr.userpwd:"",
+                (data->state.use_range && conn->allocptr.rangeline)?
+                conn->allocptr.rangeline:"",
+                NULL);
+
+  /* user agent, accept, TE: and accept-encoding */
+  if(!result && tmpl->custom)
+    result = Curl_add_buffer(req_buffer, tmpl->lines, tmpl->custom);
+
+  if(!result)
+    result =
+      add_strings(req_buffer,
+                  (data->change.referer && conn->allocptr.ref)?
+                  conn->allocptr.ref:"" /* Referer: <data> */,
+                  (conn->bits.httpproxy &&
+                   !conn->bits.tunnel_proxy &&
+                   !Curl_checkProxyheaders(conn, "Proxy-Connection:"))?
+                  "Proxy-Connection: Keep-Alive\r\n":"",
+                  te, /* transfer-encoding */
+                  NULL);
 
   /* clear userpwd to avoid re-using credentials from re-used connections */
   Curl_safefree(conn->allocptr.userpwd);
@@ -2353,14 +2479,8 @@ CURLcode Curl_http(struct connectdata *conn, bool *done)
       /* now loop through all cookies that matched */
       while(co) {
         if(co->value) {
-          if(0 == count) {
-            result = Curl_add_bufferf(req_buffer, "Cookie: ");
-            if(result)
-              break;
-          }
-          result = Curl_add_bufferf(req_buffer,
-                                    "%s%s=%s", count?"; ":"",
-                                    co->name, co->value);
+          result = add_strings(req_buffer, count?"; ":"Cookie: ",
+                               co->name, "=", co->value, NULL);
           if(result)
             break;
           count++;
@@ -2370,13 +2490,9 @@ CURLcode Curl_http(struct connectdata *conn, bool *done)
       Curl_cookie_freelist(store);
     }
     if(addcookies && !result) {
-      if(!count)
-        result = Curl_add_bufferf(req_buffer, "Cookie: ");
-      if(!result) {
-        result = Curl_add_bufferf(req_buffer, "%s%s", count?"; ":"",
-                                  addcookies);
-        count++;
-      }
+      result = add_strings(req_buffer, count?"; ":"Cookie: ", addcookies,
+                           NULL);
+      count++;
     }
     if(count && !result)
       result = Curl_add_buffer(req_buffer, "\r\n", 2);
@@ -2390,9 +2506,12 @@ CURLcode Curl_http(struct connectdata *conn, bool *done)
   if(result)
     return result;
 
-  result = Curl_add_custom_headers(conn, FALSE, req_buffer);
-  if(result)
-    return result;
+  if(tmpl->len > tmpl->custom) {
+    result = Curl_add_buffer(req_buffer, tmpl->lines + tmpl->custom,
+                             tmpl->len - tmpl->custom);
+    if(result)
+      return result;
+  }
 
   http->postdata = NULL;  /* nothing to post at this point */
   Curl_pgrsSetUploadSize(data, -1); /* upload size is unknown atm */
@@ -2880,6 +2999,89 @@ static CURLcode header_append(struct Curl_easy *data,
   return CURLE_OK;
 }
 
+/* The response headers that libcurl acts on */
+enum resp_header {
+  RESP_OTHER,
+  RESP_CONNECTION,
+  RESP_CONTENT_ENCODING,
+  RESP_CONTENT_LENGTH,
+  RESP_CONTENT_RANGE,
+  RESP_CONTENT_TYPE,
+  RESP_LAST_MODIFIED,
+  RESP_LOCATION,
+  RESP_PROXY_AUTHENTICATE,
+  RESP_PROXY_CONNECTION,
+  RESP_SERVER,
+  RESP_SET_COOKIE,
+  RESP_TRANSFER_ENCODING,
+  RESP_WWW_AUTHENTICATE
+};
+
+struct known_header {
+  const char *name;
+  size_t len;
+  enum resp_header id;
+};
+
+#define KNOWN_HEADER(name, id) { name, sizeof(name) - 1, id }
+#define NO_HEADER { NULL, 0, RESP_OTHER }
+
+/*
+ * The known headers, where known_hash() of their names puts them. The hash
+ * has no collisions for these names, so one comparison tells whether a
+ * header is one of them. Upper and lower case letters differ by 32, so the
+ * hash does not depend on the case of the name.
+ */
+static const struct known_header known_headers[32] = {
+  KNOWN_HEADER("Set-Cookie", RESP_SET_COOKIE),                  /* 0 */
+  KNOWN_HEADER("Server", RESP_SERVER),                          /* 1 */
+  NO_HEADER, NO_HEADER, NO_HEADER, NO_HEADER,
+  KNOWN_HEADER("Last-Modified", RESP_LAST_MODIFIED),            /* 6 */
+  KNOWN_HEADER("Connection", RESP_CONNECTION),                  /* 7 */
+  KNOWN_HEADER("Content-Range", RESP_CONTENT_RANGE),            /* 8 */
+  NO_HEADER, NO_HEADER, NO_HEADER, NO_HEADER,
+  KNOWN_HEADER("Transfer-Encoding", RESP_TRANSFER_ENCODING),    /* 13 */
+  NO_HEADER, NO_HEADER,
+  KNOWN_HEADER("Content-Type", RESP_CONTENT_TYPE),              /* 16 */
+  KNOWN_HEADER("WWW-Authenticate", RESP_WWW_AUTHENTICATE),      /* 17 */
+  KNOWN_HEADER("Content-Encoding", RESP_CONTENT_ENCODING),      /* 18 */
+  NO_HEADER, NO_HEADER, NO_HEADER,
+  KNOWN_HEADER("Content-Length", RESP_CONTENT_LENGTH),          /* 22 */
+  KNOWN_HEADER("Proxy-Connection", RESP_PROXY_CONNECTION),      /* 23 */
+  KNOWN_HEADER("Location", RESP_LOCATION),                      /* 24 */
+  NO_HEADER, NO_HEADER, NO_HEADER, NO_HEADER, NO_HEADER,
+  KNOWN_HEADER("Proxy-authenticate", RESP_PROXY_AUTHENTICATE),  /* 30 */
+  NO_HEADER
+};
+
+/* the length plus the fourth and the second last letters of the name */
+#define known_hash(name, len) \
+  (((len) + (unsigned char)(name)[3] + (unsigned char)(name)[(len) - 2]) & 31)
+
+/*
+ * header_id() tells which of the known headers a header line is, or
+ * RESP_OTHER. The name must be followed by a colon, as in "Name:".
+ */
+static enum resp_header header_id(const char *line, size_t length)
+{
+  const char *colon = memchr(line, ':', length);
+  const struct known_header *known;
+  size_t len;
+
+  if(!colon)
+    return RESP_OTHER;
+
+  len = colon - line;
+  if(len < 4)
+    return RESP_OTHER;
+
+  known = &known_headers[known_hash(line, len)];
+  if((known->len == len) && strncasecompare(known->name, line, len))
+    return known->id;
+
+  return RESP_OTHER;
+}
+
 static void print_http_error(struct Curl_easy *data)
 {
   struct SingleRequest *k = &data->req;
@@ -2933,6 +3135,9 @@ CURLcode Curl_http_readwrite_headers(struct Curl_easy *data,
     size_t rest_length;
     size_t full_length;
     int writetype;
+    enum resp_header id;
+    bool in_place = FALSE;
+    char next = 0;
 
     /* str_start is start of line within buf */
     k->str_start = k->str;
@@ -2968,12 +3173,28 @@ CURLcode Curl_http_readwrite_headers(struct Curl_easy *data,
 
     full_length = k->str - k->str_start;
 
-    result = header_append(data, k, full_length);
-    if(result)
-      return result;
+    if(k->headerline && !k->hbuflen &&
+       (0x0a != *k->str_start) && (0x0d != *k->str_start)) {
+      /* A header line that is all in the receive buffer is used from there.
+         It is zero terminated in place of the first byte of the next line,
+         which is put back when the line has been dealt with. The status
+         line and the end of the headers always go through the headerbuff,
+         which the code that follows expects to find them in. */
+      in_place = TRUE;
+      next = *k->str;
+      *k->str = 0;
+      k->p = k->str_start;
+      k->hbuflen = full_length;
+      k->end_ptr = k->str;
+    }
+    else {
+      result = header_append(data, k, full_length);
+      if(result)
+        return result;
 
-    k->end_ptr = k->hbufp;
-    k->p = data->state.headerbuff;
+      k->end_ptr = k->hbufp;
+      k->p = data->state.headerbuff;
+    }
 
     /****
      * We now have a FULL header line that p points to
@@ -3457,34 +3678,38 @@ CURLcode Curl_http_readwrite_headers(struct Curl_easy *data,
     if(result)
       return result;
 
-    /* Check for Content-Length: header lines to get size */
-    if(!k->ignorecl && !data->set.ignorecl &&
-       checkprefix("Content-Length:", k->p)) {
-      curl_off_t contentlength = curlx_strtoofft(k->p+15, NULL, 10);
-      if(data->set.max_filesize &&
-         contentlength > data->set.max_filesize) {
-        failf(data, "Maximum file size exceeded");
-        return CURLE_FILESIZE_EXCEEDED;
-      }
-      if(contentlength >= 0) {
-        k->size = contentlength;
-        k->maxdownload = k->size;
-        /* we set the progress download size already at this point
-           just to make it easier for apps/callbacks to extract this
-           info as soon as possible */
-        Curl_pgrsSetDownloadSize(data, k->size);
-      }
-      else {
-        /* Negative Content-Length is really odd, and we know it
-           happens for example when older Apache servers send large
-           files */
-        streamclose(conn, "negative content-length");
-        infof(data, "Negative content-length: %" CURL_FORMAT_CURL_OFF_T
-              ", closing after transfer\n", contentlength);
+    id = header_id(k->p, k->hbuflen);
+    switch(id) {
+    case RESP_CONTENT_LENGTH:
+      /* Check for Content-Length: header lines to get size */
+      if(!k->ignorecl && !data->set.ignorecl) {
+        curl_off_t contentlength = curlx_strtoofft(k->p+15, NULL, 10);
+        if(data->set.max_filesize &&
+           contentlength > data->set.max_filesize) {
+          failf(data, "Maximum file size exceeded");
+          return CURLE_FILESIZE_EXCEEDED;
+        }
+        if(contentlength >= 0) {
+          k->size = contentlength;
+          k->maxdownload = k->size;
+          /* we set the progress download size already at this point
+             just to make it easier for apps/callbacks to extract this
+             info as soon as possible */
+          Curl_pgrsSetDownloadSize(data, k->size);
+        }
+        else {
+          /* Negative Content-Length is really odd, and we know it
+             happens for example when older Apache servers send large
+             files */
+          streamclose(conn, "negative content-length");
+          infof(data, "Negative content-length: %" CURL_FORMAT_CURL_OFF_T
+                ", closing after transfer\n", contentlength);
+        }
       }
-    }
-    /* check for Content-Type: header lines to get the MIME-type */
-    else if(checkprefix("Content-Type:", k->p)) {
+      break;
+
+    case RESP_CONTENT_TYPE: {
+      /* check for Content-Type: header lines to get the MIME-type */
       char *contenttype = Curl_copy_header_value(k->p);
       if(!contenttype)
         return CURLE_OUT_OF_MEMORY;
@@ -3495,8 +3720,10 @@ CURLcode Curl_http_readwrite_headers(struct Curl_easy *data,
         Curl_safefree(data->info.contenttype);
         data->info.contenttype = contenttype;
       }
+      break;
     }
-    else if(checkprefix("Server:", k->p)) {
+
+    case RESP_SERVER:
       if(conn->httpversion < 20) {
         /* only do this for non-h2 servers */
         char *server_name = Curl_copy_header_value(k->p);
@@ -3508,52 +3735,57 @@ CURLcode Curl_http_readwrite_headers(struct Curl_easy *data,
         }
         free(server_name);
       }
-    }
-    else if((conn->httpversion == 10) &&
-            conn->bits.httpproxy &&
-            Curl_compareheader(k->p,
-                               "Proxy-Connection:", "keep-alive")) {
-      /*
-       * When a HTTP/1.0 reply comes when using a proxy, the
-       * 'Proxy-Connection: keep-alive' line tells us the
-       * connection will be kept alive for our pleasure.
-       * Default action for 1.0 is to close.
-       */
-      connkeep(conn, "Proxy-Connection keep-alive"); /* don't close */
-      infof(data, "HTTP/1.0 proxy connection set to keep alive!\n");
-    }
-    else if((conn->httpversion == 11) &&
-            conn->bits.httpproxy &&
-            Curl_compareheader(k->p,
-                               "Proxy-Connection:", "close")) {
-      /*
-       * We get a HTTP/1.1 response from a proxy and it says it'll
-       * close down after this transfer.
-       */
-      connclose(conn, "Proxy-Connection: asked to close after done");
-      infof(data, "HTTP/1.1 proxy connection set close!\n");
-    }
-    else if((conn->httpversion == 10) &&
-            Curl_compareheader(k->p, "Connection:", "keep-alive")) {
-      /*
-       * A HTTP/1.0 reply with the 'Connection: keep-alive' line
-       * tells us the connection will be kept alive for our
-       * pleasure.  Default action for 1.0 is to close.
-       *
-       * [RFC2068, section 19.7.1] */
-      connkeep(conn, "Connection keep-alive");
-      infof(data, "HTTP/1.0 connection set to keep alive!\n");
-    }
-    else if(Curl_compareheader(k->p, "Connection:", "close")) {
-      /*
-       * [RFC 2616, section 8.1.2.1]
-       * "Connection: close" is HTTP/1.1 language and means that
-       * the connection will close when this request has been
-       * served.
-       */
-      streamclose(conn, "Connection: close used");
-    }
-    else if(checkprefix("Transfer-Encoding:", k->p)) {
+      break;
+
+    case RESP_PROXY_CONNECTION:
+      if((conn->httpversion == 10) &&
+         conn->bits.httpproxy &&
+         Curl_compareheader(k->p, "Proxy-Connection:", "keep-alive")) {
+        /*
+         * When a HTTP/1.0 reply comes when using a proxy, the
+         * 'Proxy-Connection: keep-alive' line tells us the
+         * connection will be kept alive for our pleasure.
+         * Default action for 1.0 is to close.
+         */
+        connkeep(conn, "Proxy-Connection keep-alive"); /* don't close */
+        infof(data, "HTTP/1.0 proxy connection set to keep alive!\n");
+      }
+      else if((conn->httpversion == 11) &&
+              conn->bits.httpproxy &&
+              Curl_compareheader(k->p, "Proxy-Connection:", "close")) {
+        /*
+         * We get a HTTP/1.1 response from a proxy and it says it'll
+         * close down after this transfer.
+         */
+        connclose(conn, "Proxy-Connection: asked to close after done");
+        infof(data, "HTTP/1.1 proxy connection set close!\n");
+      }
+      break;
+
+    case RESP_CONNECTION:
+      if((conn->httpversion == 10) &&
+         Curl_compareheader(k->p, "Connection:", "keep-alive")) {
+        /*
+         * A HTTP/1.0 reply with the 'Connection: keep-alive' line
+         * tells us the connection will be kept alive for our
+         * pleasure.  Default action for 1.0 is to close.
+         *
+         * [RFC2068, section 19.7.1] */
+        connkeep(conn, "Connection keep-alive");
+        infof(data, "HTTP/1.0 connection set to keep alive!\n");
+      }
+      else if(Curl_compareheader(k->p, "Connection:", "close")) {
+        /*
+         * [RFC 2616, section 8.1.2.1]
+         * "Connection: close" is HTTP/1.1 language and means that
+         * the connection will close when this request has been
+         * served.
+         */
+        streamclose(conn, "Connection: close used");
+      }
+      break;
+
+    case RESP_TRANSFER_ENCODING: {
       /* One or more encodings. We check for chunked and/or a compression
          algorithm. */
       /*
@@ -3609,34 +3841,37 @@ CURLcode Curl_http_readwrite_headers(struct Curl_easy *data,
           break;
 
       }
-
+      break;
     }
-    else if(checkprefix("Content-Encoding:", k->p) &&
-            data->set.str[STRING_ENCODING]) {
-      /*
-       * Process Content-Encoding. Look for the values: identity,
-       * gzip, deflate, compress, x-gzip and x-compress. x-gzip and
-       * x-compress are the same as gzip and compress. (Sec 3.5 RFC
-       * 2616). zlib cannot handle compress.  However, errors are
-       * handled further down when the response body is processed
-       */
-      char *start;
 
-      /* Find the first non-space letter */
-      start = k->p + 17;
-      while(*start && ISSPACE(*start))
-        start++;
-
-      /* Record the content-encoding for later use */
-      if(checkprefix("identity", start))
-        k->auto_decoding = IDENTITY;
-      else if(checkprefix("deflate", start))
-        k->auto_decoding = DEFLATE;
-      else if(checkprefix("gzip", start)
-              || checkprefix("x-gzip", start))
-        k->auto_decoding = GZIP;
-    }
-    else if(checkprefix("Content-Range:", k->p)) {
+    case RESP_CONTENT_ENCODING:
+      if(data->set.str[STRING_ENCODING]) {
+        /*
+         * Process Content-Encoding. Look for the values: identity,
+         * gzip, deflate, compress, x-gzip and x-compress. x-gzip and
+         * x-compress are the same as gzip and compress. (Sec 3.5 RFC
+         * 2616). zlib cannot handle compress.  However, errors are
+         * handled further down when the response body is processed
+         */
+        char *start;
+
+        /* Find the first non-space letter */
+        start = k->p + 17;
+        while(*start && ISSPACE(*start))
+          start++;
+
+        /* Record the content-encoding for later use */
+        if(checkprefix("identity", start))
+          k->auto_decoding = IDENTITY;
+        else if(checkprefix("deflate", start))
+          k->auto_decoding = DEFLATE;
+        else if(checkprefix("gzip", start)
+                || checkprefix("x-gzip", start))
+          k->auto_decoding = GZIP;
+      }
+      break;
+
+    case RESP_CONTENT_RANGE: {
       /* Content-Range: bytes [num]-
          Content-Range: bytes: [num]-
          Content-Range: [num]-
@@ -3664,78 +3899,89 @@ CURLcode Curl_http_readwrite_headers(struct Curl_easy *data,
       }
       else
         data->state.resume_from = 0; /* get everything */
+      break;
     }
+
+    case RESP_SET_COOKIE:
 #if !defined(CURL_DISABLE_COOKIES)
-    else if(data->cookies &&
-            checkprefix("Set-Cookie:", k->p)) {
-      Curl_share_lock(data, CURL_LOCK_DATA_COOKIE,
-                      CURL_LOCK_ACCESS_SINGLE);
-      Curl_cookie_add(data,
-                      data->cookies, TRUE, k->p+11,
-                      /* If there is a custom-set Host: name, use it
-                         here, or else use real peer host name. */
-                      conn->allocptr.cookiehost?
-                      conn->allocptr.cookiehost:conn->host.name,
-                      data->state.path);
-      Curl_share_unlock(data, CURL_LOCK_DATA_COOKIE);
-    }
+      if(data->cookies) {
+        Curl_share_lock(data, CURL_LOCK_DATA_COOKIE,
+                        CURL_LOCK_ACCESS_SINGLE);
+        Curl_cookie_add(data,
+                        data->cookies, TRUE, k->p+11,
+                        /* If there is a custom-set Host: name, use it
+                           here, or else use real peer host name. */
+                        conn->allocptr.cookiehost?
+                        conn->allocptr.cookiehost:conn->host.name,
+                        data->state.path);
+        Curl_share_unlock(data, CURL_LOCK_DATA_COOKIE);
+      }
 #endif
-    else if(checkprefix("Last-Modified:", k->p) &&
-            (data->set.timecondition || data->set.get_filetime) ) {
-      time_t secs=time(NULL);
-      k->timeofdoc = curl_getdate(k->p+strlen("Last-Modified:"),
-                                  &secs);
-      if(data->set.get_filetime)
-        data->info.filetime = (long)k->timeofdoc;
-    }
-    else if((checkprefix("WWW-Authenticate:", k->p) &&
-             (401 == k->httpcode)) ||
-            (checkprefix("Proxy-authenticate:", k->p) &&
-             (407 == k->httpcode))) {
-
-      bool proxy = (k->httpcode == 407) ? TRUE : FALSE;
-      char *auth = Curl_copy_header_value(k->p);
-      if(!auth)
-        return CURLE_OUT_OF_MEMORY;
+      break;
 
-      result = Curl_http_input_auth(conn, proxy, auth);
+    case RESP_LAST_MODIFIED:
+      if(data->set.timecondition || data->set.get_filetime) {
+        time_t secs=time(NULL);
+        k->timeofdoc = curl_getdate(k->p+strlen("Last-Modified:"),
+                                    &secs);
+        if(data->set.get_filetime)
+          data->info.filetime = (long)k->timeofdoc;
+      }
+      break;
 
-      free(auth);
+    case RESP_WWW_AUTHENTICATE:
+    case RESP_PROXY_AUTHENTICATE:
+      if(k->httpcode == ((id == RESP_PROXY_AUTHENTICATE) ? 407 : 401)) {
+        bool proxy = (k->httpcode == 407) ? TRUE : FALSE;
+        char *auth = Curl_copy_header_value(k->p);
+        if(!auth)
+          return CURLE_OUT_OF_MEMORY;
 
-      if(result)
-        return result;
-    }
-    else if((k->httpcode >= 300 && k->httpcode < 400) &&
-            checkprefix("Location:", k->p) &&
-            !data->req.location) {
-      /* this is the URL that the server advises us to use instead */
-      char *location = Curl_copy_header_value(k->p);
-      if(!location)
-        return CURLE_OUT_OF_MEMORY;
-      if(!*location)
-        /* ignore empty data */
-        free(location);
-      else {
-        data->req.location = location;
+        result = Curl_http_input_auth(conn, proxy, auth);
 
-        if(data->set.http_follow_location) {
-          DEBUGASSERT(!data->req.newurl);
-          data->req.newurl = strdup(data->req.location); /* clone */
-          if(!data->req.newurl)
-            return CURLE_OUT_OF_MEMORY;
+        free(auth);
 
-          /* some cases of POST and PUT etc needs to rewind the data
-             stream at this point */
-          result = http_perhapsrewind(conn);
-          if(result)
-            return result;
+        if(result)
+          return result;
+      }
+      break;
+
+    case RESP_LOCATION:
+      if((k->httpcode >= 300 && k->httpcode < 400) &&
+         !data->req.location) {
+        /* this is the URL that the server advises us to use instead */
+        char *location = Curl_copy_header_value(k->p);
+        if(!location)
+          return CURLE_OUT_OF_MEMORY;
+        if(!*location)
+          /* ignore empty data */
+          free(location);
+        else {
+          data->req.location = location;
+
+          if(data->set.http_follow_location) {
+            DEBUGASSERT(!data->req.newurl);
+            data->req.newurl = strdup(data->req.location); /* clone */
+            if(!data->req.newurl)
+              return CURLE_OUT_OF_MEMORY;
+
+            /* some cases of POST and PUT etc needs to rewind the data
+               stream at this point */
+            result = http_perhapsrewind(conn);
+            if(result)
+              return result;
+          }
         }
       }
-    }
-    else if(conn->handler->protocol & CURLPROTO_RTSP) {
-      result = Curl_rtsp_parseheader(conn, k->p);
-      if(result)
-        return result;
+      break;
+
+    default:
+      if(conn->handler->protocol & CURLPROTO_RTSP) {
+        result = Curl_rtsp_parseheader(conn, k->p);
+        if(result)
+          return result;
+      }
+      break;
     }
 
     /*
@@ -3760,6 +4006,10 @@ CURLcode Curl_http_readwrite_headers(struct Curl_easy *data,
     /* reset hbufp pointer && hbuflen */
     k->hbufp = data->state.headerbuff;
     k->hbuflen = 0;
+
+    if(in_place)
+      /* put back the start of the next line */
+      *k->str = next;
   }
   while(*k->str); /* header line within buffer */
 
@@ -75,6 +75,9 @@ CURLcode Curl_add_custom_headers(struct connectdata *conn,
                                  bool is_connect,
                                  Curl_send_buffer *req_buffer);
 
+/* forget the request template, an option that goes into it has changed */
+void Curl_http_reqtmpl_reset(struct Curl_easy *data);
+
 /* protocol-specific functions set up to be called by the main engine */
 CURLcode Curl_http(struct connectdata *conn, bool *done);
 CURLcode Curl_http_done(struct connectdata *, CURLcode, bool premature);
@@ -119,8 +122,33 @@ CURLcode Curl_http_perhapsrewind(struct connectdata *conn);
 #define TINY_INITIAL_POST_SIZE 1024
 #endif
 
+#else
+#define Curl_http_reqtmpl_reset(x) Curl_nop_stmt
 #endif /* CURL_DISABLE_HTTP */
 
+/* what a header list looked like, to tell if it has been changed since */
+struct reqtmpl_list {
+  struct curl_slist *head;
+  struct curl_slist *last;
+  size_t count;
+};
+
+/*
+ * The request headers that only depend on the options of the easy handle,
+ * rendered once and then copied into every request made with the handle
+ * until one of those options is set again.
+ */
+struct http_reqtmpl {
+  char *lines;   /* User-Agent: up to Accept-Encoding:, then the custom
+                    headers */
+  size_t custom; /* offset of the custom headers in 'lines' */
+  size_t len;    /* total length of 'lines' */
+  int props;     /* the properties of the request it was rendered for */
+  struct reqtmpl_list headers;      /* data->set.headers when rendered */
+  struct reqtmpl_list proxyheaders; /* data->set.proxyheaders when rendered */
+  bool valid;
+};
+
 /****************************************************************************
  * HTTP unique setup
  ***************************************************************************/
@@ -130,7 +158,6 @@ struct HTTP {
   const char *postdata;
 
   const char *p_pragma;      /* Pragma: string */
-  const char *p_accept;      /* Accept: string */
   curl_off_t readbytecount;
   curl_off_t writebytecount;
 
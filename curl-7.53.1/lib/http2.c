@@ -353,6 +353,11 @@ char *curl_pushheader_byname(struct curl_pushheaders *h, const char *header)
 static struct Curl_easy *duphandle(struct Curl_easy *data)
 {
   struct Curl_easy *second = curl_easy_duphandle(data);
+  if(second && Curl_multi_getbuffers(second)) {
+    /* a pushed stream skips the start of a transfer that gets them */
+    (void)Curl_close(second);
+    second = NULL;
+  }
   if(second) {
     /* setup the request struct */
     struct HTTP *http = calloc(1, sizeof(struct HTTP));
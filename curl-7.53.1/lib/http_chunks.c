@@ -92,61 +92,112 @@ void Curl_httpchunk_init(struct connectdata *conn)
 }
 
 /*
- * chunk_read() returns a OK for normal operations, or a positive return code
- * for errors. STOP means this sequence of chunks is complete.  The 'wrote'
- * argument is set to tell the caller how many bytes we actually passed to the
- * client (for byte-counting and whatever).
- *
- * The states and the state-machine is further explained in the header file.
- *
- * This function always uses ASCII hex values to accommodate non-ASCII hosts.
- * For example, 0x0d and 0x0a are used instead of '\r' and '\n'.
+ * Chunk data that is not larger than this is moved back in the buffer, over
+ * the chunk header and CRLF in front of it, to join the data of the chunks
+ * before it. A run of small chunks is then passed on with a single write
+ * instead of one write per chunk. Larger chunks are written where they are,
+ * as moving them would cost more than the extra write.
  */
-CHUNKcode Curl_httpchunk_read(struct connectdata *conn,
-                              char *datap,
-                              ssize_t datalen,
-                              ssize_t *wrotep)
+#define CHUNK_JOIN_MAX 1024
+
+/* chunk data in the buffer that has not been passed on yet */
+struct chunk_run {
+  char *start;
+  size_t len;
+  size_t *wrote;
+};
+
+/*
+ * Passes on the pending run of chunk data to the content decoder or the
+ * client.
+ */
+static CHUNKcode chunk_flush(struct connectdata *conn, struct chunk_run *run)
 {
-  CURLcode result=CURLE_OK;
+  CURLcode result = CURLE_OK;
   struct Curl_easy *data = conn->data;
-  struct Curl_chunker *ch = &conn->chunk;
   struct SingleRequest *k = &data->req;
-  size_t piece;
-  curl_off_t length = (curl_off_t)datalen;
-  size_t *wrote = (size_t *)wrotep;
+  size_t len = run->len;
 
-  *wrote = 0; /* nothing's written yet */
+  if(!len)
+    return CHUNKE_OK;
+  run->len = 0;
 
-  /* the original data is written to the client, but we go on with the
-     chunk read process, to properly calculate the content length*/
-  if(data->set.http_te_skip && !k->ignorebody) {
-    result = Curl_client_write(conn, CLIENTWRITE_BODY, datap, datalen);
-    if(result)
-      return CHUNKE_WRITE_ERROR;
+#ifdef HAVE_LIBZ
+  switch(conn->data->set.http_ce_skip?
+         IDENTITY : data->req.auto_decoding) {
+  case IDENTITY:
+#endif
+    if(!k->ignorebody) {
+      if(!data->set.http_te_skip)
+        result = Curl_client_write(conn, CLIENTWRITE_BODY, run->start, len);
+      else
+        result = CURLE_OK;
+    }
+#ifdef HAVE_LIBZ
+    break;
+
+  case DEFLATE:
+    /* update data->req.keep.str to point to the chunk data. */
+    data->req.str = run->start;
+    result = Curl_unencode_deflate_write(conn, &data->req, (ssize_t)len);
+    break;
+
+  case GZIP:
+    /* update data->req.keep.str to point to the chunk data. */
+    data->req.str = run->start;
+    result = Curl_unencode_gzip_write(conn, &data->req, (ssize_t)len);
+    break;
+
+  default:
+    failf(conn->data,
+          "Unrecognized content encoding type. "
+          "libcurl understands `identity', `deflate' and `gzip' "
+          "content encodings.");
+    return CHUNKE_BAD_ENCODING;
   }
+#endif
+
+  if(result)
+    return CHUNKE_WRITE_ERROR;
+
+  *run->wrote += len;
+  return CHUNKE_OK;
+}
+
+/*
+ * The state machine. Chunk data is not written from here but added to 'run',
+ * which the caller flushes when the machine returns.
+ */
+static CHUNKcode chunk_parse(struct connectdata *conn,
+                             char *datap,
+                             curl_off_t length,
+                             struct chunk_run *run)
+{
+  CURLcode result=CURLE_OK;
+  CHUNKcode code;
+  struct Curl_easy *data = conn->data;
+  struct Curl_chunker *ch = &conn->chunk;
+  size_t piece;
+  char *lf;
 
   while(length) {
     switch(ch->state) {
     case CHUNK_HEX:
-      if(Curl_isxdigit(*datap)) {
-        if(ch->hexindex < MAXNUM_SIZE) {
-          ch->hexbuffer[ch->hexindex] = *datap;
-          datap++;
-          length--;
-          ch->hexindex++;
-        }
-        else {
+      /* take all the digits there are in this buffer in one go */
+      while(length && Curl_isxdigit(*datap)) {
+        if(ch->hexindex >= MAXNUM_SIZE)
           return CHUNKE_TOO_LONG_HEX; /* longer hex than we support */
-        }
+        ch->hexbuffer[ch->hexindex++] = *datap++;
+        length--;
       }
-      else {
+      if(length) {
         char *endptr;
         if(0 == ch->hexindex)
           /* This is illegal data, we received junk where we expected
              a hexadecimal digit. */
           return CHUNKE_ILLEGAL_HEX;
 
-        /* length and datap are unmodified */
+        /* length and datap point to the first byte after the digits */
         ch->hexbuffer[ch->hexindex]=0;
 
         /* convert to host encoding before calling strtoul */
@@ -167,19 +218,24 @@ CHUNKcode Curl_httpchunk_read(struct connectdata *conn,
       break;
 
     case CHUNK_LF:
-      /* waiting for the LF after a chunk size */
-      if(*datap == 0x0a) {
-        /* we're now expecting data to come, unless size was zero! */
-        if(0 == ch->datasize) {
-          ch->state = CHUNK_TRAILER; /* now check for trailers */
-          conn->trlPos=0;
-        }
-        else
-          ch->state = CHUNK_DATA;
+      /* waiting for the LF after a chunk size, anything before it (a chunk
+         extension and the CR) is skipped */
+      lf = memchr(datap, 0x0a, curlx_sotouz(length));
+      if(!lf) {
+        datap += length;
+        length = 0;
+        break;
       }
+      length -= (lf - datap) + 1;
+      datap = lf + 1;
 
-      datap++;
-      length--;
+      /* we're now expecting data to come, unless size was zero! */
+      if(0 == ch->datasize) {
+        ch->state = CHUNK_TRAILER; /* now check for trailers */
+        conn->trlPos=0;
+      }
+      else
+        ch->state = CHUNK_DATA;
       break;
 
     case CHUNK_DATA:
@@ -188,49 +244,19 @@ CHUNKcode Curl_httpchunk_read(struct connectdata *conn,
       */
       piece = curlx_sotouz((ch->datasize >= length)?length:ch->datasize);
 
-      /* Write the data portion available */
-#ifdef HAVE_LIBZ
-      switch(conn->data->set.http_ce_skip?
-             IDENTITY : data->req.auto_decoding) {
-      case IDENTITY:
-#endif
-        if(!k->ignorebody) {
-          if(!data->set.http_te_skip)
-            result = Curl_client_write(conn, CLIENTWRITE_BODY, datap,
-                                       piece);
-          else
-            result = CURLE_OK;
+      if(run->len && (run->start + run->len != datap)) {
+        /* there is a chunk header between this and the pending data */
+        if(piece <= CHUNK_JOIN_MAX)
+          memmove(run->start + run->len, datap, piece);
+        else {
+          code = chunk_flush(conn, run);
+          if(code)
+            return code;
         }
-#ifdef HAVE_LIBZ
-        break;
-
-      case DEFLATE:
-        /* update data->req.keep.str to point to the chunk data. */
-        data->req.str = datap;
-        result = Curl_unencode_deflate_write(conn, &data->req,
-                                             (ssize_t)piece);
-        break;
-
-      case GZIP:
-        /* update data->req.keep.str to point to the chunk data. */
-        data->req.str = datap;
-        result = Curl_unencode_gzip_write(conn, &data->req,
-                                          (ssize_t)piece);
-        break;
-
-      default:
-        failf(conn->data,
-              "Unrecognized content encoding type. "
-              "libcurl understands `identity', `deflate' and `gzip' "
-              "content encodings.");
-        return CHUNKE_BAD_ENCODING;
       }
-#endif
-
-      if(result)
-        return CHUNKE_WRITE_ERROR;
-
-      *wrote += piece;
+      if(!run->len)
+        run->start = datap;
+      run->len += piece;
 
       ch->datasize -= piece; /* decrease amount left to expect */
       datap += piece;    /* move read pointer forward */
@@ -242,6 +268,13 @@ CHUNKcode Curl_httpchunk_read(struct connectdata *conn,
       break;
 
     case CHUNK_POSTLF:
+      if((length >= 2) && (datap[0] == 0x0d) && (datap[1] == 0x0a)) {
+        /* the whole CRLF is here */
+        Curl_httpchunk_init(conn); /* sets state back to CHUNK_HEX */
+        datap += 2;
+        length -= 2;
+        break;
+      }
       if(*datap == 0x0a) {
         /* The last one before we go back to hex state and start all over. */
         Curl_httpchunk_init(conn); /* sets state back to CHUNK_HEX */
@@ -272,6 +305,10 @@ CHUNKcode Curl_httpchunk_read(struct connectdata *conn,
             return CHUNKE_BAD_CHUNK;
 
           if(!data->set.http_te_skip) {
+            /* the body data goes first */
+            code = chunk_flush(conn, run);
+            if(code)
+              return code;
             result = Curl_client_write(conn, CLIENTWRITE_HEADER,
                                        conn->trailer, conn->trlPos);
             if(result)
@@ -358,6 +395,55 @@ CHUNKcode Curl_httpchunk_read(struct connectdata *conn,
   return CHUNKE_OK;
 }
 
+/*
+ * chunk_read() returns a OK for normal operations, or a positive return code
+ * for errors. STOP means this sequence of chunks is complete.  The 'wrote'
+ * argument is set to tell the caller how many bytes we actually passed to the
+ * client (for byte-counting and whatever).
+ *
+ * The states and the state-machine is further explained in the header file.
+ *
+ * The data of the chunks in the buffer is passed on in as few writes as
+ * possible, which means that the buffer may be modified: the data of small
+ * chunks is moved back over the chunk headers in front of it. Any data left
+ * after the last chunk stays where it is.
+ *
+ * This function always uses ASCII hex values to accommodate non-ASCII hosts.
+ * For example, 0x0d and 0x0a are used instead of '\r' and '\n'.
+ */
+CHUNKcode Curl_httpchunk_read(struct connectdata *conn,
+                              char *datap,
+                              ssize_t datalen,
+                              ssize_t *wrotep)
+{
+  CURLcode result=CURLE_OK;
+  CHUNKcode code;
+  CHUNKcode flushed;
+  struct Curl_easy *data = conn->data;
+  struct SingleRequest *k = &data->req;
+  struct chunk_run run;
+
+  run.start = datap;
+  run.len = 0;
+  run.wrote = (size_t *)wrotep;
+  *run.wrote = 0; /* nothing's written yet */
+
+  /* the original data is written to the client, but we go on with the
+     chunk read process, to properly calculate the content length*/
+  if(data->set.http_te_skip && !k->ignorebody) {
+    result = Curl_client_write(conn, CLIENTWRITE_BODY, datap, datalen);
+    if(result)
+      return CHUNKE_WRITE_ERROR;
+  }
+
+  code = chunk_parse(conn, datap, (curl_off_t)datalen, &run);
+
+  /* the data in front of an error is passed on as well, as it was received
+     before the error was found */
+  flushed = chunk_flush(conn, &run);
+  return flushed ? flushed : code;
+}
+
 const char *Curl_chunked_strerror(CHUNKcode code)
 {
   switch(code) {
@@ -7,7 +7,7 @@
  *                            | (__| |_| |  _ <| |___
  *                             \___|\___/|_| \_\_____|
  *
- * Copyright (C) 1998 - 2010, Daniel Stenberg, <daniel@haxx.se>, et al.
+ * Copyright (C) 1998 - 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
  *
  * This software is licensed as described in the file COPYING, which
  * you should have received as part of this distribution. The terms
@@ -27,6 +27,8 @@
 
 typedef void (*curl_llist_dtor)(void *, void *);
 
+/* The element is kept in the struct it links into a list, so that adding to
+   a list never allocates anything. 'ptr' points back to that struct. */
 struct curl_llist_element {
   void *ptr;
 
@@ -43,9 +45,9 @@ struct curl_llist {
   size_t size;
 };
 
-struct curl_llist *Curl_llist_alloc(curl_llist_dtor);
-int Curl_llist_insert_next(struct curl_llist *, struct curl_llist_element *,
-                           const void *);
+void Curl_llist_init(struct curl_llist *, curl_llist_dtor);
+void Curl_llist_insert_next(struct curl_llist *, struct curl_llist_element *,
+                            const void *, struct curl_llist_element *);
 int Curl_llist_remove(struct curl_llist *, struct curl_llist_element *,
                       void *);
 size_t Curl_llist_count(struct curl_llist *);
@@ -24,6 +24,10 @@
 
 #include <curl/curl.h>
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #include "urldata.h"
 #include "transfer.h"
 #include "url.h"
@@ -65,6 +69,9 @@
 #define GOOD_MULTI_HANDLE(x) \
   ((x) && (x)->type == CURL_MULTI_HANDLE)
 
+/* the most socket events curl_multi_wait_perform() handles in one call */
+#define MULTI_POLL_EVENTS 64
+
 static void singlesocket(struct Curl_multi *multi,
                          struct Curl_easy *data);
 static int update_timer(struct Curl_multi *multi);
@@ -271,6 +278,43 @@ static int sh_init(struct curl_hash *hash, int hashsize)
                         sh_freeentry);
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * epoll_update() keeps the epoll set used by curl_multi_wait_perform() in step
+ * with the sockhash. It is told about the same changes as the socket
+ * callback.
+ */
+static void epoll_update(struct Curl_multi *multi, curl_socket_t s,
+                         int action)
+{
+  struct epoll_event ev;
+
+  if(multi->epollfd == -1)
+    /* curl_multi_wait_perform() has not been used on this handle */
+    return;
+
+  memset(&ev, 0, sizeof(ev));
+  if(action == CURL_POLL_REMOVE) {
+    /* old kernels want a non-NULL event even for a delete */
+    (void)epoll_ctl(multi->epollfd, EPOLL_CTL_DEL, s, &ev);
+    return;
+  }
+
+  if(action & CURL_POLL_IN)
+    ev.events |= EPOLLIN;
+  if(action & CURL_POLL_OUT)
+    ev.events |= EPOLLOUT;
+  ev.data.fd = s;
+
+  /* the socket is either new to the set or already in it, possibly from
+     another transfer using the same connection */
+  if(epoll_ctl(multi->epollfd, EPOLL_CTL_MOD, s, &ev) && (errno == ENOENT))
+    (void)epoll_ctl(multi->epollfd, EPOLL_CTL_ADD, s, &ev);
+}
+#else
+#define epoll_update(x,y,z) Curl_nop_stmt
+#endif
+
 /*
  * multi_addmsg()
  *
@@ -280,9 +324,8 @@ static int sh_init(struct curl_hash *hash, int hashsize)
 static CURLMcode multi_addmsg(struct Curl_multi *multi,
                               struct Curl_message *msg)
 {
-  if(!Curl_llist_insert_next(multi->msglist, multi->msglist->tail, msg))
-    return CURLM_OUT_OF_MEMORY;
-
+  Curl_llist_insert_next(&multi->msglist, multi->msglist.tail, msg,
+                         &msg->list);
   return CURLM_OK;
 }
 
@@ -316,13 +359,10 @@ struct Curl_multi *Curl_multi_handle(int hashsize, /* socket hash */
   if(Curl_conncache_init(&multi->conn_cache, chashsize))
     goto error;
 
-  multi->msglist = Curl_llist_alloc(multi_freeamsg);
-  if(!multi->msglist)
-    goto error;
+  Curl_llist_init(&multi->msglist, multi_freeamsg);
+  Curl_llist_init(&multi->pending, multi_freeamsg);
 
-  multi->pending = Curl_llist_alloc(multi_freeamsg);
-  if(!multi->pending)
-    goto error;
+  Curl_wheel_init(&multi->timers, Curl_tvnow());
 
   /* allocate a new easy handle to use when closing cached connections */
   multi->closure_handle = curl_easy_init();
@@ -336,17 +376,19 @@ struct Curl_multi *Curl_multi_handle(int hashsize, /* socket hash */
 
   /* -1 means it not set by user, use the default value */
   multi->maxconnects = -1;
+
+#ifdef HAVE_SYS_EPOLL_H
+  multi->epollfd = -1;
+#endif
   return multi;
 
   error:
 
   Curl_hash_destroy(&multi->sockhash);
-  Curl_hash_destroy(&multi->hostcache);
+  Curl_dnscache_destroy(&multi->hostcache);
   Curl_conncache_destroy(&multi->conn_cache);
   Curl_close(multi->closure_handle);
   multi->closure_handle = NULL;
-  Curl_llist_destroy(multi->msglist, NULL);
-  Curl_llist_destroy(multi->pending, NULL);
 
   free(multi);
   return NULL;
@@ -361,8 +403,6 @@ struct Curl_multi *curl_multi_init(void)
 CURLMcode curl_multi_add_handle(struct Curl_multi *multi,
                                 struct Curl_easy *data)
 {
-  struct curl_llist *timeoutlist;
-
   /* First, make some basic checks that the CURLM handle is a good handle */
   if(!GOOD_MULTI_HANDLE(multi))
     return CURLM_BAD_HANDLE;
@@ -376,21 +416,8 @@ CURLMcode curl_multi_add_handle(struct Curl_multi *multi,
   if(data->multi)
     return CURLM_ADDED_ALREADY;
 
-  /* Allocate and initialize timeout list for easy handle */
-  timeoutlist = Curl_llist_alloc(multi_freetimeout);
-  if(!timeoutlist)
-    return CURLM_OUT_OF_MEMORY;
-
-  /*
-   * No failure allowed in this function beyond this point. And no
-   * modification of easy nor multi handle allowed before this except for
-   * potential multi's connection cache growing which won't be undone in this
-   * function no matter what.
-   */
-
-  /* Make easy handle use timeout list initialized above */
-  data->state.timeoutlist = timeoutlist;
-  timeoutlist = NULL;
+  /* Initialize the timeout list for the easy handle */
+  Curl_llist_init(&data->state.timeoutlist, multi_freetimeout);
 
   /* set the easy handle */
   multistate(data, CURLM_STATE_INIT);
@@ -398,7 +425,7 @@ CURLMcode curl_multi_add_handle(struct Curl_multi *multi,
   if((data->set.global_dns_cache) &&
      (data->dns.hostcachetype != HCACHE_GLOBAL)) {
     /* global dns cache was requested but still isn't */
-    struct curl_hash *global = Curl_global_host_cache_init();
+    struct Curl_dnscache *global = Curl_global_host_cache_init();
     if(global) {
       /* only do this if the global cache init works */
       data->dns.hostcache = global;
@@ -579,7 +606,7 @@ static CURLcode multi_done(struct connectdata **connp,
       result = CURLE_ABORTED_BY_CALLBACK;
   }
 
-  if(conn->send_pipe->size + conn->recv_pipe->size != 0 &&
+  if(conn->send_pipe.size + conn->recv_pipe.size != 0 &&
      !data->set.reuse_forbid &&
      !conn->bits.close) {
     /* Stop if pipeline is not empty and we do not have to close
@@ -705,11 +732,6 @@ CURLMcode curl_multi_remove_handle(struct Curl_multi *multi,
     easy_owns_conn = TRUE;
   }
 
-  /* The timer must be shut down before data->multi is set to NULL,
-     else the timenode will remain in the splay tree after
-     curl_easy_cleanup is called. */
-  Curl_expire_clear(data);
-
   if(data->dns.hostcachetype == HCACHE_MULTI) {
     /* stop using the multi handle's DNS cache */
     data->dns.hostcache = NULL;
@@ -736,12 +758,16 @@ CURLMcode curl_multi_remove_handle(struct Curl_multi *multi,
 
   Curl_wildcard_dtor(&data->wildcard);
 
-  /* destroy the timeout list that is held in the easy handle, do this *after*
-     multi_done() as that may actually call Curl_expire that uses this */
-  if(data->state.timeoutlist) {
-    Curl_llist_destroy(data->state.timeoutlist, NULL);
-    data->state.timeoutlist = NULL;
-  }
+  /* The timers must be shut down before data->multi is set to NULL, else
+     they remain in the timer wheel after curl_easy_cleanup is called. Do
+     this *after* multi_done() as that may actually call Curl_expire. */
+  Curl_expire_clear(data);
+
+  /* destroy the timeout list that is held in the easy handle */
+  Curl_llist_destroy(&data->state.timeoutlist, NULL);
+
+  /* give back the buffers while the pool is still known */
+  Curl_multi_putbuffers(data);
 
   /* as this was using a shared connection cache we clear the pointer to that
      since we're not part of that multi handle anymore */
@@ -764,11 +790,11 @@ CURLMcode curl_multi_remove_handle(struct Curl_multi *multi,
   /* make sure there's no pending message in the queue sent from this easy
      handle */
 
-  for(e = multi->msglist->head; e; e = e->next) {
+  for(e = multi->msglist.head; e; e = e->next) {
     struct Curl_message *msg = e->ptr;
 
     if(msg->extmsg.easy_handle == easy) {
-      Curl_llist_remove(multi->msglist, e, NULL);
+      Curl_llist_remove(&multi->msglist, e, NULL);
       /* there can only be one from this specific handle */
       break;
     }
@@ -1437,10 +1463,9 @@ static CURLMcode multi_runsingle(struct Curl_multi *multi,
         multistate(data, CURLM_STATE_CONNECT_PEND);
 
         /* add this handle to the list of connect-pending handles */
-        if(!Curl_llist_insert_next(multi->pending, multi->pending->tail, data))
-          result = CURLE_OUT_OF_MEMORY;
-        else
-          result = CURLE_OK;
+        Curl_llist_insert_next(&multi->pending, multi->pending.tail, data,
+                               &data->connect_queue);
+        result = CURLE_OK;
         break;
       }
 
@@ -1943,11 +1968,11 @@ static CURLMcode multi_runsingle(struct Curl_multi *multi,
         Curl_posttransfer(data);
 
         /* we're no longer receiving */
-        Curl_removeHandleFromPipeline(data, data->easy_conn->recv_pipe);
+        Curl_removeHandleFromPipeline(data, &data->easy_conn->recv_pipe);
 
         /* expire the new receiving pipeline head */
-        if(data->easy_conn->recv_pipe->head)
-          Curl_expire_latest(data->easy_conn->recv_pipe->head->ptr, 0);
+        if(data->easy_conn->recv_pipe.head)
+          Curl_expire_latest(data->easy_conn->recv_pipe.head->ptr, 0);
 
         /* Check if we can move pending requests to send pipe */
         Curl_multi_process_pending_handles(multi);
@@ -2012,7 +2037,7 @@ static CURLMcode multi_runsingle(struct Curl_multi *multi,
         CURLcode res;
 
         /* Remove ourselves from the receive pipeline, if we are there. */
-        Curl_removeHandleFromPipeline(data, data->easy_conn->recv_pipe);
+        Curl_removeHandleFromPipeline(data, &data->easy_conn->recv_pipe);
         /* Check if we can move pending requests to send pipe */
         Curl_multi_process_pending_handles(multi);
 
@@ -2088,8 +2113,8 @@ static CURLMcode multi_runsingle(struct Curl_multi *multi,
           /* if this has a connection, unsubscribe from the pipelines */
           Curl_pipeline_leave_write(data->easy_conn);
           Curl_pipeline_leave_read(data->easy_conn);
-          Curl_removeHandleFromPipeline(data, data->easy_conn->send_pipe);
-          Curl_removeHandleFromPipeline(data, data->easy_conn->recv_pipe);
+          Curl_removeHandleFromPipeline(data, &data->easy_conn->send_pipe);
+          Curl_removeHandleFromPipeline(data, &data->easy_conn->recv_pipe);
 
           if(stream_error) {
             /* Don't attempt to send data over a connection that timed out */
@@ -2125,6 +2150,10 @@ static CURLMcode multi_runsingle(struct Curl_multi *multi,
     }
 
     if(CURLM_STATE_COMPLETED == data->mstate) {
+      /* the transfer is over, others may use its buffers until the next
+         one */
+      Curl_multi_putbuffers(data);
+
       /* now fill in the Curl_message with this info */
       msg = &data->msg;
 
@@ -2149,12 +2178,16 @@ CURLMcode curl_multi_perform(struct Curl_multi *multi, int *running_handles)
 {
   struct Curl_easy *data;
   CURLMcode returncode=CURLM_OK;
-  struct Curl_tree *t;
+  struct Curl_wheelnode *t;
   struct timeval now = Curl_tvnow();
 
   if(!GOOD_MULTI_HANDLE(multi))
     return CURLM_BAD_HANDLE;
 
+  /* the handles use this time too instead of reading the clock */
+  multi->now = now;
+  multi->in_pass = TRUE;
+
   data=multi->easyp;
   while(data) {
     CURLMcode result;
@@ -2164,6 +2197,12 @@ CURLMcode curl_multi_perform(struct Curl_multi *multi, int *running_handles)
     result = multi_runsingle(multi, now, data);
     sigpipe_restore(&pipe_st);
 
+#ifdef HAVE_SYS_EPOLL_H
+    if(multi->epollfd != -1 && CURLM_OK >= result)
+      /* keep the epoll set of curl_multi_wait_perform() up to date */
+      singlesocket(multi, data);
+#endif
+
     if(result)
       returncode = result;
 
@@ -2171,22 +2210,20 @@ CURLMcode curl_multi_perform(struct Curl_multi *multi, int *running_handles)
   }
 
   /*
-   * Simply remove all expired timers from the splay since handles are dealt
+   * Simply remove all expired timers from the wheel since handles are dealt
    * with unconditionally by this function and curl_multi_timeout() requires
-   * that already passed/handled expire times are removed from the splay.
+   * that already passed/handled expire times are removed from the wheel.
    *
    * It is important that the 'now' value is set at the entry of this function
    * and not for the current time as it may have ticked a little while since
    * then and then we risk this loop to remove timers that actually have not
    * been handled!
    */
-  do {
-    multi->timetree = Curl_splaygetbest(now, multi->timetree, &t);
-    if(t)
-      /* the removed may have another timeout in queue */
-      (void)add_next_timeout(now, multi, t->payload);
+  while((t = Curl_wheel_getbest(&multi->timers, now)) != NULL)
+    /* the handle may have more timeouts that have expired */
+    (void)add_next_timeout(now, multi, t->payload);
 
-  } while(t);
+  multi->in_pass = FALSE;
 
   *running_handles = multi->num_alive;
 
@@ -2244,8 +2281,8 @@ CURLMcode curl_multi_cleanup(struct Curl_multi *multi)
 
     Curl_hash_destroy(&multi->sockhash);
     Curl_conncache_destroy(&multi->conn_cache);
-    Curl_llist_destroy(multi->msglist, NULL);
-    Curl_llist_destroy(multi->pending, NULL);
+    Curl_llist_destroy(&multi->msglist, NULL);
+    Curl_llist_destroy(&multi->pending, NULL);
 
     /* remove all easy handles */
     data = multi->easyp;
@@ -2260,17 +2297,30 @@ CURLMcode curl_multi_cleanup(struct Curl_multi *multi)
 
       /* Clear the pointer to the connection cache */
       data->state.conn_cache = NULL;
+      Curl_expire_clear(data);
       data->multi = NULL; /* clear the association */
 
       data = nextdata;
     }
 
-    Curl_hash_destroy(&multi->hostcache);
+    Curl_dnscache_destroy(&multi->hostcache);
 
     /* Free the blacklists by setting them to NULL */
     Curl_pipeline_set_site_blacklist(NULL, &multi->pipelining_site_bl);
     Curl_pipeline_set_server_blacklist(NULL, &multi->pipelining_server_bl);
 
+    /* free the pooled transfer buffers */
+    while(multi->bufpool) {
+      char *buf = multi->bufpool;
+      memcpy(&multi->bufpool, buf, sizeof(char *));
+      free(buf);
+    }
+
+#ifdef HAVE_SYS_EPOLL_H
+    if(multi->epollfd != -1)
+      close(multi->epollfd);
+#endif
+
     free(multi);
     if(restore_pipe)
       sigpipe_restore(&pipe_st);
@@ -2297,19 +2347,19 @@ CURLMsg *curl_multi_info_read(struct Curl_multi *multi, int *msgs_in_queue)
 
   *msgs_in_queue = 0; /* default to none */
 
-  if(GOOD_MULTI_HANDLE(multi) && Curl_llist_count(multi->msglist)) {
+  if(GOOD_MULTI_HANDLE(multi) && Curl_llist_count(&multi->msglist)) {
     /* there is one or more messages in the list */
     struct curl_llist_element *e;
 
     /* extract the head of the list to return */
-    e = multi->msglist->head;
+    e = multi->msglist.head;
 
     msg = e->ptr;
 
     /* remove the extracted entry */
-    Curl_llist_remove(multi->msglist, e, NULL);
+    Curl_llist_remove(&multi->msglist, e, NULL);
 
-    *msgs_in_queue = curlx_uztosi(Curl_llist_count(multi->msglist));
+    *msgs_in_queue = curlx_uztosi(Curl_llist_count(&multi->msglist));
 
     return &msg->extmsg;
   }
@@ -2380,6 +2430,7 @@ static void singlesocket(struct Curl_multi *multi,
                        action,
                        multi->socket_userp,
                        entry->socketp);
+    epoll_update(multi, s, action);
 
     entry->action = action; /* store the current action state */
   }
@@ -2409,7 +2460,7 @@ static void singlesocket(struct Curl_multi *multi,
          removed. */
       struct connectdata *easy_conn = data->easy_conn;
       if(easy_conn) {
-        if(easy_conn->recv_pipe && easy_conn->recv_pipe->size > 1) {
+        if(easy_conn->recv_pipe.size > 1) {
           /* the handle should not be removed from the pipe yet */
           remove_sock_from_hash = FALSE;
 
@@ -2418,12 +2469,12 @@ static void singlesocket(struct Curl_multi *multi,
              isn't already) */
           if(entry->easy == data) {
             if(Curl_recvpipe_head(data, easy_conn))
-              entry->easy = easy_conn->recv_pipe->head->next->ptr;
+              entry->easy = easy_conn->recv_pipe.head->next->ptr;
             else
-              entry->easy = easy_conn->recv_pipe->head->ptr;
+              entry->easy = easy_conn->recv_pipe.head->ptr;
           }
         }
-        if(easy_conn->send_pipe  && easy_conn->send_pipe->size > 1) {
+        if(easy_conn->send_pipe.size > 1) {
           /* the handle should not be removed from the pipe yet */
           remove_sock_from_hash = FALSE;
 
@@ -2432,9 +2483,9 @@ static void singlesocket(struct Curl_multi *multi,
              isn't already) */
           if(entry->easy == data) {
             if(Curl_sendpipe_head(data, easy_conn))
-              entry->easy = easy_conn->send_pipe->head->next->ptr;
+              entry->easy = easy_conn->send_pipe.head->next->ptr;
             else
-              entry->easy = easy_conn->send_pipe->head->ptr;
+              entry->easy = easy_conn->send_pipe.head->ptr;
           }
         }
         /* Don't worry about overwriting recv_pipe head with send_pipe_head,
@@ -2451,6 +2502,7 @@ static void singlesocket(struct Curl_multi *multi,
                            CURL_POLL_REMOVE,
                            multi->socket_userp,
                            entry->socketp);
+        epoll_update(multi, s, CURL_POLL_REMOVE);
         sh_delentry(&multi->sockhash, s);
       }
     } /* if sockhash entry existed */
@@ -2483,6 +2535,7 @@ void Curl_multi_closed(struct connectdata *conn, curl_socket_t s)
         multi->socket_cb(conn->data, s, CURL_POLL_REMOVE,
                          multi->socket_userp,
                          entry->socketp);
+      epoll_update(multi, s, CURL_POLL_REMOVE);
 
       /* now remove it from the socket hash */
       sh_delentry(&multi->sockhash, s);
@@ -2495,55 +2548,38 @@ void Curl_multi_closed(struct connectdata *conn, curl_socket_t s)
 /*
  * add_next_timeout()
  *
- * Each Curl_easy has a list of timeouts. The add_next_timeout() is called
- * when it has just been removed from the splay tree because the timeout has
- * expired. This function is then to advance in the list to pick the next
- * timeout to use (skip the already expired ones) and add this node back to
- * the splay tree again.
- *
- * The splay tree only has each sessionhandle as a single node and the nearest
- * timeout is used to sort it on.
+ * Each Curl_easy has a list of timeouts, which are all in the timer wheel.
+ * The add_next_timeout() is called when one of them has just been taken out
+ * of the wheel because it has expired. This function is then to remove all
+ * the other expired timeouts of the handle too, since the handle is dealt
+ * with once for all of them, and to keep the nearest pending timeout in
+ * 'expiretime'.
  */
 static CURLMcode add_next_timeout(struct timeval now,
                                   struct Curl_multi *multi,
                                   struct Curl_easy *d)
 {
   struct timeval *tv = &d->state.expiretime;
-  struct curl_llist *list = d->state.timeoutlist;
+  struct curl_llist *list = &d->state.timeoutlist;
   struct curl_llist_element *e;
 
-  /* move over the timeout list for this specific handle and remove all
-     timeouts that are now passed tense and store the next pending
-     timeout in *tv */
+  tv->tv_sec = 0;
+  tv->tv_usec = 0;
+
   for(e = list->head; e;) {
     struct curl_llist_element *n = e->next;
-    time_t diff = curlx_tvdiff(*(struct timeval *)e->ptr, now);
-    if(diff <= 0)
+    struct time_node *node = (struct time_node *)e->ptr;
+
+    if(curlx_tvdiff(node->wheel.time, now) <= 0) {
       /* remove outdated entry */
+      Curl_wheel_remove(&multi->timers, &node->wheel);
       Curl_llist_remove(list, e, NULL);
-    else
-      /* the list is sorted so get out on the first mismatch */
-      break;
+    }
+    else if((!tv->tv_sec && !tv->tv_usec) ||
+            (Curl_wheel_compare(node->wheel.time, *tv) < 0))
+      *tv = node->wheel.time;
     e = n;
   }
-  e = list->head;
-  if(!e) {
-    /* clear the expire times within the handles that we remove from the
-       splay tree */
-    tv->tv_sec = 0;
-    tv->tv_usec = 0;
-  }
-  else {
-    /* copy the first entry to 'tv' */
-    memcpy(tv, e->ptr, sizeof(*tv));
-
-    /* remove first entry from list */
-    Curl_llist_remove(list, e, NULL);
-
-    /* insert this node again into the splay */
-    multi->timetree = Curl_splayinsert(*tv, multi->timetree,
-                                       &d->state.timenode);
-  }
   return CURLM_OK;
 }
 
@@ -2555,7 +2591,7 @@ static CURLMcode multi_socket(struct Curl_multi *multi,
 {
   CURLMcode result = CURLM_OK;
   struct Curl_easy *data = NULL;
-  struct Curl_tree *t;
+  struct Curl_wheelnode *t;
   struct timeval now = Curl_tvnow();
 
   if(checkall) {
@@ -2575,7 +2611,14 @@ static CURLMcode multi_socket(struct Curl_multi *multi,
     /* or should we fall-through and do the timer-based stuff? */
     return result;
   }
-  else if(s != CURL_SOCKET_TIMEOUT) {
+
+  /* the handles use this time too instead of reading the clock. It must be
+     the same as 'now' below, or a handle that sets a timeout relative to
+     it could get picked again and again by the expire loop at the end */
+  multi->now = now;
+  multi->in_pass = TRUE;
+
+  if(s != CURL_SOCKET_TIMEOUT) {
 
     struct Curl_sh_entry *entry = sh_getentry(&multi->sockhash, s);
 
@@ -2591,22 +2634,22 @@ static CURLMcode multi_socket(struct Curl_multi *multi,
 
       data = entry->easy;
 
-      if(data->magic != CURLEASY_MAGIC_NUMBER)
+      if(data->magic != CURLEASY_MAGIC_NUMBER) {
         /* bad bad bad bad bad bad bad */
+        multi->in_pass = FALSE;
         return CURLM_INTERNAL_ERROR;
+      }
 
       /* If the pipeline is enabled, take the handle which is in the head of
          the pipeline. If we should write into the socket, take the send_pipe
          head.  If we should read from the socket, take the recv_pipe head. */
       if(data->easy_conn) {
         if((ev_bitmask & CURL_POLL_OUT) &&
-           data->easy_conn->send_pipe &&
-           data->easy_conn->send_pipe->head)
-          data = data->easy_conn->send_pipe->head->ptr;
+           data->easy_conn->send_pipe.head)
+          data = data->easy_conn->send_pipe.head->ptr;
         else if((ev_bitmask & CURL_POLL_IN) &&
-                data->easy_conn->recv_pipe &&
-                data->easy_conn->recv_pipe->head)
-          data = data->easy_conn->recv_pipe->head->ptr;
+                data->easy_conn->recv_pipe.head)
+          data = data->easy_conn->recv_pipe.head->ptr;
       }
 
       if(data->easy_conn &&
@@ -2636,6 +2679,7 @@ static CURLMcode multi_socket(struct Curl_multi *multi,
                       multi_runsingle() in case there's no need to */
       now = Curl_tvnow(); /* get a newer time since the multi_runsingle() loop
                              may have taken some time */
+      multi->now = now;
     }
   }
   else {
@@ -2648,7 +2692,7 @@ static CURLMcode multi_socket(struct Curl_multi *multi,
 
   /*
    * The loop following here will go on as long as there are expire-times left
-   * to process in the splay and 'data' will be re-assigned for every expired
+   * to process in the wheel and 'data' will be re-assigned for every expired
    * handle we deal with.
    */
   do {
@@ -2669,7 +2713,7 @@ static CURLMcode multi_socket(struct Curl_multi *multi,
     /* Check if there's one (more) expired timer to deal with! This function
        extracts a matching node if there is one */
 
-    multi->timetree = Curl_splaygetbest(now, multi->timetree, &t);
+    t = Curl_wheel_getbest(&multi->timers, now);
     if(t) {
       data = t->payload; /* assign this for next loop */
       (void)add_next_timeout(now, multi, t->payload);
@@ -2677,6 +2721,8 @@ static CURLMcode multi_socket(struct Curl_multi *multi,
 
   } while(t);
 
+  multi->in_pass = FALSE;
+
   *running_handles = multi->num_alive;
   return result;
 }
@@ -2781,21 +2827,104 @@ CURLMcode curl_multi_socket_all(struct Curl_multi *multi, int *running_handles)
   return result;
 }
 
+/*
+ * curl_multi_wait_perform() waits for the sockets of the transfers and then
+ * acts on the ones that are ready, just like an application driving
+ * curl_multi_socket_action() would. With epoll the sockets are kept in a set
+ * that singlesocket() updates as transfers change state, so a call is
+ * O(ready sockets) instead of O(transfers) like curl_multi_wait().
+ */
+CURLMcode curl_multi_wait_perform(struct Curl_multi *multi, int timeout_ms,
+                                  int *running_handles)
+{
+#ifdef HAVE_SYS_EPOLL_H
+  struct epoll_event events[MULTI_POLL_EVENTS];
+  CURLMcode result = CURLM_OK;
+  long timeout_internal;
+  int nevents;
+  int i;
+
+  if(!GOOD_MULTI_HANDLE(multi))
+    return CURLM_BAD_HANDLE;
+
+  if(multi->epollfd == -1) {
+    /* First use. Create the set, add the sockets already known from the
+       socket API and bring every transfer up to date once. After this the
+       set is only changed when transfers change their sockets. */
+    struct curl_hash_iterator iter;
+    struct curl_hash_element *he;
+
+    multi->epollfd = epoll_create1(EPOLL_CLOEXEC);
+    if(multi->epollfd == -1)
+      return CURLM_INTERNAL_ERROR;
+
+    Curl_hash_start_iterate(&multi->sockhash, &iter);
+    for(he = Curl_hash_next_element(&iter); he;
+        he = Curl_hash_next_element(&iter)) {
+      struct Curl_sh_entry *entry = he->ptr;
+      epoll_update(multi, entry->socket, entry->action);
+    }
+
+    result = multi_socket(multi, TRUE, CURL_SOCKET_BAD, 0, running_handles);
+    if(result > CURLM_OK)
+      return result;
+  }
+
+  /* If the internally desired timeout is shorter than requested from the
+     outside, then use the shorter time! */
+  (void)multi_timeout(multi, &timeout_internal);
+  if((timeout_internal >= 0) && (timeout_internal < (long)timeout_ms))
+    timeout_ms = (int)timeout_internal;
+
+  nevents = epoll_wait(multi->epollfd, events, MULTI_POLL_EVENTS, timeout_ms);
+
+  for(i = 0; i < nevents; i++) {
+    int ev_bitmask = 0;
+    CURLMcode rc;
+
+    if(events[i].events & (EPOLLIN|EPOLLHUP|EPOLLERR))
+      ev_bitmask |= CURL_CSELECT_IN;
+    if(events[i].events & EPOLLOUT)
+      ev_bitmask |= CURL_CSELECT_OUT;
+    if(events[i].events & EPOLLERR)
+      ev_bitmask |= CURL_CSELECT_ERR;
+
+    /* this also runs any timers that have expired */
+    rc = multi_socket(multi, FALSE, events[i].data.fd, ev_bitmask,
+                      running_handles);
+    if(rc > CURLM_OK)
+      result = rc;
+  }
+
+  if(nevents <= 0)
+    /* nothing happened (or the wait was interrupted), run the timers */
+    result = multi_socket(multi, FALSE, CURL_SOCKET_TIMEOUT, 0,
+                          running_handles);
+
+  if(CURLM_OK >= result)
+    update_timer(multi);
+  return result;
+#else
+  /* without epoll this is the same as the usual wait and perform loop */
+  CURLMcode result = curl_multi_wait(multi, NULL, 0, timeout_ms, NULL);
+  if(!result)
+    result = curl_multi_perform(multi, running_handles);
+  return result;
+#endif
+}
+
 static CURLMcode multi_timeout(struct Curl_multi *multi,
                                long *timeout_ms)
 {
-  static struct timeval tv_zero = {0, 0};
+  struct timeval first;
 
-  if(multi->timetree) {
-    /* we have a tree of expire times */
+  if(Curl_wheel_first(&multi->timers, &first)) {
+    /* we have expire times */
     struct timeval now = Curl_tvnow();
 
-    /* splay the lowest to the bottom */
-    multi->timetree = Curl_splay(tv_zero, multi->timetree);
-
-    if(Curl_splaycomparekeys(multi->timetree->key, now) > 0) {
+    if(Curl_wheel_compare(first, now) > 0) {
       /* some time left before expiration */
-      *timeout_ms = (long)curlx_tvdiff(multi->timetree->key, now);
+      *timeout_ms = (long)curlx_tvdiff(first, now);
       if(!*timeout_ms)
         /*
          * Since we only provide millisecond resolution on the returned value
@@ -2833,6 +2962,7 @@ CURLMcode curl_multi_timeout(struct Curl_multi *multi,
 static int update_timer(struct Curl_multi *multi)
 {
   long timeout_ms;
+  struct timeval first;
 
   if(!multi->timer_cb)
     return 0;
@@ -2841,7 +2971,7 @@ static int update_timer(struct Curl_multi *multi)
   }
   if(timeout_ms < 0) {
     static const struct timeval none={0, 0};
-    if(Curl_splaycomparekeys(none, multi->timer_lastcall)) {
+    if(Curl_wheel_compare(none, multi->timer_lastcall)) {
       multi->timer_lastcall = none;
       /* there's no timeout now but there was one previously, tell the app to
          disable it */
@@ -2850,14 +2980,15 @@ static int update_timer(struct Curl_multi *multi)
     return 0;
   }
 
-  /* When multi_timeout() is done, multi->timetree points to the node with the
-   * timeout we got the (relative) time-out time for. We can thus easily check
-   * if this is the same (fixed) time as we got in a previous call and then
-   * avoid calling the callback again. */
-  if(Curl_splaycomparekeys(multi->timetree->key, multi->timer_lastcall) == 0)
+  /* The wheel keeps the earliest expire time that multi_timeout() got the
+   * (relative) time-out time for. We can thus easily check if this is the
+   * same (fixed) time as we got in a previous call and then avoid calling the
+   * callback again. */
+  (void)Curl_wheel_first(&multi->timers, &first);
+  if(Curl_wheel_compare(first, multi->timer_lastcall) == 0)
     return 0;
 
-  multi->timer_lastcall = multi->timetree->key;
+  multi->timer_lastcall = first;
 
   return multi->timer_cb(multi, timeout_ms, multi->timer_userp);
 }
@@ -2870,78 +3001,161 @@ static int update_timer(struct Curl_multi *multi)
  */
 static void multi_freetimeout(void *user, void *entryptr)
 {
+  struct time_node *node = (struct time_node *)entryptr;
   (void)user;
 
-  /* the entry was plain malloc()'ed */
-  free(entryptr);
+  /* the handle's own nodes are free again when out of the list */
+  if(node->allocated)
+    free(node);
 }
 
 /*
  * multi_addtimeout()
  *
- * Add a timestamp to the list of timeouts. Keep the list sorted so that head
- * of list is always the timeout nearest in time.
+ * Add a timestamp to the list of timeouts of the handle and to the timer
+ * wheel of the multi handle.
  *
  */
 static CURLMcode
-multi_addtimeout(struct curl_llist *timeoutlist,
+multi_addtimeout(struct Curl_easy *data,
                  struct timeval *stamp)
 {
-  struct curl_llist_element *e;
-  struct timeval *timedup;
-  struct curl_llist_element *prev = NULL;
-
-  timedup = malloc(sizeof(*timedup));
-  if(!timedup)
-    return CURLM_OUT_OF_MEMORY;
-
-  /* copy the timestamp */
-  memcpy(timedup, stamp, sizeof(*timedup));
-
-  if(Curl_llist_count(timeoutlist)) {
-    /* find the correct spot in the list */
-    for(e = timeoutlist->head; e; e = e->next) {
-      struct timeval *checktime = e->ptr;
-      time_t diff = curlx_tvdiff(*checktime, *timedup);
-      if(diff > 0)
-        break;
-      prev = e;
-    }
+  struct curl_llist *timeoutlist = &data->state.timeoutlist;
+  struct time_node *node = NULL;
+  int i;
 
+  /* use one of the handle's own nodes that isn't in the list, if any */
+  for(i = 0; i < TIMEOUT_NODES; i++) {
+    if(!data->state.timenodes[i].list.ptr) {
+      node = &data->state.timenodes[i];
+      node->allocated = FALSE;
+      break;
+    }
   }
-  /* else
-     this is the first timeout on the list */
-
-  if(!Curl_llist_insert_next(timeoutlist, prev, timedup)) {
-    free(timedup);
-    return CURLM_OUT_OF_MEMORY;
+  if(!node) {
+    node = malloc(sizeof(*node));
+    if(!node)
+      return CURLM_OUT_OF_MEMORY;
+    node->allocated = TRUE;
   }
 
+  node->wheel.payload = data;
+  Curl_wheel_add(&data->multi->timers, &node->wheel, *stamp);
+
+  Curl_llist_insert_next(timeoutlist, timeoutlist->tail, node, &node->list);
   return CURLM_OK;
 }
 
+/* the most transfer buffers a multi handle keeps for the next transfers */
+#define MAX_POOLED_BUFFERS 64
+
 /*
- * Curl_expire()
- *
- * given a number of milliseconds from now to use to set the 'act before
- * this'-time for the transfer, to be extracted by curl_multi_timeout()
- *
- * The timeout will be added to a queue of timeouts if it defines a moment in
- * time that is later than the current head of queue.
+ * Curl_multi_getbuf() returns a buffer of BUFSIZE+1 bytes for the handle,
+ * taken from the pool of its multi handle when there is one in there.
  */
-void Curl_expire(struct Curl_easy *data, time_t milli)
+char *Curl_multi_getbuf(struct Curl_easy *data)
 {
   struct Curl_multi *multi = data->multi;
-  struct timeval *nowp = &data->state.expiretime;
-  int rc;
-  struct timeval set;
+  char *buf = multi ? multi->bufpool : NULL;
 
-  /* this is only interesting while there is still an associated multi struct
-     remaining! */
-  if(!multi)
+  if(!buf)
+    return malloc(BUFSIZE + 1);
+
+  /* the buffer holds the pointer to the next one */
+  memcpy(&multi->bufpool, buf, sizeof(char *));
+  multi->num_bufpool--;
+  return buf;
+}
+
+/* give back a buffer got with Curl_multi_getbuf() */
+static void putbuf(struct Curl_multi *multi, char *buf)
+{
+  if(!buf)
     return;
 
-  set = Curl_tvnow();
+  if(multi && (multi->num_bufpool < MAX_POOLED_BUFFERS)) {
+    memcpy(buf, &multi->bufpool, sizeof(char *));
+    multi->bufpool = buf;
+    multi->num_bufpool++;
+  }
+  else
+    free(buf);
+}
+
+CURLcode Curl_multi_getbuffers(struct Curl_easy *data)
+{
+  if(!data->state.buffer) {
+    if(data->set.buffer_size > BUFSIZE)
+      /* a larger CURLOPT_BUFFERSIZE than the pooled ones */
+      data->state.buffer = malloc(data->set.buffer_size + 1);
+    else
+      data->state.buffer = Curl_multi_getbuf(data);
+    if(!data->state.buffer)
+      return CURLE_OUT_OF_MEMORY;
+  }
+
+  if(!data->state.headerbuff) {
+    data->state.headerbuff = malloc(HEADERSIZE);
+    if(!data->state.headerbuff)
+      return CURLE_OUT_OF_MEMORY;
+    data->state.headersize = HEADERSIZE;
+  }
+  return CURLE_OK;
+}
+
+CURLcode Curl_multi_uploadbuffer(struct Curl_easy *data)
+{
+  if(!data->state.uploadbuffer) {
+    data->state.uploadbuffer = Curl_multi_getbuf(data);
+    if(!data->state.uploadbuffer)
+      return CURLE_OUT_OF_MEMORY;
+  }
+  return CURLE_OK;
+}
+
+void Curl_multi_putbuffers(struct Curl_easy *data)
+{
+  struct Curl_multi *multi = data->multi;
+
+  if(data->set.buffer_size > BUFSIZE)
+    Curl_safefree(data->state.buffer);
+  else {
+    /* one grown by a later CURLOPT_BUFFERSIZE is only larger, which is
+       fine for the pool */
+    putbuf(multi, data->state.buffer);
+    data->state.buffer = NULL;
+  }
+  putbuf(multi, data->state.uploadbuffer);
+  data->state.uploadbuffer = NULL;
+#ifdef HAVE_LIBZ
+  putbuf(multi, data->state.unencode_buf);
+  data->state.unencode_buf = NULL;
+#endif
+  Curl_safefree(data->state.headerbuff);
+  data->state.headersize = 0;
+
+  data->req.buf = NULL;
+  data->req.uploadbuf = NULL;
+  data->req.hbufp = NULL;
+}
+
+struct timeval Curl_multi_tvnow(const struct Curl_easy *data)
+{
+  if(data->multi && data->multi->in_pass)
+    return data->multi->now;
+  return Curl_tvnow();
+}
+
+/*
+ * expire_time() returns the time 'milli' milliseconds from now. Longer delays
+ * are counted from the time of the present pass over the handles, but a zero
+ * delay reads the clock so that the expire loop of the pass setting it will
+ * not pick the handle again at once.
+ */
+static struct timeval expire_time(struct Curl_easy *data, time_t milli)
+{
+  struct timeval set = milli ? Curl_multi_tvnow(data) : Curl_tvnow();
+
   set.tv_sec += (long)(milli/1000);
   set.tv_usec += (milli%1000)*1000;
 
@@ -2949,36 +3163,43 @@ void Curl_expire(struct Curl_easy *data, time_t milli)
     set.tv_sec++;
     set.tv_usec -= 1000000;
   }
+  return set;
+}
 
-  if(nowp->tv_sec || nowp->tv_usec) {
-    /* This means that the struct is added as a node in the splay tree.
-       Compare if the new time is earlier, and only remove-old/add-new if it
-       is. */
-    time_t diff = curlx_tvdiff(set, *nowp);
-    if(diff > 0) {
-      /* the new expire time was later so just add it to the queue
-         and get out */
-      multi_addtimeout(data->state.timeoutlist, &set);
-      return;
-    }
+/*
+ * expire_at() sets the 'act before this'-time of the transfer to 'set',
+ * as described for Curl_expire() below.
+ */
+static void expire_at(struct Curl_easy *data, struct timeval set)
+{
+  struct timeval *nowp = &data->state.expiretime;
 
-    /* the new time is newer than the presently set one, so add the current
-       to the queue and update the head */
-    multi_addtimeout(data->state.timeoutlist, nowp);
-
-    /* Since this is an updated time, we must remove the previous entry from
-       the splay tree first and then re-add the new value */
-    rc = Curl_splayremovebyaddr(multi->timetree,
-                                &data->state.timenode,
-                                &multi->timetree);
-    if(rc)
-      infof(data, "Internal error removing splay node = %d\n", rc);
-  }
+  if(multi_addtimeout(data, &set))
+    return;
 
-  *nowp = set;
-  data->state.timenode.payload = data;
-  multi->timetree = Curl_splayinsert(*nowp, multi->timetree,
-                                     &data->state.timenode);
+  if((!nowp->tv_sec && !nowp->tv_usec) ||
+     (Curl_wheel_compare(set, *nowp) < 0))
+    /* this is the nearest timeout of the handle now */
+    *nowp = set;
+}
+
+/*
+ * Curl_expire()
+ *
+ * given a number of milliseconds from now to use to set the 'act before
+ * this'-time for the transfer, to be extracted by curl_multi_timeout()
+ *
+ * The timeout is added to the timeouts of the handle, the nearest of them
+ * is kept in 'expiretime'.
+ */
+void Curl_expire(struct Curl_easy *data, time_t milli)
+{
+  /* this is only interesting while there is still an associated multi struct
+     remaining! */
+  if(!data->multi)
+    return;
+
+  expire_at(data, expire_time(data, milli));
 }
 
 /*
@@ -2998,19 +3219,14 @@ void Curl_expire_latest(struct Curl_easy *data, time_t milli)
 
   struct timeval set;
 
-  set = Curl_tvnow();
-  set.tv_sec += (long)(milli / 1000);
-  set.tv_usec += (milli % 1000) * 1000;
+  if(!data->multi)
+    return;
 
-  if(set.tv_usec >= 1000000) {
-    set.tv_sec++;
-    set.tv_usec -= 1000000;
-  }
+  set = expire_time(data, milli);
 
   if(expire->tv_sec || expire->tv_usec) {
-    /* This means that the struct is added as a node in the splay tree.
-       Compare if the new time is earlier, and only remove-old/add-new if it
-         is. */
+    /* This means that the handle has timeouts pending. Compare if the new
+       time is earlier, and only add it if it is. */
     time_t diff = curlx_tvdiff(set, *expire);
     if(diff > 0)
       /* the new expire time was later than the top time, so just skip this */
@@ -3018,7 +3234,7 @@ void Curl_expire_latest(struct Curl_easy *data, time_t milli)
   }
 
   /* Just add the timeout like normal */
-  Curl_expire(data, milli);
+  expire_at(data, set);
 }
 
 
@@ -3031,34 +3247,30 @@ void Curl_expire_clear(struct Curl_easy *data)
 {
   struct Curl_multi *multi = data->multi;
   struct timeval *nowp = &data->state.expiretime;
-  int rc;
+  struct curl_llist *list = &data->state.timeoutlist;
 
   /* this is only interesting while there is still an associated multi struct
      remaining! */
   if(!multi)
     return;
 
-  if(nowp->tv_sec || nowp->tv_usec) {
-    /* Since this is an cleared time, we must remove the previous entry from
-       the splay tree */
-    struct curl_llist *list = data->state.timeoutlist;
-
-    rc = Curl_splayremovebyaddr(multi->timetree,
-                                &data->state.timenode,
-                                &multi->timetree);
-    if(rc)
-      infof(data, "Internal error clearing splay node = %d\n", rc);
+  if(list->size) {
+    struct curl_llist_element *e;
 
-    /* flush the timeout list too */
+    /* take the timeouts out of the wheel and flush the list */
+    for(e = list->head; e; e = e->next) {
+      struct time_node *node = (struct time_node *)e->ptr;
+      Curl_wheel_remove(&multi->timers, &node->wheel);
+    }
     while(list->size > 0)
       Curl_llist_remove(list, list->tail, NULL);
 
 #ifdef DEBUGBUILD
     infof(data, "Expire cleared\n");
 #endif
-    nowp->tv_sec = 0;
-    nowp->tv_usec = 0;
   }
+  nowp->tv_sec = 0;
+  nowp->tv_usec = 0;
 }
 
 
@@ -3101,17 +3313,17 @@ curl_off_t Curl_multi_chunk_length_penalty_size(struct Curl_multi *multi)
 
 struct curl_llist *Curl_multi_pipelining_site_bl(struct Curl_multi *multi)
 {
-  return multi->pipelining_site_bl;
+  return &multi->pipelining_site_bl;
 }
 
 struct curl_llist *Curl_multi_pipelining_server_bl(struct Curl_multi *multi)
 {
-  return multi->pipelining_server_bl;
+  return &multi->pipelining_server_bl;
 }
 
 void Curl_multi_process_pending_handles(struct Curl_multi *multi)
 {
-  struct curl_llist_element *e = multi->pending->head;
+  struct curl_llist_element *e = multi->pending.head;
 
   while(e) {
     struct Curl_easy *data = e->ptr;
@@ -3121,7 +3333,7 @@ void Curl_multi_process_pending_handles(struct Curl_multi *multi)
       multistate(data, CURLM_STATE_CONNECT);
 
       /* Remove this node from the list */
-      Curl_llist_remove(multi->pending, e, NULL);
+      Curl_llist_remove(&multi->pending, e, NULL);
 
       /* Make sure that the handle will be processed soonish. */
       Curl_expire_latest(data, 0);
@@ -25,6 +25,7 @@
 #include "conncache.h"
 
 struct Curl_message {
+  struct curl_llist_element list;
   /* the 'CURLMsg' is the part that is visible to the external user */
   struct CURLMsg extmsg;
 };
@@ -80,10 +81,10 @@ struct Curl_multi {
   int num_alive; /* amount of easy handles that are added but have not yet
                     reached COMPLETE state */
 
-  struct curl_llist *msglist; /* a list of messages from completed transfers */
+  struct curl_llist msglist; /* a list of messages from completed transfers */
 
-  struct curl_llist *pending; /* Curl_easys that are in the
-                                 CURLM_STATE_CONNECT_PEND state */
+  struct curl_llist pending; /* Curl_easys that are in the
+                                CURLM_STATE_CONNECT_PEND state */
 
   /* callback function and user data pointer for the *socket() API */
   curl_socket_callback socket_cb;
@@ -94,11 +95,10 @@ struct Curl_multi {
   void *push_userp;
 
   /* Hostname cache */
-  struct curl_hash hostcache;
+  struct Curl_dnscache hostcache;
 
-  /* timetree points to the splay-tree of time nodes to figure out expire
-     times of all currently set timers */
-  struct Curl_tree *timetree;
+  /* the timer wheel holding all currently set timers of the handles */
+  struct Curl_timewheel timers;
 
   /* 'sockhash' is the lookup hash for socket descriptor => easy handles (note
      the pluralis form, there can be more than one easy handle waiting on the
@@ -117,6 +117,12 @@ struct Curl_multi {
      curl_multi_cleanup() */
   struct Curl_easy *closure_handle;
 
+  /* transfer buffers of BUFSIZE+1 bytes given back by the handles that
+     completed, for the next transfers to use. Linked through their first
+     bytes, see Curl_multi_getbuf() */
+  char *bufpool;
+  int num_bufpool; /* amount of buffers in the pool */
+
   long maxconnects; /* if >0, a fixed limit of the maximum number of entries
                        we're allowed to grow the connection cache to */
 
@@ -138,17 +144,27 @@ struct Curl_multi {
                                      bigger than this is not
                                      considered for pipelining */
 
-  struct curl_llist *pipelining_site_bl; /* List of sites that are blacklisted
-                                            from pipelining */
+  struct curl_llist pipelining_site_bl; /* List of sites that are blacklisted
+                                           from pipelining */
 
-  struct curl_llist *pipelining_server_bl; /* List of server types that are
-                                              blacklisted from pipelining */
+  struct curl_llist pipelining_server_bl; /* List of server types that are
+                                             blacklisted from pipelining */
 
   /* timer callback and user data pointer for the *socket() API */
   curl_multi_timer_callback timer_cb;
   void *timer_userp;
   struct timeval timer_lastcall; /* the fixed time for the timeout for the
                                     previous callback */
+
+  /* the time read when the present curl_multi_perform() or
+     curl_multi_socket*() pass started, see Curl_multi_tvnow() */
+  struct timeval now;
+  bool in_pass; /* TRUE while such a pass is running and 'now' is valid */
+
+#ifdef HAVE_SYS_EPOLL_H
+  int epollfd; /* the epoll set kept for curl_multi_wait_perform(), or -1
+                  until that function is first called */
+#endif
 };
 
 #endif /* HEADER_CURL_MULTIHANDLE_H */
@@ -89,6 +89,30 @@ void Curl_multi_connchanged(struct Curl_multi *multi);
 
 void Curl_multi_closed(struct connectdata *conn, curl_socket_t s);
 
+/*
+ * Curl_multi_tvnow()
+ *
+ * Returns the time the present pass over the handles of the transfer's multi
+ * handle started, and reads the clock when there is no such pass running.
+ * Use it where the time of the pass is good enough, to avoid reading the
+ * clock many times per handle and pass.
+ */
+struct timeval Curl_multi_tvnow(const struct Curl_easy *data);
+
+/*
+ * Curl_multi_getbuffers() makes sure the handle has the download and header
+ * buffers a transfer needs, Curl_multi_uploadbuffer() the upload buffer which
+ * is only got when something is to be sent. Curl_multi_putbuffers() gives
+ * all of them back when the transfer is over, to the pool of the multi handle
+ * they were taken from so that idle handles don't keep any.
+ */
+CURLcode Curl_multi_getbuffers(struct Curl_easy *data);
+CURLcode Curl_multi_uploadbuffer(struct Curl_easy *data);
+void Curl_multi_putbuffers(struct Curl_easy *data);
+
+/* A buffer of BUFSIZE+1 bytes, from the pool when there is one */
+char *Curl_multi_getbuf(struct Curl_easy *data);
+
 /*
  * Add a handle and move it into PERFORM state at once. For pushed streams.
  */
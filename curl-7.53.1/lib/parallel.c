@@ -0,0 +1,824 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+
+#include "curl_setup.h"
+
+#include <curl/curl.h>
+
+#include "urldata.h"
+#include "parallel.h"
+#include "sendf.h"
+#include "getinfo.h"
+#include "cookie.h"
+#include "progress.h"
+#include "select.h"
+#include "sigpipe.h"
+#include "slist.h"
+#include "strcase.h"
+/* The last 3 #include files should be in this order */
+#include "curl_printf.h"
+#include "curl_memory.h"
+#include "memdebug.h"
+
+/*
+ * A download over several connections. The first request asks for the first
+ * PROBE_SIZE bytes of the resource. If the server answers that with 206 and
+ * tells the size of the whole resource, the rest is split into parts that are
+ * fetched with range requests by up to CURLOPT_RANGE_CONNECTIONS easy handles
+ * at the same time, in the multi handle the easy handle does its transfers
+ * in. Any other answer is passed on as it is, as the whole resource.
+ *
+ * The parts are either written to CURLOPT_RANGE_FD at their offsets as they
+ * arrive, or passed to the write callback in order: the data of the part that
+ * is in turn goes straight to the callback, the data of later parts is kept
+ * until it is their turn. Then parts are only started when they are less
+ * than WINDOW_PARTS parts per connection ahead, which limits the memory used.
+ *
+ * A part that fails on the way is fetched again from where it stopped, up to
+ * MAX_RETRIES times.
+ *
+ * The workers use the cookie jar of the easy handle, so the cookies they get
+ * end up there, and the progress callback of the easy handle is called with
+ * the sum of what they have received.
+ */
+
+#define PROBE_SIZE (256 * 1024)
+#define MIN_PART_SIZE (64 * 1024)
+#define MAX_PART_SIZE (2 * 1024 * 1024)      /* when kept in memory */
+#define MAX_PART_SIZE_FD (16 * 1024 * 1024)  /* when written to the fd */
+#define WINDOW_PARTS 2
+#define MAX_RETRIES 3
+
+enum part_state {
+  PART_TODO,
+  PART_BUSY,
+  PART_DONE
+};
+
+struct range_part {
+  curl_off_t start;       /* offset of the first byte of the part */
+  curl_off_t size;        /* number of bytes in it, -1 for up to the end */
+  curl_off_t got;         /* number of bytes received so far */
+  char *mem;              /* received data waiting for its turn */
+  size_t memlen;          /* number of bytes in 'mem' */
+  size_t memsize;         /* allocated size of 'mem' */
+  int retries;
+  enum part_state state;
+  bool whole;             /* the whole resource, asked for without a range */
+};
+
+struct parallel;
+
+struct range_worker {
+  struct Curl_easy *easy;
+  struct parallel *par;
+  int part;               /* the part being fetched, -1 when idle */
+  bool added;             /* the handle is in the multi handle */
+  bool checked;           /* the response has been checked */
+  bool swallow;           /* throw the body away */
+  curl_off_t cr_start;    /* from the Content-Range: header, -1 if none */
+  curl_off_t cr_end;
+  curl_off_t cr_total;    /* -1 if none or not known */
+  struct curl_slist *headers; /* header lines of the first response, kept
+                                 until it has been checked */
+  CURLcode result;        /* error in a callback */
+  char errbuf[CURL_ERROR_SIZE];
+};
+
+struct parallel {
+  struct Curl_easy *data;
+  struct Curl_multi *multi;
+  struct range_part *parts;
+  int num_parts;
+  int done_parts;
+  struct range_worker workers[MAX_RANGE_CONNECTIONS];
+  int num_workers;        /* number of workers created */
+  int max_workers;
+  int deliver;            /* the part in turn for the write callback */
+  bool split;             /* the rest has been split into parts */
+  bool headers_sent;      /* the headers have been passed on */
+  curl_off_t total;       /* size of the resource, -1 if not known */
+  int httpcode;           /* of the response passed on */
+  char *url;              /* the URL to fetch the parts from */
+  CURLcode result;
+};
+
+/*
+ * Curl_parallel_wanted() returns TRUE if the transfer the handle is set up
+ * for is to be done over several connections. That is an HTTP GET asking for
+ * the resource as it is.
+ */
+bool Curl_parallel_wanted(struct Curl_easy *data)
+{
+  const char *url = data->set.str[STRING_SET_URL];
+
+  return (data->set.range_connections > 1) && url &&
+    (checkprefix("http://", url) || checkprefix("https://", url)) &&
+    (data->set.httpreq == HTTPREQ_GET) && !data->set.opt_no_body &&
+    !data->set.upload && !data->set.set_resume_from &&
+    !data->set.str[STRING_SET_RANGE] && !data->set.str[STRING_ENCODING] &&
+    !data->set.str[STRING_CUSTOMREQUEST] && !data->set.connect_only &&
+    !data->set.wildcardmatch && !data->set.fwritebuffer;
+}
+
+/* pass data on to the write callback */
+static CURLcode write_body(struct Curl_easy *easy, struct Curl_easy *data,
+                           char *ptr, size_t len)
+{
+  while(len) {
+    size_t chunklen = len <= CURL_MAX_WRITE_SIZE? len: CURL_MAX_WRITE_SIZE;
+    size_t wrote = data->set.fwrite_func(ptr, 1, chunklen, data->set.out);
+
+    /* pausing isn't supported here */
+    if(wrote != chunklen) {
+      failf(easy, "Failed writing body (%zu != %zu)", wrote, chunklen);
+      return CURLE_WRITE_ERROR;
+    }
+    ptr += chunklen;
+    len -= chunklen;
+  }
+  return CURLE_OK;
+}
+
+/* write data to CURLOPT_RANGE_FD at the given offset */
+static CURLcode write_fd(struct Curl_easy *easy, int fd, curl_off_t offset,
+                         const char *ptr, size_t len)
+{
+  if(lseek(fd, (off_t)offset, SEEK_SET) == -1) {
+    failf(easy, "Failed to seek in the range file descriptor");
+    return CURLE_WRITE_ERROR;
+  }
+
+  while(len) {
+    ssize_t nwritten = write(fd, ptr, len);
+    if(nwritten < 0) {
+      if(errno == EINTR)
+        continue;
+      failf(easy, "Failed writing to the range file descriptor");
+      return CURLE_WRITE_ERROR;
+    }
+    ptr += nwritten;
+    len -= (size_t)nwritten;
+  }
+  return CURLE_OK;
+}
+
+/* keep data of a part until it is its turn */
+static CURLcode keep(struct range_part *p, const char *ptr, size_t len)
+{
+  if(p->memlen + len > p->memsize) {
+    size_t newsize = p->memsize ? p->memsize * 2 : CURL_MAX_WRITE_SIZE;
+    char *newmem;
+
+    if(p->size >= 0)
+      /* the data never goes beyond the size of the part */
+      newsize = (size_t)(p->size - (p->got - (curl_off_t)p->memlen));
+    while(newsize < p->memlen + len)
+      newsize *= 2;
+
+    newmem = realloc(p->mem, newsize);
+    if(!newmem)
+      return CURLE_OUT_OF_MEMORY;
+    p->mem = newmem;
+    p->memsize = newsize;
+  }
+
+  memcpy(p->mem + p->memlen, ptr, len);
+  p->memlen += len;
+  return CURLE_OK;
+}
+
+/* pass the headers of the first response on to the header callback */
+static CURLcode send_headers(struct parallel *par, struct range_worker *w)
+{
+  struct Curl_easy *data = par->data;
+  struct curl_slist *item;
+  CURLcode result = CURLE_OK;
+
+  par->headers_sent = TRUE;
+
+  if(data->set.fwrite_header || data->set.writeheader) {
+    curl_write_callback writeheader =
+      data->set.fwrite_header? data->set.fwrite_header: data->set.fwrite_func;
+
+    for(item = w->headers; item && !result; item = item->next) {
+      size_t len = strlen(item->data);
+      if(writeheader(item->data, 1, len, data->set.writeheader) != len) {
+        failf(w->easy, "Failed writing header");
+        result = CURLE_WRITE_ERROR;
+      }
+    }
+  }
+
+  curl_slist_free_all(w->headers);
+  w->headers = NULL;
+  return result;
+}
+
+/*
+ * Check the response before its body is taken. The first one decides how the
+ * download is done, the others have to be the range that was asked for.
+ */
+static CURLcode check_response(struct parallel *par, struct range_worker *w)
+{
+  struct range_part *p = &par->parts[w->part];
+  int code = w->easy->info.httpcode;
+
+  if(par->headers_sent) {
+    if((code != 206) || (w->cr_start != p->start + p->got) ||
+       ((par->total >= 0) && (w->cr_total != par->total))) {
+      failf(w->easy, "Range %" CURL_FORMAT_CURL_OFF_T "- not served as "
+            "asked for", p->start + p->got);
+      return CURLE_RANGE_ERROR;
+    }
+    return CURLE_OK;
+  }
+
+  if(!p->whole && (code == 206)) {
+    if(w->cr_start || (w->cr_end < 0) || (w->cr_end >= PROBE_SIZE) ||
+       ((w->cr_total >= 0) && (w->cr_end >= w->cr_total))) {
+      failf(w->easy, "Range 0-%d not served as asked for", PROBE_SIZE - 1);
+      return CURLE_RANGE_ERROR;
+    }
+    p->size = w->cr_end + 1;
+    par->total = w->cr_total;
+  }
+  else if(!p->whole && (code == 416)) {
+    /* most likely an empty resource, it is asked for again without a
+       range */
+    w->swallow = TRUE;
+    return CURLE_OK;
+  }
+  else {
+    /* the server doesn't do ranges, this is all of it */
+    p->whole = TRUE;
+    p->size = -1;
+  }
+
+  par->httpcode = code;
+  return send_headers(par, w);
+}
+
+static size_t part_header(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  struct range_worker *w = (struct range_worker *)userp;
+  size_t len = size * nmemb;
+
+  if((len > 5) && checkprefix("HTTP/", ptr))
+    /* a new response, after a redirect or a 100 */
+    w->cr_start = w->cr_end = w->cr_total = -1;
+  else if((len > 14) && checkprefix("Content-Range:", ptr)) {
+    char line[128];
+    curl_off_t start;
+    curl_off_t end;
+    curl_off_t total;
+    size_t linelen = len < sizeof(line) ? len : sizeof(line) - 1;
+    int rc;
+
+    memcpy(line, ptr, linelen);
+    line[linelen] = 0;
+    rc = sscanf(&line[14], " bytes %" CURL_FORMAT_CURL_OFF_T "-%"
+                CURL_FORMAT_CURL_OFF_T "/%" CURL_FORMAT_CURL_OFF_T,
+                &start, &end, &total);
+    if(rc >= 2) {
+      w->cr_start = start;
+      w->cr_end = end;
+      w->cr_total = (rc == 3) ? total : -1;
+    }
+  }
+
+  if(!w->part && !w->par->headers_sent) {
+    /* keep them to pass on when the response has been checked */
+    struct curl_slist *list;
+    char *line = malloc(len + 1);
+    if(!line) {
+      w->result = CURLE_OUT_OF_MEMORY;
+      return 0;
+    }
+    memcpy(line, ptr, len);
+    line[len] = 0;
+    list = Curl_slist_append_nodup(w->headers, line);
+    if(!list) {
+      free(line);
+      w->result = CURLE_OUT_OF_MEMORY;
+      return 0;
+    }
+    w->headers = list;
+  }
+
+  return len;
+}
+
+static size_t part_write(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  struct range_worker *w = (struct range_worker *)userp;
+  struct parallel *par = w->par;
+  struct range_part *p = &par->parts[w->part];
+  int fd = par->data->set.range_fd;
+  size_t len = size * nmemb;
+
+  if(!w->checked) {
+    w->checked = TRUE;
+    w->result = check_response(par, w);
+  }
+  if(w->result)
+    return 0;
+  if(w->swallow)
+    return len;
+
+  if((p->size >= 0) && ((curl_off_t)len > p->size - p->got)) {
+    failf(w->easy, "Got more data than the range asked for");
+    w->result = CURLE_RANGE_ERROR;
+    return 0;
+  }
+
+  if(fd != -1)
+    w->result = write_fd(w->easy, fd, p->start + p->got, ptr, len);
+  else if(w->part == par->deliver)
+    w->result = write_body(w->easy, par->data, ptr, len);
+  else
+    w->result = keep(p, ptr, len);
+  if(w->result)
+    return 0;
+
+  p->got += (curl_off_t)len;
+  return len;
+}
+
+static CURLcode new_worker(struct parallel *par, struct range_worker *w)
+{
+  struct Curl_easy *easy = curl_easy_duphandle(par->data);
+  CURLcode result;
+
+  if(!easy)
+    return CURLE_OUT_OF_MEMORY;
+
+  w->easy = easy;
+  w->par = par;
+  w->part = -1;
+
+  result = curl_easy_setopt(easy, CURLOPT_RANGE_CONNECTIONS, 0L);
+  if(!result)
+    result = curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, part_write);
+  if(!result)
+    result = curl_easy_setopt(easy, CURLOPT_WRITEDATA, w);
+  if(!result)
+    result = curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, part_header);
+  if(!result)
+    result = curl_easy_setopt(easy, CURLOPT_HEADERDATA, w);
+  if(!result)
+    result = curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, w->errbuf);
+  if(!result)
+    result = curl_easy_setopt(easy, CURLOPT_NOPROGRESS, 1L);
+  if(!result)
+    /* the cookies are saved by the handle of the application */
+    result = curl_easy_setopt(easy, CURLOPT_COOKIEJAR, NULL);
+  if(!result && par->data->share)
+    result = curl_easy_setopt(easy, CURLOPT_SHARE, par->data->share);
+  if(!result && (easy->cookies != par->data->cookies)) {
+    /* use the jar of the application's handle instead of the copy of it */
+    Curl_cookie_cleanup(easy->cookies);
+    easy->cookies = par->data->cookies;
+  }
+  if(!result && par->url)
+    result = curl_easy_setopt(easy, CURLOPT_URL, par->url);
+  return result;
+}
+
+/* fetch a part, from where it got to */
+static CURLcode start_part(struct parallel *par, struct range_worker *w,
+                           int index)
+{
+  struct range_part *p = &par->parts[index];
+  char range[64];
+  CURLcode result;
+
+  if(p->whole)
+    result = curl_easy_setopt(w->easy, CURLOPT_RANGE, NULL);
+  else {
+    if(p->size < 0)
+      snprintf(range, sizeof(range), "%" CURL_FORMAT_CURL_OFF_T "-",
+               p->start + p->got);
+    else
+      snprintf(range, sizeof(range), "%" CURL_FORMAT_CURL_OFF_T "-%"
+               CURL_FORMAT_CURL_OFF_T, p->start + p->got,
+               p->start + p->size - 1);
+    result = curl_easy_setopt(w->easy, CURLOPT_RANGE, range);
+  }
+  if(result)
+    return result;
+
+  w->part = index;
+  w->checked = FALSE;
+  w->swallow = FALSE;
+  w->cr_start = w->cr_end = w->cr_total = -1;
+  w->result = CURLE_OK;
+  w->errbuf[0] = 0;
+  p->state = PART_BUSY;
+
+  if(curl_multi_add_handle(par->multi, w->easy))
+    return CURLE_OUT_OF_MEMORY;
+  w->added = TRUE;
+  return CURLE_OK;
+}
+
+/* give the parts that may start now to the idle workers */
+static CURLcode schedule(struct parallel *par)
+{
+  int limit = par->num_parts;
+  int next = 0;
+  int i;
+
+  if((par->data->set.range_fd == -1) &&
+     (limit > par->deliver + WINDOW_PARTS * par->max_workers))
+    limit = par->deliver + WINDOW_PARTS * par->max_workers;
+
+  for(i = 0; i < par->max_workers; i++) {
+    struct range_worker *w = &par->workers[i];
+    CURLcode result;
+
+    if((i < par->num_workers) && (w->part != -1))
+      continue;
+
+    while((next < limit) && (par->parts[next].state != PART_TODO))
+      next++;
+    if(next == limit)
+      break;
+
+    if(i == par->num_workers) {
+      par->num_workers++;
+      result = new_worker(par, w);
+      if(result)
+        return result;
+    }
+
+    result = start_part(par, w, next);
+    if(result)
+      return result;
+  }
+  return CURLE_OK;
+}
+
+/* split the rest of the resource, after the first part, into parts */
+static CURLcode split(struct parallel *par)
+{
+  struct range_part *parts;
+  curl_off_t from = par->parts[0].size;
+  curl_off_t partsize = -1;
+  char *url = NULL;
+  int count = 1;
+  int i;
+
+  par->split = TRUE;
+
+  if(par->parts[0].whole || ((par->total >= 0) && (from >= par->total)) ||
+     ((par->total < 0) && (from < PROBE_SIZE)))
+    /* nothing more to get, a server that doesn't tell the size sent all of
+       it if it sent less than was asked for */
+    return CURLE_OK;
+
+  if(par->total >= 0) {
+    curl_off_t rest = par->total - from;
+    curl_off_t maxsize = (par->data->set.range_fd != -1) ?
+      MAX_PART_SIZE_FD : MAX_PART_SIZE;
+
+    partsize = (rest + par->max_workers - 1) / par->max_workers;
+    if(partsize < MIN_PART_SIZE)
+      partsize = MIN_PART_SIZE;
+    else if(partsize > maxsize)
+      partsize = maxsize;
+    count = (int)((rest + partsize - 1) / partsize);
+  }
+  /* else the size isn't known, the rest is one part */
+
+  curl_easy_getinfo(par->workers[0].easy, CURLINFO_EFFECTIVE_URL, &url);
+  par->url = url ? strdup(url) : NULL;
+  if(!par->url)
+    return CURLE_OUT_OF_MEMORY;
+
+  parts = realloc(par->parts, (size_t)(count + 1) * sizeof(struct range_part));
+  if(!parts)
+    return CURLE_OUT_OF_MEMORY;
+  memset(&parts[1], 0, (size_t)count * sizeof(struct range_part));
+  for(i = 1; i <= count; i++) {
+    struct range_part *p = &parts[i];
+    p->start = from + (i - 1) * (partsize < 0 ? 0 : partsize);
+    p->size = partsize;
+    if((partsize >= 0) && (p->start + partsize > par->total))
+      p->size = par->total - p->start;
+    p->state = PART_TODO;
+  }
+  par->parts = parts;
+  par->num_parts = count + 1;
+
+  infof(par->data, "Downloading in %d parts over %d connections\n",
+        par->num_parts, par->max_workers);
+  return CURLE_OK;
+}
+
+/* pass the kept data of the parts that are in turn to the write callback */
+static CURLcode advance(struct parallel *par)
+{
+  while(par->deliver < par->num_parts) {
+    struct range_part *p = &par->parts[par->deliver];
+
+    if(p->memlen) {
+      CURLcode result = write_body(par->data, par->data, p->mem, p->memlen);
+      if(result)
+        return result;
+    }
+    Curl_safefree(p->mem);
+    p->memlen = p->memsize = 0;
+
+    if(p->state != PART_DONE)
+      break;
+    par->deliver++;
+  }
+  return CURLE_OK;
+}
+
+/* the errors after which a part is fetched again */
+static bool retryable(CURLcode result)
+{
+  switch(result) {
+  case CURLE_OK: /* but the part isn't complete */
+  case CURLE_PARTIAL_FILE:
+  case CURLE_RECV_ERROR:
+  case CURLE_SEND_ERROR:
+  case CURLE_GOT_NOTHING:
+  case CURLE_OPERATION_TIMEDOUT:
+  case CURLE_COULDNT_CONNECT:
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
+/* a worker is done with its part */
+static void part_done(struct parallel *par, struct range_worker *w,
+                      CURLcode result)
+{
+  struct range_part *p = &par->parts[w->part];
+  /* the first response, that decides how the download is done */
+  bool first = !w->part && !par->headers_sent;
+
+  curl_multi_remove_handle(par->multi, w->easy);
+  w->added = FALSE;
+
+  if(w->result)
+    result = w->result;
+  else if(!result && !w->checked) {
+    /* there was no body */
+    w->checked = TRUE;
+    result = check_response(par, w);
+  }
+
+  curl_slist_free_all(w->headers);
+  w->headers = NULL;
+  w->part = -1;
+
+  if(first && !p->whole &&
+     (w->swallow || (w->easy->info.httpcode == 416))) {
+    p->whole = TRUE;
+    p->size = -1;
+    p->state = PART_TODO;
+    return;
+  }
+
+  if(!result && (p->whole || (p->size < 0) || (p->got == p->size))) {
+    p->state = PART_DONE;
+    par->done_parts++;
+    return;
+  }
+
+  if(par->headers_sent && !p->whole && retryable(result) &&
+     (p->retries < MAX_RETRIES)) {
+    p->retries++;
+    p->state = PART_TODO;
+    infof(par->data, "Range %" CURL_FORMAT_CURL_OFF_T "- failed, trying "
+          "again\n", p->start + p->got);
+    return;
+  }
+
+  if(!result) {
+    failf(par->data, "Range %" CURL_FORMAT_CURL_OFF_T "- ended early",
+          p->start + p->got);
+    result = CURLE_PARTIAL_FILE;
+  }
+  else if(w->errbuf[0])
+    failf(par->data, "%s", w->errbuf);
+  par->result = result;
+}
+
+/* call the progress callback with what has been received so far */
+static CURLcode progress(struct parallel *par)
+{
+  struct Curl_easy *data = par->data;
+  curl_off_t received = 0;
+  int rc = 0;
+  int i;
+
+  for(i = 0; i < par->num_parts; i++)
+    received += par->parts[i].got;
+  Curl_pgrsSetDownloadSize(data, par->total);
+  Curl_pgrsSetDownloadCounter(data, received);
+
+  if(data->progress.flags & PGRS_HIDE)
+    return CURLE_OK;
+
+  if(data->set.fxferinfo)
+    rc = data->set.fxferinfo(data->set.progress_client,
+                             data->progress.size_dl,
+                             data->progress.downloaded, 0, 0);
+  else if(data->set.fprogress)
+    rc = data->set.fprogress(data->set.progress_client,
+                             (double)data->progress.size_dl,
+                             (double)data->progress.downloaded, 0, 0);
+  if(rc) {
+    failf(data, "Callback aborted");
+    return CURLE_ABORTED_BY_CALLBACK;
+  }
+  return CURLE_OK;
+}
+
+static CURLcode run(struct parallel *par)
+{
+  struct Curl_multi *multi = par->multi;
+  CURLMcode mcode = CURLM_OK;
+  struct timeval before;
+  int without_fds = 0;  /* count number of consecutive returns from
+                           curl_multi_wait() without any filedescriptors */
+
+  par->result = schedule(par);
+
+  while(!par->result && !mcode &&
+        (!par->split || (par->done_parts < par->num_parts))) {
+    int still_running = 0;
+    CURLMsg *msg;
+    int rc;
+
+    before = curlx_tvnow();
+    mcode = curl_multi_wait(multi, NULL, 0, 1000, &rc);
+
+    if(!mcode) {
+      if(!rc) {
+        struct timeval after = curlx_tvnow();
+
+        /* If it returns without any filedescriptor instantly, we need to
+           avoid busy-looping during periods where it has nothing particular
+           to wait for */
+        if(curlx_tvdiff(after, before) <= 10) {
+          without_fds++;
+          if(without_fds > 2) {
+            int sleep_ms = without_fds < 10 ? (1 << (without_fds - 1)) : 1000;
+            Curl_wait_ms(sleep_ms);
+          }
+        }
+        else
+          /* it wasn't "instant", restart counter */
+          without_fds = 0;
+      }
+      else
+        /* got file descriptor, restart counter */
+        without_fds = 0;
+
+      mcode = curl_multi_perform(multi, &still_running);
+    }
+    if(mcode)
+      break;
+
+    while(!par->result && ((msg = curl_multi_info_read(multi, &rc)) != NULL)) {
+      int i;
+      if(msg->msg != CURLMSG_DONE)
+        continue;
+      for(i = 0; i < par->num_workers; i++) {
+        if(par->workers[i].easy == msg->easy_handle) {
+          part_done(par, &par->workers[i], msg->data.result);
+          break;
+        }
+      }
+    }
+
+    if(!par->result && !par->split && par->headers_sent)
+      par->result = split(par);
+    if(!par->result && (par->data->set.range_fd == -1))
+      par->result = advance(par);
+    if(!par->result)
+      par->result = schedule(par);
+    if(!par->result)
+      par->result = progress(par);
+  }
+
+  /* Make sure to return some kind of error if there was a multi problem */
+  if(mcode) {
+    return (mcode == CURLM_OUT_OF_MEMORY) ? CURLE_OUT_OF_MEMORY :
+      /* The other multi errors should never happen, so return
+         something suitably generic */
+      CURLE_BAD_FUNCTION_ARGUMENT;
+  }
+
+  return par->result;
+}
+
+/*
+ * Curl_parallel_perform() does the transfer the easy handle is set up for
+ * over several connections, in the given multi handle.
+ */
+CURLcode Curl_parallel_perform(struct Curl_easy *data,
+                               struct Curl_multi *multi)
+{
+  struct parallel *par = calloc(1, sizeof(struct parallel));
+  struct timeval start = curlx_tvnow();
+  curl_off_t received = 0;
+  CURLcode result;
+  int i;
+  SIGPIPE_VARIABLE(pipe_st);
+
+  if(!par)
+    return CURLE_OUT_OF_MEMORY;
+
+  par->parts = calloc(1, sizeof(struct range_part));
+  if(!par->parts) {
+    free(par);
+    return CURLE_OUT_OF_MEMORY;
+  }
+  par->data = data;
+  par->multi = multi;
+  par->max_workers = (int)data->set.range_connections;
+  par->total = -1;
+  par->num_parts = 1;
+  par->parts[0].size = PROBE_SIZE;
+
+  /* keep a connection for each of them */
+  if(data->set.maxconnects < (size_t)par->max_workers)
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, (long)par->max_workers);
+
+  /* what Curl_pretransfer() resets for a transfer on the handle itself */
+  data->state.errorbuf = FALSE; /* no error has occurred */
+  data->state.httpversion = 0;
+  Curl_safefree(data->info.wouldredirect);
+  Curl_initinfo(data);
+  Curl_pgrsResetTimesSizes(data);
+  Curl_pgrsSetUploadCounter(data, 0);
+
+  /* read the cookie files into the jar the workers use */
+  if(data->change.cookielist)
+    Curl_cookie_loadfiles(data);
+
+  sigpipe_ignore(data, &pipe_st);
+  result = run(par);
+  sigpipe_restore(&pipe_st);
+
+  if(par->headers_sent)
+    data->info.httpcode = par->httpcode;
+  else if(par->num_workers)
+    data->info.httpcode = par->workers[0].easy->info.httpcode;
+
+  for(i = 0; i < par->num_parts; i++) {
+    received += par->parts[i].got;
+    free(par->parts[i].mem);
+  }
+  Curl_pgrsSetDownloadSize(data, par->total);
+  Curl_pgrsSetDownloadCounter(data, received);
+  data->progress.timespent = curlx_tvdiff_secs(curlx_tvnow(), start);
+  if(data->progress.timespent > 0)
+    data->progress.dlspeed =
+      (curl_off_t)((double)received / data->progress.timespent);
+
+  for(i = 0; i < par->num_workers; i++) {
+    struct range_worker *w = &par->workers[i];
+    if(w->added)
+      curl_multi_remove_handle(multi, w->easy);
+    curl_slist_free_all(w->headers);
+    if(!w->easy)
+      continue;
+    if(w->easy->cookies == data->cookies)
+      /* the jar stays with the application's handle */
+      w->easy->cookies = NULL;
+    curl_easy_cleanup(w->easy);
+  }
+  free(par->parts);
+  free(par->url);
+  free(par);
+
+  return result;
+}
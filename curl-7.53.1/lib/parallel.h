@@ -0,0 +1,34 @@
+#ifndef HEADER_CURL_PARALLEL_H
+#define HEADER_CURL_PARALLEL_H
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+#include "curl_setup.h"
+
+/* the most connections CURLOPT_RANGE_CONNECTIONS allows */
+#define MAX_RANGE_CONNECTIONS 16
+
+bool Curl_parallel_wanted(struct Curl_easy *data);
+
+CURLcode Curl_parallel_perform(struct Curl_easy *data,
+                               struct Curl_multi *multi);
+
+#endif /* HEADER_CURL_PARALLEL_H */
@@ -25,6 +25,7 @@
 #include "urldata.h"
 #include "sendf.h"
 #include "progress.h"
+#include "multiif.h"
 #include "curl_printf.h"
 
 /* Provide a string that is 2 + 1 + 2 + 1 + 2 = 8 letters long (plus the zero
@@ -130,12 +131,16 @@ static char *max5data(curl_off_t bytes, char *max5)
 
 */
 
+static int pgrs_update(struct connectdata *conn, struct timeval now);
+
 int Curl_pgrsDone(struct connectdata *conn)
 {
   int rc;
   struct Curl_easy *data = conn->data;
   data->progress.lastshow=0;
-  rc = Curl_pgrsUpdate(conn); /* the final (forced) update */
+  /* the final (forced) update, with the clock read as this is the time the
+     total time is reported from */
+  rc = pgrs_update(conn, Curl_tvnow());
   if(rc)
     return rc;
 
@@ -215,7 +220,8 @@ void Curl_pgrsTime(struct Curl_easy *data, timerid timer)
 void Curl_pgrsStartNow(struct Curl_easy *data)
 {
   data->progress.speeder_c = 0; /* reset the progress meter display */
-  data->progress.start = Curl_tvnow();
+  /* the time of the pass, as later updates in the same pass use that */
+  data->progress.start = Curl_multi_tvnow(data);
   data->progress.ul_limit_start.tv_sec = 0;
   data->progress.ul_limit_start.tv_usec = 0;
   data->progress.dl_limit_start.tv_sec = 0;
@@ -273,7 +279,7 @@ long Curl_pgrsLimitWaitTime(curl_off_t cursize,
 
 void Curl_pgrsSetDownloadCounter(struct Curl_easy *data, curl_off_t size)
 {
-  struct timeval now = Curl_tvnow();
+  struct timeval now = Curl_multi_tvnow(data);
 
   data->progress.downloaded = size;
 
@@ -291,7 +297,7 @@ void Curl_pgrsSetDownloadCounter(struct Curl_easy *data, curl_off_t size)
 
 void Curl_pgrsSetUploadCounter(struct Curl_easy *data, curl_off_t size)
 {
-  struct timeval now = Curl_tvnow();
+  struct timeval now = Curl_multi_tvnow(data);
 
   data->progress.uploaded = size;
 
@@ -337,7 +343,11 @@ void Curl_pgrsSetUploadSize(struct Curl_easy *data, curl_off_t size)
  */
 int Curl_pgrsUpdate(struct connectdata *conn)
 {
-  struct timeval now;
+  return pgrs_update(conn, Curl_multi_tvnow(conn->data));
+}
+
+static int pgrs_update(struct connectdata *conn, struct timeval now)
+{
   int result;
   char max5[6][10];
   curl_off_t dlpercen=0;
@@ -358,8 +368,6 @@ int Curl_pgrsUpdate(struct connectdata *conn)
   curl_off_t total_estimate;
   bool shownow=FALSE;
 
-  now = Curl_tvnow(); /* what time is it */
-
   /* The time spent so far (from the start) */
   data->progress.timespent = curlx_tvdiff_secs(now, data->progress.start);
   timespent = (curl_off_t)data->progress.timespent;
@@ -242,21 +242,21 @@ void Curl_failf(struct Curl_easy *data, const char *fmt, ...)
 {
   va_list ap;
   size_t len;
+  /* not the transfer buffer, failures happen when there is none */
+  char print_buffer[2048 + 1];
   va_start(ap, fmt);
 
-  vsnprintf(data->state.buffer, BUFSIZE, fmt, ap);
+  vsnprintf(print_buffer, sizeof(print_buffer) - 1, fmt, ap);
 
   if(data->set.errorbuffer && !data->state.errorbuf) {
-    snprintf(data->set.errorbuffer, CURL_ERROR_SIZE, "%s", data->state.buffer);
+    snprintf(data->set.errorbuffer, CURL_ERROR_SIZE, "%s", print_buffer);
     data->state.errorbuf = TRUE; /* wrote error string */
   }
   if(data->set.verbose) {
-    len = strlen(data->state.buffer);
-    if(len < BUFSIZE - 1) {
-      data->state.buffer[len] = '\n';
-      data->state.buffer[++len] = '\0';
-    }
-    Curl_debug(data, CURLINFO_TEXT, data->state.buffer, len, NULL);
+    len = strlen(print_buffer);
+    print_buffer[len] = '\n';
+    print_buffer[++len] = '\0';
+    Curl_debug(data, CURLINFO_TEXT, print_buffer, len, NULL);
   }
 
   va_end(ap);
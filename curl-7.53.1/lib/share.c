@@ -31,6 +31,51 @@
 /* The last #include file should be: */
 #include "memdebug.h"
 
+#ifdef USE_SHARE_LOCKS
+/* set up the locks of a share that locks itself and split its DNS cache */
+static CURLSHcode builtin_locks_init(struct Curl_share *share)
+{
+  int i;
+
+  share->dnsparts = calloc(SHARE_DNS_PARTS, sizeof(struct Curl_dnspart));
+  if(!share->dnsparts)
+    return CURLSHE_NOMEM;
+
+  for(i = 0; i < SHARE_DNS_PARTS; i++) {
+    if(Curl_mk_dnscache(&share->dnsparts[i].cache)) {
+      while(i--)
+        Curl_dnscache_destroy(&share->dnsparts[i].cache);
+      Curl_safefree(share->dnsparts);
+      return CURLSHE_NOMEM;
+    }
+  }
+
+  for(i = 0; i < SHARE_DNS_PARTS; i++)
+    Curl_rwlock_init(&share->dnsparts[i].lock);
+  for(i = 0; i < CURL_LOCK_DATA_LAST; i++)
+    Curl_mutex_init(&share->locks[i]);
+  share->builtin_locks = TRUE;
+  return CURLSHE_OK;
+}
+
+static void builtin_locks_cleanup(struct Curl_share *share)
+{
+  int i;
+
+  if(!share->builtin_locks)
+    return;
+
+  for(i = 0; i < SHARE_DNS_PARTS; i++) {
+    Curl_dnscache_destroy(&share->dnsparts[i].cache);
+    Curl_rwlock_destroy(&share->dnsparts[i].lock);
+  }
+  Curl_safefree(share->dnsparts);
+  for(i = 0; i < CURL_LOCK_DATA_LAST; i++)
+    Curl_mutex_destroy(&share->locks[i]);
+  share->builtin_locks = FALSE;
+}
+#endif
+
 struct Curl_share *
 curl_share_init(void)
 {
@@ -160,6 +205,22 @@ curl_share_setopt(struct Curl_share *share, CURLSHoption option, ...)
     share->clientdata = ptr;
     break;
 
+  case CURLSHOPT_BUILTIN_LOCKS:
+    /* the share->dirty check above matters here: the locks and the split DNS
+       cache must not be switched while easy handles use them */
+#ifdef USE_SHARE_LOCKS
+    if(va_arg(param, long)) {
+      if(!share->builtin_locks)
+        res = builtin_locks_init(share);
+    }
+    else
+      builtin_locks_cleanup(share);
+#else
+    (void)va_arg(param, long);
+    res = CURLSHE_NOT_BUILT_IN;
+#endif
+    break;
+
   default:
     res = CURLSHE_BAD_OPTION;
     break;
@@ -176,17 +237,33 @@ curl_share_cleanup(struct Curl_share *share)
   if(share == NULL)
     return CURLSHE_INVALID;
 
-  if(share->lockfunc)
-    share->lockfunc(NULL, CURL_LOCK_DATA_SHARE, CURL_LOCK_ACCESS_SINGLE,
-                    share->clientdata);
-
-  if(share->dirty) {
-    if(share->unlockfunc)
-      share->unlockfunc(NULL, CURL_LOCK_DATA_SHARE, share->clientdata);
-    return CURLSHE_IN_USE;
+#ifdef USE_SHARE_LOCKS
+  if(share->builtin_locks) {
+    Curl_mutex_acquire(&share->locks[CURL_LOCK_DATA_SHARE]);
+    if(share->dirty) {
+      Curl_mutex_release(&share->locks[CURL_LOCK_DATA_SHARE]);
+      return CURLSHE_IN_USE;
+    }
+    Curl_mutex_release(&share->locks[CURL_LOCK_DATA_SHARE]);
+  }
+  else
+#endif
+  {
+    if(share->lockfunc)
+      share->lockfunc(NULL, CURL_LOCK_DATA_SHARE, CURL_LOCK_ACCESS_SINGLE,
+                      share->clientdata);
+
+    if(share->dirty) {
+      if(share->unlockfunc)
+        share->unlockfunc(NULL, CURL_LOCK_DATA_SHARE, share->clientdata);
+      return CURLSHE_IN_USE;
+    }
   }
 
-  Curl_hash_destroy(&share->hostcache);
+  Curl_dnscache_destroy(&share->hostcache);
+#ifdef USE_SHARE_LOCKS
+  builtin_locks_cleanup(share);
+#endif
 
 #if !defined(CURL_DISABLE_HTTP) && !defined(CURL_DISABLE_COOKIES)
   Curl_cookie_cleanup(share->cookies);
@@ -201,8 +278,11 @@ curl_share_cleanup(struct Curl_share *share)
   }
 #endif
 
-  if(share->unlockfunc)
-    share->unlockfunc(NULL, CURL_LOCK_DATA_SHARE, share->clientdata);
+#ifdef USE_SHARE_LOCKS
+  if(!share->builtin_locks)
+#endif
+    if(share->unlockfunc)
+      share->unlockfunc(NULL, CURL_LOCK_DATA_SHARE, share->clientdata);
   free(share);
 
   return CURLSHE_OK;
@@ -219,6 +299,11 @@ Curl_share_lock(struct Curl_easy *data, curl_lock_data type,
     return CURLSHE_INVALID;
 
   if(share->specifier & (1<<type)) {
+#ifdef USE_SHARE_LOCKS
+    if(share->builtin_locks)
+      Curl_mutex_acquire(&share->locks[type]);
+    else
+#endif
     if(share->lockfunc) /* only call this if set! */
       share->lockfunc(data, type, accesstype, share->clientdata);
   }
@@ -236,9 +321,59 @@ Curl_share_unlock(struct Curl_easy *data, curl_lock_data type)
     return CURLSHE_INVALID;
 
   if(share->specifier & (1<<type)) {
+#ifdef USE_SHARE_LOCKS
+    if(share->builtin_locks)
+      Curl_mutex_release(&share->locks[type]);
+    else
+#endif
     if(share->unlockfunc) /* only call this if set! */
       share->unlockfunc (data, type, share->clientdata);
   }
 
   return CURLSHE_OK;
 }
+
+#ifdef USE_SHARE_LOCKS
+/*
+ * Curl_share_dns_part() returns the part of a split DNS cache that the entry
+ * with the given id is in. The id is hashed differently than the hash tables
+ * of the parts do, so that each part gets entries of all their slots.
+ */
+int Curl_share_dns_part(const char *id, size_t idlen)
+{
+  unsigned int h = 2166136261u;
+
+  while(idlen--) {
+    h ^= (unsigned char)*id++;
+    h *= 16777619u;
+  }
+  return (int)(h % SHARE_DNS_PARTS);
+}
+
+/*
+ * Curl_share_dns_lock() locks a part of the split DNS cache of a share that
+ * locks itself and returns it. Other threads can hold the lock at the same
+ * time, unless 'write' is set or they want to write.
+ */
+struct Curl_dnscache *Curl_share_dns_lock(struct Curl_share *share, int part,
+                                          bool write)
+{
+  struct Curl_dnspart *p = &share->dnsparts[part];
+
+  if(write)
+    Curl_rwlock_write(&p->lock);
+  else
+    Curl_rwlock_read(&p->lock);
+  return &p->cache;
+}
+
+void Curl_share_dns_unlock(struct Curl_share *share, int part, bool write)
+{
+  struct Curl_dnspart *p = &share->dnsparts[part];
+
+  if(write)
+    Curl_rwlock_write_release(&p->lock);
+  else
+    Curl_rwlock_read_release(&p->lock);
+}
+#endif
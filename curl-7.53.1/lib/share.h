@@ -26,6 +26,11 @@
 #include <curl/curl.h>
 #include "cookie.h"
 #include "urldata.h"
+#include "curl_threads.h"
+
+#if defined(USE_THREADS_POSIX) && defined(HAVE_PTHREAD_H)
+#  include <pthread.h>
+#endif
 
 /* SalfordC says "A structure member may not be volatile". Hence:
  */
@@ -35,6 +40,21 @@
 #define CURL_VOLATILE volatile
 #endif
 
+#if (defined(USE_THREADS_POSIX) || defined(USE_THREADS_WIN32)) && \
+  defined(Curl_atomic_inc)
+/* the share can lock itself, see CURLSHOPT_BUILTIN_LOCKS */
+#define USE_SHARE_LOCKS
+
+/* the DNS cache of a share that locks itself is split in this many parts,
+   each with a lock of its own */
+#define SHARE_DNS_PARTS 16
+
+struct Curl_dnspart {
+  curl_rwlock_t lock;
+  struct Curl_dnscache cache;
+};
+#endif
+
 /* this struct is libcurl-private, don't export details */
 struct Curl_share {
   unsigned int specifier;
@@ -44,7 +64,7 @@ struct Curl_share {
   curl_unlock_function unlockfunc;
   void *clientdata;
 
-  struct curl_hash hostcache;
+  struct Curl_dnscache hostcache;
 #if !defined(CURL_DISABLE_HTTP) && !defined(CURL_DISABLE_COOKIES)
   struct CookieInfo *cookies;
 #endif
@@ -52,10 +72,23 @@ struct Curl_share {
   struct curl_ssl_session *sslsession;
   size_t max_ssl_sessions;
   long sessionage;
+
+#ifdef USE_SHARE_LOCKS
+  bool builtin_locks;   /* lock with these, not with the callbacks */
+  curl_mutex_t locks[CURL_LOCK_DATA_LAST];
+  struct Curl_dnspart *dnsparts; /* SHARE_DNS_PARTS of them */
+#endif
 };
 
 CURLSHcode Curl_share_lock(struct Curl_easy *, curl_lock_data,
                            curl_lock_access);
 CURLSHcode Curl_share_unlock(struct Curl_easy *, curl_lock_data);
 
+#ifdef USE_SHARE_LOCKS
+int Curl_share_dns_part(const char *id, size_t idlen);
+struct Curl_dnscache *Curl_share_dns_lock(struct Curl_share *share, int part,
+                                          bool write);
+void Curl_share_dns_unlock(struct Curl_share *share, int part, bool write);
+#endif
+
 #endif /* HEADER_CURL_SHARE_H */
@@ -413,6 +413,10 @@ static CURLcode smb_flush(struct connectdata *conn)
 static CURLcode smb_send_message(struct connectdata *conn, unsigned char cmd,
                                  const void *msg, size_t msg_len)
 {
+  CURLcode result = Curl_multi_uploadbuffer(conn->data);
+  if(result)
+    return result;
+
   smb_format_message(conn, (struct smb_header *)conn->data->state.uploadbuffer,
                      cmd, msg_len);
   memcpy(conn->data->state.uploadbuffer + sizeof(struct smb_header),
@@ -576,11 +580,16 @@ static CURLcode smb_send_read(struct connectdata *conn)
 
 static CURLcode smb_send_write(struct connectdata *conn)
 {
-  struct smb_write *msg = (struct smb_write *)conn->data->state.uploadbuffer;
+  struct smb_write *msg;
   struct smb_request *req = conn->data->req.protop;
   curl_off_t offset = conn->data->req.offset;
 
   curl_off_t upload_size = conn->data->req.size - conn->data->req.bytecount;
+  CURLcode result = Curl_multi_uploadbuffer(conn->data);
+  if(result)
+    return result;
+
+  msg = (struct smb_write *)conn->data->state.uploadbuffer;
   if(upload_size >= MAX_PAYLOAD_SIZE - 1) /* There is one byte of padding */
     upload_size = MAX_PAYLOAD_SIZE - 1;
 
@@ -0,0 +1,376 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+
+#include "curl_setup.h"
+
+#include "timewheel.h"
+
+/*
+ * The wheel counts time in ticks of one millisecond since 'base' and has
+ * been run up to tick 'tick'. A node is kept in the lowest level whose slots
+ * reach its tick: level 0 has one slot per tick for the next WHEEL_SIZE
+ * ticks, level 1 one slot per WHEEL_SIZE ticks and so on. When the wheel
+ * reaches the start of a slot of a higher level, the nodes of that slot are
+ * filed again, further down. Nodes of level 0 slots are moved to the due list
+ * when their tick is reached, and handed out from there when their exact time
+ * has passed.
+ *
+ * Adding and removing a node is O(1), and running the wheel only stops at
+ * ticks where there are slots to deal with.
+ */
+
+#define LEVEL_MASK (WHEEL_SIZE - 1)
+
+#define compare(i,j) Curl_wheel_compare(i,j)
+
+/* the tick the given time falls in, -1 for times before the base */
+static curl_off_t totick(const struct Curl_timewheel *wheel,
+                         struct timeval time)
+{
+  curl_off_t us = (curl_off_t)(time.tv_sec - wheel->base.tv_sec) * 1000000 +
+    (time.tv_usec - wheel->base.tv_usec);
+  return (us < 0) ? -1 : us / 1000;
+}
+
+/* the number of the lowest bit set in a non-zero mask */
+static int lowest_bit(unsigned int mask)
+{
+  int bit = 0;
+  if(!(mask & 0xffff)) {
+    bit += 16;
+    mask >>= 16;
+  }
+  if(!(mask & 0xff)) {
+    bit += 8;
+    mask >>= 8;
+  }
+  if(!(mask & 0xf)) {
+    bit += 4;
+    mask >>= 4;
+  }
+  if(!(mask & 0x3)) {
+    bit += 2;
+    mask >>= 2;
+  }
+  if(!(mask & 0x1))
+    bit++;
+  return bit;
+}
+
+static void link_node(struct Curl_timewheel *wheel,
+                      struct Curl_wheelnode *node, int slot)
+{
+  node->prev = NULL;
+  node->next = wheel->slot[slot];
+  if(node->next)
+    node->next->prev = node;
+  wheel->slot[slot] = node;
+  node->slot = slot;
+  if(slot < WHEEL_DUE)
+    wheel->used[slot / WHEEL_SIZE] |= 1u << (slot & LEVEL_MASK);
+}
+
+static void unlink_node(struct Curl_timewheel *wheel,
+                        struct Curl_wheelnode *node)
+{
+  int slot = node->slot;
+
+  if(node->prev)
+    node->prev->next = node->next;
+  else
+    wheel->slot[slot] = node->next;
+  if(node->next)
+    node->next->prev = node->prev;
+  if(!wheel->slot[slot] && (slot < WHEEL_DUE))
+    wheel->used[slot / WHEEL_SIZE] &= ~(1u << (slot & LEVEL_MASK));
+  node->next = node->prev = NULL;
+  node->slot = -1;
+}
+
+/* put the node in the slot for its time, as seen from the present tick */
+static void file_node(struct Curl_timewheel *wheel,
+                      struct Curl_wheelnode *node)
+{
+  curl_off_t tick = totick(wheel, node->time);
+  curl_off_t ahead;
+  int level = 0;
+
+  if(tick <= wheel->tick) {
+    link_node(wheel, node, WHEEL_DUE);
+    return;
+  }
+
+  ahead = tick - wheel->tick;
+  while(ahead >= ((curl_off_t)1 << (WHEEL_BITS * (level + 1)))) {
+    if(level == WHEEL_LEVELS - 1) {
+      /* beyond the reach of the wheel, keep it in the last slot it reaches
+         to get filed again from there */
+      tick = wheel->tick + ((curl_off_t)1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+      break;
+    }
+    level++;
+  }
+
+  link_node(wheel, node, level * WHEEL_SIZE +
+            (int)((tick >> (WHEEL_BITS * level)) & LEVEL_MASK));
+}
+
+/*
+ * Find the slots holding the earliest nodes of each level, up to the first
+ * level that has nodes before the end of its present round. Their slot
+ * numbers are stored in 'slots' and the ticks they start at in 'starts'.
+ * Returns the number of slots found.
+ */
+static int find_slots(const struct Curl_timewheel *wheel, int *slots,
+                      curl_off_t *starts)
+{
+  int found = 0;
+  int level;
+
+  for(level = 0; level < WHEEL_LEVELS; level++) {
+    int shift = WHEEL_BITS * level;
+    curl_off_t round = wheel->tick >> shift;
+    int index = (int)(round & LEVEL_MASK);
+    unsigned int used = wheel->used[level];
+    unsigned int ahead = (index < LEVEL_MASK) ? used & (~0u << (index + 1)) :
+      0;
+    int bit;
+
+    if(!used)
+      continue;
+
+    if(ahead) {
+      /* this round, before anything in the levels above */
+      bit = lowest_bit(ahead);
+      starts[found] = (round - index + bit) << shift;
+    }
+    else {
+      /* next round */
+      bit = lowest_bit(used);
+      starts[found] = (round - index + WHEEL_SIZE + bit) << shift;
+    }
+    slots[found++] = level * WHEEL_SIZE + bit;
+
+    if(ahead)
+      break;
+  }
+  return found;
+}
+
+/* run the wheel up to the given tick */
+static void advance(struct Curl_timewheel *wheel, curl_off_t tick)
+{
+  while(wheel->tick < tick) {
+    int slots[WHEEL_LEVELS];
+    curl_off_t starts[WHEEL_LEVELS];
+    curl_off_t when;
+    struct Curl_wheelnode *node;
+    int found = find_slots(wheel, slots, starts);
+    int level;
+    int i;
+
+    for(i = 0, when = tick + 1; i < found; i++)
+      if(starts[i] < when)
+        when = starts[i];
+
+    if(when > tick) {
+      /* nothing to do before then */
+      wheel->tick = tick;
+      break;
+    }
+
+    wheel->tick = when;
+
+    /* file the nodes of the higher level slots starting here again, from
+       the top down */
+    for(level = WHEEL_LEVELS - 1; level > 0; level--) {
+      int shift = WHEEL_BITS * level;
+      int slot;
+
+      if(when & (((curl_off_t)1 << shift) - 1))
+        continue;
+
+      slot = level * WHEEL_SIZE + (int)((when >> shift) & LEVEL_MASK);
+      node = wheel->slot[slot];
+      if(!node)
+        continue;
+      wheel->slot[slot] = NULL;
+      wheel->used[level] &= ~(1u << (slot & LEVEL_MASK));
+      /* the first time may have been the start of this slot */
+      wheel->first_ok = FALSE;
+      while(node) {
+        struct Curl_wheelnode *next = node->next;
+        file_node(wheel, node);
+        node = next;
+      }
+    }
+
+    /* the nodes of this tick are due */
+    while((node = wheel->slot[when & LEVEL_MASK]) != NULL) {
+      unlink_node(wheel, node);
+      link_node(wheel, node, WHEEL_DUE);
+    }
+  }
+}
+
+/*
+ * Curl_wheel_init() prepares an empty wheel starting at the given time.
+ */
+void Curl_wheel_init(struct Curl_timewheel *wheel, struct timeval now)
+{
+  memset(wheel, 0, sizeof(*wheel));
+  wheel->base = now;
+  wheel->first_slot = -1;
+}
+
+/*
+ * Curl_wheel_add() adds a node that expires at the given time.
+ *
+ * @unittest: 1399
+ */
+void Curl_wheel_add(struct Curl_timewheel *wheel,
+                    struct Curl_wheelnode *node,
+                    struct timeval time)
+{
+  node->time = time;
+  file_node(wheel, node);
+
+  if(!wheel->count || (wheel->first_ok && (compare(time, wheel->first) < 0))) {
+    wheel->first = time;
+    wheel->first_slot = -1;
+    wheel->first_ok = TRUE;
+  }
+  wheel->count++;
+}
+
+/*
+ * Curl_wheel_remove() removes a node from the wheel. It does nothing if the
+ * node isn't in it.
+ */
+void Curl_wheel_remove(struct Curl_timewheel *wheel,
+                       struct Curl_wheelnode *node)
+{
+  if(node->slot < 0)
+    return;
+
+  if(wheel->first_ok && (!compare(node->time, wheel->first) ||
+                         (node->slot == wheel->first_slot)))
+    /* this may have been the earliest one, or the last one of the slot the
+       first time is the start of */
+    wheel->first_ok = FALSE;
+
+  unlink_node(wheel, node);
+  wheel->count--;
+}
+
+/*
+ * Curl_wheel_getbest() removes and returns a node that has expired at the
+ * given time, or NULL if there is none.
+ *
+ * @unittest: 1399
+ */
+struct Curl_wheelnode *Curl_wheel_getbest(struct Curl_timewheel *wheel,
+                                          struct timeval now)
+{
+  struct Curl_wheelnode *node;
+
+  if(!wheel->count)
+    return NULL;
+
+  advance(wheel, totick(wheel, now));
+
+  /* the due nodes that haven't expired are of the present tick, there are
+     not many of them */
+  for(node = wheel->slot[WHEEL_DUE]; node; node = node->next) {
+    if(compare(node->time, now) <= 0) {
+      Curl_wheel_remove(wheel, node);
+      return node;
+    }
+  }
+
+  /* nothing has expired, so a first time that has passed is out of date */
+  if(wheel->first_ok && (compare(wheel->first, now) <= 0))
+    wheel->first_ok = FALSE;
+  return NULL;
+}
+
+/*
+ * Curl_wheel_first() stores a time no later than the earliest expire time of
+ * the nodes in the wheel in '*first'. It is exact for the nodes of the next
+ * WHEEL_SIZE ticks, for nodes further away it is the tick their slot starts
+ * at, which saves looking at all of them. Returns FALSE if the wheel is
+ * empty.
+ *
+ * @unittest: 1399
+ */
+bool Curl_wheel_first(struct Curl_timewheel *wheel, struct timeval *first)
+{
+  if(!wheel->count)
+    return FALSE;
+
+  if(!wheel->first_ok) {
+    struct Curl_wheelnode *node;
+    int slots[WHEEL_LEVELS];
+    curl_off_t starts[WHEEL_LEVELS];
+    int found = find_slots(wheel, slots, starts);
+    bool ok = FALSE;
+    int i;
+
+    wheel->first_slot = -1;
+    for(node = wheel->slot[WHEEL_DUE]; node; node = node->next)
+      if(!ok || (compare(node->time, wheel->first) < 0)) {
+        wheel->first = node->time;
+        ok = TRUE;
+      }
+
+    for(i = 0; i < found; i++) {
+      if(slots[i] < WHEEL_SIZE) {
+        for(node = wheel->slot[slots[i]]; node; node = node->next)
+          if(!ok || (compare(node->time, wheel->first) < 0)) {
+            wheel->first = node->time;
+            wheel->first_slot = -1;
+            ok = TRUE;
+          }
+      }
+      else {
+        struct timeval start = wheel->base;
+        start.tv_sec += (time_t)(starts[i] / 1000);
+        start.tv_usec += (long)(starts[i] % 1000) * 1000;
+        if(start.tv_usec >= 1000000) {
+          start.tv_sec++;
+          start.tv_usec -= 1000000;
+        }
+        if(!ok || (compare(start, wheel->first) < 0)) {
+          wheel->first = start;
+          wheel->first_slot = slots[i];
+          ok = TRUE;
+        }
+      }
+    }
+
+    DEBUGASSERT(ok);
+    wheel->first_ok = TRUE;
+  }
+
+  *first = wheel->first;
+  return TRUE;
+}
@@ -0,0 +1,77 @@
+#ifndef HEADER_CURL_TIMEWHEEL_H
+#define HEADER_CURL_TIMEWHEEL_H
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+#include "curl_setup.h"
+
+/* A hierarchical timer wheel with millisecond ticks. Every level has
+   WHEEL_SIZE slots, each slot of a level spans all the slots of the level
+   below it. */
+#define WHEEL_BITS 5
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 6
+
+/* the list of nodes that have reached their tick, after all the slots */
+#define WHEEL_DUE (WHEEL_LEVELS * WHEEL_SIZE)
+
+struct Curl_wheelnode {
+  struct Curl_wheelnode *next;
+  struct Curl_wheelnode *prev;
+  struct timeval time;       /* when this node expires */
+  void *payload;             /* data the wheel code doesn't care about */
+  int slot;                  /* the list the node is in, -1 for none */
+};
+
+struct Curl_timewheel {
+  struct Curl_wheelnode *slot[WHEEL_DUE + 1];
+  unsigned int used[WHEEL_LEVELS]; /* bitmask of the non-empty slots */
+  struct timeval base;       /* the time of tick zero */
+  curl_off_t tick;           /* the tick the wheel has been run up to */
+  size_t count;              /* number of nodes in the wheel */
+  struct timeval first;      /* no later than the earliest expire time, if
+                                first_ok */
+  int first_slot;            /* the slot 'first' is the start of, -1 if it
+                                is the time of a node */
+  bool first_ok;
+};
+
+/* compares two times like strcmp() */
+#define Curl_wheel_compare(i,j) (((i).tv_sec < (j).tv_sec) ? -1 : \
+                                 (((i).tv_sec > (j).tv_sec) ? 1 :  \
+                                 (((i).tv_usec < (j).tv_usec) ? -1 : \
+                                 (((i).tv_usec > (j).tv_usec) ? 1 : 0))))
+
+void Curl_wheel_init(struct Curl_timewheel *wheel, struct timeval now);
+
+void Curl_wheel_add(struct Curl_timewheel *wheel,
+                    struct Curl_wheelnode *node,
+                    struct timeval time);
+
+void Curl_wheel_remove(struct Curl_timewheel *wheel,
+                       struct Curl_wheelnode *node);
+
+struct Curl_wheelnode *Curl_wheel_getbest(struct Curl_timewheel *wheel,
+                                          struct timeval now);
+
+bool Curl_wheel_first(struct Curl_timewheel *wheel, struct timeval *first);
+
+#endif /* HEADER_CURL_TIMEWHEEL_H */
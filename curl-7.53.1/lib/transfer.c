@@ -50,6 +50,10 @@
 #include <sys/select.h>
 #endif
 
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
 #ifndef HAVE_SOCKET
 #error "We can't compile without socket() support!"
 #endif
@@ -73,12 +77,38 @@
 #include "connect.h"
 #include "non-ascii.h"
 #include "http2.h"
+#include "strerror.h"
 
 /* The last 3 #include files should be in this order */
 #include "curl_printf.h"
 #include "curl_memory.h"
 #include "memdebug.h"
 
+/*
+ * The read callback used to read the data to upload from CURLOPT_UPLOAD_FD.
+ */
+static size_t fd_read(char *buffer, size_t size, size_t nitems, void *userp)
+{
+  struct Curl_easy *data = (struct Curl_easy *)userp;
+  int fd = data->set.upload_fd;
+  ssize_t nread;
+
+  /* a pipe can't seek, it is read from where it is */
+  if((lseek(fd, (off_t)data->state.upload_fd_offset, SEEK_SET) == -1) &&
+     (errno != ESPIPE)) {
+    failf(data, "Failed to seek in the upload file descriptor");
+    return CURL_READFUNC_ABORT;
+  }
+
+  nread = read(fd, buffer, size * nitems);
+  if(nread < 0) {
+    failf(data, "Failed to read the upload file descriptor");
+    return CURL_READFUNC_ABORT;
+  }
+  data->state.upload_fd_offset += nread;
+  return (size_t)nread;
+}
+
 /*
  * This function will call the read callback to fill our buffer with data
  * to upload.
@@ -257,7 +287,10 @@ CURLcode Curl_readrewind(struct connectdata *conn)
      (data->set.httpreq == HTTPREQ_POST_FORM))
     ; /* do nothing */
   else {
-    if(data->set.seek_func) {
+    if(data->set.upload_fd != -1)
+      /* start over from the offset that was set */
+      data->state.upload_fd_offset = data->set.upload_fd_offset;
+    else if(data->set.seek_func) {
       int err;
 
       err = (data->set.seek_func)(data->set.seek_client, 0, SEEK_SET);
@@ -378,6 +411,36 @@ bool Curl_meets_timecondition(struct Curl_easy *data, time_t timeofdoc)
   return TRUE;
 }
 
+/*
+ * Get the memory to receive body data into. A plain HTTP/1 body that is
+ * neither chunked nor compressed is passed on to the application exactly as
+ * it arrives, so if CURLOPT_WRITEBUFFERFUNCTION gives memory for it, it is
+ * read from the socket straight into that and the copy is saved. All other
+ * data goes through the buffer of the handle.
+ */
+static char *recv_buffer(struct Curl_easy *data,
+                         struct connectdata *conn,
+                         struct SingleRequest *k,
+                         size_t *bytestoread)
+{
+  if(data->set.fwritebuffer && !k->header && !k->chunk &&
+     k->bodywrites && (k->badheader == HEADER_NORMAL) && !k->ignorebody &&
+     !data->set.opt_no_body &&
+     (data->set.http_ce_skip || (k->auto_decoding == IDENTITY)) &&
+     (conn->handler->protocol & PROTO_FAMILY_HTTP) &&
+     !conn->handler->readwrite && (conn->httpversion != 20) &&
+     !Curl_pipeline_wanted(data->multi, CURLPIPE_HTTP1)) {
+    size_t len = 0;
+    char *buf = data->set.fwritebuffer(&len, data->set.writebuffer_data);
+    if(buf && len) {
+      if(len < *bytestoread)
+        *bytestoread = len;
+      return buf;
+    }
+  }
+  return k->buf;
+}
+
 /*
  * Go ahead and do a read if we have a readable socket or if
  * the stream was rewound (in which case we have data in a
@@ -408,6 +471,7 @@ static CURLcode readwrite_data(struct Curl_easy *data,
     size_t buffersize = data->set.buffer_size?
       data->set.buffer_size : BUFSIZE;
     size_t bytestoread = buffersize;
+    char *buf = k->buf; /* where to receive the data */
 
     if(
 #if defined(USE_NGHTTP2)
@@ -430,8 +494,10 @@ static CURLcode readwrite_data(struct Curl_easy *data,
     }
 
     if(bytestoread) {
+      buf = recv_buffer(data, conn, k, &bytestoread);
+
       /* receive data from the network! */
-      result = Curl_read(conn, conn->sockfd, k->buf, bytestoread, &nread);
+      result = Curl_read(conn, conn->sockfd, buf, bytestoread, &nread);
 
       /* read would've blocked */
       if(CURLE_AGAIN == result)
@@ -460,7 +526,8 @@ static CURLcode readwrite_data(struct Curl_easy *data,
 
     /* NUL terminate, allowing string ops to be used */
     if(0 < nread || is_empty_data) {
-      k->buf[nread] = 0;
+      if(buf == k->buf)
+        k->buf[nread] = 0;
     }
     else if(0 >= nread) {
       /* if we receive 0 or less here, the server closed the connection
@@ -472,7 +539,7 @@ static CURLcode readwrite_data(struct Curl_easy *data,
 
     /* Default buffer to use when we write the buffer, it may be changed
        in the flow below before the actual storing is done. */
-    k->str = k->buf;
+    k->str = buf;
 
     if(conn->handler->readwrite) {
       result = conn->handler->readwrite(data, conn, &nread, &readmore);
@@ -847,6 +914,102 @@ static CURLcode done_sending(struct connectdata *conn,
   return CURLE_OK;
 }
 
+#ifdef HAVE_SYS_SENDFILE_H
+
+/* the most data to pass to one sendfile() call */
+#define SENDFILE_MAX (1024*1024)
+
+/*
+ * Returns TRUE if the data to upload can go from CURLOPT_UPLOAD_FD straight
+ * to the socket: nothing needs to be done to the data on the way and the
+ * socket is a plain one without TLS or HTTP/2 on top.
+ */
+static bool can_sendfile(struct connectdata *conn)
+{
+  struct Curl_easy *data = conn->data;
+  int num = (conn->writesockfd == conn->sock[SECONDARYSOCKET]);
+
+  return (data->set.upload_fd != -1) &&
+    !data->state.upload_fd_copy &&
+    /* not sending request headers or a form */
+    (data->state.fread_func == fd_read) &&
+    !data->req.upload_chunky &&
+    !data->set.crlf &&
+    !data->set.prefer_ascii &&
+    !data->set.max_send_speed &&
+    /* the debug callback is to get the data it sends */
+    !(data->set.verbose && data->set.fdebug) &&
+    !(conn->handler->protocol & PROTO_FAMILY_SMTP) &&
+    (conn->send[num] == Curl_send_plain);
+}
+
+/*
+ * Sends data to upload from CURLOPT_UPLOAD_FD to the socket with sendfile().
+ * If sendfile() doesn't work with the descriptor, upload_fd_copy is set and
+ * nothing is sent.
+ */
+static CURLcode sendfile_upload(struct connectdata *conn,
+                                struct SingleRequest *k)
+{
+  struct Curl_easy *data = conn->data;
+  CURLcode result = CURLE_OK;
+  off_t offset = (off_t)data->state.upload_fd_offset;
+  size_t count = SENDFILE_MAX;
+  ssize_t sent;
+  int err;
+#if defined(HAVE_SIGNAL) && defined(SIGPIPE)
+  void (*prev_signal)(int sig) = NULL;
+#endif
+
+  if(data->state.infilesize != -1) {
+    curl_off_t left = data->state.infilesize - k->writebytecount;
+    if(left < (curl_off_t)count)
+      count = (size_t)left;
+  }
+
+#if defined(HAVE_SIGNAL) && defined(SIGPIPE)
+  /* sendfile() has no MSG_NOSIGNAL, a closed connection raises SIGPIPE */
+  if(!data->set.no_signal)
+    prev_signal = signal(SIGPIPE, SIG_IGN);
+#endif
+  sent = sendfile(conn->writesockfd, data->set.upload_fd, &offset, count);
+  err = SOCKERRNO;
+#if defined(HAVE_SIGNAL) && defined(SIGPIPE)
+  if(!data->set.no_signal)
+    signal(SIGPIPE, prev_signal);
+#endif
+
+  if(sent < 0) {
+    if((EAGAIN == err) || (EWOULDBLOCK == err) || (EINTR == err))
+      return CURLE_OK; /* try again when the socket is writable */
+    if((EINVAL == err) || (ESPIPE == err) || (ENOSYS == err)) {
+      /* not a descriptor sendfile() can read from, such as a pipe */
+      infof(data, "Can't use sendfile() for the upload, reading it\n");
+      data->state.upload_fd_copy = TRUE;
+      return CURLE_OK;
+    }
+    failf(data, "sendfile() failed: %s", Curl_strerror(conn, err));
+    return CURLE_SEND_ERROR;
+  }
+
+  if(!sent)
+    /* the end of the file */
+    return done_sending(conn, k);
+
+  data->state.upload_fd_offset = (curl_off_t)offset;
+  k->writebytecount += sent;
+
+  if(k->writebytecount == data->state.infilesize) {
+    /* we have sent all data we were supposed to */
+    k->upload_done = TRUE;
+    infof(data, "We are completely uploaded and fine\n");
+    result = done_sending(conn, k);
+  }
+
+  Curl_pgrsSetUploadCounter(data, k->writebytecount);
+  return result;
+}
+#endif /* HAVE_SYS_SENDFILE_H */
 
 /*
  * Send data to upload to the server, when the socket is writable.
@@ -872,6 +1035,14 @@ static CURLcode readwrite_upload(struct Curl_easy *data,
     /* only read more data if there's no upload data already
        present in the upload buffer */
     if(0 == data->req.upload_present) {
+      if(!k->uploadbuf) {
+        /* the first upload of this transfer */
+        result = Curl_multi_uploadbuffer(data);
+        if(result)
+          return result;
+        k->uploadbuf = data->state.uploadbuffer;
+      }
+
       /* init the "upload from here" pointer */
       data->req.upload_fromhere = k->uploadbuf;
 
@@ -905,6 +1076,15 @@ static CURLcode readwrite_upload(struct Curl_easy *data,
             sending_http_headers = FALSE;
         }
 
+#ifdef HAVE_SYS_SENDFILE_H
+        if(!sending_http_headers && can_sendfile(conn)) {
+          result = sendfile_upload(conn, k);
+          if(result || !data->state.upload_fd_copy)
+            return result;
+          /* read the data to upload from the descriptor instead */
+        }
+#endif
+
         result = Curl_fillreadbuffer(conn, BUFSIZE, &fillcount);
         if(result)
           return result;
@@ -1113,7 +1293,7 @@ CURLcode Curl_readwrite(struct connectdata *conn,
       return result;
   }
 
-  k->now = Curl_tvnow();
+  k->now = Curl_multi_tvnow(data);
   if(didwhat) {
     /* Update read/write counters */
     if(k->bytecountp)
@@ -1275,8 +1455,15 @@ int Curl_single_getsock(const struct connectdata *conn,
    which means this gets called once for each subsequent redirect etc */
 void Curl_init_CONNECT(struct Curl_easy *data)
 {
-  data->state.fread_func = data->set.fread_func_set;
-  data->state.in = data->set.in_set;
+  if(data->set.upload_fd != -1) {
+    /* read the data to upload from the file descriptor */
+    data->state.fread_func = fd_read;
+    data->state.in = data;
+  }
+  else {
+    data->state.fread_func = data->set.fread_func_set;
+    data->state.in = data->set.in_set;
+  }
 }
 
 /*
@@ -1293,6 +1480,11 @@ CURLcode Curl_pretransfer(struct Curl_easy *data)
     return CURLE_URL_MALFORMAT;
   }
 
+  /* the handle has no buffers while it doesn't transfer */
+  result = Curl_multi_getbuffers(data);
+  if(result)
+    return result;
+
   /* Init the SSL session ID cache here. We do it here since we want to do it
      after the *_setopt() calls (that could specify the size of the cache) but
      before any transfer takes place. */
@@ -1316,6 +1508,19 @@ CURLcode Curl_pretransfer(struct Curl_easy *data)
   else
     data->state.infilesize = data->set.postfieldsize;
 
+  if(data->set.upload_fd != -1) {
+    struct_stat st;
+    data->state.upload_fd_offset = data->set.upload_fd_offset;
+    data->state.upload_fd_copy = FALSE;
+
+    /* unless told, the size to upload is the rest of a regular file */
+    if((data->state.infilesize == -1) &&
+       !fstat(data->set.upload_fd, &st) && S_ISREG(st.st_mode) &&
+       ((curl_off_t)st.st_size >= data->set.upload_fd_offset))
+      data->state.infilesize = (curl_off_t)st.st_size -
+        data->set.upload_fd_offset;
+  }
+
   /* If there is a list of cookie files to read, do it now! */
   if(data->change.cookielist)
     Curl_cookie_loadfiles(data);
@@ -1356,7 +1561,7 @@ CURLcode Curl_pretransfer(struct Curl_easy *data)
 
     if(data->set.wildcardmatch) {
       struct WildcardData *wc = &data->wildcard;
-      if(!wc->filelist) {
+      if(!wc->filelist.dtor) {
         result = Curl_wildcard_init(wc); /* init wildcard structures */
         if(result)
           return CURLE_OUT_OF_MEMORY;
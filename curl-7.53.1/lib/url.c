@@ -119,6 +119,7 @@ bool curl_win32_idn_to_ascii(const char *in, char **out);
 #include "pipeline.h"
 #include "dotdot.h"
 #include "strdup.h"
+#include "parallel.h"
 /* The last 3 #include files should be in this order */
 #include "curl_printf.h"
 #include "curl_memory.h"
@@ -284,6 +285,9 @@ void Curl_freeset(struct Curl_easy *data)
     data->change.url_alloc = FALSE;
   }
   data->change.url = NULL;
+
+  /* the template was made from the options freed above */
+  Curl_http_reqtmpl_reset(data);
 }
 
 static CURLcode setstropt(char **charp, const char *s)
@@ -411,10 +415,7 @@ CURLcode Curl_close(struct Curl_easy *data)
   /* Destroy the timeout list that is held in the easy handle. It is
      /normally/ done by curl_multi_remove_handle() but this is "just in
      case" */
-  if(data->state.timeoutlist) {
-    Curl_llist_destroy(data->state.timeoutlist, NULL);
-    data->state.timeoutlist = NULL;
-  }
+  Curl_llist_destroy(&data->state.timeoutlist, NULL);
 
   data->magic = 0; /* force a clear AFTER the possibly enforced removal from
                       the multi handle, since that function uses the magic
@@ -434,6 +435,7 @@ CURLcode Curl_close(struct Curl_easy *data)
   Curl_ssl_close_all(data);
   Curl_safefree(data->state.first_host);
   Curl_safefree(data->state.scratch);
+  Curl_unencode_close(data);
   Curl_ssl_free_certinfo(data);
 
   /* Cleanup possible redirect junk */
@@ -452,8 +454,7 @@ CURLcode Curl_close(struct Curl_easy *data)
   }
   data->change.url = NULL;
 
-  Curl_safefree(data->state.buffer);
-  Curl_safefree(data->state.headerbuff);
+  Curl_multi_putbuffers(data);
 
   Curl_flush_cookies(data, 1);
 
@@ -515,6 +516,8 @@ CURLcode Curl_init_userdefined(struct UserDefined *set)
   set->convfromutf8    = ZERO_NULL;
 
   set->filesize = -1;        /* we don't know the size */
+  set->upload_fd = -1;       /* read the upload data with the callback */
+  set->range_fd = -1;        /* write the ranges with the callback */
   set->postfieldsize = -1;   /* unknown size */
   set->maxredirs = -1;       /* allow any amount by default */
 
@@ -647,22 +650,10 @@ CURLcode Curl_open(struct Curl_easy **curl)
 
   /* We do some initial setup here, all those fields that can't be just 0 */
 
-  data->state.buffer = malloc(BUFSIZE + 1);
-  if(!data->state.buffer) {
-    DEBUGF(fprintf(stderr, "Error: malloc of buffer failed\n"));
-    result = CURLE_OUT_OF_MEMORY;
-  }
-
-  data->state.headerbuff = malloc(HEADERSIZE);
-  if(!data->state.headerbuff) {
-    DEBUGF(fprintf(stderr, "Error: malloc of headerbuff failed\n"));
-    result = CURLE_OUT_OF_MEMORY;
-  }
-  else {
-    result = Curl_init_userdefined(&data->set);
-
-    data->state.headersize=HEADERSIZE;
-
+  /* the transfer buffers are allocated when a transfer starts, see
+     Curl_multi_getbuffers() */
+  result = Curl_init_userdefined(&data->set);
+  if(!result) {
     Curl_convert_init(data);
 
     Curl_initinfo(data);
@@ -674,7 +665,6 @@ CURLcode Curl_open(struct Curl_easy **curl)
     data->state.current_speed = -1; /* init to negative == impossible */
 
     data->wildcard.state = CURLWC_INIT;
-    data->wildcard.filelist = NULL;
     data->set.fnmatch = ZERO_NULL;
     data->set.maxconnects = DEFAULT_CONNCACHE_SIZE; /* for easy handles */
 
@@ -683,8 +673,6 @@ CURLcode Curl_open(struct Curl_easy **curl)
 
   if(result) {
     Curl_resolver_cleanup(data->state.resolver);
-    free(data->state.buffer);
-    free(data->state.headerbuff);
     Curl_freeset(data);
     free(data);
     data = NULL;
@@ -709,6 +697,16 @@ CURLcode Curl_setopt(struct Curl_easy *data, CURLoption option,
   case CURLOPT_DNS_CACHE_TIMEOUT:
     data->set.dns_cache_timeout = va_arg(param, long);
     break;
+  case CURLOPT_DNS_STALE_WHILE_REVALIDATE:
+    /*
+     * Seconds past the DNS cache timeout that an entry may still be used,
+     * while it is resolved again in the background.
+     */
+    arg = va_arg(param, long);
+    if(arg < 0)
+      return CURLE_BAD_FUNCTION_ARGUMENT;
+    data->set.dns_stale_while_revalidate = arg;
+    break;
   case CURLOPT_DNS_USE_GLOBAL_CACHE:
     /* remember we want this enabled */
     arg = va_arg(param, long);
@@ -966,11 +964,13 @@ CURLcode Curl_setopt(struct Curl_easy *data, CURLoption option,
     result = setstropt(&data->set.str[STRING_ENCODING],
                        (argptr && !*argptr)?
                        ALL_CONTENT_ENCODINGS: argptr);
+    Curl_http_reqtmpl_reset(data);
     break;
 
   case CURLOPT_TRANSFER_ENCODING:
     data->set.http_transfer_encoding = (0 != va_arg(param, long)) ?
                                        TRUE : FALSE;
+    Curl_http_reqtmpl_reset(data);
     break;
 
   case CURLOPT_FOLLOWLOCATION:
@@ -1144,6 +1144,7 @@ CURLcode Curl_setopt(struct Curl_easy *data, CURLoption option,
      */
     result = setstropt(&data->set.str[STRING_USERAGENT],
                        va_arg(param, char *));
+    Curl_http_reqtmpl_reset(data);
     break;
 
   case CURLOPT_HTTPHEADER:
@@ -1151,6 +1152,7 @@ CURLcode Curl_setopt(struct Curl_easy *data, CURLoption option,
      * Set a list with HTTP headers to use (or replace internals with)
      */
     data->set.headers = va_arg(param, struct curl_slist *);
+    Curl_http_reqtmpl_reset(data);
     break;
 
   case CURLOPT_PROXYHEADER:
@@ -1165,6 +1167,7 @@ CURLcode Curl_setopt(struct Curl_easy *data, CURLoption option,
      * Set this option to NULL to restore the previous behavior.
      */
     data->set.proxyheaders = va_arg(param, struct curl_slist *);
+    Curl_http_reqtmpl_reset(data);
     break;
 
   case CURLOPT_HEADEROPT:
@@ -1173,6 +1176,7 @@ CURLcode Curl_setopt(struct Curl_easy *data, CURLoption option,
      */
     arg = va_arg(param, long);
     data->set.sep_headers = (arg & CURLHEADER_SEPARATE)? TRUE: FALSE;
+    Curl_http_reqtmpl_reset(data);
     break;
 
   case CURLOPT_HTTP200ALIASES:
@@ -1626,6 +1630,46 @@ CURLcode Curl_setopt(struct Curl_easy *data, CURLoption option,
      */
     data->set.filesize = va_arg(param, curl_off_t);
     break;
+  case CURLOPT_UPLOAD_FD:
+    /*
+     * File descriptor to read the data to upload from. Where possible the
+     * data is sent from it to the socket without passing through libcurl.
+     */
+    arg = va_arg(param, long);
+    if(arg < -1)
+      return CURLE_BAD_FUNCTION_ARGUMENT;
+    data->set.upload_fd = (int)arg;
+    break;
+  case CURLOPT_UPLOAD_FD_OFFSET:
+    /*
+     * Where in the upload file descriptor the data to upload starts.
+     */
+    data->set.upload_fd_offset = va_arg(param, curl_off_t);
+    if(data->set.upload_fd_offset < 0) {
+      data->set.upload_fd_offset = 0;
+      return CURLE_BAD_FUNCTION_ARGUMENT;
+    }
+    break;
+  case CURLOPT_RANGE_CONNECTIONS:
+    /*
+     * Number of connections to download an HTTP resource over, each getting
+     * ranges of it.
+     */
+    arg = va_arg(param, long);
+    if((arg < 0) || (arg > MAX_RANGE_CONNECTIONS))
+      return CURLE_BAD_FUNCTION_ARGUMENT;
+    data->set.range_connections = arg;
+    break;
+  case CURLOPT_RANGE_FD:
+    /*
+     * File descriptor the ranges of a download over several connections are
+     * written to, each at its offset.
+     */
+    arg = va_arg(param, long);
+    if(arg < -1)
+      return CURLE_BAD_FUNCTION_ARGUMENT;
+    data->set.range_fd = (int)arg;
+    break;
   case CURLOPT_LOW_SPEED_LIMIT:
     /*
      * The low speed limit that if transfers are below this for
@@ -1901,6 +1945,18 @@ CURLcode Curl_setopt(struct Curl_easy *data, CURLoption option,
     else
       data->set.is_fwrite_set = 1;
     break;
+  case CURLOPT_WRITEBUFFERFUNCTION:
+    /*
+     * Set the callback that gives the memory to write received data to
+     */
+    data->set.fwritebuffer = va_arg(param, curl_writebuffer_callback);
+    break;
+  case CURLOPT_WRITEBUFFERDATA:
+    /*
+     * Custom pointer to pass the write buffer callback.
+     */
+    data->set.writebuffer_data = va_arg(param, void *);
+    break;
   case CURLOPT_READFUNCTION:
     /*
      * Read data callback
@@ -2290,8 +2346,9 @@ CURLcode Curl_setopt(struct Curl_easy *data, CURLoption option,
     else if(data->set.buffer_size < 1)
       data->set.buffer_size = BUFSIZE;
 
-    /* Resize only if larger than default buffer size. */
-    if(data->set.buffer_size > BUFSIZE) {
+    /* Resize only if larger than default buffer size, and only a buffer of
+       a transfer going on. Others get the size when they are allocated. */
+    if(data->state.buffer && (data->set.buffer_size > BUFSIZE)) {
       data->state.buffer = realloc(data->state.buffer,
                                    data->set.buffer_size + 1);
       if(!data->state.buffer) {
@@ -2975,7 +3032,6 @@ static void conn_free(struct connectdata *conn)
   Curl_safefree(conn->allocptr.uagent);
   Curl_safefree(conn->allocptr.userpwd);
   Curl_safefree(conn->allocptr.accept_encoding);
-  Curl_safefree(conn->allocptr.te);
   Curl_safefree(conn->allocptr.rangeline);
   Curl_safefree(conn->allocptr.ref);
   Curl_safefree(conn->allocptr.host);
@@ -2991,11 +3047,8 @@ static void conn_free(struct connectdata *conn)
 
   conn_reset_all_postponed_data(conn);
 
-  Curl_llist_destroy(conn->send_pipe, NULL);
-  Curl_llist_destroy(conn->recv_pipe, NULL);
-
-  conn->send_pipe = NULL;
-  conn->recv_pipe = NULL;
+  Curl_llist_destroy(&conn->send_pipe, NULL);
+  Curl_llist_destroy(&conn->recv_pipe, NULL);
 
   Curl_safefree(conn->localdev);
   Curl_free_primary_ssl_config(&conn->ssl_config);
@@ -3021,6 +3074,7 @@ static void conn_free(struct connectdata *conn)
 CURLcode Curl_disconnect(struct connectdata *conn, bool dead_connection)
 {
   struct Curl_easy *data;
+  bool getbuffers;
   if(!conn)
     return CURLE_OK; /* this is closed and fine already */
   data = conn->data;
@@ -3035,9 +3089,9 @@ CURLcode Curl_disconnect(struct connectdata *conn, bool dead_connection)
    * are other users of it
    */
   if(!conn->bits.close &&
-     (conn->send_pipe->size + conn->recv_pipe->size)) {
+     (conn->send_pipe.size + conn->recv_pipe.size)) {
     DEBUGF(infof(data, "Curl_disconnect, usecounter: %d\n",
-                 conn->send_pipe->size + conn->recv_pipe->size));
+                 conn->send_pipe.size + conn->recv_pipe.size));
     return CURLE_OK;
   }
 
@@ -3053,10 +3107,19 @@ CURLcode Curl_disconnect(struct connectdata *conn, bool dead_connection)
   Curl_http_ntlm_cleanup(conn);
 #endif
 
+  /* a handle that doesn't transfer has no buffers, but the protocol may
+     need them to say goodbye to the server */
+  getbuffers = !data->state.buffer;
+  if(getbuffers && Curl_multi_getbuffers(data))
+    dead_connection = TRUE;
+
   if(conn->handler->disconnect)
     /* This is set if protocol-specific cleanups should be made */
     conn->handler->disconnect(conn, dead_connection);
 
+  if(getbuffers)
+    Curl_multi_putbuffers(data);
+
     /* unlink ourselves! */
   infof(data, "Closing connection %ld\n", conn->connection_id);
   Curl_conncache_remove_conn(data->state.conn_cache, conn);
@@ -3070,8 +3133,8 @@ CURLcode Curl_disconnect(struct connectdata *conn, bool dead_connection)
 
   /* Indicate to all handles on the pipe that we're dead */
   if(Curl_pipeline_wanted(data->multi, CURLPIPE_ANY)) {
-    signalPipeClose(conn->send_pipe, TRUE);
-    signalPipeClose(conn->recv_pipe, TRUE);
+    signalPipeClose(&conn->send_pipe, TRUE);
+    signalPipeClose(&conn->recv_pipe, TRUE);
   }
 
   conn_free(conn);
@@ -3176,9 +3239,9 @@ void Curl_getoff_all_pipelines(struct Curl_easy *data,
   bool send_head = (conn->writechannel_inuse &&
                     Curl_sendpipe_head(data, conn));
 
-  if(Curl_removeHandleFromPipeline(data, conn->recv_pipe) && recv_head)
+  if(Curl_removeHandleFromPipeline(data, &conn->recv_pipe) && recv_head)
     Curl_pipeline_leave_read(conn);
-  if(Curl_removeHandleFromPipeline(data, conn->send_pipe) && send_head)
+  if(Curl_removeHandleFromPipeline(data, &conn->send_pipe) && send_head)
     Curl_pipeline_leave_write(conn);
 }
 
@@ -3239,7 +3302,7 @@ Curl_oldest_idle_connection(struct Curl_easy *data)
 
     bundle = he->ptr;
 
-    curr = bundle->conn_list->head;
+    curr = bundle->conn_list.head;
     while(curr) {
       conn = curr->ptr;
 
@@ -3298,7 +3361,7 @@ find_oldest_idle_connection_in_bundle(struct Curl_easy *data,
 
   now = Curl_tvnow();
 
-  curr = bundle->conn_list->head;
+  curr = bundle->conn_list.head;
   while(curr) {
     conn = curr->ptr;
 
@@ -3326,7 +3389,7 @@ find_oldest_idle_connection_in_bundle(struct Curl_easy *data,
 static bool disconnect_if_dead(struct connectdata *conn,
                                struct Curl_easy *data)
 {
-  size_t pipeLen = conn->send_pipe->size + conn->recv_pipe->size;
+  size_t pipeLen = conn->send_pipe.size + conn->recv_pipe.size;
   if(!pipeLen && !conn->inuse) {
     /* The check for a dead socket makes sense only if there are no
        handles in pipeline and the connection isn't already marked in
@@ -3473,7 +3536,7 @@ ConnectionExists(struct Curl_easy *data,
       }
     }
 
-    curr = bundle->conn_list->head;
+    curr = bundle->conn_list.head;
     while(curr) {
       bool match = FALSE;
       size_t pipeLen;
@@ -3488,7 +3551,7 @@ ConnectionExists(struct Curl_easy *data,
       if(disconnect_if_dead(check, data))
         continue;
 
-      pipeLen = check->send_pipe->size + check->recv_pipe->size;
+      pipeLen = check->send_pipe.size + check->recv_pipe.size;
 
       if(canPipeline) {
         if(check->bits.protoconnstart && check->bits.close)
@@ -3496,8 +3559,8 @@ ConnectionExists(struct Curl_easy *data,
 
         if(!check->bits.multiplex) {
           /* If not multiplexing, make sure the pipe has only GET requests */
-          struct Curl_easy* sh = gethandleathead(check->send_pipe);
-          struct Curl_easy* rh = gethandleathead(check->recv_pipe);
+          struct Curl_easy* sh = gethandleathead(&check->send_pipe);
+          struct Curl_easy* rh = gethandleathead(&check->recv_pipe);
           if(sh) {
             if(!IsPipeliningPossible(sh, check))
               continue;
@@ -3535,7 +3598,7 @@ ConnectionExists(struct Curl_easy *data,
           infof(data, "Connection #%ld isn't open enough, can't reuse\n",
                 check->connection_id);
 #ifdef DEBUGBUILD
-          if(check->recv_pipe->size > 0) {
+          if(check->recv_pipe.size > 0) {
             infof(data,
                   "BAD! Unconnected #%ld has a non-empty recv pipeline!\n",
                   check->connection_id);
@@ -4209,10 +4272,8 @@ static struct connectdata *allocate_conn(struct Curl_easy *data)
   }
 
   /* Initialize the pipeline lists */
-  conn->send_pipe = Curl_llist_alloc((curl_llist_dtor) llist_dtor);
-  conn->recv_pipe = Curl_llist_alloc((curl_llist_dtor) llist_dtor);
-  if(!conn->send_pipe || !conn->recv_pipe)
-    goto error;
+  Curl_llist_init(&conn->send_pipe, (curl_llist_dtor) llist_dtor);
+  Curl_llist_init(&conn->recv_pipe, (curl_llist_dtor) llist_dtor);
 
 #ifdef HAVE_GSSAPI
   conn->data_prot = PROT_CLEAR;
@@ -4235,12 +4296,6 @@ static struct connectdata *allocate_conn(struct Curl_easy *data)
   return conn;
   error:
 
-  Curl_llist_destroy(conn->send_pipe, NULL);
-  Curl_llist_destroy(conn->recv_pipe, NULL);
-
-  conn->send_pipe = NULL;
-  conn->recv_pipe = NULL;
-
   free(conn->master_buffer);
   free(conn->localdev);
   free(conn);
@@ -6065,11 +6120,8 @@ static void reuse_conn(struct connectdata *old_conn,
   Curl_safefree(old_conn->socks_proxy.passwd);
   Curl_safefree(old_conn->localdev);
 
-  Curl_llist_destroy(old_conn->send_pipe, NULL);
-  Curl_llist_destroy(old_conn->recv_pipe, NULL);
-
-  old_conn->send_pipe = NULL;
-  old_conn->recv_pipe = NULL;
+  Curl_llist_destroy(&old_conn->send_pipe, NULL);
+  Curl_llist_destroy(&old_conn->recv_pipe, NULL);
 
   Curl_safefree(old_conn->master_buffer);
 
@@ -6607,7 +6659,7 @@ static CURLcode create_conn(struct Curl_easy *data,
   /* If we found a reusable connection, we may still want to
      open a new connection if we are pipelining. */
   if(reuse && !force_reuse && IsPipeliningPossible(data, conn_temp)) {
-    size_t pipelen = conn_temp->send_pipe->size + conn_temp->recv_pipe->size;
+    size_t pipelen = conn_temp->send_pipe.size + conn_temp->recv_pipe.size;
     if(pipelen > 0) {
       infof(data, "Found connection %ld, with requests in the pipe (%zu)\n",
             conn_temp->connection_id, pipelen);
@@ -6877,7 +6929,7 @@ CURLcode Curl_connect(struct Curl_easy *data,
 
   if(!result) {
     /* no error */
-    if((*in_connect)->send_pipe->size || (*in_connect)->recv_pipe->size)
+    if((*in_connect)->send_pipe.size || (*in_connect)->recv_pipe.size)
       /* pipelining */
       *protocol_done = TRUE;
     else if(!*asyncp) {
@@ -170,7 +170,7 @@
 #include "http_chunks.h" /* for the structs and enum stuff */
 #include "hostip.h"
 #include "hash.h"
-#include "splay.h"
+#include "timewheel.h"
 
 #include "imap.h"
 #include "pop3.h"
@@ -316,7 +316,7 @@ struct ssl_connect_data {
   PRFileDesc *handle;
   char *client_nickname;
   struct Curl_easy *data;
-  struct curl_llist *obj_list;
+  struct curl_llist obj_list;
   PK11GenericObject *obj_clicert;
 #elif defined(USE_GSKIT)
   gsk_handle handle;
@@ -708,7 +708,6 @@ struct SingleRequest {
 #ifdef HAVE_LIBZ
   zlibInitState zlib_init;      /* possible zlib init state;
                                    undefined if Content-Encoding header. */
-  z_stream z;                   /* State structure for zlib. */
 #endif
 
   time_t timeofdoc;
@@ -1030,7 +1029,6 @@ struct connectdata {
     char *host;
     char *cookiehost;
     char *rtsp_transport;
-    char *te; /* TE: request header */
   } allocptr;
 
 #ifdef HAVE_GSSAPI
@@ -1057,10 +1055,10 @@ struct connectdata {
                               handle */
   bool writechannel_inuse; /* whether the write channel is in use by an easy
                               handle */
-  struct curl_llist *send_pipe; /* List of handles waiting to
-                                   send on this pipeline */
-  struct curl_llist *recv_pipe; /* List of handles waiting to read
-                                   their responses on this pipeline */
+  struct curl_llist send_pipe; /* List of handles waiting to
+                                  send on this pipeline */
+  struct curl_llist recv_pipe; /* List of handles waiting to read
+                                  their responses on this pipeline */
   char *master_buffer; /* The master buffer allocated on-demand;
                           used for pipelining. */
   size_t read_pos; /* Current read position in the master buffer */
@@ -1135,6 +1133,9 @@ struct connectdata {
     TUNNEL_COMPLETE /* CONNECT response received completely */
   } tunnel_state[2]; /* two separate ones to allow FTP */
   struct connectbundle *bundle; /* The bundle we are member of */
+  struct curl_llist_element bundle_node; /* in the bundle's list */
+  size_t bundle_hash; /* hash of the connection cache key, computed once */
+  bool bundle_hashed; /* TRUE when bundle_hash is set */
 
   int negnpn; /* APLN or NPN TLS negotiated protocol, CURL_HTTP_VERSION* */
 
@@ -1165,6 +1166,9 @@ struct PureInfo {
   unsigned long proxyauthavail; /* what proxy auth types were announced */
   unsigned long httpauthavail;  /* what host auth types were announced */
   long numconnects; /* how many new connection did libcurl created */
+  long dns_cache_hits;   /* names found in the DNS cache */
+  long dns_cache_misses; /* names not found in the DNS cache */
+  long dns_cache_stale;  /* stale names used while they were refreshed */
   char *contenttype; /* the content type of the object */
   char *wouldredirect; /* URL this would've been redirected to if asked to */
 
@@ -1293,6 +1297,17 @@ struct Curl_http2_dep {
   struct Curl_easy *data;
 };
 
+/* A timeout in the list of pending timeouts of a handle, and in the timer
+   wheel of the multi handle */
+struct time_node {
+  struct curl_llist_element list;
+  struct Curl_wheelnode wheel;
+  bool allocated; /* TRUE if not one of the handle's own 'timenodes' */
+};
+
+/* the number of pending timeouts a handle keeps without allocating */
+#define TIMEOUT_NODES 8
+
 struct UrlState {
 
   /* Points to the connection cache */
@@ -1308,11 +1323,14 @@ struct UrlState {
 
   struct connectdata *lastconnect; /* The last connection, NULL if undefined */
 
+  /* the buffers of a transfer are only allocated while there is one going
+     on, see Curl_multi_getbuffers() */
   char *headerbuff; /* allocated buffer to store headers in */
   size_t headersize;   /* size of the allocation */
 
   char *buffer; /* download buffer */
-  char uploadbuffer[BUFSIZE+1]; /* upload buffer */
+  char *uploadbuffer; /* upload buffer of BUFSIZE+1 bytes, allocated when
+                         first sent from */
   curl_off_t current_speed;  /* the ProgressShow() funcion sets this,
                                 bytes / second */
   bool this_is_a_follow; /* this is a followed Location: request */
@@ -1324,6 +1342,7 @@ struct UrlState {
                        strdup() data.
                     */
   int first_remote_port; /* remote port of the first (not followed) request */
+  int dns_prune_part; /* the part of a split DNS cache to prune next */
   struct curl_ssl_session *session; /* array of 'max_ssl_sessions' size */
   long sessionage;                  /* number of the most recent session */
   char *tempwrite;      /* allocated buffer to keep data in when a write
@@ -1332,6 +1351,12 @@ struct UrlState {
   int tempwritetype;    /* type of the 'tempwrite' buffer as a bitmask that is
                            used with Curl_client_write() */
   char *scratch; /* huge buffer[BUFSIZE*2] when doing upload CRLF replacing */
+#ifdef HAVE_LIBZ
+  z_stream z;    /* zlib stream for content decoding, kept to be reset and
+                    used again by the next response */
+  int zlib_wbits; /* window bits 'z' is initialized with, 0 when it is not */
+  char *unencode_buf; /* allocated buffer that is inflated into */
+#endif
   bool errorbuf; /* Set to TRUE if the error buffer is already filled in.
                     This must be set to FALSE every time _easy_perform() is
                     called. */
@@ -1355,15 +1380,18 @@ struct UrlState {
 
   bool authproblem; /* TRUE if there's some problem authenticating */
 
+  struct http_reqtmpl reqtmpl; /* pre-rendered request headers */
+
   void *resolver; /* resolver state, if it is used in the URL state -
                      ares_channel f.e. */
 
 #if defined(USE_OPENSSL) && defined(HAVE_OPENSSL_ENGINE_H)
   ENGINE *engine;
 #endif /* USE_OPENSSL */
-  struct timeval expiretime; /* set this with Curl_expire() only */
-  struct Curl_tree timenode; /* for the splay stuff */
-  struct curl_llist *timeoutlist; /* list of pending timeouts */
+  struct timeval expiretime; /* the earliest pending timeout, set this with
+                                Curl_expire() only */
+  struct curl_llist timeoutlist; /* list of pending timeouts */
+  struct time_node timenodes[TIMEOUT_NODES]; /* for the timeout list */
 
   /* a place to store the most recently set FTP entrypath */
   char *most_recent_ftp_entrypath;
@@ -1416,6 +1444,9 @@ struct UrlState {
 
   curl_read_callback fread_func; /* read callback/function */
   void *in;                      /* CURLOPT_READDATA */
+  curl_off_t upload_fd_offset;   /* where to read the upload fd next */
+  bool upload_fd_copy;           /* the upload fd can't be sent from
+                                    directly, read it instead */
 
   struct Curl_easy *stream_depends_on;
   bool stream_depends_e; /* set or don't set the Exclusive bit */
@@ -1555,6 +1586,7 @@ struct UserDefined {
   void *in_set;      /* CURLOPT_READDATA */
   void *writeheader; /* write the header to this if non-NULL */
   void *rtp_out;     /* write RTP to this if non-NULL */
+  void *writebuffer_data; /* CURLOPT_WRITEBUFFERDATA */
   long use_port;     /* which port to use (when not using default) */
   unsigned long httpauth;  /* kind of HTTP authentication to use (bitmask) */
   unsigned long proxyauth; /* kind of proxy authentication to use (bitmask) */
@@ -1577,6 +1609,8 @@ struct UserDefined {
   curl_write_callback fwrite_func;   /* function that stores the output */
   curl_write_callback fwrite_header; /* function that stores headers */
   curl_write_callback fwrite_rtp;    /* function that stores interleaved RTP */
+  curl_writebuffer_callback fwritebuffer; /* function that gives memory to
+                                             write received data to */
   curl_read_callback fread_func_set; /* function that reads the input */
   int is_fread_set; /* boolean, has read callback been set to non-NULL? */
   int is_fwrite_set; /* boolean, has write callback been set to non-NULL? */
@@ -1612,6 +1646,10 @@ struct UserDefined {
   long tftp_blksize;    /* in bytes, 0 means use default */
   bool tftp_no_options; /* do not send TFTP options requests */
   curl_off_t filesize;  /* size of file to upload, -1 means unknown */
+  int upload_fd;        /* CURLOPT_UPLOAD_FD, -1 means not set */
+  curl_off_t upload_fd_offset; /* CURLOPT_UPLOAD_FD_OFFSET */
+  long range_connections; /* CURLOPT_RANGE_CONNECTIONS */
+  int range_fd;         /* CURLOPT_RANGE_FD, -1 means not set */
   long low_speed_limit; /* bytes/second */
   long low_speed_time;  /* number of seconds */
   curl_off_t max_send_speed; /* high speed limit in bytes/second for upload */
@@ -1647,6 +1685,7 @@ struct UserDefined {
   struct ssl_general_config general_ssl; /* general user defined SSL stuff */
   curl_proxytype proxytype; /* what kind of proxy that is in use */
   long dns_cache_timeout; /* DNS cache timeout */
+  long dns_stale_while_revalidate; /* seconds stale entries may be used */
   long buffer_size;      /* size of receive buffer to use */
   void *private_data; /* application-private data */
 
@@ -1766,7 +1805,7 @@ struct UserDefined {
 };
 
 struct Names {
-  struct curl_hash *hostcache;
+  struct Curl_dnscache *hostcache;
   enum {
     HCACHE_NONE,    /* not pointing to anything */
     HCACHE_GLOBAL,  /* points to the (shrug) global one */
@@ -1796,6 +1835,9 @@ struct Curl_easy {
   CURLcode result;   /* previous result */
 
   struct Curl_message msg; /* A single posted message. */
+  struct curl_llist_element connect_queue; /* for the multi's pending list */
+  struct curl_llist_element pipeline_queue; /* for the connection's send or
+                                               receive pipeline */
 
   /* Array with the plain socket numbers this handle takes care of, in no
      particular order. Note that all sockets are added to the sockhash, where
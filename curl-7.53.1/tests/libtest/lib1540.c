@@ -0,0 +1,226 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 1998 - 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+/*
+ * Runs a number of transfers, one after the other, while many other
+ * transfers sit idle in the same multi handle. This is done once driven by
+ * curl_multi_wait() and curl_multi_perform() and once by
+ * curl_multi_wait_perform(), and the time each took is shown on stderr.
+ *
+ * The idle transfers connect to a socket that listens but never accepts, so
+ * that they stay waiting for a response. Run by hand with large numbers, for
+ * example "lib1540 http://127.0.0.1:8990/1540 5000 1000" with the test
+ * server running, this compares the two ways of waiting with thousands of
+ * quiet connections.
+ *
+ * argv1 = URL for the active transfers
+ * argv2 = number of idle transfers
+ * argv3 = number of active transfers for each way of waiting
+ */
+#include "test.h"
+
+#ifdef HAVE_NETINET_IN_H
+#  include <netinet/in.h>
+#endif
+#ifdef HAVE_ARPA_INET_H
+#  include <arpa/inet.h>
+#endif
+#ifdef HAVE_SYS_RESOURCE_H
+#  include <sys/resource.h>
+#endif
+
+#include "testutil.h"
+#include "warnless.h"
+#include "memdebug.h"
+
+#define TEST_HANG_TIMEOUT 60 * 1000
+
+static size_t discard(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)ptr;
+  (void)userp;
+  return size * nmemb;
+}
+
+/* a socket that accepts connections in the kernel but never answers */
+static curl_socket_t idle_listener(int backlog, int *portp)
+{
+  struct sockaddr_in addr;
+  curl_socklen_t len = sizeof(addr);
+  curl_socket_t sock = socket(AF_INET, SOCK_STREAM, 0);
+
+  if(sock == CURL_SOCKET_BAD)
+    return CURL_SOCKET_BAD;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+
+  if(bind(sock, (struct sockaddr *)&addr, sizeof(addr)) ||
+     listen(sock, backlog) ||
+     getsockname(sock, (struct sockaddr *)&addr, &len)) {
+    sclose(sock);
+    return CURL_SOCKET_BAD;
+  }
+
+  *portp = ntohs(addr.sin_port);
+  return sock;
+}
+
+static int run_transfers(char *URL, int idle, int active, int use_poll)
+{
+  int res = 0;
+  CURLM *m = NULL;
+  CURL **idlers = NULL;
+  CURL *curl = NULL;
+  curl_socket_t listener;
+  char idle_url[64];
+  struct timeval started;
+  int running;
+  int port;
+  int i;
+
+  listener = idle_listener(idle, &port);
+  if(listener == CURL_SOCKET_BAD) {
+    fprintf(stderr, "failed to create the idle listener\n");
+    return TEST_ERR_MAJOR_BAD;
+  }
+  snprintf(idle_url, sizeof(idle_url), "http://127.0.0.1:%d/idle", port);
+
+  idlers = calloc(idle ? idle : 1, sizeof(CURL *));
+  if(!idlers) {
+    sclose(listener);
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  multi_init(m);
+
+  for(i = 0; i < idle; i++) {
+    easy_init(idlers[i]);
+    easy_setopt(idlers[i], CURLOPT_URL, idle_url);
+    easy_setopt(idlers[i], CURLOPT_WRITEFUNCTION, discard);
+    multi_add_handle(m, idlers[i]);
+  }
+
+  easy_init(curl);
+  easy_setopt(curl, CURLOPT_URL, URL);
+
+  started = tutil_tvnow();
+
+  for(i = 0; i < active; i++) {
+    int done = FALSE;
+
+    multi_add_handle(m, curl);
+
+    while(!done) {
+      CURLMsg *msg;
+      int msgs;
+
+      if(use_poll)
+        multi_wait_perform(m, 1000, &running);
+      else
+        multi_perform(m, &running);
+
+      abort_on_test_timeout();
+
+      while((msg = curl_multi_info_read(m, &msgs)) != NULL) {
+        if(msg->msg != CURLMSG_DONE)
+          continue;
+        if(msg->easy_handle != curl) {
+          fprintf(stderr, "an idle transfer ended (%d)\n",
+                  (int)msg->data.result);
+          res = TEST_ERR_FAILURE;
+          goto test_cleanup;
+        }
+        if(msg->data.result) {
+          fprintf(stderr, "transfer %d failed (%d)\n", i,
+                  (int)msg->data.result);
+          res = (int)msg->data.result;
+          goto test_cleanup;
+        }
+        done = TRUE;
+      }
+
+      if(!done && !use_poll) {
+        CURLMcode mc = curl_multi_wait(m, NULL, 0, 1000, NULL);
+        if(mc != CURLM_OK) {
+          fprintf(stderr, "curl_multi_wait() failed, with code %d (%s)\n",
+                  (int)mc, curl_multi_strerror(mc));
+          res = (int)mc;
+          goto test_cleanup;
+        }
+      }
+    }
+
+    multi_remove_handle(m, curl);
+  }
+
+  fprintf(stderr, "%s: %d transfers next to %d idle ones in %ld ms\n",
+          use_poll ? "curl_multi_wait_perform" : "curl_multi_wait",
+          active, idle,
+          tutil_tvdiff(tutil_tvnow(), started));
+
+test_cleanup:
+
+  /* proper cleanup sequence - type PB */
+
+  for(i = 0; i < idle; i++) {
+    curl_multi_remove_handle(m, idlers[i]);
+    curl_easy_cleanup(idlers[i]);
+  }
+  curl_multi_remove_handle(m, curl);
+  curl_easy_cleanup(curl);
+  curl_multi_cleanup(m);
+  free(idlers);
+  sclose(listener);
+
+  return res;
+}
+
+int test(char *URL)
+{
+  int res = 0;
+  int idle = libtest_arg2 ? atoi(libtest_arg2) : 10;
+  int active = libtest_arg3 ? atoi(libtest_arg3) : 3;
+
+#ifdef HAVE_SYS_RESOURCE_H
+  struct rlimit rl;
+
+  /* every idle transfer needs a descriptor, so allow as many as possible */
+  if(!getrlimit(RLIMIT_NOFILE, &rl) && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    (void)setrlimit(RLIMIT_NOFILE, &rl);
+  }
+#endif
+
+  start_test_timing();
+
+  global_init(CURL_GLOBAL_ALL);
+
+  res = run_transfers(URL, idle, active, FALSE);
+  if(!res)
+    res = run_transfers(URL, idle, active, TRUE);
+
+  curl_global_cleanup();
+
+  return res;
+}
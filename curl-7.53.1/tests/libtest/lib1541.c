@@ -0,0 +1,125 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 1998 - 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+/*
+ * Starts a number of transfers to the same host name at once, so that they
+ * all want it resolved at the same time. With the threaded resolver they
+ * share one resolve. This is done once with the DNS cache and once with
+ * entries that go stale at once, so that each transfer needs a copy of the
+ * result. The time each round took is shown on stderr.
+ *
+ * argv1 = URL, with a host name that has to be resolved
+ * argv2 = number of transfers in each round
+ */
+#include "test.h"
+
+#include "testutil.h"
+#include "warnless.h"
+#include "memdebug.h"
+
+#define TEST_HANG_TIMEOUT 60 * 1000
+
+static int run_round(char *URL, int num, long cache_timeout)
+{
+  int res = 0;
+  CURLM *m = NULL;
+  CURL **handles;
+  struct timeval started;
+  int running = 1;
+  int i;
+
+  handles = calloc(num ? num : 1, sizeof(CURL *));
+  if(!handles)
+    return TEST_ERR_MAJOR_BAD;
+
+  multi_init(m);
+
+  for(i = 0; i < num; i++) {
+    easy_init(handles[i]);
+    easy_setopt(handles[i], CURLOPT_URL, URL);
+    easy_setopt(handles[i], CURLOPT_IPRESOLVE, (long)CURL_IPRESOLVE_V4);
+    easy_setopt(handles[i], CURLOPT_DNS_CACHE_TIMEOUT, cache_timeout);
+    multi_add_handle(m, handles[i]);
+  }
+
+  started = tutil_tvnow();
+
+  while(running) {
+    CURLMsg *msg;
+    int msgs;
+
+    multi_perform(m, &running);
+
+    abort_on_test_timeout();
+
+    while((msg = curl_multi_info_read(m, &msgs)) != NULL) {
+      if(msg->msg == CURLMSG_DONE && msg->data.result) {
+        fprintf(stderr, "transfer failed (%d)\n", (int)msg->data.result);
+        res = (int)msg->data.result;
+        goto test_cleanup;
+      }
+    }
+
+    if(running) {
+      CURLMcode mc = curl_multi_wait(m, NULL, 0, 1000, NULL);
+      if(mc != CURLM_OK) {
+        fprintf(stderr, "curl_multi_wait() failed, with code %d (%s)\n",
+                (int)mc, curl_multi_strerror(mc));
+        res = (int)mc;
+        goto test_cleanup;
+      }
+    }
+  }
+
+  fprintf(stderr, "%d transfers with DNS cache timeout %ld in %ld ms\n",
+          num, cache_timeout, tutil_tvdiff(tutil_tvnow(), started));
+
+test_cleanup:
+
+  /* proper cleanup sequence - type PB */
+
+  for(i = 0; i < num; i++) {
+    curl_multi_remove_handle(m, handles[i]);
+    curl_easy_cleanup(handles[i]);
+  }
+  curl_multi_cleanup(m);
+  free(handles);
+
+  return res;
+}
+
+int test(char *URL)
+{
+  int res = 0;
+  int num = libtest_arg2 ? atoi(libtest_arg2) : 5;
+
+  start_test_timing();
+
+  global_init(CURL_GLOBAL_ALL);
+
+  res = run_round(URL, num, 60);
+  if(!res)
+    res = run_round(URL, num, 0);
+
+  curl_global_cleanup();
+
+  return res;
+}
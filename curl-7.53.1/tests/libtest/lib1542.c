@@ -0,0 +1,98 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 1998 - 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+/*
+ * Checks the DNS cache counters of one handle over a few transfers: the
+ * first one resolves the name, the second finds it in the cache, and the
+ * third finds it expired. With CURLOPT_DNS_STALE_WHILE_REVALIDATE set, the
+ * threaded resolver uses the expired entry while it resolves the name again,
+ * the other resolvers resolve it at once.
+ */
+#include "test.h"
+
+#include "memdebug.h"
+
+static int check_counters(CURL *curl, int round, long hits, long misses,
+                          long stale_or_misses)
+{
+  long h = -1;
+  long m = -1;
+  long s = -1;
+
+  if(curl_easy_getinfo(curl, CURLINFO_DNS_CACHE_HITS, &h) ||
+     curl_easy_getinfo(curl, CURLINFO_DNS_CACHE_MISSES, &m) ||
+     curl_easy_getinfo(curl, CURLINFO_DNS_CACHE_STALE, &s)) {
+    fprintf(stderr, "curl_easy_getinfo() failed\n");
+    return TEST_ERR_FAILURE;
+  }
+
+  if((h != hits) || (misses >= 0 && m != misses) ||
+     (stale_or_misses >= 0 && s + m != stale_or_misses)) {
+    fprintf(stderr, "round %d: %ld hits, %ld misses, %ld stale\n",
+            round, h, m, s);
+    return TEST_ERR_FAILURE;
+  }
+
+  return 0;
+}
+
+int test(char *URL)
+{
+  CURL *curl;
+  CURLcode res = CURLE_OK;
+
+  global_init(CURL_GLOBAL_ALL);
+
+  easy_init(curl);
+
+  easy_setopt(curl, CURLOPT_URL, URL);
+  /* every transfer needs a new connection, and a name */
+  easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+
+  res = curl_easy_perform(curl);
+  if(res)
+    goto test_cleanup;
+  res = check_counters(curl, 1, 0, 1, -1);
+  if(res)
+    goto test_cleanup;
+
+  res = curl_easy_perform(curl);
+  if(res)
+    goto test_cleanup;
+  res = check_counters(curl, 2, 1, 0, -1);
+  if(res)
+    goto test_cleanup;
+
+  easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 0L);
+  easy_setopt(curl, CURLOPT_DNS_STALE_WHILE_REVALIDATE, 60L);
+
+  res = curl_easy_perform(curl);
+  if(res)
+    goto test_cleanup;
+  res = check_counters(curl, 3, 0, -1, 1);
+
+test_cleanup:
+
+  curl_easy_cleanup(curl);
+  curl_global_cleanup();
+
+  return (int)res;
+}
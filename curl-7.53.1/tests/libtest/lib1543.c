@@ -0,0 +1,104 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+/*
+ * Uploads with CURLOPT_UPLOAD_FD twice: first the rest of a file from an
+ * offset, with the size taken from the file, then the same data from a pipe
+ * that can only be read.
+ */
+#include "test.h"
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#include "memdebug.h"
+
+/* the upload file starts with this line, which is not uploaded */
+#define SKIPPED "skip this\n"
+
+int test(char *URL)
+{
+  CURL *curl = NULL;
+  CURLcode res = CURLE_OK;
+  char buffer[256];
+  ssize_t len;
+  int fd = -1;
+  int pipefd[2] = { -1, -1 };
+
+  if(!libtest_arg2) {
+    fprintf(stderr, "Usage: <url> <file-to-upload>\n");
+    return TEST_ERR_USAGE;
+  }
+
+  fd = open(libtest_arg2, O_RDONLY);
+  if(fd == -1) {
+    fprintf(stderr, "Error opening file: %s\n", libtest_arg2);
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  global_init(CURL_GLOBAL_ALL);
+
+  easy_init(curl);
+
+  easy_setopt(curl, CURLOPT_URL, URL);
+  easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+  easy_setopt(curl, CURLOPT_UPLOAD_FD, (long)fd);
+  easy_setopt(curl, CURLOPT_UPLOAD_FD_OFFSET,
+              (curl_off_t)strlen(SKIPPED));
+
+  res = curl_easy_perform(curl);
+  if(res)
+    goto test_cleanup;
+
+  /* a pipe with the same data in it, of a size that is not known */
+  if(lseek(fd, 0, SEEK_SET) || pipe(pipefd)) {
+    fprintf(stderr, "Failed to fill a pipe with the upload\n");
+    res = TEST_ERR_MAJOR_BAD;
+    goto test_cleanup;
+  }
+  len = read(fd, buffer, sizeof(buffer)) - (ssize_t)strlen(SKIPPED);
+  if((len <= 0) ||
+     (write(pipefd[1], buffer + strlen(SKIPPED), (size_t)len) != len)) {
+    fprintf(stderr, "Failed to fill a pipe with the upload\n");
+    res = TEST_ERR_MAJOR_BAD;
+    goto test_cleanup;
+  }
+  close(pipefd[1]);
+  pipefd[1] = -1;
+
+  easy_setopt(curl, CURLOPT_UPLOAD_FD, (long)pipefd[0]);
+  easy_setopt(curl, CURLOPT_UPLOAD_FD_OFFSET, (curl_off_t)0);
+
+  res = curl_easy_perform(curl);
+
+test_cleanup:
+
+  curl_easy_cleanup(curl);
+  curl_global_cleanup();
+  if(pipefd[0] != -1)
+    close(pipefd[0]);
+  if(pipefd[1] != -1)
+    close(pipefd[1]);
+  close(fd);
+
+  return (int)res;
+}
@@ -0,0 +1,103 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+/*
+ * Gets a plain body with a small receive buffer and gives memory of its own
+ * with CURLOPT_WRITEBUFFERFUNCTION. The start of the body arrives together
+ * with the headers and is copied, the rest is to be received straight into
+ * the given memory.
+ */
+#include "test.h"
+
+#include "memdebug.h"
+
+/* a small piece to have the body received in a number of reads */
+#define PIECE 40
+
+struct output {
+  char buf[1024];
+  size_t used;
+  int inplace; /* number of writes made where we asked for them */
+};
+
+static char *writebuffer(size_t *size, void *userdata)
+{
+  struct output *out = (struct output *)userdata;
+
+  *size = sizeof(out->buf) - out->used;
+  if(*size > PIECE)
+    *size = PIECE;
+  return out->buf + out->used;
+}
+
+static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+  struct output *out = (struct output *)userdata;
+  size_t len = size * nmemb;
+
+  if(len > sizeof(out->buf) - out->used)
+    return 0;
+  if(ptr == out->buf + out->used)
+    out->inplace++;
+  else
+    memcpy(out->buf + out->used, ptr, len);
+  out->used += len;
+  return len;
+}
+
+int test(char *URL)
+{
+  CURL *curl = NULL;
+  CURLcode res = CURLE_OK;
+  struct output out;
+
+  memset(&out, 0, sizeof(out));
+
+  global_init(CURL_GLOBAL_ALL);
+
+  easy_init(curl);
+
+  easy_setopt(curl, CURLOPT_URL, URL);
+  easy_setopt(curl, CURLOPT_BUFFERSIZE, 100L);
+  easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+  easy_setopt(curl, CURLOPT_WRITEDATA, &out);
+  easy_setopt(curl, CURLOPT_WRITEBUFFERFUNCTION, writebuffer);
+  easy_setopt(curl, CURLOPT_WRITEBUFFERDATA, &out);
+
+  res = curl_easy_perform(curl);
+  if(res)
+    goto test_cleanup;
+
+  if(!out.inplace) {
+    fprintf(stderr, "no data was received into the given buffer\n");
+    res = TEST_ERR_FAILURE;
+    goto test_cleanup;
+  }
+
+  fwrite(out.buf, 1, out.used, stdout);
+
+test_cleanup:
+
+  curl_easy_cleanup(curl);
+  curl_global_cleanup();
+
+  return (int)res;
+}
@@ -0,0 +1,174 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+/*
+ * Downloads a resource over several connections with CURLOPT_RANGE_CONNECTIONS
+ * twice: first through the write callback, then into a file with
+ * CURLOPT_RANGE_FD. The server makes up a resource where each 8 bytes hold
+ * their offset in hex, which shows when a part ends up in the wrong place.
+ */
+#include "test.h"
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#include "memdebug.h"
+
+/* the size of the resource the server is told to serve */
+#define RESOURCE_SIZE 700000
+
+struct output {
+  char *buf;
+  size_t used;
+  int headers; /* number of header lines */
+  int partial; /* the first one was a 206 */
+};
+
+static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+  struct output *out = (struct output *)userdata;
+  size_t len = size * nmemb;
+
+  if(len > RESOURCE_SIZE - out->used)
+    return 0;
+  memcpy(out->buf + out->used, ptr, len);
+  out->used += len;
+  return len;
+}
+
+static size_t header_cb(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+  struct output *out = (struct output *)userdata;
+  size_t len = size * nmemb;
+
+  if(!out->headers++ && (len > 12) && !strncmp(ptr, "HTTP/1.1 206", 12))
+    out->partial = 1;
+  return len;
+}
+
+/* returns the offset of the first byte that is wrong, or -1 */
+static long check(const char *buf, size_t len)
+{
+  char block[16];
+  size_t i;
+
+  if(len != RESOURCE_SIZE)
+    return (long)len;
+  for(i = 0; i < len; i++) {
+    if(!(i & 7))
+      snprintf(block, sizeof(block), "%07lx\n", (unsigned long)i);
+    if(buf[i] != block[i & 7])
+      return (long)i;
+  }
+  return -1;
+}
+
+int test(char *URL)
+{
+  CURL *curl = NULL;
+  CURLcode res = CURLE_OK;
+  struct output out;
+  long code = 0;
+  double size = 0;
+  long wrong;
+  int fd = -1;
+
+  if(!libtest_arg2) {
+    fprintf(stderr, "Usage: <url> <file-to-download-to>\n");
+    return TEST_ERR_USAGE;
+  }
+
+  memset(&out, 0, sizeof(out));
+  out.buf = malloc(RESOURCE_SIZE);
+  if(!out.buf)
+    return TEST_ERR_MAJOR_BAD;
+
+  global_init(CURL_GLOBAL_ALL);
+
+  easy_init(curl);
+
+  easy_setopt(curl, CURLOPT_URL, URL);
+  easy_setopt(curl, CURLOPT_RANGE_CONNECTIONS, 4L);
+  easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+  easy_setopt(curl, CURLOPT_WRITEDATA, &out);
+  easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_cb);
+  easy_setopt(curl, CURLOPT_HEADERDATA, &out);
+
+  res = curl_easy_perform(curl);
+  if(res)
+    goto test_cleanup;
+
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD, &size);
+  wrong = check(out.buf, out.used);
+  if((wrong != -1) || (code != 206) || !out.partial ||
+     ((curl_off_t)size != RESOURCE_SIZE)) {
+    fprintf(stderr, "callback: wrong at %ld, code %ld, size %.0f\n",
+            wrong, code, size);
+    res = TEST_ERR_FAILURE;
+    goto test_cleanup;
+  }
+  printf("callback: %zu bytes in order\n", out.used);
+
+  fd = open(libtest_arg2, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(fd == -1) {
+    fprintf(stderr, "Error opening file: %s\n", libtest_arg2);
+    res = TEST_ERR_MAJOR_BAD;
+    goto test_cleanup;
+  }
+
+  out.used = 0;
+  easy_setopt(curl, CURLOPT_RANGE_FD, (long)fd);
+
+  res = curl_easy_perform(curl);
+  if(res)
+    goto test_cleanup;
+
+  if(out.used) {
+    fprintf(stderr, "fd: the write callback was called\n");
+    res = TEST_ERR_FAILURE;
+    goto test_cleanup;
+  }
+  if(lseek(fd, 0, SEEK_SET) ||
+     (read(fd, out.buf, RESOURCE_SIZE) != RESOURCE_SIZE)) {
+    fprintf(stderr, "fd: failed to read back %s\n", libtest_arg2);
+    res = TEST_ERR_FAILURE;
+    goto test_cleanup;
+  }
+  wrong = check(out.buf, RESOURCE_SIZE);
+  if(wrong != -1) {
+    fprintf(stderr, "fd: wrong at %ld\n", wrong);
+    res = TEST_ERR_FAILURE;
+    goto test_cleanup;
+  }
+  printf("fd: %d bytes in order\n", RESOURCE_SIZE);
+
+test_cleanup:
+
+  curl_easy_cleanup(curl);
+  curl_global_cleanup();
+  if(fd != -1)
+    close(fd);
+  free(out.buf);
+
+  return (int)res;
+}
@@ -0,0 +1,125 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+
+/*
+ * Share the DNS cache between handles with a share that locks itself,
+ * populate it with CURLOPT_RESOLVE in the first request and then make sure
+ * the other handles find and use the populated stuff.
+ */
+
+#include "test.h"
+
+#include "memdebug.h"
+
+#define NUM_HANDLES 4
+
+int test(char *URL)
+{
+  int res = 0;
+  CURL *curl[NUM_HANDLES] = {NULL, NULL, NULL, NULL};
+  CURLSH *share = NULL;
+  CURLSHcode shres;
+  char *port = libtest_arg3;
+  char *address = libtest_arg2;
+  char dnsentry[256];
+  struct curl_slist *slist = NULL;
+  int i;
+  char target_url[256];
+  (void)URL; /* URL is setup in the code */
+
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
+    fprintf(stderr, "curl_global_init() failed\n");
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  share = curl_share_init();
+  if(!share) {
+    fprintf(stderr, "curl_share_init() failed\n");
+    curl_global_cleanup();
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  /* builds without threads can't lock, but then it isn't needed */
+  shres = curl_share_setopt(share, CURLSHOPT_BUILTIN_LOCKS, 1L);
+  if(shres && (shres != CURLSHE_NOT_BUILT_IN)) {
+    fprintf(stderr, "CURLSHOPT_BUILTIN_LOCKS failed: %d\n", (int)shres);
+    res = TEST_ERR_MAJOR_BAD;
+    goto test_cleanup;
+  }
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+
+  snprintf(dnsentry, sizeof(dnsentry), "server.example.curl:%s:%s",
+           port, address);
+  printf("%s\n", dnsentry);
+  slist = curl_slist_append(slist, dnsentry);
+
+  /* get NUM_HANDLES easy handles */
+  for(i=0; i < NUM_HANDLES; i++) {
+    /* get an easy handle */
+    easy_init(curl[i]);
+    /* specify target */
+    snprintf(target_url, sizeof(target_url),
+             "http://server.example.curl:%s/path/1547%04i",
+             port, i + 1);
+    target_url[sizeof(target_url) - 1] = '\0';
+    easy_setopt(curl[i], CURLOPT_URL, target_url);
+    /* go verbose */
+    easy_setopt(curl[i], CURLOPT_VERBOSE, 1L);
+    /* include headers */
+    easy_setopt(curl[i], CURLOPT_HEADER, 1L);
+
+    easy_setopt(curl[i], CURLOPT_SHARE, share);
+  }
+
+  /* make the first one populate the shared cache */
+  easy_setopt(curl[0], CURLOPT_RESOLVE, slist);
+
+  /* run NUM_HANDLES transfers */
+  for(i=0; (i < NUM_HANDLES) && !res; i++)
+    res = curl_easy_perform(curl[i]);
+
+  /* the share can't go away while it is used */
+  if(!res && (curl_share_cleanup(share) != CURLSHE_IN_USE)) {
+    fprintf(stderr, "curl_share_cleanup() of a used share didn't fail\n");
+    res = TEST_ERR_MAJOR_BAD;
+  }
+
+  /* nor can its locks be switched off */
+  if(!res && (curl_share_setopt(share, CURLSHOPT_BUILTIN_LOCKS, 0L) !=
+              CURLSHE_IN_USE)) {
+    fprintf(stderr, "CURLSHOPT_BUILTIN_LOCKS on a used share didn't fail\n");
+    res = TEST_ERR_MAJOR_BAD;
+  }
+
+test_cleanup:
+
+  for(i=0; i < NUM_HANDLES; i++)
+    curl_easy_cleanup(curl[i]);
+  if(curl_share_cleanup(share) != CURLSHE_OK) {
+    fprintf(stderr, "curl_share_cleanup() failed\n");
+    res = TEST_ERR_MAJOR_BAD;
+  }
+  curl_slist_free_all(slist);
+  curl_global_cleanup();
+
+  return res;
+}
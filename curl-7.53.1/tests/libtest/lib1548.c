@@ -0,0 +1,93 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+
+/*
+ * Repeat a request with the same handle and change the headers in between:
+ * append to the header list without setting it again, change the user-agent
+ * and then remove the list. Every request must send the headers as they are
+ * at that time.
+ */
+
+#include "test.h"
+
+#include "memdebug.h"
+
+int test(char *URL)
+{
+  CURL *curl = NULL;
+  struct curl_slist *headers = NULL;
+  int res = 0;
+
+  global_init(CURL_GLOBAL_ALL);
+
+  easy_init(curl);
+
+  headers = curl_slist_append(NULL, "X-First: 1");
+  if(!headers) {
+    res = TEST_ERR_MAJOR_BAD;
+    goto test_cleanup;
+  }
+
+  easy_setopt(curl, CURLOPT_URL, URL);
+  easy_setopt(curl, CURLOPT_USERAGENT, "one");
+  easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+
+  res = curl_easy_perform(curl);
+  if(res)
+    goto test_cleanup;
+
+  /* a header without contents, added to the list that is already set */
+  if(!curl_slist_append(headers, "X-Second;")) {
+    res = TEST_ERR_MAJOR_BAD;
+    goto test_cleanup;
+  }
+
+  res = curl_easy_perform(curl);
+  if(res)
+    goto test_cleanup;
+
+  /* the application's list must be left as it was */
+  if(strcmp(headers->next->data, "X-Second;")) {
+    fprintf(stderr, "header list modified: %s\n", headers->next->data);
+    res = TEST_ERR_FAILURE;
+    goto test_cleanup;
+  }
+
+  easy_setopt(curl, CURLOPT_USERAGENT, "two");
+
+  res = curl_easy_perform(curl);
+  if(res)
+    goto test_cleanup;
+
+  easy_setopt(curl, CURLOPT_HTTPHEADER, NULL);
+
+  res = curl_easy_perform(curl);
+
+test_cleanup:
+
+  /* always cleanup */
+  curl_easy_cleanup(curl);
+  curl_slist_free_all(headers);
+  curl_global_cleanup();
+
+  return res;
+}
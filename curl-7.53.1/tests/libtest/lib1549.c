@@ -0,0 +1,106 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+
+/*
+ * Download over several connections from a server that answers the first
+ * range request with all of a resource shorter than asked for, without
+ * telling its size. That is the whole download. The cookie it sets must end
+ * up in the jar of the handle and the progress callback must be called with
+ * what has been received. Then two downloads in a row fail, and each of them
+ * must leave its message in the error buffer.
+ */
+
+#include "test.h"
+
+#include "memdebug.h"
+
+static curl_off_t downloaded = -1;
+
+static int xferinfo(void *p, curl_off_t dltotal, curl_off_t dlnow,
+                    curl_off_t ultotal, curl_off_t ulnow)
+{
+  (void)p;
+  (void)dltotal;
+  (void)ultotal;
+  (void)ulnow;
+  downloaded = dlnow;
+  return 0;
+}
+
+int test(char *URL)
+{
+  CURL *curl = NULL;
+  struct curl_slist *cookies = NULL;
+  struct curl_slist *item;
+  char errbuf[CURL_ERROR_SIZE];
+  int res = 0;
+  int i;
+
+  if(!libtest_arg2) {
+    fprintf(stderr, "Usage: <url> <url-that-fails>\n");
+    return TEST_ERR_USAGE;
+  }
+
+  global_init(CURL_GLOBAL_ALL);
+
+  easy_init(curl);
+
+  easy_setopt(curl, CURLOPT_URL, URL);
+  easy_setopt(curl, CURLOPT_RANGE_CONNECTIONS, 4L);
+  easy_setopt(curl, CURLOPT_COOKIEFILE, "");
+  easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, xferinfo);
+  easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+  res = curl_easy_perform(curl);
+  if(res)
+    goto test_cleanup;
+
+  printf("progress: %" CURL_FORMAT_CURL_OFF_T " bytes\n", downloaded);
+
+  res = curl_easy_getinfo(curl, CURLINFO_COOKIELIST, &cookies);
+  if(res)
+    goto test_cleanup;
+  for(item = cookies; item; item = item->next)
+    printf("cookie: %s\n", item->data);
+
+  easy_setopt(curl, CURLOPT_URL, libtest_arg2);
+  easy_setopt(curl, CURLOPT_ERRORBUFFER, errbuf);
+  for(i = 0; i < 2; i++) {
+    errbuf[0] = 0;
+    res = curl_easy_perform(curl);
+    printf("failure %d: %d %s\n", i + 1, res, errbuf);
+    if(!res) {
+      res = TEST_ERR_FAILURE;
+      goto test_cleanup;
+    }
+  }
+  res = 0;
+
+test_cleanup:
+
+  /* always cleanup */
+  curl_slist_free_all(cookies);
+  curl_easy_cleanup(curl);
+  curl_global_cleanup();
+
+  return res;
+}
@@ -295,6 +295,36 @@ extern int unitfail;
 
 /* ---------------------------------------------------------------- */
 
+#define exe_multi_wait_perform(A,B,C,Y,Z) do {                    \
+  CURLMcode ec;                                                   \
+  if((ec = curl_multi_wait_perform((A), (B), (C))) != CURLM_OK) { \
+    fprintf(stderr, "%s:%d curl_multi_wait_perform() failed, "    \
+            "with code %d (%s)\n",                                \
+            (Y), (Z), (int)ec, curl_multi_strerror(ec));          \
+    res = (int)ec;                                                \
+  }                                                               \
+  else if(*((C)) < 0) {                                           \
+    fprintf(stderr, "%s:%d curl_multi_wait_perform() succeeded, " \
+            "but returned invalid running_handles value (%d)\n",  \
+            (Y), (Z), (int)*((C)));                               \
+    res = TEST_ERR_NUM_HANDLES;                                   \
+  }                                                               \
+} WHILE_FALSE
+
+#define res_multi_wait_perform(A, B, C) \
+  exe_multi_wait_perform((A), (B), (C), (__FILE__), (__LINE__))
+
+#define chk_multi_wait_perform(A, B, C, Y, Z) do { \
+  exe_multi_wait_perform((A), (B), (C), (Y), (Z)); \
+  if(res)                                  \
+    goto test_cleanup;                     \
+} WHILE_FALSE
+
+#define multi_wait_perform(A,B,C) \
+  chk_multi_wait_perform((A), (B), (C), (__FILE__), (__LINE__))
+
+/* ---------------------------------------------------------------- */
+
 #define exe_multi_fdset(A, B, C, D, E, Y, Z) do {                    \
   CURLMcode ec;                                                      \
   if((ec = curl_multi_fdset((A), (B), (C), (D), (E))) != CURLM_OK) { \
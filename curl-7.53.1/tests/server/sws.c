@@ -121,6 +121,10 @@ struct httprequest {
   bool connmon;   /* monitor the state of the connection, log disconnects */
   bool upgrade;   /* test case allows upgrade to http2 */
   bool upgrade_request; /* upgrade request found and allowed */
+  long rangesize; /* if non-zero, serve a made up resource of this size,
+                     in the byte range asked for */
+  long rangestart; /* the first byte asked for with Range:, -1 if none */
+  long rangeend;   /* the last byte asked for, -1 for up to the end */
   int done_processing;
 };
 
@@ -427,6 +431,10 @@ static int parse_servercmd(struct httprequest *req)
         logmsg("instructed to delay %d secs between packets", num);
         req->writedelay = num;
       }
+      else if(1 == sscanf(cmd, "rangesize: %d", &num)) {
+        logmsg("instructed to serve ranges of %d bytes", num);
+        req->rangesize = num;
+      }
       else {
         logmsg("Unknown <servercmd> instruction found: %s", cmd);
       }
@@ -791,6 +799,14 @@ static int ProcessRequest(struct httprequest *req)
   if(strstr(req->reqbuf, "Connection: close"))
     req->open = FALSE; /* close connection after this request */
 
+  if(req->rangesize) {
+    char *range = strstr(req->reqbuf, "\r\nRange: bytes=");
+    req->rangestart = req->rangeend = -1;
+    if(range &&
+       (1 <= sscanf(range + 15, "%ld-%ld", &req->rangestart, &req->rangeend)))
+      logmsg("Asked for the range %ld-%ld", req->rangestart, req->rangeend);
+  }
+
   if(!req->pipe &&
      req->open &&
      req->prot_version >= 11 &&
@@ -924,6 +940,59 @@ static void init_httprequest(struct httprequest *req)
   req->done_processing = 0;
   req->upgrade = 0;
   req->upgrade_request = 0;
+  req->rangesize = 0;
+  req->rangestart = -1;
+  req->rangeend = -1;
+}
+
+/* the byte at the given offset of the resource served with "rangesize", each
+   8 bytes hold their offset in hex */
+static char range_byte(long offset)
+{
+  char block[16];
+  snprintf(block, sizeof(block), "%07lx\n", (unsigned long)(offset & ~7L));
+  return block[offset & 7];
+}
+
+/* make up the response to a request of the resource served with
+   "rangesize" */
+static char *range_response(struct httprequest *req, size_t *count)
+{
+  char head[256];
+  long start = 0;
+  long end = req->rangesize - 1;
+  size_t headlen;
+  char *resp;
+  long i;
+
+  if(req->rangestart < 0)
+    snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\n"
+             "Content-Length: %ld\r\n\r\n", req->rangesize);
+  else if(req->rangestart >= req->rangesize) {
+    snprintf(head, sizeof(head), "HTTP/1.1 416 Range Not Satisfiable\r\n"
+             "Content-Range: bytes */%ld\r\n"
+             "Content-Length: 0\r\n\r\n", req->rangesize);
+    end = -1;
+  }
+  else {
+    start = req->rangestart;
+    if((req->rangeend >= 0) && (req->rangeend < end))
+      end = req->rangeend;
+    snprintf(head, sizeof(head), "HTTP/1.1 206 Partial Content\r\n"
+             "Content-Range: bytes %ld-%ld/%ld\r\n"
+             "Content-Length: %ld\r\n\r\n",
+             start, end, req->rangesize, end - start + 1);
+  }
+
+  headlen = strlen(head);
+  *count = headlen + (size_t)(end - start + 1);
+  resp = malloc(*count);
+  if(!resp)
+    return NULL;
+  memcpy(resp, head, headlen);
+  for(i = start; i <= end; i++)
+    resp[headlen + (i - start)] = range_byte(i);
+  return resp;
 }
 
 /* returns 1 if the connection should be serviced again immediately, 0 if there
@@ -1162,6 +1231,17 @@ static int send_doc(curl_socket_t sock, struct httprequest *req)
     }
   }
 
+  if(req->rangesize && (req->testno >= 0)) {
+    /* instead of the <data> section */
+    free(ptr);
+    ptr = range_response(req, &count);
+    if(!ptr) {
+      free(cmd);
+      return -1;
+    }
+    buffer = ptr;
+  }
+
   if(got_exit_signal) {
     free(ptr);
     free(cmd);
@@ -23,9 +23,11 @@
 
 #include "llist.h"
 
-static struct curl_llist *llist;
+static struct curl_llist llist_storage;
+static struct curl_llist *llist = &llist_storage;
 
-static struct curl_llist *llist_destination;
+static struct curl_llist llist_destination_storage;
+static struct curl_llist *llist_destination = &llist_destination_storage;
 
 static void test_curl_llist_dtor(void *key, void *value)
 {
@@ -36,15 +38,8 @@ static void test_curl_llist_dtor(void *key, void *value)
 
 static CURLcode unit_setup(void)
 {
-  llist = Curl_llist_alloc(test_curl_llist_dtor);
-  if(!llist)
-    return CURLE_OUT_OF_MEMORY;
-  llist_destination = Curl_llist_alloc(test_curl_llist_dtor);
-  if(!llist_destination) {
-    Curl_llist_destroy(llist, NULL);
-    return CURLE_OUT_OF_MEMORY;
-  }
-
+  Curl_llist_init(llist, test_curl_llist_dtor);
+  Curl_llist_init(llist_destination, test_curl_llist_dtor);
   return CURLE_OK;
 }
 
@@ -58,6 +53,10 @@ UNITTEST_START
   int unusedData_case1 = 1;
   int unusedData_case2 = 2;
   int unusedData_case3 = 3;
+  struct curl_llist_element case1_list;
+  struct curl_llist_element case2_list;
+  struct curl_llist_element case3_list;
+  struct curl_llist_element case4_list;
   struct curl_llist_element *head;
   struct curl_llist_element *element_next;
   struct curl_llist_element *element_prev;
@@ -65,6 +64,11 @@ UNITTEST_START
   size_t llist_size = Curl_llist_count(llist);
   int curlErrCode = 0;
 
+  memset(&case1_list, 0, sizeof(case1_list));
+  memset(&case2_list, 0, sizeof(case2_list));
+  memset(&case3_list, 0, sizeof(case3_list));
+  memset(&case4_list, 0, sizeof(case4_list));
+
   /**
    * testing llist_init
    * case 1:
@@ -92,67 +96,51 @@ UNITTEST_START
    * 3: list tail will be the same as list head
    */
 
-  curlErrCode = Curl_llist_insert_next(llist, llist->head, &unusedData_case1);
-  if(curlErrCode == 1) {
-    fail_unless(Curl_llist_count(llist) == 1,
-                 "List size should be 1 after adding a new element");
-    /*test that the list head data holds my unusedData */
-    fail_unless(llist->head->ptr == &unusedData_case1,
-                 "List size should be 1 after adding a new element");
-    /*same goes for the list tail */
-    fail_unless(llist->tail == llist->head,
-                 "List size should be 1 after adding a new element");
-
-    /**
-     * testing Curl_llist_insert_next
-     * case 2:
-     * list has 1 element, adding one element after the head
-     * @assumptions:
-     * 1: the element next to head should be our newly created element
-     * 2: the list tail should be our newly created element
-     */
-
-    curlErrCode = Curl_llist_insert_next(llist, llist->head,
-                                         &unusedData_case3);
-    if(curlErrCode == 1) {
-      fail_unless(llist->head->next->ptr == &unusedData_case3,
-                  "the node next to head is not getting set correctly");
-      fail_unless(llist->tail->ptr == &unusedData_case3,
-                  "the list tail is not getting set correctly");
-    }
-    else {
-      printf("skipping Curl_llist_insert_next as a non "
-             "success error code was returned\n");
-    }
-
-    /**
-     * testing Curl_llist_insert_next
-     * case 3:
-     * list has >1 element, adding one element after "NULL"
-     * @assumptions:
-     * 1: the element next to head should be our newly created element
-     * 2: the list tail should different from newly created element
-     */
-
-    curlErrCode = Curl_llist_insert_next(llist, llist->head,
-                                         &unusedData_case2);
-    if(curlErrCode == 1) {
-      fail_unless(llist->head->next->ptr == &unusedData_case2,
-                  "the node next to head is not getting set correctly");
-      /* better safe than sorry, check that the tail isn't corrupted */
-      fail_unless(llist->tail->ptr != &unusedData_case2,
-                  "the list tail is not getting set correctly");
-    }
-    else {
-      printf("skipping Curl_llist_insert_next as a non "
-             "success error code was returned\n");
-    }
-
-  }
-  else {
-    printf("skipping Curl_llist_insert_next as a non "
-           "success error code was returned\n");
-  }
+  Curl_llist_insert_next(llist, llist->head, &unusedData_case1, &case1_list);
+  fail_unless(Curl_llist_count(llist) == 1,
+              "List size should be 1 after adding a new element");
+  /*test that the list head data holds my unusedData */
+  fail_unless(llist->head->ptr == &unusedData_case1,
+              "List size should be 1 after adding a new element");
+  /*same goes for the list tail */
+  fail_unless(llist->tail == llist->head,
+              "List size should be 1 after adding a new element");
+  /* the list element given is the one in the list */
+  fail_unless(llist->head == &case1_list,
+              "the given list element is not the one in the list");
+
+  /**
+   * testing Curl_llist_insert_next
+   * case 2:
+   * list has 1 element, adding one element after the head
+   * @assumptions:
+   * 1: the element next to head should be our newly created element
+   * 2: the list tail should be our newly created element
+   */
+
+  Curl_llist_insert_next(llist, llist->head, &unusedData_case3,
+                         &case3_list);
+  fail_unless(llist->head->next->ptr == &unusedData_case3,
+              "the node next to head is not getting set correctly");
+  fail_unless(llist->tail->ptr == &unusedData_case3,
+              "the list tail is not getting set correctly");
+
+  /**
+   * testing Curl_llist_insert_next
+   * case 3:
+   * list has >1 element, adding one element after "NULL"
+   * @assumptions:
+   * 1: the element next to head should be our newly created element
+   * 2: the list tail should different from newly created element
+   */
+
+  Curl_llist_insert_next(llist, llist->head, &unusedData_case2,
+                         &case2_list);
+  fail_unless(llist->head->next->ptr == &unusedData_case2,
+              "the node next to head is not getting set correctly");
+  /* better safe than sorry, check that the tail isn't corrupted */
+  fail_unless(llist->tail->ptr != &unusedData_case2,
+              "the list tail is not getting set correctly");
 
   /* unit tests for Curl_llist_remove */
 
@@ -172,6 +160,8 @@ UNITTEST_START
 
   Curl_llist_remove(llist, llist->head, NULL);
 
+  fail_unless(case1_list.ptr == NULL && case1_list.next == NULL,
+              "removed element not cleared");
   fail_unless(Curl_llist_count(llist) ==  (llist_size-1),
                "llist size not decremented as expected");
   fail_unless(llist->head == element_next,
@@ -190,7 +180,8 @@ UNITTEST_START
    * 2: element->previous->next will be element->next
    * 3: element->next->previous will be element->previous
    */
-  Curl_llist_insert_next(llist, llist->head, &unusedData_case3);
+  Curl_llist_insert_next(llist, llist->head, &unusedData_case3,
+                         &case4_list);
   llist_size = Curl_llist_count(llist);
   to_remove = llist->head->next;
   abort_unless(to_remove, "to_remove is NULL");
@@ -255,11 +246,9 @@ UNITTEST_START
   * add one element to the list
   */
 
-  curlErrCode = Curl_llist_insert_next(llist, llist->head, &unusedData_case1);
+  Curl_llist_insert_next(llist, llist->head, &unusedData_case1, &case1_list);
   /* necessary assertions */
 
-  abort_unless(curlErrCode == 1,
-  "Curl_llist_insert_next returned an error, Can't move on with test");
   abort_unless(Curl_llist_count(llist) == 1,
   "Number of list elements is not as expected, Aborting");
   abort_unless(Curl_llist_count(llist_destination) == 0,
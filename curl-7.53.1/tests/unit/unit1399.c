@@ -0,0 +1,195 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "timewheel.h"
+
+static CURLcode unit_setup(void)
+{
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+
+}
+
+/* number of nodes to add to the wheel */
+#define NUM_NODES 300
+
+static struct Curl_timewheel wheel;
+static struct Curl_wheelnode nodes[NUM_NODES];
+static bool added[NUM_NODES];
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) & 0x7fff;
+}
+
+/* a time 'ms' milliseconds and 'us' microseconds after 'base' */
+static struct timeval later(struct timeval base, long ms, long us)
+{
+  base.tv_sec += ms / 1000;
+  base.tv_usec += (ms % 1000) * 1000 + us;
+  while(base.tv_usec >= 1000000) {
+    base.tv_sec++;
+    base.tv_usec -= 1000000;
+  }
+  return base;
+}
+
+/* a time from now to far beyond what the wheel reaches */
+static struct timeval sometime(struct timeval now)
+{
+  switch(rnd() % 4) {
+  case 0:
+    return later(now, (long)(rnd() % 40), (long)(rnd() % 1000));
+  case 1:
+    return later(now, (long)(rnd() % 2000), (long)(rnd() % 1000));
+  case 2:
+    return later(now, (long)(rnd() * 10), 0);
+  default:
+    return later(now, (long)rnd() * 1000, (long)(rnd() % 1000));
+  }
+}
+
+/* the earliest time of the added nodes, or NULL */
+static struct Curl_wheelnode *earliest(void)
+{
+  struct Curl_wheelnode *best = NULL;
+  int i;
+
+  for(i = 0; i < NUM_NODES; i++)
+    if(added[i] &&
+       (!best || (Curl_wheel_compare(nodes[i].time, best->time) < 0)))
+      best = &nodes[i];
+  return best;
+}
+
+UNITTEST_START
+
+  struct timeval now;
+  struct timeval first;
+  struct Curl_wheelnode *best;
+  int rounds = 0;
+  int i;
+
+  now.tv_sec = 1000;
+  now.tv_usec = 0;
+  Curl_wheel_init(&wheel, now);
+
+  fail_unless(!Curl_wheel_first(&wheel, &first), "empty wheel has a time");
+  fail_unless(!Curl_wheel_getbest(&wheel, now), "empty wheel expires");
+
+  for(i = 0; i < NUM_NODES; i++) {
+    nodes[i].slot = -1;
+    nodes[i].payload = &added[i];
+    if(i % 10 == 5)
+      /* the same time as another one */
+      Curl_wheel_add(&wheel, &nodes[i], nodes[i - 1].time);
+    else
+      Curl_wheel_add(&wheel, &nodes[i], sometime(now));
+    added[i] = TRUE;
+  }
+
+  /* one that expired before the wheel started */
+  Curl_wheel_remove(&wheel, &nodes[0]);
+  Curl_wheel_add(&wheel, &nodes[0], later(now, -1000, 0));
+
+  /* take some out again, twice */
+  for(i = 1; i < NUM_NODES; i += 7) {
+    Curl_wheel_remove(&wheel, &nodes[i]);
+    Curl_wheel_remove(&wheel, &nodes[i]);
+    added[i] = FALSE;
+  }
+
+  /* run the time forward, adding new timeouts, until all have expired */
+  while((best = earliest()) != NULL) {
+    struct Curl_wheelnode *node;
+
+    abort_unless(rounds++ < 10 * NUM_NODES, "the wheel never empties");
+
+    abort_unless(Curl_wheel_first(&wheel, &first), "no time in the wheel");
+    abort_unless(Curl_wheel_compare(first, best->time) <= 0,
+                 "first time too late");
+    /* when it isn't exact it is the start of a slot, a whole tick */
+    fail_unless(!Curl_wheel_compare(first, best->time) ||
+                !(first.tv_usec % 1000), "first time not a tick");
+
+    /* just before the first one, nothing expires */
+    now = best->time;
+    if(now.tv_usec)
+      now.tv_usec--;
+    else {
+      now.tv_sec--;
+      now.tv_usec = 999999;
+    }
+    fail_unless(!Curl_wheel_getbest(&wheel, now), "expired too early");
+
+    /* at the time or a little after it */
+    now = later(best->time, (long)(rnd() % 3), (long)(rnd() % 1000));
+    while((node = Curl_wheel_getbest(&wheel, now)) != NULL) {
+      int n = (int)(node - nodes);
+      abort_unless(added[n], "got a node not in the wheel");
+      abort_unless(Curl_wheel_compare(node->time, now) <= 0,
+                   "got a node that hasn't expired");
+      added[n] = FALSE;
+
+      /* some are added again, for later */
+      if(rounds < 4 * NUM_NODES && !(rnd() % 3)) {
+        Curl_wheel_add(&wheel, node, sometime(later(now, 0, 1)));
+        added[n] = TRUE;
+      }
+    }
+
+    for(i = 0; i < NUM_NODES; i++)
+      fail_unless(!added[i] || Curl_wheel_compare(nodes[i].time, now) > 0,
+                  "an expired node was left");
+
+    /* nothing more has expired, so neither has the first time */
+    if(Curl_wheel_first(&wheel, &first))
+      fail_unless(Curl_wheel_compare(first, now) > 0, "first time passed");
+  }
+
+  fail_unless(!Curl_wheel_first(&wheel, &first), "wheel not empty");
+
+  /* the first time is the start of the slot of the node in 5 seconds, that
+     node is removed and the time is run past that slot */
+  now.tv_sec = 1000;
+  now.tv_usec = 0;
+  Curl_wheel_init(&wheel, now);
+  Curl_wheel_add(&wheel, &nodes[0], later(now, 5000, 0));
+  Curl_wheel_add(&wheel, &nodes[1], later(now, 60000, 0));
+  Curl_wheel_add(&wheel, &nodes[2], later(now, 10, 0));
+  Curl_wheel_remove(&wheel, &nodes[2]);
+  abort_unless(Curl_wheel_first(&wheel, &first), "no time in the wheel");
+  Curl_wheel_remove(&wheel, &nodes[0]);
+  now = later(now, 6000, 0);
+  fail_unless(!Curl_wheel_getbest(&wheel, now), "expired too early");
+  abort_unless(Curl_wheel_first(&wheel, &first), "no time in the wheel");
+  fail_unless(Curl_wheel_compare(first, now) > 0, "first time passed");
+  fail_unless(Curl_wheel_compare(first, nodes[1].time) <= 0,
+              "first time too late");
+
+UNITTEST_STOP
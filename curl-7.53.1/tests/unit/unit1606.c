@@ -0,0 +1,153 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2015 - 2016, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "conncache.h"
+
+#include "memdebug.h" /* LAST include file */
+
+/*
+ * Connection cache lookups with many hosts in the cache. The time they take
+ * is shown by the conncache measurement of unitperf.
+ */
+
+#define HOSTS 5000
+
+static struct Curl_easy *data;
+static struct conncache cache;
+static struct connectdata **conns;
+static char names[HOSTS][32];
+
+static CURLcode unit_setup(void)
+{
+  data = curl_easy_init();
+  if(!data)
+    return CURLE_OUT_OF_MEMORY;
+
+  if(Curl_conncache_init(&cache, 97)) {
+    curl_easy_cleanup(data);
+    return CURLE_OUT_OF_MEMORY;
+  }
+  data->state.conn_cache = &cache;
+
+  conns = calloc(HOSTS, sizeof(struct connectdata *));
+  if(!conns) {
+    Curl_conncache_destroy(&cache);
+    curl_easy_cleanup(data);
+    return CURLE_OUT_OF_MEMORY;
+  }
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  int i;
+
+  for(i = 0; i < HOSTS; i++) {
+    if(conns[i] && conns[i]->bundle)
+      Curl_conncache_remove_conn(&cache, conns[i]);
+    free(conns[i]);
+  }
+  free(conns);
+  Curl_conncache_destroy(&cache);
+  curl_easy_cleanup(data);
+}
+
+/* a connection in the state it has when it is looked up */
+static void setup_conn(struct connectdata *conn, char *name, long port)
+{
+  memset(conn, 0, sizeof(*conn));
+  conn->data = data;
+  conn->host.name = name;
+  conn->port = port;
+}
+
+UNITTEST_START
+  struct connectdata needle;
+  char longname[300];
+  int i;
+  int found;
+
+  for(i = 0; i < HOSTS; i++) {
+    snprintf(names[i], sizeof(names[i]), "host%d.example.com", i);
+    conns[i] = malloc(sizeof(struct connectdata));
+    abort_unless(conns[i], "out of memory");
+    setup_conn(conns[i], names[i], 80 + (i % 3));
+    abort_unless(Curl_conncache_add_conn(&cache, conns[i]) == CURLE_OK,
+                 "adding a connection failed");
+  }
+  fail_unless(cache.num_connections == HOSTS, "wrong number of connections");
+  fail_unless(cache.hash.size == HOSTS, "wrong number of bundles");
+
+  /* every transfer looks up a new connection struct once */
+  found = 0;
+  for(i = 0; i < HOSTS; i++) {
+    setup_conn(&needle, names[i], 80 + (i % 3));
+    if(Curl_conncache_find_bundle(&needle, &cache) == conns[i]->bundle)
+      found++;
+  }
+  fail_unless(found == HOSTS, "bundle lookup failed");
+
+  /* the same host on another port is another bundle */
+  setup_conn(&needle, names[0], 8080);
+  fail_unless(!Curl_conncache_find_bundle(&needle, &cache),
+              "lookup of a missing bundle succeeded");
+
+  /* a name too long for the key buffer */
+  memset(longname, 'a', sizeof(longname) - 1);
+  longname[sizeof(longname) - 1] = 0;
+  setup_conn(&needle, longname, 80);
+  fail_unless(!Curl_conncache_find_bundle(&needle, &cache),
+              "lookup of a missing bundle succeeded");
+
+  /* remove every other connection, the rest must still be found */
+  for(i = 0; i < HOSTS; i += 2)
+    Curl_conncache_remove_conn(&cache, conns[i]);
+  fail_unless(cache.hash.size == HOSTS / 2, "wrong number of bundles");
+  for(i = 0; i < HOSTS; i++) {
+    struct connectbundle *bundle;
+    setup_conn(&needle, names[i], 80 + (i % 3));
+    bundle = Curl_conncache_find_bundle(&needle, &cache);
+    if(i % 2) {
+      fail_unless(bundle && bundle == conns[i]->bundle,
+                  "bundle lookup failed");
+    }
+    else {
+      fail_unless(!bundle, "removed bundle was found");
+    }
+  }
+
+  /* add them back, on top of the deleted ones */
+  for(i = 0; i < HOSTS; i += 2) {
+    setup_conn(conns[i], names[i], 80 + (i % 3));
+    abort_unless(Curl_conncache_add_conn(&cache, conns[i]) == CURLE_OK,
+                 "adding a connection failed");
+  }
+  fail_unless(cache.hash.size == HOSTS, "wrong number of bundles");
+  for(i = 0; i < HOSTS; i++) {
+    setup_conn(&needle, names[i], 80 + (i % 3));
+    fail_unless(Curl_conncache_find_bundle(&needle, &cache) ==
+                conns[i]->bundle, "bundle lookup failed");
+  }
+
+UNITTEST_STOP
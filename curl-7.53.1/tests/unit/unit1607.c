@@ -0,0 +1,172 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "hostip.h"
+
+#include "memdebug.h" /* LAST include file */
+
+/*
+ * The DNS cache keeps the entries that expire in a heap by age, and pruning
+ * removes only the expired ones.
+ */
+
+#define HOSTS 200
+#define STEP 10 /* seconds between the entries */
+
+static struct Curl_easy *data;
+static struct Curl_dnscache cache;
+static struct curl_slist *resolve;
+
+static CURLcode unit_setup(void)
+{
+  data = curl_easy_init();
+  if(!data)
+    return CURLE_OUT_OF_MEMORY;
+
+  if(Curl_mk_dnscache(&cache)) {
+    curl_easy_cleanup(data);
+    return CURLE_OUT_OF_MEMORY;
+  }
+  data->dns.hostcache = &cache;
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  Curl_dnscache_destroy(&cache);
+  data->dns.hostcache = NULL;
+  curl_slist_free_all(resolve);
+  curl_easy_cleanup(data);
+}
+
+/* every entry is where it says it is, and no older than its parent */
+static bool heap_ok(void)
+{
+  size_t i;
+
+  for(i = 0; i < cache.expiry_num; i++) {
+    if(cache.expiry[i]->expiry_index != i + 1)
+      return FALSE;
+    if(i && (cache.expiry[(i - 1) / 2]->timestamp >
+             cache.expiry[i]->timestamp))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+static int add_host(int n)
+{
+  char name[32];
+  char address[] = "127.0.0.1";
+  Curl_addrinfo *addr = Curl_str2addr(address, 80);
+  struct Curl_dns_entry *dns;
+
+  if(!addr)
+    return 1;
+  snprintf(name, sizeof(name), "host%d.example.com", n);
+  dns = Curl_cache_addr(data, addr, name, 80);
+  if(!dns) {
+    Curl_freeaddrinfo(addr);
+    return 1;
+  }
+  dns->inuse--; /* only the cache keeps it */
+  return 0;
+}
+
+static int delete_host(int n)
+{
+  char name[48];
+
+  snprintf(name, sizeof(name), "host%d.example.com:80", n);
+  return Curl_hash_delete(&cache.hash, name, strlen(name) + 1);
+}
+
+UNITTEST_START
+  size_t i;
+  int k;
+  int left;
+  time_t now;
+
+  /* add the hosts in a mixed up order, each one STEP seconds younger than
+     the one before it */
+  for(k = 0; k < HOSTS; k++) {
+    for(i = 0; i < cache.expiry_num; i++)
+      cache.expiry[i]->timestamp -= STEP;
+    abort_unless(!add_host((k * 37) % HOSTS), "adding to the cache failed");
+  }
+  fail_unless(cache.hash.size == HOSTS, "wrong number of entries");
+  fail_unless(cache.expiry_num == HOSTS, "wrong number of entries to expire");
+  fail_unless(heap_ok(), "the heap is broken after adding");
+
+  /* delete every seventh one, from the middle of the heap */
+  left = HOSTS;
+  for(k = 0; k < HOSTS; k += 7) {
+    fail_unless(!delete_host((k * 37) % HOSTS), "deleting failed");
+    left--;
+  }
+  fail_unless(cache.expiry_num == (size_t)left, "deleted entry in the heap");
+  fail_unless(heap_ok(), "the heap is broken after deleting");
+
+  /* nothing has expired yet */
+  data->set.dns_cache_timeout = STEP * HOSTS;
+  Curl_hostcache_prune(data);
+  fail_unless(cache.hash.size == (size_t)left, "pruned too early");
+
+  /* the older half expires, the time between the entries allows the clock
+     to tick while this runs */
+  data->set.dns_cache_timeout = STEP * HOSTS / 2 - STEP / 2;
+  Curl_hostcache_prune(data);
+  for(k = 0; k < HOSTS / 2; k++) {
+    if(k % 7)
+      left--;
+  }
+  fail_unless(cache.hash.size == (size_t)left, "wrong number pruned");
+  fail_unless(cache.expiry_num == (size_t)left, "pruned entry in the heap");
+  fail_unless(heap_ok(), "the heap is broken after pruning");
+  time(&now);
+  for(i = 0; i < cache.expiry_num; i++) {
+    fail_unless(now - cache.expiry[i]->timestamp <
+                data->set.dns_cache_timeout, "expired entry was kept");
+  }
+
+  /* expired entries are kept while they may be served stale */
+  data->set.dns_cache_timeout = 0;
+  data->set.dns_stale_while_revalidate = STEP * HOSTS;
+  Curl_hostcache_prune(data);
+  fail_unless(cache.hash.size == (size_t)left, "stale entry was pruned");
+
+  /* entries from CURLOPT_RESOLVE never expire */
+  resolve = curl_slist_append(NULL, "resolved.example.com:80:127.0.0.1");
+  abort_unless(resolve, "out of memory");
+  data->change.resolve = resolve;
+  fail_unless(Curl_loadhostpairs(data) == CURLE_OK, "loading failed");
+  fail_unless(cache.hash.size == (size_t)left + 1, "entry not added");
+  fail_unless(cache.expiry_num == (size_t)left, "entry in the heap");
+
+  data->set.dns_stale_while_revalidate = 0;
+  Curl_hostcache_prune(data);
+  fail_unless(cache.hash.size == 1, "entries were kept");
+  fail_unless(cache.expiry_num == 0, "heap is not empty");
+
+UNITTEST_STOP
@@ -0,0 +1,165 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "http.h"
+
+#include "memdebug.h" /* LAST include file */
+
+/*
+ * Parses the headers of a response, all at once and in pieces of different
+ * sizes, and checks that the result and the header data passed on are the
+ * same every time. The time it takes is shown by the headers measurement of
+ * unitperf.
+ */
+
+static struct Curl_easy *data;
+static struct connectdata *conn;
+static char received[2048];
+static size_t received_len;
+
+static const char response[] =
+  "HTTP/1.1 200 OK\r\n"
+  "Date: Tue, 09 Nov 2010 14:49:00 GMT\r\n"
+  "Server: test-server/fake\r\n"
+  "Content-Type: application/json; charset=utf-8\r\n"
+  "Content-Length: 7\r\n"
+  "Connection: keep-alive\r\n"
+  "Cache-Control: no-cache, no-store, must-revalidate\r\n"
+  "Pragma: no-cache\r\n"
+  "Expires: 0\r\n"
+  "Vary: Accept-Encoding, Origin\r\n"
+  "X-Request-Id: 8f1c2b6e-5d0a-4c4b-9f3e-2a7d1e6c9b01\r\n"
+  "X-RateLimit-Limit: 5000\r\n"
+  "X-RateLimit-Remaining: 4999\r\n"
+  "X-Content-Type-Options: nosniff\r\n"
+  "X-Frame-Options: DENY\r\n"
+  "Strict-Transport-Security: max-age=31536000\r\n"
+  "Access-Control-Allow-Origin: *\r\n"
+  "ETag: \"33a64df551425fcc55e4d42a148795d9f25f89d4\"\r\n"
+  "Last-Modified: Tue, 09 Nov 2010 14:49:00 GMT\r\n"
+  "\r\n"
+  "{\"a\":1}";
+
+static size_t header_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  size_t len = size * nmemb;
+  (void)userp;
+  if(received_len + len <= sizeof(received)) {
+    memcpy(&received[received_len], ptr, len);
+    received_len += len;
+  }
+  return len;
+}
+
+static CURLcode unit_setup(void)
+{
+  data = curl_easy_init();
+  if(!data)
+    return CURLE_OUT_OF_MEMORY;
+
+  conn = calloc(1, sizeof(struct connectdata));
+  if(!conn) {
+    curl_easy_cleanup(data);
+    return CURLE_OUT_OF_MEMORY;
+  }
+  conn->data = data;
+  conn->handler = &Curl_handler_http;
+  conn->given = &Curl_handler_http;
+  curl_easy_setopt(data, CURLOPT_HEADERFUNCTION, header_cb);
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  free(conn);
+  curl_easy_cleanup(data);
+}
+
+/* the state a transfer is in when the response starts */
+static void start_response(void)
+{
+  struct SingleRequest *k = &data->req;
+
+  memset(k, 0, sizeof(*k));
+  k->header = TRUE;
+  k->size = -1;
+  k->maxdownload = -1;
+  k->hbufp = data->state.headerbuff;
+  received_len = 0;
+}
+
+/*
+ * Parses the response headers in pieces of 'step' bytes, with each piece
+ * zero terminated as it is when it has been received. Returns the number of
+ * body bytes after the headers, or -1 on failure.
+ */
+static ssize_t parse(size_t step)
+{
+  struct SingleRequest *k = &data->req;
+  char piece[sizeof(response)];
+  size_t len = sizeof(response) - 1;
+  size_t offset = 0;
+
+  start_response();
+  while(offset < len) {
+    bool stop = FALSE;
+    ssize_t nread = (ssize_t)CURLMIN(step, len - offset);
+
+    memcpy(piece, &response[offset], nread);
+    piece[nread] = 0;
+    offset += nread;
+    k->str = piece;
+
+    if(Curl_http_readwrite_headers(data, conn, &nread, &stop))
+      return -1;
+    if(!k->header)
+      return (ssize_t)(len - offset) + nread;
+  }
+  return -1;
+}
+
+UNITTEST_START
+  static const size_t steps[] = { 0, 1, 2, 3, 7, 16, 50, 100 };
+  size_t headers_len = strstr(response, "\r\n\r\n") + 4 - response;
+  size_t i;
+
+  for(i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+    ssize_t body = parse(steps[i] ? steps[i] : sizeof(response));
+
+    fail_unless(body == 7, "wrong amount of body data");
+    fail_unless(data->req.httpcode == 200, "wrong response code");
+    fail_unless(data->req.size == 7, "wrong content length");
+    fail_unless(data->info.contenttype &&
+                !strcmp(data->info.contenttype,
+                        "application/json; charset=utf-8"),
+                "wrong content type");
+    fail_unless(received_len == headers_len &&
+                !memcmp(received, response, headers_len),
+                "wrong header data passed on");
+    fail_unless(data->info.header_size == (long)headers_len,
+                "wrong header size");
+    data->info.header_size = 0;
+  }
+
+UNITTEST_STOP
@@ -0,0 +1,396 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "http.h"
+#include "strtoofft.h"
+
+#include "memdebug.h" /* LAST include file */
+
+/*
+ * Decodes a large number of randomly made chunked bodies, some of them
+ * broken, in randomly sized pieces and checks that the result is the same as
+ * from a plain byte-at-a-time decoder: the same return codes, the same data
+ * and trailers passed on and the same amount of data left after the end.
+ * The time it takes to decode a body of small chunks is shown by the chunked
+ * measurement of unitperf.
+ */
+
+#define CASES 3000
+#define MAX_BODY 32768
+
+static struct Curl_easy *data;
+static struct connectdata *conn;
+
+static char input[MAX_BODY];
+static char piece[MAX_BODY];
+
+struct output {
+  char body[MAX_BODY];
+  size_t body_len;
+  char head[MAX_BODY];
+  size_t head_len;
+};
+
+static struct output got;
+static struct output expected;
+static size_t body_writes;
+
+static unsigned int seed = 1609;
+
+static size_t rnd(size_t range)
+{
+  seed = seed * 1103515245 + 12345;
+  return ((seed >> 8) & 0xffffff) % range;
+}
+
+static void append(char *buf, size_t *len, const char *ptr, size_t size)
+{
+  if(*len + size <= MAX_BODY) {
+    memcpy(&buf[*len], ptr, size);
+    *len += size;
+  }
+  else
+    *len = MAX_BODY + 1; /* makes the comparison fail */
+}
+
+static size_t body_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)userp;
+  append(got.body, &got.body_len, ptr, size * nmemb);
+  body_writes++;
+  return size * nmemb;
+}
+
+static size_t header_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)userp;
+  append(got.head, &got.head_len, ptr, size * nmemb);
+  return size * nmemb;
+}
+
+/*
+ * The decoder to compare with, which handles one byte at a time in the
+ * states of the chunked decoder in libcurl.
+ */
+struct plain_decoder {
+  ChunkyState state;
+  char hexbuffer[MAXNUM_SIZE + 1];
+  int hexindex;
+  curl_off_t datasize;
+  char trailer[MAX_BODY];
+  size_t trlpos;
+  size_t dataleft;
+};
+
+static struct plain_decoder plain;
+
+static bool plain_isxdigit(char c)
+{
+  return ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') ||
+          (c >= 'a' && c <= 'f')) ? TRUE : FALSE;
+}
+
+static CHUNKcode plain_read(struct plain_decoder *d, const char *p,
+                            size_t len)
+{
+  while(len) {
+    switch(d->state) {
+    case CHUNK_HEX:
+      if(plain_isxdigit(*p)) {
+        if(d->hexindex >= MAXNUM_SIZE)
+          return CHUNKE_TOO_LONG_HEX;
+        d->hexbuffer[d->hexindex++] = *p++;
+        len--;
+      }
+      else {
+        char *endptr;
+        if(!d->hexindex)
+          return CHUNKE_ILLEGAL_HEX;
+        d->hexbuffer[d->hexindex] = 0;
+        d->datasize = curlx_strtoofft(d->hexbuffer, &endptr, 16);
+        if((d->datasize == CURL_OFF_T_MAX) && (errno == ERANGE))
+          return CHUNKE_ILLEGAL_HEX;
+        d->state = CHUNK_LF;
+      }
+      break;
+
+    case CHUNK_LF:
+      if(*p == '\n') {
+        d->state = d->datasize ? CHUNK_DATA : CHUNK_TRAILER;
+        d->trlpos = 0;
+      }
+      p++;
+      len--;
+      break;
+
+    case CHUNK_DATA:
+      if(d->datasize < (curl_off_t)len) {
+        size_t size = (size_t)d->datasize;
+        append(expected.body, &expected.body_len, p, size);
+        p += size;
+        len -= size;
+        d->datasize = 0;
+        d->state = CHUNK_POSTLF;
+      }
+      else {
+        append(expected.body, &expected.body_len, p, len);
+        d->datasize -= len;
+        len = 0;
+        if(!d->datasize)
+          d->state = CHUNK_POSTLF;
+      }
+      break;
+
+    case CHUNK_POSTLF:
+      if(*p == '\n') {
+        d->state = CHUNK_HEX;
+        d->hexindex = 0;
+      }
+      else if(*p != '\r')
+        return CHUNKE_BAD_CHUNK;
+      p++;
+      len--;
+      break;
+
+    case CHUNK_TRAILER:
+      if((*p == '\r') || (*p == '\n')) {
+        if(d->trlpos) {
+          append(expected.head, &expected.head_len, d->trailer, d->trlpos);
+          append(expected.head, &expected.head_len, "\r\n", 2);
+          d->trlpos = 0;
+          d->state = CHUNK_TRAILER_CR;
+          if(*p == '\n')
+            break;
+        }
+        else {
+          d->state = CHUNK_TRAILER_POSTCR;
+          break;
+        }
+      }
+      else if(d->trlpos < sizeof(d->trailer))
+        d->trailer[d->trlpos++] = *p;
+      p++;
+      len--;
+      break;
+
+    case CHUNK_TRAILER_CR:
+      if(*p != '\n')
+        return CHUNKE_BAD_CHUNK;
+      d->state = CHUNK_TRAILER_POSTCR;
+      p++;
+      len--;
+      break;
+
+    case CHUNK_TRAILER_POSTCR:
+      if((*p != '\r') && (*p != '\n')) {
+        d->state = CHUNK_TRAILER;
+        break;
+      }
+      if(*p == '\r') {
+        p++;
+        len--;
+      }
+      d->state = CHUNK_STOP;
+      break;
+
+    case CHUNK_STOP:
+      if(*p != '\n')
+        return CHUNKE_BAD_CHUNK;
+      d->dataleft = len - 1;
+      return CHUNKE_STOP;
+    }
+  }
+  return CHUNKE_OK;
+}
+
+static CURLcode unit_setup(void)
+{
+  data = curl_easy_init();
+  if(!data)
+    return CURLE_OUT_OF_MEMORY;
+
+  conn = calloc(1, sizeof(struct connectdata));
+  if(!conn) {
+    curl_easy_cleanup(data);
+    return CURLE_OUT_OF_MEMORY;
+  }
+  conn->data = data;
+  conn->handler = &Curl_handler_http;
+  conn->given = &Curl_handler_http;
+  curl_easy_setopt(data, CURLOPT_WRITEFUNCTION, body_cb);
+  curl_easy_setopt(data, CURLOPT_HEADERFUNCTION, header_cb);
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  free(conn->trailer);
+  free(conn);
+  curl_easy_cleanup(data);
+}
+
+static void add_text(size_t *len, const char *text)
+{
+  size_t size = strlen(text);
+  if(*len + size <= MAX_BODY) {
+    memcpy(&input[*len], text, size);
+    *len += size;
+  }
+}
+
+/* a chunk header with the size in upper or lower case and maybe with leading
+   zeroes, an extension or a lone LF */
+static void add_chunk_header(size_t *len, size_t size)
+{
+  char hex[40];
+  size_t i;
+
+  snprintf(hex, sizeof(hex), "%s%zx", rnd(4) ? "" : "00", size);
+  if(rnd(2))
+    for(i = 0; hex[i]; i++)
+      if(hex[i] >= 'a')
+        hex[i] = (char)(hex[i] - 'a' + 'A');
+  add_text(len, hex);
+  if(!rnd(6))
+    add_text(len, rnd(2) ? ";name=value" : "; ext");
+  add_text(len, rnd(8) ? "\r\n" : "\n");
+}
+
+/* makes a chunked body and returns its length */
+static size_t make_input(void)
+{
+  size_t len = 0;
+  size_t chunks = rnd(40);
+  size_t i;
+
+  while(chunks--) {
+    size_t size = rnd(10) ? 1 + rnd(64) : 1 + rnd(3000);
+    if(len + size + 32 > MAX_BODY / 2)
+      break;
+    add_chunk_header(&len, size);
+    for(i = 0; i < size; i++)
+      input[len++] = (char)rnd(256);
+    add_text(&len, rnd(8) ? "\r\n" : "\n");
+  }
+  add_chunk_header(&len, 0);
+  for(i = rnd(3); i; i--)
+    add_text(&len, rnd(2) ? "X-Checksum: 4a5b6c\r\n" : "Expires: 0\r\n");
+  add_text(&len, "\r\n");
+  if(!rnd(4))
+    add_text(&len, "HTTP/1.1 200 OK\r\n");
+
+  /* break some of them */
+  if(!rnd(3))
+    for(i = 1 + rnd(3); i; i--)
+      input[rnd(len)] = rnd(2) ? (char)rnd(256) : "0aG\r\n;"[rnd(6)];
+
+  return len;
+}
+
+/*
+ * Decodes the input with both decoders, fed in the same pieces. Returns
+ * non-zero when they disagree.
+ */
+static int decode(size_t len)
+{
+  size_t offset = 0;
+  bool whole = rnd(4) ? FALSE : TRUE;
+
+  memset(&plain, 0, sizeof(plain));
+  plain.state = CHUNK_HEX;
+  expected.body_len = expected.head_len = 0;
+
+  Curl_httpchunk_init(conn);
+  conn->trlPos = 0;
+  got.body_len = got.head_len = 0;
+
+  while(offset < len) {
+    size_t size = whole ? len : 1 + rnd(rnd(2) ? 16 : 4000);
+    ssize_t wrote;
+    CHUNKcode code;
+    CHUNKcode plain_code;
+
+    if(size > len - offset)
+      size = len - offset;
+
+    /* the decoder may move data around in the buffer it gets */
+    memcpy(piece, &input[offset], size);
+    code = Curl_httpchunk_read(conn, piece, (ssize_t)size, &wrote);
+    plain_code = plain_read(&plain, &input[offset], size);
+    offset += size;
+
+    if(code != plain_code)
+      return 1;
+    if(code == CHUNKE_STOP) {
+      if(conn->chunk.dataleft != plain.dataleft)
+        return 2;
+      break;
+    }
+    if(code != CHUNKE_OK)
+      break;
+  }
+
+  if((got.body_len != expected.body_len) ||
+     memcmp(got.body, expected.body, got.body_len))
+    return 3;
+  if((got.head_len != expected.head_len) ||
+     memcmp(got.head, expected.head, got.head_len))
+    return 4;
+  return 0;
+}
+
+UNITTEST_START
+  static const char small[] =
+    "a\r\n0123456789\r\n"
+    "A;x=y\r\n0123456789\r\n"
+    "00a\n0123456789\n"
+    "0\r\n\r\n";
+  ssize_t wrote;
+  size_t len;
+  int i;
+
+  /* the data of small chunks is passed on in a single write */
+  memcpy(piece, small, sizeof(small) - 1);
+  Curl_httpchunk_init(conn);
+  got.body_len = 0;
+  body_writes = 0;
+  fail_unless(Curl_httpchunk_read(conn, piece, (ssize_t)sizeof(small) - 1,
+                                  &wrote) == CHUNKE_STOP,
+              "small chunks not decoded");
+  fail_unless(wrote == 30 && got.body_len == 30 && body_writes == 1,
+              "small chunks not passed on in one write");
+
+  for(i = 0; i < CASES; i++) {
+    int rc;
+    len = make_input();
+    rc = decode(len);
+    if(rc) {
+      fprintf(stderr, "case %d of %zu bytes: decoders disagree (%d)\n",
+              i, len, rc);
+      fail("decoders disagree");
+      break;
+    }
+  }
+
+UNITTEST_STOP
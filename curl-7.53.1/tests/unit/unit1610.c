@@ -0,0 +1,173 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "cookie.h"
+
+#include "memdebug.h" /* LAST include file */
+
+/*
+ * Fills a jar with cookies for many domains, replaces some of them and checks
+ * that the jar lists them in the order they were first added, with the new
+ * values. Then checks the cookies picked for a number of hosts. The time it
+ * takes to fill the jar and to pick cookies from it is shown by the cookies
+ * measurement of unitperf.
+ */
+
+#define DOMAINS 3000
+#define PATHS 4
+#define REPLACED 400
+
+static struct Curl_easy *data;
+
+static const char *paths[PATHS] = { "/", "/a", "/a/b", "/c" };
+
+static CURLcode unit_setup(void)
+{
+  data = curl_easy_init();
+  if(!data)
+    return CURLE_OUT_OF_MEMORY;
+  data->cookies = Curl_cookie_init(data, NULL, NULL, FALSE);
+  if(!data->cookies) {
+    curl_easy_cleanup(data);
+    return CURLE_OUT_OF_MEMORY;
+  }
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  Curl_cookie_cleanup(data->cookies);
+  data->cookies = NULL;
+  curl_easy_cleanup(data);
+}
+
+/*
+ * The cookie line for a domain and path in the format of a cookie file. A
+ * third of the domains are tail-matched sites, the rest are hosts in them.
+ */
+static void cookie_line(char *line, size_t size, int d, int p, int value)
+{
+  char domain[64];
+
+  if(d % 3)
+    snprintf(domain, sizeof(domain), "www%d.site%d.com", d, d / 3);
+  else
+    snprintf(domain, sizeof(domain), ".site%d.com", d / 3);
+
+  snprintf(line, size, "%s%s\t%s\t%s\tFALSE\t4102444800\tc%d_%d\tv%d",
+           (d % 7) ? "" : "#HttpOnly_", domain, (d % 3) ? "FALSE" : "TRUE",
+           paths[p], d, p, value);
+}
+
+UNITTEST_START
+  char line[256];
+  struct curl_slist *list;
+  struct curl_slist *item;
+  struct Cookie *co;
+  struct Cookie *head;
+  int d;
+  int p;
+  int i;
+  int n;
+
+  for(d = 0; d < DOMAINS; d++) {
+    for(p = 0; p < PATHS; p++) {
+      cookie_line(line, sizeof(line), d, p, 0);
+      Curl_cookie_add(data, data->cookies, FALSE, line, NULL, NULL);
+    }
+  }
+  for(i = 0; i < REPLACED; i++) {
+    d = i * 7;
+    cookie_line(line, sizeof(line), d, i % PATHS, 1);
+    Curl_cookie_add(data, data->cookies, FALSE, line, NULL, NULL);
+  }
+
+  fail_unless(data->cookies->numcookies == DOMAINS * PATHS,
+              "wrong number of cookies in the jar");
+
+  /* the jar is listed in the order the cookies were first added */
+  list = Curl_cookie_list(data);
+  fail_unless(list, "no cookie list");
+  item = list;
+  n = 0;
+  for(d = 0; d < DOMAINS && item; d++) {
+    for(p = 0; p < PATHS && item; p++) {
+      bool replaced = (d % 7 == 0) && ((d / 7) < REPLACED) &&
+        ((d / 7) % PATHS == p);
+      cookie_line(line, sizeof(line), d, p, replaced ? 1 : 0);
+      if(!strcmp(item->data, line))
+        n++;
+      item = item->next;
+    }
+  }
+  curl_slist_free_all(list);
+  fail_unless(n == DOMAINS * PATHS, "jar not listed in the order added");
+
+  /* a host gets its own cookies and those of its site, longest path
+     first */
+  for(d = 1; d < 100; d++) {
+    char host[64];
+    snprintf(host, sizeof(host), "www%d.site%d.com", d, d / 3);
+    head = Curl_cookie_getlist(data->cookies, host, "/a/b/c", FALSE);
+    if(head)
+      fail_unless(!strcmp(head->path, "/a/b"), "longest path not first");
+    for(n = 0, co = head; co; co = co->next)
+      n++;
+    Curl_cookie_freelist(head);
+    fail_unless(n == ((d % 3) ? 6 : 3), "wrong cookies picked for a host");
+  }
+
+  /* a tail-matched domain of one label */
+  strcpy(line, ".com\tTRUE\t/\tFALSE\t4102444800\ttld\tyes");
+  Curl_cookie_add(data, data->cookies, FALSE, line, NULL, NULL);
+  head = Curl_cookie_getlist(data->cookies, "www4.site1.com", "/", FALSE);
+  for(n = 0, co = head; co; co = co->next)
+    if(!strcmp(co->name, "tld"))
+      n++;
+  Curl_cookie_freelist(head);
+  fail_unless(n == 1, "cookie for a one label domain not picked");
+
+  /* of two cookies that only differ in tail-matching, the one added last
+     goes first, also after the other one has been replaced */
+  for(i = 0; i < 2; i++) {
+    snprintf(line, sizeof(line), "%stie%d.org\t%s\t/\tFALSE\t4102444800\t"
+             "tie\told", i ? "." : "", i, i ? "TRUE" : "FALSE");
+    Curl_cookie_add(data, data->cookies, FALSE, line, NULL, NULL);
+    snprintf(line, sizeof(line), "%stie%d.org\t%s\t/\tFALSE\t4102444800\t"
+             "tie\tnew", i ? "" : ".", i, i ? "FALSE" : "TRUE");
+    Curl_cookie_add(data, data->cookies, FALSE, line, NULL, NULL);
+    snprintf(line, sizeof(line), "%stie%d.org\t%s\t/\tFALSE\t4102444800\t"
+             "tie\told", i ? "." : "", i, i ? "TRUE" : "FALSE");
+    Curl_cookie_add(data, data->cookies, FALSE, line, NULL, NULL);
+    snprintf(line, sizeof(line), "tie%d.org", i);
+    head = Curl_cookie_getlist(data->cookies, line, "/", FALSE);
+    fail_unless(head && head->next && !head->next->next,
+                "wrong cookies picked for a tie");
+    if(head && head->next)
+      fail_unless(!strcmp(head->value, "new") &&
+                  !strcmp(head->next->value, "old"), "older cookie first");
+    Curl_cookie_freelist(head);
+  }
+
+UNITTEST_STOP
@@ -0,0 +1,423 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) 2017, Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ***************************************************************************/
+
+/*
+ * Shows how long some internal functions of libcurl take on large inputs, to
+ * see the effect of a change to them. This is not a test: the unit tests
+ * check that the functions work. Run it with the names of the measurements
+ * to make, or with no arguments to make all of them.
+ */
+
+#include "curl_setup.h"
+
+#include "urldata.h"
+#include "conncache.h"
+#include "cookie.h"
+#include "http.h"
+#include "http_chunks.h"
+#include "timeval.h"
+#include "curl_printf.h"
+
+#include "memdebug.h" /* LAST include file */
+
+/*
+ * Connection cache lookups with many hosts in the cache, as each transfer
+ * looks up a new connection struct once.
+ */
+
+#define CONN_HOSTS 5000
+#define CONN_ROUNDS 20
+
+/* a connection in the state it has when it is looked up */
+static void setup_conn(struct connectdata *conn, struct Curl_easy *data,
+                       char *name, long port)
+{
+  memset(conn, 0, sizeof(*conn));
+  conn->data = data;
+  conn->host.name = name;
+  conn->port = port;
+}
+
+static int perf_conncache(void)
+{
+  static char names[CONN_HOSTS][32];
+  struct connectdata **conns;
+  struct connectdata needle;
+  struct conncache cache;
+  struct Curl_easy *data;
+  struct timeval started;
+  int found = 0;
+  int round;
+  int i;
+
+  data = curl_easy_init();
+  if(!data)
+    return 1;
+  if(Curl_conncache_init(&cache, 97)) {
+    curl_easy_cleanup(data);
+    return 1;
+  }
+  data->state.conn_cache = &cache;
+  conns = calloc(CONN_HOSTS, sizeof(struct connectdata *));
+  if(!conns) {
+    Curl_conncache_destroy(&cache);
+    curl_easy_cleanup(data);
+    return 1;
+  }
+
+  for(i = 0; i < CONN_HOSTS; i++) {
+    snprintf(names[i], sizeof(names[i]), "host%d.example.com", i);
+    conns[i] = malloc(sizeof(struct connectdata));
+    if(!conns[i])
+      break;
+    setup_conn(conns[i], data, names[i], 80 + (i % 3));
+    if(Curl_conncache_add_conn(&cache, conns[i])) {
+      free(conns[i]);
+      conns[i] = NULL;
+      break;
+    }
+  }
+
+  if(i == CONN_HOSTS) {
+    started = Curl_tvnow();
+    for(round = 0; round < CONN_ROUNDS; round++) {
+      for(i = 0; i < CONN_HOSTS; i++) {
+        setup_conn(&needle, data, names[i], 80 + (i % 3));
+        if(Curl_conncache_find_bundle(&needle, &cache) == conns[i]->bundle)
+          found++;
+      }
+    }
+    printf("conncache: %d lookups among %d hosts in %ld ms\n",
+           CONN_ROUNDS * CONN_HOSTS, CONN_HOSTS,
+           Curl_tvdiff(Curl_tvnow(), started));
+  }
+
+  for(i = 0; i < CONN_HOSTS; i++) {
+    if(conns[i] && conns[i]->bundle)
+      Curl_conncache_remove_conn(&cache, conns[i]);
+    free(conns[i]);
+  }
+  free(conns);
+  Curl_conncache_destroy(&cache);
+  curl_easy_cleanup(data);
+
+  return (found == CONN_ROUNDS * CONN_HOSTS) ? 0 : 1;
+}
+
+/*
+ * Parsing the headers of a response that is received in one piece.
+ */
+
+#define HEADER_ROUNDS 20000
+
+static const char response[] =
+  "HTTP/1.1 200 OK\r\n"
+  "Date: Tue, 09 Nov 2010 14:49:00 GMT\r\n"
+  "Server: test-server/fake\r\n"
+  "Content-Type: application/json; charset=utf-8\r\n"
+  "Content-Length: 7\r\n"
+  "Connection: keep-alive\r\n"
+  "Cache-Control: no-cache, no-store, must-revalidate\r\n"
+  "Pragma: no-cache\r\n"
+  "Expires: 0\r\n"
+  "Vary: Accept-Encoding, Origin\r\n"
+  "X-Request-Id: 8f1c2b6e-5d0a-4c4b-9f3e-2a7d1e6c9b01\r\n"
+  "X-RateLimit-Limit: 5000\r\n"
+  "X-RateLimit-Remaining: 4999\r\n"
+  "X-Content-Type-Options: nosniff\r\n"
+  "X-Frame-Options: DENY\r\n"
+  "Strict-Transport-Security: max-age=31536000\r\n"
+  "Access-Control-Allow-Origin: *\r\n"
+  "ETag: \"33a64df551425fcc55e4d42a148795d9f25f89d4\"\r\n"
+  "Last-Modified: Tue, 09 Nov 2010 14:49:00 GMT\r\n"
+  "\r\n"
+  "{\"a\":1}";
+
+static size_t discard_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)ptr;
+  (void)userp;
+  return size * nmemb;
+}
+
+static int perf_headers(void)
+{
+  struct connectdata *conn;
+  struct Curl_easy *data;
+  struct timeval started;
+  char piece[sizeof(response)];
+  int parsed = 0;
+  int round;
+
+  data = curl_easy_init();
+  if(!data)
+    return 1;
+  conn = calloc(1, sizeof(struct connectdata));
+  if(!conn) {
+    curl_easy_cleanup(data);
+    return 1;
+  }
+  conn->data = data;
+  conn->handler = &Curl_handler_http;
+  conn->given = &Curl_handler_http;
+  curl_easy_setopt(data, CURLOPT_HEADERFUNCTION, discard_cb);
+
+  started = Curl_tvnow();
+  for(round = 0; round < HEADER_ROUNDS; round++) {
+    struct SingleRequest *k = &data->req;
+    ssize_t nread = (ssize_t)sizeof(response) - 1;
+    bool stop = FALSE;
+
+    /* the state a transfer is in when the response starts */
+    memset(k, 0, sizeof(*k));
+    k->header = TRUE;
+    k->size = -1;
+    k->maxdownload = -1;
+    k->hbufp = data->state.headerbuff;
+
+    memcpy(piece, response, sizeof(response));
+    k->str = piece;
+    if(Curl_http_readwrite_headers(data, conn, &nread, &stop) || k->header)
+      break;
+    parsed++;
+  }
+  printf("headers: the headers of %d responses parsed in %ld ms\n",
+         parsed, Curl_tvdiff(Curl_tvnow(), started));
+
+  free(conn);
+  curl_easy_cleanup(data);
+
+  return (parsed == HEADER_ROUNDS) ? 0 : 1;
+}
+
+/*
+ * Decoding a chunked body of 16 byte chunks, read in pieces of the usual
+ * buffer size.
+ */
+
+#define CHUNK_BODY 32768
+#define CHUNK_ROUNDS 200
+
+static size_t body_writes;
+
+static size_t count_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)ptr;
+  (void)userp;
+  body_writes++;
+  return size * nmemb;
+}
+
+static int perf_chunked(void)
+{
+  static const char chunk[] = "10\r\n0123456789abcdef\r\n";
+  static char input[CHUNK_BODY];
+  static char piece[CURL_MAX_WRITE_SIZE];
+  struct connectdata *conn;
+  struct Curl_easy *data;
+  struct timeval started;
+  size_t len = 0;
+  int decoded = 0;
+  int round;
+
+  data = curl_easy_init();
+  if(!data)
+    return 1;
+  conn = calloc(1, sizeof(struct connectdata));
+  if(!conn) {
+    curl_easy_cleanup(data);
+    return 1;
+  }
+  conn->data = data;
+  conn->handler = &Curl_handler_http;
+  conn->given = &Curl_handler_http;
+  curl_easy_setopt(data, CURLOPT_WRITEFUNCTION, count_cb);
+
+  while(len + sizeof(chunk) - 1 <= CHUNK_BODY - 5) {
+    memcpy(&input[len], chunk, sizeof(chunk) - 1);
+    len += sizeof(chunk) - 1;
+  }
+  memcpy(&input[len], "0\r\n\r\n", 5);
+  len += 5;
+
+  body_writes = 0;
+  started = Curl_tvnow();
+  for(round = 0; round < CHUNK_ROUNDS; round++) {
+    CHUNKcode code = CHUNKE_OK;
+    size_t offset;
+    ssize_t wrote;
+
+    Curl_httpchunk_init(conn);
+    for(offset = 0; offset < len && code == CHUNKE_OK;
+        offset += CURL_MAX_WRITE_SIZE) {
+      size_t size = CURLMIN(CURL_MAX_WRITE_SIZE, len - offset);
+      memcpy(piece, &input[offset], size);
+      code = Curl_httpchunk_read(conn, piece, (ssize_t)size, &wrote);
+    }
+    if(code != CHUNKE_STOP)
+      break;
+    decoded++;
+  }
+  printf("chunked: %d bodies of %zu bytes decoded in %ld ms, %zu writes\n",
+         decoded, len, Curl_tvdiff(Curl_tvnow(), started), body_writes);
+
+  free(conn->trailer);
+  free(conn);
+  curl_easy_cleanup(data);
+
+  return (decoded == CHUNK_ROUNDS) ? 0 : 1;
+}
+
+/*
+ * Filling a cookie jar with cookies for many domains, replacing some of them,
+ * and picking the cookies for hosts from it.
+ */
+
+#define COOKIE_DOMAINS 3000
+#define COOKIE_PATHS 4
+#define COOKIE_REPLACED 400
+#define COOKIE_LOOKUPS 10000
+
+/* the cookie line for a domain and path in the format of a cookie file */
+static void cookie_line(char *line, size_t size, int d, int p, int value)
+{
+  static const char *paths[COOKIE_PATHS] = { "/", "/a", "/a/b", "/c" };
+  char domain[64];
+
+  if(d % 3)
+    snprintf(domain, sizeof(domain), "www%d.site%d.com", d, d / 3);
+  else
+    snprintf(domain, sizeof(domain), ".site%d.com", d / 3);
+
+  snprintf(line, size, "%s%s\t%s\t%s\tFALSE\t4102444800\tc%d_%d\tv%d",
+           (d % 7) ? "" : "#HttpOnly_", domain, (d % 3) ? "FALSE" : "TRUE",
+           paths[p], d, p, value);
+}
+
+static int perf_cookies(void)
+{
+  struct Curl_easy *data;
+  struct CookieInfo *jar;
+  struct timeval started;
+  char line[256];
+  long filled;
+  int picked = 0;
+  int d;
+  int p;
+  int i;
+
+  data = curl_easy_init();
+  if(!data)
+    return 1;
+  jar = Curl_cookie_init(data, NULL, NULL, FALSE);
+  if(!jar) {
+    curl_easy_cleanup(data);
+    return 1;
+  }
+
+  started = Curl_tvnow();
+  for(d = 0; d < COOKIE_DOMAINS; d++) {
+    for(p = 0; p < COOKIE_PATHS; p++) {
+      cookie_line(line, sizeof(line), d, p, 0);
+      Curl_cookie_add(data, jar, FALSE, line, NULL, NULL);
+    }
+  }
+  for(i = 0; i < COOKIE_REPLACED; i++) {
+    cookie_line(line, sizeof(line), i * 7, i % COOKIE_PATHS, 1);
+    Curl_cookie_add(data, jar, FALSE, line, NULL, NULL);
+  }
+  filled = Curl_tvdiff(Curl_tvnow(), started);
+
+  started = Curl_tvnow();
+  for(i = 0; i < COOKIE_LOOKUPS; i++) {
+    struct Cookie *co;
+    d = (i * 31) % COOKIE_DOMAINS;
+    snprintf(line, sizeof(line), "www%d.site%d.com", d, d / 3);
+    co = Curl_cookie_getlist(jar, line, "/a/b/c", FALSE);
+    if(co)
+      picked++;
+    Curl_cookie_freelist(co);
+  }
+  printf("cookies: %d cookies added in %ld ms, %d lookups done in %ld ms\n",
+         COOKIE_DOMAINS * COOKIE_PATHS + COOKIE_REPLACED, filled,
+         COOKIE_LOOKUPS, Curl_tvdiff(Curl_tvnow(), started));
+
+  Curl_cookie_cleanup(jar);
+  curl_easy_cleanup(data);
+
+  return (picked == COOKIE_LOOKUPS) ? 0 : 1;
+}
+
+struct perf {
+  const char *name;
+  int (*func)(void);
+};
+
+static const struct perf perfs[] = {
+  { "conncache", perf_conncache },
+  { "headers", perf_headers },
+  { "chunked", perf_chunked },
+  { "cookies", perf_cookies },
+  { NULL, NULL }
+};
+
+int main(int argc, char **argv)
+{
+  const struct perf *p;
+  int rc = 0;
+  int i;
+
+  for(i = 1; i < argc; i++) {
+    for(p = perfs; p->name; p++)
+      if(!strcmp(argv[i], p->name))
+        break;
+    if(!p->name) {
+      fprintf(stderr, "unknown measurement: %s\nknown ones:", argv[i]);
+      for(p = perfs; p->name; p++)
+        fprintf(stderr, " %s", p->name);
+      fprintf(stderr, "\n");
+      return 2;
+    }
+  }
+
+  if(curl_global_init(CURL_GLOBAL_ALL)) {
+    fprintf(stderr, "curl_global_init() failed\n");
+    return 1;
+  }
+
+  for(p = perfs; p->name; p++) {
+    if(argc > 1) {
+      for(i = 1; i < argc; i++)
+        if(!strcmp(argv[i], p->name))
+          break;
+      if(i == argc)
+        continue;
+    }
+    if(p->func()) {
+      fprintf(stderr, "%s: failed\n", p->name);
+      rc = 1;
+    }
+  }
+
+  curl_global_cleanup();
+  return rc;
+}
@@ -121,4 +121,33 @@ for (p = string; length-- > 0; p++)
 return PCRE_UTF32_ERR0;   /* This indicates success */
 }
 
+
+
+/*************************************************
+*    Validate a UTF-32 subject for later use    *
+*************************************************/
+
+/* This is the public interface to the check above. An application that
+matches one subject against many patterns can check it once here, and then
+pass PCRE_NO_UTF32_CHECK to every match, instead of having the whole
+subject checked again for every pattern. Without UTF support, every string is
+accepted, as it is by the matching functions.
+
+Arguments:
+  string       points to the string
+  length       length of string, or -1 if the string is zero-terminated
+  erroroffset  pointer to an error position offset variable
+
+Returns:       = 0    if the string is a valid UTF-32 string
+               > 0    otherwise, setting the offset of the bad character
+               PCRE_ERROR_NULL if string or erroroffset is NULL
+*/
+
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre32_valid_utf32(PCRE_SPTR32 string, int length, int *erroroffset)
+{
+if (string == NULL || erroroffset == NULL) return PCRE_ERROR_NULL;
+return PRIV(valid_utf)((PCRE_PUCHAR)string, length, erroroffset);
+}
+
 /* End of pcre32_valid_utf32.c */
@@ -0,0 +1,877 @@
+/*************************************************
+*      Perl-Compatible Regular Expressions       *
+*************************************************/
+
+/* PCRE is a library of functions to support regular expressions whose syntax
+and semantics are as close as possible to those of the Perl 5 language.
+
+                       Written by Philip Hazel
+           Copyright (c) 1997-2015 University of Cambridge
+
+-----------------------------------------------------------------------------
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of the University of Cambridge nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+-----------------------------------------------------------------------------
+*/
+
+
+
+/* This module contains the external functions that save a set of compiled
+patterns in a single bundle file, and load them again without compiling them.
+A bundle is loaded by mapping the file into memory where that is possible, and
+by reading it otherwise. The compiled patterns are used where they lie. Any
+study data is copied into a pcre[16|32]_extra block when a pattern is first
+fetched, and JIT compilation, if it is wanted, is also done at that point, so
+patterns that are never used cost nothing beyond their share of the file.
+
+A bundle file contains a header, an index with one entry for each pattern,
+and then, for each pattern, its source (zero-terminated), its compiled form,
+and its study data if it has any. Each of these starts on an 8-byte boundary.
+All the numbers are in the byte order of the host that wrote the file; a
+bundle written on a host of the other byte order is converted when it is
+loaded. Compiled patterns depend on the PCRE release and on the link size, so
+these are recorded in the header and must match. */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+
+#if defined HAVE_SYS_MMAN_H && defined HAVE_SYS_STAT_H && defined HAVE_UNISTD_H
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define BUNDLE_MMAP
+#endif
+
+#include "pcre_internal.h"
+
+#if defined COMPILE_PCRE8
+#define BUNDLE_SPTR PCRE_SPTR
+#elif defined COMPILE_PCRE16
+#define BUNDLE_SPTR PCRE_SPTR16
+#elif defined COMPILE_PCRE32
+#define BUNDLE_SPTR PCRE_SPTR32
+#endif
+
+#define BUNDLE_MAGIC          0x50435242UL   /* 'PCRB' */
+#define REVERSED_BUNDLE_MAGIC 0x42524350UL   /* 'BRCP' */
+#define BUNDLE_VERSION        ((PCRE_MAJOR << 16) | PCRE_MINOR)
+#define BUNDLE_ALIGN(n)       (((n) + 7) & ~(pcre_uint32)7)
+
+/* The layout of the file. The header is a multiple of 8 bytes long. */
+
+typedef struct bundle_header {
+  pcre_uint32 magic;              /* BUNDLE_MAGIC */
+  pcre_uint32 version;            /* PCRE release that wrote the file */
+  pcre_uint32 mode;               /* PCRE_MODE8, PCRE_MODE16, or PCRE_MODE32 */
+  pcre_uint32 link_size;          /* LINK_SIZE that the patterns use */
+  pcre_uint32 count;              /* Number of patterns */
+  pcre_uint32 size;               /* Size of the whole file */
+} bundle_header;
+
+typedef struct bundle_entry {
+  pcre_uint32 source_offset;      /* Offset of the source, or 0 if none */
+  pcre_uint32 source_length;      /* Its length in code units */
+  pcre_uint32 code_offset;        /* Offset of the compiled pattern */
+  pcre_uint32 code_size;          /* Its size in bytes */
+  pcre_uint32 study_offset;       /* Offset of the study data, or 0 if none */
+  pcre_uint32 study_size;         /* Its size in bytes */
+} bundle_entry;
+
+/* A loaded bundle. The extras and ready vectors follow the structure in the
+same piece of memory. */
+
+typedef struct bundle {
+  pcre_uint8 *data;               /* The contents of the file */
+  size_t size;                    /* Their size */
+  BOOL mapped;                    /* TRUE if mapped, FALSE if read */
+  int options;                    /* Study options for the first fetch */
+  int count;                      /* Number of patterns */
+  bundle_entry *index;            /* The index, within data */
+  PUBL(extra) **extras;           /* Extra blocks, made on first fetch */
+  pcre_uint8 *ready;              /* TRUE when extras[n] has been made */
+} bundle;
+
+
+
+/*************************************************
+*        Swap the bytes of a 32-bit number       *
+*************************************************/
+
+static pcre_uint32
+swap_uint32(pcre_uint32 value)
+{
+return ((value & 0x000000ff) << 24) |
+       ((value & 0x0000ff00) <<  8) |
+       ((value & 0x00ff0000) >>  8) |
+       (value >> 24);
+}
+
+
+
+/*************************************************
+*       Write padding up to an offset            *
+*************************************************/
+
+/* Arguments:
+  f           the file
+  position    the current offset in the file
+  offset      the offset wanted
+
+Returns:      TRUE if all went well
+*/
+
+static BOOL
+write_padding(FILE *f, pcre_uint32 position, pcre_uint32 offset)
+{
+static const pcre_uint8 zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+return offset == position ||
+  fwrite(zeros, 1, offset - position, f) == offset - position;
+}
+
+
+
+/*************************************************
+*        Save compiled patterns in a bundle      *
+*************************************************/
+
+/* The patterns must have been compiled with the default character tables,
+because the bundle cannot record any others; a pattern that uses other tables
+is saved, but when it is loaded it uses the default ones.
+
+Arguments:
+  filename    the file to write
+  count       the number of patterns
+  sources     a vector of pattern sources, to be found by pcre_bundle_find(),
+                or NULL; any of its entries may be NULL
+  codes       a vector of compiled patterns
+  extras      a vector of study results, or NULL; any of its entries may be
+                NULL
+
+Returns:      0 when all has gone well
+              PCRE_ERROR_BADFILE if the file could not be written
+              another negative error code
+*/
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre_bundle_save(const char *filename, int count, PCRE_SPTR *sources,
+  pcre **codes, pcre_extra **extras)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre16_bundle_save(const char *filename, int count, PCRE_SPTR16 *sources,
+  pcre16 **codes, pcre16_extra **extras)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre32_bundle_save(const char *filename, int count, PCRE_SPTR32 *sources,
+  pcre32 **codes, pcre32_extra **extras)
+#endif
+{
+bundle_header header;
+bundle_entry *index;
+pcre_uint32 offset, position;
+FILE *f;
+int i, rc = 0;
+
+if (filename == NULL || codes == NULL) return PCRE_ERROR_NULL;
+if (count < 0) return PCRE_ERROR_BADCOUNT;
+
+index = (bundle_entry *)(PUBL(malloc))(
+  (count > 0? count : 1) * sizeof(bundle_entry));
+if (index == NULL) return PCRE_ERROR_NOMEMORY;
+
+/* Check the patterns and lay out the file. */
+
+offset = BUNDLE_ALIGN(sizeof(bundle_header) + count * sizeof(bundle_entry));
+for (i = 0; i < count; i++)
+  {
+  const REAL_PCRE *re = (const REAL_PCRE *)codes[i];
+  bundle_entry *entry = index + i;
+
+  if (re == NULL) { rc = PCRE_ERROR_NULL; break; }
+  if (re->magic_number != MAGIC_NUMBER) { rc = PCRE_ERROR_BADMAGIC; break; }
+  if ((re->flags & PCRE_MODE) == 0) { rc = PCRE_ERROR_BADMODE; break; }
+
+  entry->source_offset = entry->source_length = 0;
+  if (sources != NULL && sources[i] != NULL)
+    {
+    BUNDLE_SPTR p = sources[i];
+    while (*p != 0) p++;
+    entry->source_offset = offset;
+    entry->source_length = (pcre_uint32)(p - sources[i]);
+    offset = BUNDLE_ALIGN(offset + IN_UCHARS(entry->source_length + 1));
+    }
+
+  entry->code_offset = offset;
+  entry->code_size = re->size;
+  offset = BUNDLE_ALIGN(offset + re->size);
+
+  entry->study_offset = entry->study_size = 0;
+  if (extras != NULL && extras[i] != NULL &&
+      (extras[i]->flags & PCRE_EXTRA_STUDY_DATA) != 0 &&
+      extras[i]->study_data != NULL)
+    {
+    entry->study_offset = offset;
+    entry->study_size = ((const pcre_study_data *)extras[i]->study_data)->size;
+    offset = BUNDLE_ALIGN(offset + entry->study_size);
+    }
+
+  /* Offsets are 32 bits; give up before they wrap round. */
+
+  if (offset > 0x7fffffffUL) { rc = PCRE_ERROR_BADFILE; break; }
+  }
+
+if (rc != 0)
+  {
+  (PUBL(free))(index);
+  return rc;
+  }
+
+header.magic = BUNDLE_MAGIC;
+header.version = BUNDLE_VERSION;
+header.mode = PCRE_MODE;
+header.link_size = LINK_SIZE;
+header.count = count;
+header.size = offset;
+
+/* Write the file. The tables pointer in a compiled pattern means nothing in
+another process, so it is written as NULL. */
+
+f = fopen(filename, "wb");
+if (f == NULL)
+  {
+  (PUBL(free))(index);
+  return PCRE_ERROR_BADFILE;
+  }
+
+position = sizeof(bundle_header) + count * sizeof(bundle_entry);
+if (fwrite(&header, sizeof(bundle_header), 1, f) != 1 ||
+    (count > 0 && fwrite(index, sizeof(bundle_entry), count, f) !=
+      (size_t)count))
+  rc = PCRE_ERROR_BADFILE;
+
+for (i = 0; i < count && rc == 0; i++)
+  {
+  const REAL_PCRE *re = (const REAL_PCRE *)codes[i];
+  bundle_entry *entry = index + i;
+  REAL_PCRE copy;
+
+  if (entry->source_offset != 0)
+    {
+    if (!write_padding(f, position, entry->source_offset) ||
+        fwrite(sources[i], IN_UCHARS(1), entry->source_length + 1, f) !=
+          entry->source_length + 1)
+      { rc = PCRE_ERROR_BADFILE; break; }
+    position = entry->source_offset + IN_UCHARS(entry->source_length + 1);
+    }
+
+  memcpy(&copy, re, sizeof(REAL_PCRE));
+  copy.tables = NULL;
+  copy.nullpad = NULL;
+  if (!write_padding(f, position, entry->code_offset) ||
+      fwrite(&copy, sizeof(REAL_PCRE), 1, f) != 1 ||
+      fwrite((const pcre_uint8 *)re + sizeof(REAL_PCRE), 1,
+        re->size - sizeof(REAL_PCRE), f) != re->size - sizeof(REAL_PCRE))
+    { rc = PCRE_ERROR_BADFILE; break; }
+  position = entry->code_offset + entry->code_size;
+
+  if (entry->study_offset != 0)
+    {
+    if (!write_padding(f, position, entry->study_offset) ||
+        fwrite(extras[i]->study_data, 1, entry->study_size, f) !=
+          entry->study_size)
+      { rc = PCRE_ERROR_BADFILE; break; }
+    position = entry->study_offset + entry->study_size;
+    }
+  }
+
+if (rc == 0 && !write_padding(f, position, header.size))
+  rc = PCRE_ERROR_BADFILE;
+if (fclose(f) != 0 && rc == 0) rc = PCRE_ERROR_BADFILE;
+if (rc != 0) (void)remove(filename);
+(PUBL(free))(index);
+return rc;
+}
+
+
+
+/*************************************************
+*         Get the contents of a bundle file      *
+*************************************************/
+
+/* Arguments:
+  filename    the file
+  bd          the bundle, whose data, size, and mapped fields are set
+
+Returns:      0 or a negative error code
+*/
+
+static int
+read_bundle(const char *filename, bundle *bd)
+{
+#ifdef BUNDLE_MMAP
+struct stat statbuf;
+void *data;
+int fd = open(filename, O_RDONLY);
+
+if (fd < 0) return PCRE_ERROR_BADFILE;
+if (fstat(fd, &statbuf) != 0 ||
+    statbuf.st_size < (off_t)sizeof(bundle_header) ||
+    statbuf.st_size > (off_t)0x7fffffffL)
+  {
+  close(fd);
+  return PCRE_ERROR_BADFILE;
+  }
+
+/* The mapping is private and writable so that a bundle from a host of the
+other byte order can be converted in place, and so that reference counts can
+be kept. Pages that are never written are shared with the file. */
+
+data = mmap(NULL, (size_t)statbuf.st_size, PROT_READ | PROT_WRITE,
+  MAP_PRIVATE, fd, 0);
+close(fd);
+if (data == MAP_FAILED) return PCRE_ERROR_BADFILE;
+
+bd->data = (pcre_uint8 *)data;
+bd->size = (size_t)statbuf.st_size;
+bd->mapped = TRUE;
+return 0;
+
+#else  /* BUNDLE_MMAP */
+FILE *f = fopen(filename, "rb");
+long size;
+
+if (f == NULL) return PCRE_ERROR_BADFILE;
+if (fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0 ||
+    size < (long)sizeof(bundle_header) || fseek(f, 0, SEEK_SET) != 0)
+  {
+  fclose(f);
+  return PCRE_ERROR_BADFILE;
+  }
+
+bd->data = (pcre_uint8 *)(PUBL(malloc))((size_t)size);
+if (bd->data == NULL)
+  {
+  fclose(f);
+  return PCRE_ERROR_NOMEMORY;
+  }
+if (fread(bd->data, 1, (size_t)size, f) != (size_t)size)
+  {
+  fclose(f);
+  (PUBL(free))(bd->data);
+  return PCRE_ERROR_BADFILE;
+  }
+
+fclose(f);
+bd->size = (size_t)size;
+bd->mapped = FALSE;
+return 0;
+#endif  /* BUNDLE_MMAP */
+}
+
+
+/* Give back what read_bundle() got. */
+
+static void
+release_bundle(bundle *bd)
+{
+#ifdef BUNDLE_MMAP
+if (bd->mapped) (void)munmap(bd->data, bd->size); else
+#endif
+(PUBL(free))(bd->data);
+}
+
+
+
+/*************************************************
+*          Check and convert a bundle            *
+*************************************************/
+
+/* Everything in the file is checked before any of it is used, so that a
+damaged file is rejected at once rather than causing trouble later. If the
+file was written on a host of the other byte order, it is converted first.
+
+Arguments:
+  data        the contents of the file
+  size        their size
+
+Returns:      0 or a negative error code
+*/
+
+static int
+check_bundle(pcre_uint8 *data, size_t size)
+{
+bundle_header *header = (bundle_header *)data;
+bundle_entry *index = (bundle_entry *)(header + 1);
+BOOL swap = header->magic == REVERSED_BUNDLE_MAGIC;
+pcre_uint32 i, count;
+
+if (header->magic != BUNDLE_MAGIC && !swap) return PCRE_ERROR_BADFILE;
+
+if (swap)
+  {
+  pcre_uint32 *p = (pcre_uint32 *)header;
+  for (i = 0; i < sizeof(bundle_header) / sizeof(pcre_uint32); i++, p++)
+    *p = swap_uint32(*p);
+  }
+
+if (header->version != BUNDLE_VERSION || header->link_size != LINK_SIZE ||
+    header->size != size)
+  return PCRE_ERROR_BADFILE;
+if (header->mode != PCRE_MODE) return PCRE_ERROR_BADMODE;
+
+count = header->count;
+if (count > (size - sizeof(bundle_header)) / sizeof(bundle_entry))
+  return PCRE_ERROR_BADFILE;
+
+if (swap)
+  {
+  pcre_uint32 *p = (pcre_uint32 *)index;
+  for (i = 0; i < count * (sizeof(bundle_entry) / sizeof(pcre_uint32)); i++, p++)
+    *p = swap_uint32(*p);
+  }
+
+for (i = 0; i < count; i++)
+  {
+  bundle_entry *entry = index + i;
+  REAL_PCRE *re = (REAL_PCRE *)(data + entry->code_offset);
+  PUBL(extra) extra;
+  int rc;
+
+  /* Check that each part is aligned and inside the file. */
+
+  if ((entry->code_offset & 7) != 0 || (entry->study_offset & 7) != 0 ||
+      entry->code_size < sizeof(REAL_PCRE) ||
+      entry->code_offset > size || size - entry->code_offset < entry->code_size)
+    return PCRE_ERROR_BADFILE;
+
+  if (entry->source_offset != 0)
+    {
+    pcre_uchar *source = (pcre_uchar *)(data + entry->source_offset);
+    pcre_uint32 length = entry->source_length;
+    if ((entry->source_offset & 7) != 0 || entry->source_offset > size ||
+        length >= (size - entry->source_offset) / IN_UCHARS(1))
+      return PCRE_ERROR_BADFILE;
+#ifndef COMPILE_PCRE8
+    if (swap)
+      {
+      pcre_uint32 j;
+      for (j = 0; j < length; j++)
+#if defined COMPILE_PCRE16
+        source[j] = (pcre_uchar)((source[j] >> 8) | (source[j] << 8));
+#else
+        source[j] = swap_uint32(source[j]);
+#endif
+      }
+#endif
+    if (source[length] != 0) return PCRE_ERROR_BADFILE;
+    }
+
+  extra.flags = 0;
+  if (entry->study_offset != 0)
+    {
+    if (entry->study_size != sizeof(pcre_study_data) ||
+        entry->study_offset > size ||
+        size - entry->study_offset < entry->study_size)
+      return PCRE_ERROR_BADFILE;
+    extra.flags = PCRE_EXTRA_STUDY_DATA;
+    extra.study_data = data + entry->study_offset;
+    }
+
+  /* This converts the pattern and its study data if they are the wrong way
+  round, and checks the pattern's magic number and mode. */
+
+  if (swap || re->magic_number != MAGIC_NUMBER)
+    {
+#if defined COMPILE_PCRE8
+    rc = pcre_pattern_to_host_byte_order((pcre *)re, &extra, NULL);
+#elif defined COMPILE_PCRE16
+    rc = pcre16_pattern_to_host_byte_order((pcre16 *)re, &extra, NULL);
+#elif defined COMPILE_PCRE32
+    rc = pcre32_pattern_to_host_byte_order((pcre32 *)re, &extra, NULL);
+#endif
+    if (rc < 0) return rc;
+    }
+  else if ((re->flags & PCRE_MODE) == 0) return PCRE_ERROR_BADMODE;
+
+  if (re->size != entry->code_size || re->tables != NULL ||
+      (entry->study_offset != 0 &&
+        ((pcre_study_data *)extra.study_data)->size != entry->study_size))
+    return PCRE_ERROR_BADFILE;
+  }
+
+return 0;
+}
+
+
+
+/*************************************************
+*              Load a bundle                     *
+*************************************************/
+
+/* Arguments:
+  filename    the file to load
+  options     study options; these are applied to each pattern when it is
+                first fetched, and can be used to ask for JIT compilation
+  errorptr    where to put an error code
+
+Returns:      the bundle, or NULL if there was an error, in which case an
+                error code is placed in errorptr if it is not NULL
+*/
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN pcre_bundle * PCRE_CALL_CONVENTION
+pcre_bundle_open(const char *filename, int options, int *errorptr)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN pcre16_bundle * PCRE_CALL_CONVENTION
+pcre16_bundle_open(const char *filename, int options, int *errorptr)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN pcre32_bundle * PCRE_CALL_CONVENTION
+pcre32_bundle_open(const char *filename, int options, int *errorptr)
+#endif
+{
+bundle file;
+bundle *bd;
+int count, rc;
+
+if (filename == NULL) rc = PCRE_ERROR_NULL;
+else if ((options & ~PUBLIC_STUDY_OPTIONS) != 0) rc = PCRE_ERROR_BADOPTION;
+else rc = read_bundle(filename, &file);
+
+if (rc == 0)
+  {
+  rc = check_bundle(file.data, file.size);
+  if (rc != 0) release_bundle(&file);
+  }
+
+if (rc != 0)
+  {
+  if (errorptr != NULL) *errorptr = rc;
+  return NULL;
+  }
+
+count = (int)((bundle_header *)file.data)->count;
+bd = (bundle *)(PUBL(malloc))(sizeof(bundle) +
+  count * (sizeof(PUBL(extra) *) + sizeof(pcre_uint8)));
+if (bd == NULL)
+  {
+  release_bundle(&file);
+  if (errorptr != NULL) *errorptr = PCRE_ERROR_NOMEMORY;
+  return NULL;
+  }
+
+*bd = file;
+bd->options = options;
+bd->count = count;
+bd->index = (bundle_entry *)(file.data + sizeof(bundle_header));
+bd->extras = (PUBL(extra) **)(bd + 1);
+bd->ready = (pcre_uint8 *)(bd->extras + count);
+memset(bd->extras, 0, count * sizeof(PUBL(extra) *));
+memset(bd->ready, 0, count * sizeof(pcre_uint8));
+
+if (errorptr != NULL) *errorptr = 0;
+#if defined COMPILE_PCRE8
+return (pcre_bundle *)bd;
+#elif defined COMPILE_PCRE16
+return (pcre16_bundle *)bd;
+#elif defined COMPILE_PCRE32
+return (pcre32_bundle *)bd;
+#endif
+}
+
+
+
+/*************************************************
+*       Find the number of patterns in a bundle  *
+*************************************************/
+
+/* Argument:  the bundle
+   Returns:   the number of patterns, or PCRE_ERROR_NULL
+*/
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre_bundle_count(const pcre_bundle *bundle_arg)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre16_bundle_count(const pcre16_bundle *bundle_arg)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre32_bundle_count(const pcre32_bundle *bundle_arg)
+#endif
+{
+const bundle *bd = (const bundle *)bundle_arg;
+return (bd == NULL)? PCRE_ERROR_NULL : bd->count;
+}
+
+
+
+/*************************************************
+*      Find a pattern in a bundle by its source  *
+*************************************************/
+
+/* The index is searched in order, so this is intended for use while a program
+is starting up, to replace its calls to pcre_compile(). The first pattern with
+the given source is found.
+
+Arguments:
+  bundle_arg  the bundle
+  source      the source of the pattern
+
+Returns:      the number of the pattern, counting from zero
+              PCRE_ERROR_NOMATCH if there is no such pattern
+              PCRE_ERROR_NULL if an argument is NULL
+*/
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre_bundle_find(const pcre_bundle *bundle_arg, PCRE_SPTR source)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre16_bundle_find(const pcre16_bundle *bundle_arg, PCRE_SPTR16 source)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre32_bundle_find(const pcre32_bundle *bundle_arg, PCRE_SPTR32 source)
+#endif
+{
+const bundle *bd = (const bundle *)bundle_arg;
+pcre_uint32 length;
+int i;
+
+if (bd == NULL || source == NULL) return PCRE_ERROR_NULL;
+length = STRLEN_UC((PCRE_PUCHAR)source);
+
+for (i = 0; i < bd->count; i++)
+  {
+  const bundle_entry *entry = bd->index + i;
+  if (entry->source_offset != 0 && entry->source_length == length &&
+      memcmp(bd->data + entry->source_offset, source, IN_UCHARS(length)) == 0)
+    return i;
+  }
+
+return PCRE_ERROR_NOMATCH;
+}
+
+
+
+/*************************************************
+*        Get the source of a pattern             *
+*************************************************/
+
+/* Arguments:
+  bundle_arg  the bundle
+  number      the number of the pattern
+
+Returns:      the source, or NULL if there is no such pattern or it was saved
+                without its source
+*/
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN PCRE_SPTR PCRE_CALL_CONVENTION
+pcre_bundle_source(const pcre_bundle *bundle_arg, int number)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN PCRE_SPTR16 PCRE_CALL_CONVENTION
+pcre16_bundle_source(const pcre16_bundle *bundle_arg, int number)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN PCRE_SPTR32 PCRE_CALL_CONVENTION
+pcre32_bundle_source(const pcre32_bundle *bundle_arg, int number)
+#endif
+{
+const bundle *bd = (const bundle *)bundle_arg;
+if (bd == NULL || number < 0 || number >= bd->count ||
+    bd->index[number].source_offset == 0)
+  return NULL;
+return (BUNDLE_SPTR)(bd->data + bd->index[number].source_offset);
+}
+
+
+
+/*************************************************
+*         Fetch a pattern from a bundle          *
+*************************************************/
+
+/* The first time a pattern's extra block is asked for, it is made from the
+saved study data, and any JIT compilation that was requested when the bundle
+was opened is done. As with pcre_study(), there may be no extra block, in
+which case NULL is returned for it. The pattern and its extra block belong to
+the bundle, and must not be freed; they remain valid until the bundle is
+closed. Because of the work done on first use, a bundle must not be used by
+more than one thread at once until each of the patterns those threads use has
+been fetched once.
+
+Arguments:
+  bundle_arg  the bundle
+  number      the number of the pattern
+  codeptr     where to put the compiled pattern
+  extraptr    where to put its extra block, or NULL if it is not wanted
+
+Returns:      0 when all has gone well
+              PCRE_ERROR_NOSUBSTRING if there is no such pattern
+              PCRE_ERROR_NOMEMORY if an extra block could not be made
+              PCRE_ERROR_NULL if an argument is NULL
+*/
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre_bundle_get(pcre_bundle *bundle_arg, int number, pcre **codeptr,
+  pcre_extra **extraptr)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre16_bundle_get(pcre16_bundle *bundle_arg, int number, pcre16 **codeptr,
+  pcre16_extra **extraptr)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre32_bundle_get(pcre32_bundle *bundle_arg, int number, pcre32 **codeptr,
+  pcre32_extra **extraptr)
+#endif
+{
+bundle *bd = (bundle *)bundle_arg;
+const bundle_entry *entry;
+REAL_PCRE *re;
+
+if (bd == NULL || codeptr == NULL) return PCRE_ERROR_NULL;
+if (number < 0 || number >= bd->count) return PCRE_ERROR_NOSUBSTRING;
+
+entry = bd->index + number;
+re = (REAL_PCRE *)(bd->data + entry->code_offset);
+
+if (extraptr != NULL && !bd->ready[number])
+  {
+  PUBL(extra) *extra = NULL;
+  int options = bd->options;
+
+  if (entry->study_offset != 0 || (options & (
+#ifdef SUPPORT_JIT
+      PCRE_STUDY_JIT_COMPILE | PCRE_STUDY_JIT_PARTIAL_SOFT_COMPILE |
+      PCRE_STUDY_JIT_PARTIAL_HARD_COMPILE |
+#endif
+      PCRE_STUDY_EXTRA_NEEDED)) != 0)
+    {
+    pcre_study_data *study;
+
+    extra = (PUBL(extra) *)(PUBL(malloc))
+      (sizeof(PUBL(extra)) + sizeof(pcre_study_data));
+    if (extra == NULL) return PCRE_ERROR_NOMEMORY;
+
+    /* The block is laid out as pcre_study() lays it out, so that it can be
+    freed in the same way. A pattern that was not studied gets empty study
+    data, which is what the JIT compiler needs. */
+
+    study = (pcre_study_data *)((char *)extra + sizeof(PUBL(extra)));
+    extra->flags = PCRE_EXTRA_STUDY_DATA;
+    extra->study_data = study;
+    if (entry->study_offset != 0)
+      memcpy(study, bd->data + entry->study_offset, sizeof(pcre_study_data));
+    else
+      {
+      memset(study, 0, sizeof(pcre_study_data));
+      study->size = sizeof(pcre_study_data);
+      }
+
+#ifdef SUPPORT_JIT
+    extra->executable_jit = NULL;
+    if ((options & PCRE_STUDY_JIT_COMPILE) != 0)
+      PRIV(jit_compile)(re, extra, JIT_COMPILE);
+    if ((options & PCRE_STUDY_JIT_PARTIAL_SOFT_COMPILE) != 0)
+      PRIV(jit_compile)(re, extra, JIT_PARTIAL_SOFT_COMPILE);
+    if ((options & PCRE_STUDY_JIT_PARTIAL_HARD_COMPILE) != 0)
+      PRIV(jit_compile)(re, extra, JIT_PARTIAL_HARD_COMPILE);
+
+    if (study->flags == 0 && (extra->flags & PCRE_EXTRA_EXECUTABLE_JIT) == 0 &&
+        (options & PCRE_STUDY_EXTRA_NEEDED) == 0)
+      {
+#if defined COMPILE_PCRE8
+      pcre_free_study(extra);
+#elif defined COMPILE_PCRE16
+      pcre16_free_study(extra);
+#elif defined COMPILE_PCRE32
+      pcre32_free_study(extra);
+#endif
+      extra = NULL;
+      }
+#endif
+    }
+
+  bd->extras[number] = extra;
+  bd->ready[number] = TRUE;
+  }
+
+#if defined COMPILE_PCRE8
+*codeptr = (pcre *)re;
+#elif defined COMPILE_PCRE16
+*codeptr = (pcre16 *)re;
+#elif defined COMPILE_PCRE32
+*codeptr = (pcre32 *)re;
+#endif
+if (extraptr != NULL) *extraptr = bd->extras[number];
+return 0;
+}
+
+
+
+/*************************************************
+*              Close a bundle                    *
+*************************************************/
+
+/* This frees the bundle, its patterns, and their extra blocks.
+
+Argument:  the bundle
+Returns:   nothing
+*/
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN void PCRE_CALL_CONVENTION
+pcre_bundle_close(pcre_bundle *bundle_arg)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN void PCRE_CALL_CONVENTION
+pcre16_bundle_close(pcre16_bundle *bundle_arg)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN void PCRE_CALL_CONVENTION
+pcre32_bundle_close(pcre32_bundle *bundle_arg)
+#endif
+{
+bundle *bd = (bundle *)bundle_arg;
+int i;
+
+if (bd == NULL) return;
+for (i = 0; i < bd->count; i++)
+#if defined COMPILE_PCRE8
+  pcre_free_study(bd->extras[i]);
+#elif defined COMPILE_PCRE16
+  pcre16_free_study(bd->extras[i]);
+#elif defined COMPILE_PCRE32
+  pcre32_free_study(bd->extras[i]);
+#endif
+release_bundle(bd);
+(PUBL(free))(bd);
+}
+
+/* End of pcre_bundle.c */
@@ -0,0 +1,331 @@
+/*************************************************
+*      Perl-Compatible Regular Expressions       *
+*************************************************/
+
+/* PCRE is a library of functions to support regular expressions whose syntax
+and semantics are as close as possible to those of the Perl 5 language.
+
+                       Written by Philip Hazel
+           Copyright (c) 1997-2015 University of Cambridge
+
+-----------------------------------------------------------------------------
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of the University of Cambridge nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+-----------------------------------------------------------------------------
+*/
+
+
+
+/* This program checks the pattern bundle functions. A set of patterns is
+compiled and saved in a bundle, which is then loaded, with and without JIT
+compilation. Each pattern from the bundle must give the same results as the
+original, and damaged bundles must be rejected. */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include "pcre.h"
+
+#define BUNDLE_FILE "testsavedbundle"
+#define OVECCOUNT 30
+
+typedef struct bundle_test {
+  const char *pattern;
+  int study;
+  int save_source;
+} bundle_test;
+
+static bundle_test tests[] = {
+  { "abc", 1, 1 },
+  { "(?i)(?<word>[a-z]+)\\s+(?P=word)", 1, 1 },
+  { "^(\\d+)-(\\d+)$", 0, 1 },
+  { "(a|b)*c[de]{2,4}", 1, 1 },
+  { "x(?=y)|(?<=q)z", 1, 0 },
+  { "(?m)^line\\d$", 1, 1 },
+#ifdef SUPPORT_UTF
+  { "(*UTF8)\\x{e9}+.", 1, 1 },
+#endif
+  { NULL, 0, 0 }
+};
+
+static const char *subjects[] = {
+  "xxabcxx",
+  "the The cat",
+  "123-456",
+  "ababcdde",
+  "qz xy",
+  "first\nline7\n",
+  "caf\xc3\xa9\xc3\xa9!",
+  "nothing here",
+  NULL
+};
+
+
+
+/*************************************************
+*     Compare a bundle with the original         *
+*************************************************/
+
+/* Arguments:
+  bundle      the bundle
+  codes       the original patterns
+  extras      their study data
+  count       the number of patterns
+  jit         TRUE if the bundle was opened for JIT
+  title       for messages
+
+Returns:      the number of failures
+*/
+
+static int
+check_bundle(pcre_bundle *bundle, pcre **codes, pcre_extra **extras,
+  int count, int jit, const char *title)
+{
+pcre *missing;
+int failed = 0;
+int i, j;
+
+if (pcre_bundle_count(bundle) != count)
+  {
+  printf("%s: count is %d, not %d\n", title, pcre_bundle_count(bundle), count);
+  return 1;
+  }
+
+for (i = 0; i < count; i++)
+  {
+  pcre *re;
+  pcre_extra *extra;
+  const char *source = (const char *)pcre_bundle_source(bundle, i);
+
+  if (pcre_bundle_get(bundle, i, &re, &extra) != 0)
+    {
+    printf("%s: failed to get pattern %d\n", title, i);
+    failed++;
+    continue;
+    }
+
+  if (tests[i].save_source)
+    {
+    if (source == NULL || strcmp(source, tests[i].pattern) != 0 ||
+        pcre_bundle_find(bundle, (PCRE_SPTR)tests[i].pattern) != i)
+      {
+      printf("%s: source of pattern %d is wrong\n", title, i);
+      failed++;
+      }
+    }
+  else if (source != NULL)
+    {
+    printf("%s: pattern %d should have no source\n", title, i);
+    failed++;
+    }
+
+  /* With JIT, a pattern that was not studied gets an extra block too. */
+
+  if ((extras[i] != NULL && extra == NULL) ||
+      (!jit && extras[i] == NULL && extra != NULL))
+    {
+    printf("%s: study data for pattern %d is wrong\n", title, i);
+    failed++;
+    }
+
+  for (j = 0; subjects[j] != NULL; j++)
+    {
+    int ovector1[OVECCOUNT], ovector2[OVECCOUNT];
+    int length = (int)strlen(subjects[j]);
+    int rc1 = pcre_exec(codes[i], extras[i], subjects[j], length, 0, 0,
+      ovector1, OVECCOUNT);
+    int rc2 = pcre_exec(re, extra, subjects[j], length, 0, 0, ovector2,
+      OVECCOUNT);
+    if (rc1 != rc2 || (rc1 > 0 &&
+        memcmp(ovector1, ovector2, 2 * rc1 * sizeof(int)) != 0))
+      {
+      printf("%s: /%s/ gives %d for \"%s\", not %d\n", title,
+        tests[i].pattern, rc2, subjects[j], rc1);
+      failed++;
+      }
+    }
+  }
+
+if (pcre_bundle_find(bundle, (PCRE_SPTR)"not there") != PCRE_ERROR_NOMATCH ||
+    pcre_bundle_get(bundle, count, &missing, NULL) != PCRE_ERROR_NOSUBSTRING)
+  {
+  printf("%s: lookup of a missing pattern did not fail\n", title);
+  failed++;
+  }
+
+return failed;
+}
+
+
+
+/*************************************************
+*      Check that a damaged bundle is rejected   *
+*************************************************/
+
+/* The bundle file is read, changed at one offset (or cut short there, if
+value is negative), and written back; it must then fail to load.
+
+Arguments:
+  offset      where to damage the file
+  value       the byte to put there, or -1 to truncate
+
+Returns:      0 if the bundle was rejected, 1 otherwise
+*/
+
+static int
+check_damaged(long offset, int value)
+{
+static char copy[65536];
+pcre_bundle *bundle;
+size_t size;
+int rc;
+FILE *f = fopen(BUNDLE_FILE, "rb");
+
+if (f == NULL) return 1;
+size = fread(copy, 1, sizeof(copy), f);
+fclose(f);
+if ((size_t)offset >= size) return 1;
+
+f = fopen(BUNDLE_FILE ".bad", "wb");
+if (f == NULL) return 1;
+if (value < 0) size = (size_t)offset; else copy[offset] = (char)value;
+(void)fwrite(copy, 1, size, f);
+fclose(f);
+
+bundle = pcre_bundle_open(BUNDLE_FILE ".bad", 0, &rc);
+remove(BUNDLE_FILE ".bad");
+if (bundle == NULL && rc < 0) return 0;
+printf("damaged bundle (offset %ld, value %d) was accepted\n", offset, value);
+pcre_bundle_close(bundle);
+return 1;
+}
+
+
+
+/*************************************************
+*                Main program                    *
+*************************************************/
+
+int
+main(void)
+{
+pcre *codes[sizeof(tests)/sizeof(bundle_test)];
+pcre_extra *extras[sizeof(tests)/sizeof(bundle_test)];
+PCRE_SPTR sources[sizeof(tests)/sizeof(bundle_test)];
+pcre_bundle *bundle;
+int count, i, rc, jit = 0;
+int failed = 0;
+
+for (count = 0; tests[count].pattern != NULL; count++)
+  {
+  const char *error;
+  int erroroffset;
+
+  codes[count] = pcre_compile(tests[count].pattern, 0, &error, &erroroffset,
+    NULL);
+  if (codes[count] == NULL)
+    {
+    printf("/%s/: compile failed: %s\n", tests[count].pattern, error);
+    return 1;
+    }
+  extras[count] = tests[count].study?
+    pcre_study(codes[count], 0, &error) : NULL;
+  sources[count] = tests[count].save_source?
+    (PCRE_SPTR)tests[count].pattern : NULL;
+  }
+
+rc = pcre_bundle_save(BUNDLE_FILE, count, sources, codes, extras);
+if (rc != 0)
+  {
+  printf("failed to save the bundle (%d)\n", rc);
+  return 1;
+  }
+
+bundle = pcre_bundle_open(BUNDLE_FILE, 0, &rc);
+if (bundle == NULL)
+  {
+  printf("failed to load the bundle (%d)\n", rc);
+  failed++;
+  }
+else
+  {
+  failed += check_bundle(bundle, codes, extras, count, 0, "interpreter");
+  pcre_bundle_close(bundle);
+  }
+
+(void)pcre_config(PCRE_CONFIG_JIT, &jit);
+if (jit)
+  {
+  bundle = pcre_bundle_open(BUNDLE_FILE, PCRE_STUDY_JIT_COMPILE, &rc);
+  if (bundle == NULL)
+    {
+    printf("failed to load the bundle for JIT (%d)\n", rc);
+    failed++;
+    }
+  else
+    {
+    failed += check_bundle(bundle, codes, extras, count, 1, "JIT");
+    pcre_bundle_close(bundle);
+    }
+  }
+
+/* Damage the magic number, the version, the count, and the first pattern's
+offset, and cut the file short. */
+
+failed += check_damaged(0, 'X');
+failed += check_damaged(4, 0xff);
+failed += check_damaged(16, 0x7f);
+failed += check_damaged(24 + 8 + 1, 0x7f);
+failed += check_damaged(100, -1);
+
+bundle = pcre_bundle_open("no-such-bundle", 0, &rc);
+if (bundle != NULL || rc != PCRE_ERROR_BADFILE)
+  {
+  printf("a missing bundle file was not reported\n");
+  failed++;
+  }
+
+remove(BUNDLE_FILE);
+for (i = 0; i < count; i++)
+  {
+  pcre_free_study(extras[i]);
+  pcre_free(codes[i]);
+  }
+
+if (failed > 0)
+  {
+  printf("%d bundle checks failed\n", failed);
+  return 1;
+  }
+printf("All bundle checks passed\n");
+return 0;
+}
+
+/* End of pcre_bundle_test.c */
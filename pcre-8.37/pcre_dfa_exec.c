@@ -3198,6 +3198,7 @@ const pcre_study_data *study = NULL;
 
 const pcre_uchar *req_char_ptr;
 const pcre_uint8 *start_bits = NULL;
+pcre_scan_bits scan_bits;
 BOOL has_first_char = FALSE;
 BOOL has_req_char = FALSE;
 pcre_uchar first_char = 0;
@@ -3403,7 +3404,10 @@ if (!anchored)
     {
     if (!startline && study != NULL &&
          (study->flags & PCRE_STUDY_MAPPED) != 0)
+      {
       start_bits = study->start_bits;
+      PRIV(scan_bits_init)(&scan_bits, start_bits);
+      }
     }
   }
 
@@ -3470,19 +3474,8 @@ for (;;)
       /* Advance to a known first pcre_uchar (i.e. data item) */
 
       if (has_first_char)
-        {
-        if (first_char != first_char2)
-          {
-          pcre_uchar csc;
-          while (current_subject < end_subject &&
-                 (csc = UCHAR21TEST(current_subject)) != first_char && csc != first_char2)
-            current_subject++;
-          }
-        else
-          while (current_subject < end_subject &&
-                 UCHAR21TEST(current_subject) != first_char)
-            current_subject++;
-        }
+        current_subject = PRIV(scan_char)(current_subject, end_subject,
+          first_char, first_char2);
 
       /* Or to just after a linebreak for a multiline match if possible */
 
@@ -3521,17 +3514,8 @@ for (;;)
       /* Advance to a non-unique first pcre_uchar after study */
 
       else if (start_bits != NULL)
-        {
-        while (current_subject < end_subject)
-          {
-          register pcre_uint32 c = UCHAR21TEST(current_subject);
-#ifndef COMPILE_PCRE8
-          if (c > 255) c = 255;
-#endif
-          if ((start_bits[c/8] & (1 << (c&7))) != 0) break;
-          current_subject++;
-          }
-        }
+        current_subject = PRIV(scan_bits)(current_subject, end_subject,
+          &scan_bits);
       }
 
     /* Restore fudged end_subject */
@@ -3559,9 +3543,9 @@ for (;;)
       subject for the match to succeed. If the first pcre_uchar is set,
       req_char must be later in the subject; otherwise the test starts at the
       match point. This optimization can save a huge amount of work in patterns
-      with nested unlimited repeats that aren't going to match. Writing
-      separate code for cased/caseless versions makes it go faster, as does
-      using an autoincrement and backing off on a match.
+      with nested unlimited repeats that aren't going to match. The search
+      itself is done by PRIV(scan_char), which uses vector instructions where
+      it can.
 
       HOWEVER: when the subject string is very, very long, searching to its end
       can take a long time, and give bad performance on quite ordinary
@@ -3577,21 +3561,7 @@ for (;;)
 
         if (p > req_char_ptr)
           {
-          if (req_char != req_char2)
-            {
-            while (p < end_subject)
-              {
-              register pcre_uint32 pp = UCHAR21INCTEST(p);
-              if (pp == req_char || pp == req_char2) { p--; break; }
-              }
-            }
-          else
-            {
-            while (p < end_subject)
-              {
-              if (UCHAR21INCTEST(p) == req_char) { p--; break; }
-              }
-            }
+          p = PRIV(scan_char)(p, end_subject, req_char, req_char2);
 
           /* If we can't find the required pcre_uchar, break the matching loop,
           which will cause a return or PCRE_ERROR_NOMATCH. */
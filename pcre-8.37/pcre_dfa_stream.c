@@ -0,0 +1,620 @@
+/*************************************************
+*      Perl-Compatible Regular Expressions       *
+*************************************************/
+
+/* PCRE is a library of functions to support regular expressions whose syntax
+and semantics are as close as possible to those of the Perl 5 language.
+
+                       Written by Philip Hazel
+           Copyright (c) 1997-2015 University of Cambridge
+
+-----------------------------------------------------------------------------
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of the University of Cambridge nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+-----------------------------------------------------------------------------
+*/
+
+
+/* This module contains the external functions that match a pattern against a
+stream of data that arrives in chunks, using the DFA matching function. The
+chunks are matched where they lie. When a chunk ends in the middle of a
+possible match, the DFA workspace remembers the state of the match, and the
+next chunk is passed to pcre_dfa_exec() with PCRE_DFA_RESTART. Only the
+characters of the unfinished match are kept, so that the match can be tried
+again from scratch if the restart fails (see the pcrepartial documentation for
+the reasons why this can be necessary). Matches are reported to a callback
+function as offsets from the start of the stream. */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pcre_internal.h"
+
+#if defined COMPILE_PCRE8
+#define STREAM_PCRE pcre
+#define STREAM_SPTR PCRE_SPTR
+#elif defined COMPILE_PCRE16
+#define STREAM_PCRE pcre16
+#define STREAM_SPTR PCRE_SPTR16
+#elif defined COMPILE_PCRE32
+#define STREAM_PCRE pcre32
+#define STREAM_SPTR PCRE_SPTR32
+#endif
+
+/* The default size of the DFA workspace, in ints */
+
+#define STREAM_WSCOUNT 1000
+
+/* The smallest amount of memory obtained for retained characters, and the
+smallest part of a chunk that is joined to them when a restart fails */
+
+#define STREAM_KEEP_MIN  64
+#define STREAM_JOIN_MIN 256
+
+/* Options that cannot be given for a stream. Most are managed by the stream
+functions themselves; PCRE_ANCHORED would anchor each chunk separately. */
+
+#define STREAM_BAD_OPTIONS \
+  (PCRE_ANCHORED|PCRE_PARTIAL_HARD|PCRE_PARTIAL_SOFT|PCRE_DFA_RESTART| \
+   PCRE_NOTBOL|PCRE_NOTEOL|PCRE_NO_UTF8_CHECK)
+
+/* The private structure behind pcre[16|32]_dfa_stream */
+
+typedef struct dfa_stream {
+  const STREAM_PCRE *code;        /* The compiled pattern */
+  const PUBL(extra) *extra;       /* Extra data, or NULL */
+  int options;                    /* Caller's options for pcre_dfa_exec() */
+  BOOL utf;                       /* The pattern is in UTF mode */
+  int *workspace;                 /* DFA workspace, kept between calls */
+  int wscount;                    /* Size of the workspace */
+  pcre_uchar *keep;               /* Retained characters */
+  int keep_length;                /* Number of retained characters */
+  int keep_size;                  /* Size of the keep vector */
+  int keep_start;                 /* Where the unfinished match starts */
+  unsigned long int keep_offset;  /* Stream offset of keep[0] */
+  BOOL restartable;               /* Workspace holds a partial match */
+  unsigned long int offset;       /* Stream offset of the next chunk */
+} dfa_stream;
+
+
+
+/*************************************************
+*     Find incomplete character at the end       *
+*************************************************/
+
+/* In UTF mode a chunk may end part way through a character. The incomplete
+character is not passed to pcre_dfa_exec(), but is retained and joined to the
+start of the next chunk. In 32-bit mode every character is a single code unit,
+so there is never an incomplete one.
+
+Arguments:
+  ds          the stream
+  chunk       the chunk
+  length      its length
+
+Returns:      the number of code units in an incomplete final character
+*/
+
+static int
+incomplete_tail(dfa_stream *ds, PCRE_PUCHAR chunk, int length)
+{
+#if defined SUPPORT_UTF && !defined COMPILE_PCRE32
+int i;
+if (!ds->utf) return 0;
+for (i = length - 1; i >= 0 && i >= length - 4; i--)
+  {
+  pcre_uint32 c = chunk[i];
+  if (NOT_FIRSTCHAR(c)) continue;
+  if (HAS_EXTRALEN(c) && length - i <= (int)GET_EXTRALEN(c)) return length - i;
+  break;
+  }
+#else
+(void)ds;
+(void)chunk;
+(void)length;
+#endif
+return 0;
+}
+
+
+
+/*************************************************
+*         Retain characters for later            *
+*************************************************/
+
+/* Characters are added to the end of the keep vector, which is enlarged when
+necessary. The data being added may itself be part of the keep vector.
+
+Arguments:
+  ds          the stream
+  data        the characters to retain
+  length      the number of characters
+  reset       TRUE to discard the previously retained characters
+
+Returns:      0 or PCRE_ERROR_NOMEMORY
+*/
+
+static int
+keep_chars(dfa_stream *ds, PCRE_PUCHAR data, int length, BOOL reset)
+{
+int used = reset? 0 : ds->keep_length;
+
+if (used + length > ds->keep_size)
+  {
+  int size = ds->keep_size * 2;
+  pcre_uchar *keep;
+  if (size < used + length) size = used + length;
+  if (size < STREAM_KEEP_MIN) size = STREAM_KEEP_MIN;
+  keep = (pcre_uchar *)(PUBL(malloc))(IN_UCHARS(size));
+  if (keep == NULL) return PCRE_ERROR_NOMEMORY;
+  if (used > 0) memcpy(keep, ds->keep, IN_UCHARS(used));
+  memcpy(keep + used, data, IN_UCHARS(length));
+  if (ds->keep != NULL) (PUBL(free))(ds->keep);
+  ds->keep = keep;
+  ds->keep_size = size;
+  }
+else memmove(ds->keep + used, data, IN_UCHARS(length));
+
+ds->keep_length = used + length;
+return 0;
+}
+
+
+
+/*************************************************
+*       Match along a buffer of the stream       *
+*************************************************/
+
+/* This function finds all the matches in a buffer, starting at a given point.
+If the buffer is not the final one and a match attempt reaches its end, the
+characters of the attempt are retained, and the workspace is left set up for a
+restart.
+
+Arguments:
+  ds          the stream
+  buffer      the characters (which may be the keep vector)
+  length      the number of characters
+  start       where to start matching
+  base        the stream offset of buffer[0]
+  final       TRUE if there are no more characters to come
+  callback    function to call for each match
+  data        passed to the callback
+
+Returns:      0 when all has gone well
+              a non-zero value returned by the callback
+              a negative error code from pcre_dfa_exec()
+*/
+
+static int
+match_buffer(dfa_stream *ds, PCRE_PUCHAR buffer, int length, int start,
+  unsigned long int base, BOOL final, pcre_dfa_stream_callback callback,
+  void *data)
+{
+int offsets[3];
+int tail = final? 0 : incomplete_tail(ds, buffer, length);
+int options = ds->options;
+int rc;
+
+if (!final) options |= PCRE_PARTIAL_HARD;
+if (base > 0) options |= PCRE_NOTBOL;
+
+length -= tail;
+ds->restartable = FALSE;
+
+while (start <= length)
+  {
+  rc = PUBL(dfa_exec)(ds->code, ds->extra, (STREAM_SPTR)buffer, length,
+    start, options, offsets, 3, ds->workspace, ds->wscount);
+
+  /* The subject has been checked once, which is enough. */
+
+  options |= PCRE_NO_UTF8_CHECK;
+
+  if (rc >= 0)
+    {
+    /* An empty match at the end of a chunk is not reported yet, because in
+    the whole subject the match at this point might not be empty. */
+
+    if (!final && offsets[1] == length && offsets[0] == length) break;
+
+    rc = callback(data, base + offsets[0], base + offsets[1]);
+    if (rc != 0) return rc;
+    start = offsets[1];
+    if (offsets[1] == offsets[0])
+      {
+      if (start >= length) break;
+      start++;
+#ifdef SUPPORT_UTF
+      if (ds->utf)
+        while (start < length && NOT_FIRSTCHAR(buffer[start])) start++;
+#endif
+      }
+    continue;
+    }
+
+  /* An unfinished match: keep everything it has inspected, together with any
+  incomplete character. The workspace can be used to continue the match only
+  if the next chunk follows on directly. */
+
+  if (rc == PCRE_ERROR_PARTIAL)
+    {
+    rc = keep_chars(ds, buffer + offsets[0], length + tail - offsets[0], TRUE);
+    if (rc != 0) return rc;
+    ds->keep_start = offsets[2] - offsets[0];
+    ds->keep_offset = base + offsets[0];
+    ds->restartable = (tail == 0);
+    return 0;
+    }
+
+  if (rc != PCRE_ERROR_NOMATCH) return rc;
+  break;
+  }
+
+/* No unfinished match; keep only an incomplete character, if any. */
+
+if (tail > 0)
+  {
+  rc = keep_chars(ds, buffer + length, tail, TRUE);
+  if (rc != 0) return rc;
+  ds->keep_start = 0;
+  ds->keep_offset = base + length;
+  }
+else ds->keep_length = 0;
+
+return 0;
+}
+
+
+
+/*************************************************
+*          Create a stream matcher               *
+*************************************************/
+
+/* Arguments:
+  code        the compiled pattern
+  extra       extra data for pcre_dfa_exec(), or NULL
+  options     options for pcre_dfa_exec(); the partial matching, restart,
+                NOTBOL, NOTEOL and NO_UTF8_CHECK options are not allowed
+  wscount     the size of the DFA workspace, or 0 for the default
+  errorptr    where to put an error code, or NULL
+
+Returns:      a pointer to the stream, or NULL on error
+*/
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN pcre_dfa_stream * PCRE_CALL_CONVENTION
+pcre_dfa_stream_create(const pcre *code, const pcre_extra *extra, int options,
+  int wscount, int *errorptr)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN pcre16_dfa_stream * PCRE_CALL_CONVENTION
+pcre16_dfa_stream_create(const pcre16 *code, const pcre16_extra *extra,
+  int options, int wscount, int *errorptr)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN pcre32_dfa_stream * PCRE_CALL_CONVENTION
+pcre32_dfa_stream_create(const pcre32 *code, const pcre32_extra *extra,
+  int options, int wscount, int *errorptr)
+#endif
+{
+dfa_stream *ds;
+unsigned long int pattern_options;
+int dummy, rc;
+
+if (errorptr == NULL) errorptr = &dummy;
+
+if (code == NULL)
+  {
+  *errorptr = PCRE_ERROR_NULL;
+  return NULL;
+  }
+if ((options & ~PUBLIC_DFA_EXEC_OPTIONS) != 0 ||
+    (options & STREAM_BAD_OPTIONS) != 0)
+  {
+  *errorptr = PCRE_ERROR_BADOPTION;
+  return NULL;
+  }
+if (wscount == 0) wscount = STREAM_WSCOUNT;
+if (wscount < 20)
+  {
+  *errorptr = PCRE_ERROR_DFA_WSSIZE;
+  return NULL;
+  }
+
+rc = PUBL(fullinfo)(code, NULL, PCRE_INFO_OPTIONS, &pattern_options);
+if (rc != 0)
+  {
+  *errorptr = rc;
+  return NULL;
+  }
+
+ds = (dfa_stream *)(PUBL(malloc))(sizeof(dfa_stream));
+if (ds == NULL)
+  {
+  *errorptr = PCRE_ERROR_NOMEMORY;
+  return NULL;
+  }
+ds->workspace = (int *)(PUBL(malloc))(wscount * sizeof(int));
+if (ds->workspace == NULL)
+  {
+  (PUBL(free))(ds);
+  *errorptr = PCRE_ERROR_NOMEMORY;
+  return NULL;
+  }
+
+ds->code = code;
+ds->extra = extra;
+ds->options = options;
+ds->utf = (pattern_options & PCRE_UTF8) != 0;
+ds->wscount = wscount;
+ds->keep = NULL;
+ds->keep_size = 0;
+ds->keep_length = 0;
+ds->keep_start = 0;
+ds->keep_offset = 0;
+ds->restartable = FALSE;
+ds->offset = 0;
+
+*errorptr = 0;
+return (PUBL(dfa_stream) *)ds;
+}
+
+
+
+/*************************************************
+*       Continue a stream with new characters    *
+*************************************************/
+
+/* The new characters are chunk[from] to chunk[length-1]; any before them have
+already been dealt with, but are still available for looking behind.
+
+Arguments:
+  ds          the stream
+  chunk       the chunk
+  length      the length of the chunk
+  from        where the new characters start
+  base        the stream offset of chunk[0]
+  callback    function to call for each match
+  data        passed to the callback
+
+Returns:      as for match_buffer()
+*/
+
+static int
+feed_chunk(dfa_stream *ds, PCRE_PUCHAR chunk, int length, int from,
+  unsigned long int base, pcre_dfa_stream_callback callback, void *data)
+{
+unsigned long int attempt;
+int join, rc;
+
+if (ds->keep_length == 0)
+  return match_buffer(ds, chunk, length, from, base, FALSE, callback, data);
+
+/* There is an unfinished match. If possible, continue it in the new
+characters without looking at the retained characters again. */
+
+if (ds->restartable && incomplete_tail(ds, chunk, length) == 0)
+  {
+  int offsets[3];
+
+  rc = PUBL(dfa_exec)(ds->code, ds->extra, (STREAM_SPTR)(chunk + from),
+    length - from, 0, ds->options | PCRE_PARTIAL_HARD | PCRE_DFA_RESTART |
+    PCRE_NOTBOL, offsets, 3, ds->workspace, ds->wscount);
+
+  if (rc >= 0)
+    {
+    ds->keep_length = 0;
+    rc = callback(data, ds->keep_offset + ds->keep_start,
+      base + from + offsets[1]);
+    if (rc != 0) return rc;
+    return match_buffer(ds, chunk, length, from + offsets[1], base, FALSE,
+      callback, data);
+    }
+
+  if (rc == PCRE_ERROR_PARTIAL)
+    return keep_chars(ds, chunk + from, length - from, FALSE);
+  if (rc != PCRE_ERROR_NOMATCH) return rc;
+  }
+
+/* The continuation failed, or was not possible. Join the start of the new
+characters to the retained ones, and match again from the start of the
+unfinished match; this may find a shorter match there, or one that starts
+later. Only a little is joined at first, so that a large chunk is not copied
+just to settle an attempt that is near its start. */
+
+join = 2 * ds->keep_length;
+if (join < STREAM_JOIN_MIN) join = STREAM_JOIN_MIN;
+if (join > length - from) join = length - from;
+
+rc = keep_chars(ds, chunk + from, join, FALSE);
+if (rc != 0) return rc;
+rc = match_buffer(ds, ds->keep, ds->keep_length, ds->keep_start,
+  ds->keep_offset, FALSE, callback, data);
+if (rc != 0 || from + join == length) return rc;
+
+/* If every attempt that starts in the retained characters has been settled,
+carry on in the chunk itself. Otherwise, the rest of the chunk continues the
+unfinished match. */
+
+attempt = ds->keep_offset + ds->keep_start;
+if (ds->keep_length == 0 || attempt >= base)
+  {
+  int start = (ds->keep_length == 0)? from + join : (int)(attempt - base);
+  ds->keep_length = 0;
+  return match_buffer(ds, chunk, length, start, base, FALSE, callback, data);
+  }
+
+return feed_chunk(ds, chunk, length, from + join, base, callback, data);
+}
+
+
+
+/*************************************************
+*         Pass the next chunk to a stream        *
+*************************************************/
+
+/* The chunk need not remain available after this function returns. Each match
+that is completed is passed to the callback function, which should return zero
+to continue. If it returns anything else, this function returns that value
+immediately, and the stream must be reset before it is used again.
+
+Arguments:
+  stream      the stream
+  chunk       the next chunk of the subject
+  length      the length of the chunk
+  callback    function to call for each match
+  data        passed to the callback
+
+Returns:      0 when all has gone well
+              a non-zero value returned by the callback
+              a negative error code
+*/
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre_dfa_stream_feed(pcre_dfa_stream *stream, PCRE_SPTR chunk, int length,
+  pcre_dfa_stream_callback callback, void *data)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre16_dfa_stream_feed(pcre16_dfa_stream *stream, PCRE_SPTR16 chunk,
+  int length, pcre_dfa_stream_callback callback, void *data)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre32_dfa_stream_feed(pcre32_dfa_stream *stream, PCRE_SPTR32 chunk,
+  int length, pcre_dfa_stream_callback callback, void *data)
+#endif
+{
+dfa_stream *ds = (dfa_stream *)stream;
+unsigned long int base;
+
+if (ds == NULL || chunk == NULL || callback == NULL) return PCRE_ERROR_NULL;
+if (length < 0) return PCRE_ERROR_BADLENGTH;
+if (length == 0) return 0;
+
+base = ds->offset;
+ds->offset += length;
+return feed_chunk(ds, (PCRE_PUCHAR)chunk, length, 0, base, callback, data);
+}
+
+
+
+/*************************************************
+*          Signal the end of a stream            *
+*************************************************/
+
+/* Any retained characters are matched with the end of the stream as the end
+of the subject; if there are none, an empty subject is matched, to find any
+empty match at the very end. The stream is then reset, ready for reuse.
+
+Arguments:
+  stream      the stream
+  callback    function to call for each match
+  data        passed to the callback
+
+Returns:      as for pcre_dfa_stream_feed()
+*/
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre_dfa_stream_finish(pcre_dfa_stream *stream,
+  pcre_dfa_stream_callback callback, void *data)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre16_dfa_stream_finish(pcre16_dfa_stream *stream,
+  pcre_dfa_stream_callback callback, void *data)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre32_dfa_stream_finish(pcre32_dfa_stream *stream,
+  pcre_dfa_stream_callback callback, void *data)
+#endif
+{
+dfa_stream *ds = (dfa_stream *)stream;
+pcre_uchar empty = 0;
+int rc;
+
+if (ds == NULL || callback == NULL) return PCRE_ERROR_NULL;
+if (ds->keep_length > 0)
+  rc = match_buffer(ds, ds->keep, ds->keep_length, ds->keep_start,
+    ds->keep_offset, TRUE, callback, data);
+else
+  rc = match_buffer(ds, &empty, 0, 0, ds->offset, TRUE, callback, data);
+
+ds->keep_length = 0;
+ds->restartable = FALSE;
+ds->offset = 0;
+return rc;
+}
+
+
+
+/*************************************************
+*     Reset a stream, or free its memory         *
+*************************************************/
+
+/* Resetting discards any retained characters; the workspace and the memory for
+retained characters are kept for the next stream.
+
+Argument:   the stream
+Returns:    nothing
+*/
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN void PCRE_CALL_CONVENTION
+pcre_dfa_stream_reset(pcre_dfa_stream *stream)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN void PCRE_CALL_CONVENTION
+pcre16_dfa_stream_reset(pcre16_dfa_stream *stream)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN void PCRE_CALL_CONVENTION
+pcre32_dfa_stream_reset(pcre32_dfa_stream *stream)
+#endif
+{
+dfa_stream *ds = (dfa_stream *)stream;
+if (ds == NULL) return;
+ds->keep_length = 0;
+ds->restartable = FALSE;
+ds->offset = 0;
+}
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN void PCRE_CALL_CONVENTION
+pcre_dfa_stream_free(pcre_dfa_stream *stream)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN void PCRE_CALL_CONVENTION
+pcre16_dfa_stream_free(pcre16_dfa_stream *stream)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN void PCRE_CALL_CONVENTION
+pcre32_dfa_stream_free(pcre32_dfa_stream *stream)
+#endif
+{
+dfa_stream *ds = (dfa_stream *)stream;
+if (ds == NULL) return;
+if (ds->keep != NULL) (PUBL(free))(ds->keep);
+(PUBL(free))(ds->workspace);
+(PUBL(free))(ds);
+}
+
+/* End of pcre_dfa_stream.c */
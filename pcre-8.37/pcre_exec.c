@@ -351,9 +351,8 @@ argument of match(), which never changes. */
   heapframe *newframe = frame->Xnextframe;\
   if (newframe == NULL)\
     {\
-    newframe = (heapframe *)(PUBL(stack_malloc))(sizeof(heapframe));\
+    newframe = extend_frame_arena((frame_arena *)md->frame_arena);\
     if (newframe == NULL) RRETURN(PCRE_ERROR_NOMEMORY);\
-    newframe->Xnextframe = NULL;\
     frame->Xnextframe = newframe;\
     }\
   frame->Xwhere = rw;\
@@ -450,6 +449,85 @@ typedef struct heapframe {
 #endif
 
 
+/* Frames for the NO_RECURSE case are obtained from an arena in blocks, the
+first of which holds FRAME_BLOCK_START frames. Each later block is twice the
+size of its predecessor, up to FRAME_BLOCK_MAX frames. All the frames are kept
+on one chain through their Xnextframe fields, so a frame that has been obtained
+once is reused by every later "recursion" to the same depth. The arena is
+normally local to one call of pcre_exec(), but the caller may supply one via
+the extra block, in which case the frames are also kept for later calls. The
+structure is defined whatever the setting of NO_RECURSE, so that the public
+functions that create and destroy arenas always exist. */
+
+#define FRAME_BLOCK_START    16
+#define FRAME_BLOCK_MAX    1024
+
+typedef struct frame_arena {
+  struct frame_block *blocks;     /* Chain of blocks, most recent first */
+  struct heapframe *frames;       /* Start of the chain of frames */
+  int block_frames;               /* Number of frames in the next block */
+} frame_arena;
+
+#ifdef NO_RECURSE
+typedef struct frame_block {
+  struct frame_block *next;
+  heapframe frames[1];            /* Really block_frames of these */
+} frame_block;
+
+
+/*************************************************
+*          Add a block of frames to an arena     *
+*************************************************/
+
+/* The frames in the new block are chained together; the caller links the
+first of them onto the end of the existing chain.
+
+Argument: the arena
+Returns:  the first frame in the new block, or NULL if no memory
+*/
+
+static heapframe *
+extend_frame_arena(frame_arena *arena)
+{
+int i;
+int n = arena->block_frames;
+frame_block *block = (frame_block *)(PUBL(stack_malloc))(sizeof(frame_block) +
+  (n - 1) * sizeof(heapframe));
+if (block == NULL) return NULL;
+block->next = arena->blocks;
+arena->blocks = block;
+for (i = 0; i < n - 1; i++) block->frames[i].Xnextframe = block->frames + i + 1;
+block->frames[n - 1].Xnextframe = NULL;
+if (n < FRAME_BLOCK_MAX) arena->block_frames = n * 2;
+return block->frames;
+}
+
+
+/*************************************************
+*          Free all the blocks in an arena       *
+*************************************************/
+
+/* Argument: the arena
+   Returns:  nothing
+*/
+
+static void
+empty_frame_arena(frame_arena *arena)
+{
+frame_block *block = arena->blocks;
+while (block != NULL)
+  {
+  frame_block *next = block->next;
+  (PUBL(stack_free))(block);
+  block = next;
+  }
+arena->blocks = NULL;
+arena->frames = NULL;
+arena->block_frames = FRAME_BLOCK_START;
+}
+#endif  /* NO_RECURSE */
+
+
 /***************************************************************************
 ***************************************************************************/
 
@@ -6297,23 +6375,24 @@ Undefine all the macros that were defined above to handle this. */
 *          Release allocated heap frames         *
 *************************************************/
 
-/* This function releases all the allocated frames. The base frame is on the
-machine stack, and so must not be freed.
+/* This function is called at the end of a match. If the arena was supplied by
+the caller, the chain of frames is remembered in it for the next match;
+otherwise all the allocated frames are released. The base frame is on the
+machine stack, and so is never part of the arena.
+
+Arguments:
+  frame_base   the address of the base frame
+  arena        the arena the frames came from
+  keep         TRUE if the arena belongs to the caller
 
-Argument: the address of the base frame
-Returns:  nothing
+Returns:       nothing
 */
 
 static void
-release_match_heapframes (heapframe *frame_base)
+release_match_heapframes (heapframe *frame_base, frame_arena *arena, BOOL keep)
 {
-heapframe *nextframe = frame_base->Xnextframe;
-while (nextframe != NULL)
-  {
-  heapframe *oldframe = nextframe;
-  nextframe = nextframe->Xnextframe;
-  (PUBL(stack_free))(oldframe);
-  }
+if (keep) arena->frames = frame_base->Xnextframe;
+  else empty_frame_arena(arena);
 }
 #endif
 
@@ -6376,6 +6455,7 @@ match_data match_block;
 match_data *md = &match_block;
 const pcre_uint8 *tables;
 const pcre_uint8 *start_bits = NULL;
+pcre_scan_bits scan_bits;
 PCRE_PUCHAR start_match = (PCRE_PUCHAR)subject + start_offset;
 PCRE_PUCHAR end_subject;
 PCRE_PUCHAR start_partial = NULL;
@@ -6387,8 +6467,13 @@ const REAL_PCRE *re = (const REAL_PCRE *)argument_re;
 
 #ifdef NO_RECURSE
 heapframe frame_zero;
+frame_arena local_arena;
+frame_arena *arena = &local_arena;
 frame_zero.Xprevframe = NULL;            /* Marks the top level */
 frame_zero.Xnextframe = NULL;            /* None are allocated yet */
+local_arena.blocks = NULL;
+local_arena.frames = NULL;
+local_arena.block_frames = FRAME_BLOCK_START;
 md->match_frames_base = &frame_zero;
 #endif
 
@@ -6523,8 +6608,19 @@ if (extra_data != NULL)
   if ((flags & PCRE_EXTRA_CALLOUT_DATA) != 0)
     md->callout_data = extra_data->callout_data;
   if ((flags & PCRE_EXTRA_TABLES) != 0) tables = extra_data->tables;
+#ifdef NO_RECURSE
+  if ((flags & PCRE_EXTRA_FRAME_ARENA) != 0 && extra_data->frame_arena != NULL)
+    {
+    arena = (frame_arena *)extra_data->frame_arena;
+    frame_zero.Xnextframe = arena->frames;
+    }
+#endif
   }
 
+#ifdef NO_RECURSE
+md->frame_arena = arena;
+#endif
+
 /* Limits in the regex override only if they are smaller. */
 
 if ((re->flags & PCRE_MLSET) != 0 && re->limit_match < md->match_limit)
@@ -6712,7 +6808,10 @@ if (!anchored)
   else
     if (!startline && study != NULL &&
       (study->flags & PCRE_STUDY_MAPPED) != 0)
-        start_bits = study->start_bits;
+      {
+      start_bits = study->start_bits;
+      PRIV(scan_bits_init)(&scan_bits, start_bits);
+      }
   }
 
 /* For anchored or unanchored matches, there may be a "last known required
@@ -6778,17 +6877,8 @@ for(;;)
     /* Advance to a unique first char if there is one. */
 
     if (has_first_char)
-      {
-      pcre_uchar smc;
-
-      if (first_char != first_char2)
-        while (start_match < end_subject &&
-          (smc = UCHAR21TEST(start_match)) != first_char && smc != first_char2)
-          start_match++;
-      else
-        while (start_match < end_subject && UCHAR21TEST(start_match) != first_char)
-          start_match++;
-      }
+      start_match = PRIV(scan_char)(start_match, end_subject, first_char,
+        first_char2);
 
     /* Or to just after a linebreak for a multiline match */
 
@@ -6826,17 +6916,7 @@ for(;;)
     /* Or to a non-unique first byte after study */
 
     else if (start_bits != NULL)
-      {
-      while (start_match < end_subject)
-        {
-        register pcre_uint32 c = UCHAR21TEST(start_match);
-#ifndef COMPILE_PCRE8
-        if (c > 255) c = 255;
-#endif
-        if ((start_bits[c/8] & (1 << (c&7))) != 0) break;
-        start_match++;
-        }
-      }
+      start_match = PRIV(scan_bits)(start_match, end_subject, &scan_bits);
     }   /* Starting optimizations */
 
   /* Restore fudged end_subject */
@@ -6864,9 +6944,8 @@ for(;;)
     subject for the match to succeed. If the first character is set, req_char
     must be later in the subject; otherwise the test starts at the match point.
     This optimization can save a huge amount of backtracking in patterns with
-    nested unlimited repeats that aren't going to match. Writing separate code
-    for cased/caseless versions makes it go faster, as does using an
-    autoincrement and backing off on a match.
+    nested unlimited repeats that aren't going to match. The search itself is
+    done by PRIV(scan_char), which uses vector instructions where it can.
 
     HOWEVER: when the subject string is very, very long, searching to its end
     can take a long time, and give bad performance on quite ordinary patterns.
@@ -6883,21 +6962,7 @@ for(;;)
 
       if (p > req_char_ptr)
         {
-        if (req_char != req_char2)
-          {
-          while (p < end_subject)
-            {
-            register pcre_uint32 pp = UCHAR21INCTEST(p);
-            if (pp == req_char || pp == req_char2) { p--; break; }
-            }
-          }
-        else
-          {
-          while (p < end_subject)
-            {
-            if (UCHAR21INCTEST(p) == req_char) { p--; break; }
-            }
-          }
+        p = PRIV(scan_char)(p, end_subject, req_char, req_char2);
 
         /* If we can't find the required character, break the matching loop,
         forcing a match failure. */
@@ -7110,7 +7175,7 @@ if (rc == MATCH_MATCH || rc == MATCH_ACCEPT)
     *(extra_data->mark) = (pcre_uchar *)md->mark;
   DPRINTF((">>>> returning %d\n", rc));
 #ifdef NO_RECURSE
-  release_match_heapframes(&frame_zero);
+  release_match_heapframes(&frame_zero, arena, arena != &local_arena);
 #endif
   return rc;
   }
@@ -7130,7 +7195,7 @@ if (rc != MATCH_NOMATCH && rc != PCRE_ERROR_PARTIAL)
   {
   DPRINTF((">>>> error: returning %d\n", rc));
 #ifdef NO_RECURSE
-  release_match_heapframes(&frame_zero);
+  release_match_heapframes(&frame_zero, arena, arena != &local_arena);
 #endif
   return rc;
   }
@@ -7164,9 +7229,64 @@ else
 if (extra_data != NULL && (extra_data->flags & PCRE_EXTRA_MARK) != 0)
   *(extra_data->mark) = (pcre_uchar *)md->nomatch_mark;
 #ifdef NO_RECURSE
-  release_match_heapframes(&frame_zero);
+  release_match_heapframes(&frame_zero, arena, arena != &local_arena);
 #endif
 return rc;
 }
 
+
+/*************************************************
+*       Create and free frame arenas             *
+*************************************************/
+
+/* An arena can be passed to pcre_exec() in the extra block so that the frames
+it needs when compiled with NO_RECURSE are kept from one call to the next. It
+must not be used by more than one call at once. When NO_RECURSE is not defined
+an arena is still created, but it is never used.
+
+Arguments:  none
+Returns:    pointer to a new arena, or NULL if no memory
+*/
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN pcre_frame_arena * PCRE_CALL_CONVENTION
+pcre_frame_arena_alloc(void)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN pcre16_frame_arena * PCRE_CALL_CONVENTION
+pcre16_frame_arena_alloc(void)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN pcre32_frame_arena * PCRE_CALL_CONVENTION
+pcre32_frame_arena_alloc(void)
+#endif
+{
+frame_arena *arena = (frame_arena *)(PUBL(malloc))(sizeof(frame_arena));
+if (arena == NULL) return NULL;
+arena->blocks = NULL;
+arena->frames = NULL;
+arena->block_frames = FRAME_BLOCK_START;
+return (PUBL(frame_arena) *)arena;
+}
+
+/* Argument:  the arena, which may be NULL
+   Returns:   nothing
+*/
+
+#if defined COMPILE_PCRE8
+PCRE_EXP_DEFN void PCRE_CALL_CONVENTION
+pcre_frame_arena_free(pcre_frame_arena *arena)
+#elif defined COMPILE_PCRE16
+PCRE_EXP_DEFN void PCRE_CALL_CONVENTION
+pcre16_frame_arena_free(pcre16_frame_arena *arena)
+#elif defined COMPILE_PCRE32
+PCRE_EXP_DEFN void PCRE_CALL_CONVENTION
+pcre32_frame_arena_free(pcre32_frame_arena *arena)
+#endif
+{
+if (arena == NULL) return;
+#ifdef NO_RECURSE
+empty_frame_arena((frame_arena *)arena);
+#endif
+(PUBL(free))(arena);
+}
+
 /* End of pcre_exec.c */
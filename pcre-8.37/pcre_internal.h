@@ -2391,6 +2391,32 @@ typedef struct pcre_study_data {
   pcre_uint32 minlength;          /* Minimum subject length */
 } pcre_study_data;
 
+/* Structure used by the start-of-match scanner in pcre_scan.c. It points at
+the start bits from the study data; the nibble tables are a rearrangement of
+the same map that lets a byte shuffle test 16 or 32 subject bytes at once. They
+are built on demand because short subjects never need them. */
+
+typedef struct pcre_scan_bits {
+  const pcre_uint8 *start_bits;   /* The 256-bit map from pcre_study() */
+  BOOL prepared;                  /* TRUE when nibbles[] has been built */
+  pcre_uint8 nibbles[32];         /* Rows for high nibbles 0-7, then 8-15 */
+} pcre_scan_bits;
+
+/* Vectorised scanning is compiled in only for the 8-bit library on x86
+processors with SSE2, which is every x86-64 processor, and not when a custom
+subject pointer type is in use. The wider code units are always handled by the
+scalar loops. SCAN_SIMD_MIN is the shortest stretch of subject for which it is
+worth setting up the vector loop (or, from JIT code, making the function
+call). */
+
+#if defined COMPILE_PCRE8 && defined SUPPORT_SIMD && \
+    !defined CUSTOM_SUBJECT_PTR && (defined __SSE2__ || defined _M_X64 || \
+    (defined _M_IX86_FP && _M_IX86_FP >= 2))
+#define SCAN_SIMD
+#endif
+
+#define SCAN_SIMD_MIN  32
+
 /* Structure for building a chain of open capturing subpatterns during
 compiling, so that instructions to close them can be compiled when (*ACCEPT) is
 encountered. This is also used to identify subpatterns that contain recursive
@@ -2550,6 +2576,7 @@ typedef struct match_data {
   const  pcre_uchar *once_target; /* Where to back up to for atomic groups */
 #ifdef NO_RECURSE
   void  *match_frames_base;       /* For remembering malloc'd frames */
+  void  *frame_arena;             /* Where further frames come from */
 #endif
 } match_data;
 
@@ -2732,6 +2759,16 @@ extern const pcre_uchar *PRIV(find_bracket)(const pcre_uchar *, BOOL, int);
 extern BOOL              PRIV(is_newline)(PCRE_PUCHAR, int, PCRE_PUCHAR,
                            int *, BOOL);
 extern unsigned int      PRIV(ord2utf)(pcre_uint32, pcre_uchar *);
+extern PCRE_PUCHAR       PRIV(scan_bits)(PCRE_PUCHAR, PCRE_PUCHAR,
+                           pcre_scan_bits *);
+extern void              PRIV(scan_bits_init)(pcre_scan_bits *,
+                           const pcre_uint8 *);
+extern void              PRIV(scan_bits_prepare)(pcre_scan_bits *);
+extern PCRE_PUCHAR       PRIV(scan_char)(PCRE_PUCHAR, PCRE_PUCHAR,
+                           pcre_uint32, pcre_uint32);
+#ifdef SCAN_SIMD
+extern PCRE_PUCHAR       PRIV(scan_utf8)(PCRE_PUCHAR, PCRE_PUCHAR);
+#endif
 extern int               PRIV(valid_utf)(PCRE_PUCHAR, int, int *);
 extern BOOL              PRIV(was_newline)(PCRE_PUCHAR, int, PCRE_PUCHAR,
                            int *, BOOL);
@@ -3541,6 +3541,41 @@ while (TRUE)
   }
 }
 
+#ifdef SCAN_SIMD
+
+static const pcre_uchar * SLJIT_CALL do_scan_char(const pcre_uchar *ptr, const pcre_uchar *end, sljit_uw chars)
+{
+return PRIV(scan_char)(ptr, end, chars & 0xff, chars >> 8);
+}
+
+static const pcre_uchar * SLJIT_CALL do_scan_bits(const pcre_uchar *ptr, const pcre_uchar *end, pcre_scan_bits *bits)
+{
+return PRIV(scan_bits)(ptr, end, bits);
+}
+
+static struct sljit_jump *fast_forward_scan(compiler_common *common, sljit_sw offset, sljit_sw func, sljit_sw arg)
+{
+/* Hands the search to one of the vectorised scanners in pcre_scan.c, unless
+fewer than SCAN_SIMD_MIN characters remain. The scan covers STR_PTR + offset to
+STR_END + offset, and STR_PTR is moved back by offset afterwards. The returned
+jump is taken when the subject is too short, and STR_PTR is unchanged. */
+DEFINE_COMPILER;
+struct sljit_jump *tooshort;
+
+OP2(SLJIT_SUB, TMP1, 0, STR_END, 0, STR_PTR, 0);
+tooshort = CMP(SLJIT_LESS, TMP1, 0, SLJIT_IMM, IN_UCHARS(SCAN_SIMD_MIN));
+OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), LOCALS0, STACK_TOP, 0);
+OP2(SLJIT_ADD, SLJIT_R0, 0, STR_PTR, 0, SLJIT_IMM, IN_UCHARS(offset));
+OP2(SLJIT_ADD, SLJIT_R1, 0, STR_END, 0, SLJIT_IMM, IN_UCHARS(offset));
+OP1(SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, arg);
+sljit_emit_ijump(compiler, SLJIT_CALL3, SLJIT_IMM, func);
+OP1(SLJIT_MOV, STACK_TOP, 0, SLJIT_MEM1(SLJIT_SP), LOCALS0);
+OP2(SLJIT_SUB, STR_PTR, 0, SLJIT_RETURN_REG, 0, SLJIT_IMM, IN_UCHARS(offset));
+return tooshort;
+}
+
+#endif /* SCAN_SIMD */
+
 static SLJIT_INLINE BOOL fast_forward_first_n_chars(compiler_common *common, BOOL firstline)
 {
 DEFINE_COMPILER;
@@ -3556,6 +3591,9 @@ int i, max, from;
 int range_right = -1, range_len = 3 - 1;
 sljit_ub *update_table = NULL;
 BOOL in_range;
+#ifdef SCAN_SIMD
+struct sljit_jump *tooshort;
+#endif
 
 for (i = 0; i < MAX_N_CHARS; i++)
   {
@@ -3710,11 +3748,24 @@ if (range_right >= 0)
   OP1(SLJIT_MOV, RETURN_ADDR, 0, SLJIT_IMM, (sljit_sw)update_table);
 #endif
 
+SLJIT_ASSERT(range_right >= 0 || offsets[0] >= 0);
+
+#ifdef SCAN_SIMD
+/* Long subjects are searched for the first fixed character with vector
+instructions. Only one other case (a single bit difference) can be given. The
+loop below then starts on that character, and the scanner is not called
+again for each candidate that the loop rejects. */
+if (range_right < 0 && !firstline && (chars[1] & (chars[1] - 1)) == 0)
+  {
+  tooshort = fast_forward_scan(common, offsets[0], SLJIT_FUNC_OFFSET(do_scan_char),
+    chars[0] | ((chars[0] & ~chars[1]) << 8));
+  JUMPHERE(tooshort);
+  }
+#endif
+
 start = LABEL();
 quit = CMP(SLJIT_GREATER_EQUAL, STR_PTR, 0, STR_END, 0);
 
-SLJIT_ASSERT(range_right >= 0 || offsets[0] >= 0);
-
 if (range_right >= 0)
   {
 #if defined COMPILE_PCRE8 || (defined SLJIT_LITTLE_ENDIAN && SLJIT_LITTLE_ENDIAN)
@@ -3789,28 +3840,40 @@ DEFINE_COMPILER;
 struct sljit_label *start;
 struct sljit_jump *quit;
 struct sljit_jump *found;
+#ifdef SCAN_SIMD
+struct sljit_jump *tooshort;
+#endif
 pcre_uchar oc, bit;
 
+oc = first_char;
+if (caseless)
+  {
+  oc = TABLE_GET(first_char, common->fcc, first_char);
+#if defined SUPPORT_UCP && !(defined COMPILE_PCRE8)
+  if (first_char > 127 && common->utf)
+    oc = UCD_OTHERCASE(first_char);
+#endif
+  }
+
 if (firstline)
   {
   SLJIT_ASSERT(common->first_line_end != 0);
   OP1(SLJIT_MOV, TMP3, 0, STR_END, 0);
   OP1(SLJIT_MOV, STR_END, 0, SLJIT_MEM1(SLJIT_SP), common->first_line_end);
   }
+#ifdef SCAN_SIMD
+else
+  {
+  /* The loop below stops at once on the character found by the scanner. */
+  tooshort = fast_forward_scan(common, 0, SLJIT_FUNC_OFFSET(do_scan_char), first_char | (oc << 8));
+  JUMPHERE(tooshort);
+  }
+#endif
 
 start = LABEL();
 quit = CMP(SLJIT_GREATER_EQUAL, STR_PTR, 0, STR_END, 0);
 OP1(MOV_UCHAR, TMP1, 0, SLJIT_MEM1(STR_PTR), 0);
 
-oc = first_char;
-if (caseless)
-  {
-  oc = TABLE_GET(first_char, common->fcc, first_char);
-#if defined SUPPORT_UCP && !(defined COMPILE_PCRE8)
-  if (first_char > 127 && common->utf)
-    oc = UCD_OTHERCASE(first_char);
-#endif
-  }
 if (first_char == oc)
   found = CMP(SLJIT_EQUAL, TMP1, 0, SLJIT_IMM, first_char);
 else
@@ -3940,6 +4003,10 @@ jump_list *matches = NULL;
 #ifndef COMPILE_PCRE8
 struct sljit_jump *jump;
 #endif
+#ifdef SCAN_SIMD
+pcre_scan_bits *scan_bits;
+struct sljit_jump *tooshort;
+#endif
 
 if (firstline)
   {
@@ -3947,6 +4014,21 @@ if (firstline)
   OP1(SLJIT_MOV, RETURN_ADDR, 0, STR_END, 0);
   OP1(SLJIT_MOV, STR_END, 0, SLJIT_MEM1(SLJIT_SP), common->first_line_end);
   }
+#ifdef SCAN_SIMD
+else if (!common->utf)
+  {
+  /* The nibble tables are built now, so that the scanner never writes to
+  them while matching. */
+  scan_bits = (pcre_scan_bits *)allocate_read_only_data(common, sizeof(pcre_scan_bits));
+  if (scan_bits != NULL)
+    {
+    PRIV(scan_bits_init)(scan_bits, start_bits);
+    PRIV(scan_bits_prepare)(scan_bits);
+    tooshort = fast_forward_scan(common, 0, SLJIT_FUNC_OFFSET(do_scan_bits), (sljit_sw)scan_bits);
+    JUMPHERE(tooshort);
+    }
+  }
+#endif
 
 start = LABEL();
 quit = CMP(SLJIT_GREATER_EQUAL, STR_PTR, 0, STR_END, 0);
@@ -4016,6 +4098,9 @@ struct sljit_jump *alreadyfound;
 struct sljit_jump *found;
 struct sljit_jump *foundoc = NULL;
 struct sljit_jump *notfound;
+#ifdef SCAN_SIMD
+struct sljit_jump *tooshort;
+#endif
 pcre_uint32 oc, bit;
 
 SLJIT_ASSERT(common->req_char_ptr != 0);
@@ -4029,10 +4114,6 @@ if (has_firstchar)
 else
   OP1(SLJIT_MOV, TMP1, 0, STR_PTR, 0);
 
-loop = LABEL();
-notfound = CMP(SLJIT_GREATER_EQUAL, TMP1, 0, STR_END, 0);
-
-OP1(MOV_UCHAR, TMP2, 0, SLJIT_MEM1(TMP1), 0);
 oc = req_char;
 if (caseless)
   {
@@ -4042,6 +4123,25 @@ if (caseless)
     oc = UCD_OTHERCASE(req_char);
 #endif
   }
+
+#ifdef SCAN_SIMD
+/* TMP1 is SLJIT_R0, so it is already the first argument and receives the
+result. The loop below stops at once on the character found. */
+SLJIT_ASSERT(TMP1 == SLJIT_R0 && STACK_TOP == SLJIT_R1);
+OP2(SLJIT_SUB, TMP2, 0, STR_END, 0, TMP1, 0);
+tooshort = CMP(SLJIT_LESS, TMP2, 0, SLJIT_IMM, IN_UCHARS(SCAN_SIMD_MIN));
+OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), LOCALS0, STACK_TOP, 0);
+OP1(SLJIT_MOV, SLJIT_R1, 0, STR_END, 0);
+OP1(SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, req_char | (oc << 8));
+sljit_emit_ijump(compiler, SLJIT_CALL3, SLJIT_IMM, SLJIT_FUNC_OFFSET(do_scan_char));
+OP1(SLJIT_MOV, STACK_TOP, 0, SLJIT_MEM1(SLJIT_SP), LOCALS0);
+JUMPHERE(tooshort);
+#endif
+
+loop = LABEL();
+notfound = CMP(SLJIT_GREATER_EQUAL, TMP1, 0, STR_END, 0);
+
+OP1(MOV_UCHAR, TMP2, 0, SLJIT_MEM1(TMP1), 0);
 if (req_char == oc)
   found = CMP(SLJIT_EQUAL, TMP2, 0, SLJIT_IMM, req_char);
 else
@@ -0,0 +1,680 @@
+/*************************************************
+*      Perl-Compatible Regular Expressions       *
+*************************************************/
+
+/* PCRE is a library of functions to support regular expressions whose syntax
+and semantics are as close as possible to those of the Perl 5 language.
+
+                       Written by Philip Hazel
+           Copyright (c) 1997-2015 University of Cambridge
+
+-----------------------------------------------------------------------------
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of the University of Cambridge nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+-----------------------------------------------------------------------------
+*/
+
+
+/* This module contains internal functions that advance through a subject
+looking for a possible starting point for a match: either a given code unit or
+its other case, or any code unit whose bit is set in a start_bits map. They are
+used by pcre_exec(), pcre_dfa_exec() and the code generated by the JIT
+compiler. In the 8-bit library on x86 processors the subject is examined 16 or
+32 bytes at a time using SSE2, SSSE3 or AVX2 instructions, chosen at run time
+according to what the processor supports. Other builds use simple loops. The
+8-bit vector code also includes a fast front end for UTF-8 validation. */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pcre_internal.h"
+
+#ifdef SCAN_SIMD
+#include <emmintrin.h>
+
+/* SSSE3 and AVX2 code is compiled into functions that carry their own target
+attribute, so the rest of the library does not need special compiler options.
+Older compilers that cannot do this get only the SSE2 code. */
+
+#if defined _MSC_VER
+#include <intrin.h>
+#define SCAN_SSSE3
+#if _MSC_VER >= 1700
+#include <immintrin.h>
+#define SCAN_AVX2
+#endif
+#define SCAN_TARGET(t)
+#elif defined __clang__ || \
+  (defined __GNUC__ && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#include <immintrin.h>
+#define SCAN_SSSE3
+#define SCAN_AVX2
+#define SCAN_TARGET(t) __attribute__((target(t)))
+#else
+#define SCAN_TARGET(t)
+#endif
+
+#define SCAN_LEVEL_SSE2   1
+#define SCAN_LEVEL_SSSE3  2
+#define SCAN_LEVEL_AVX2   3
+
+/* The detected level is cached. Several threads may race to set it, but they
+all store the same value. */
+
+static int scan_level = 0;
+
+
+
+/*************************************************
+*       Find the processor's vector support      *
+*************************************************/
+
+/* SSE2 is always present when SCAN_SIMD is defined. AVX2 also needs the
+operating system to preserve the YMM registers, which __builtin_cpu_supports()
+checks for us; with MSVC we have to ask XGETBV ourselves.
+
+Returns:       one of the SCAN_LEVEL_xxx values
+*/
+
+static int
+scan_get_level(void)
+{
+int level = scan_level;
+if (level != 0) return level;
+
+level = SCAN_LEVEL_SSE2;
+#if defined _MSC_VER
+  {
+  int info[4];
+  __cpuid(info, 1);
+  if ((info[2] & (1 << 9)) != 0) level = SCAN_LEVEL_SSSE3;
+#ifdef SCAN_AVX2
+  if ((info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6)
+    {
+    __cpuidex(info, 7, 0);
+    if ((info[1] & (1 << 5)) != 0) level = SCAN_LEVEL_AVX2;
+    }
+#endif
+  }
+#elif defined SCAN_SSSE3
+__builtin_cpu_init();
+if (__builtin_cpu_supports("ssse3")) level = SCAN_LEVEL_SSSE3;
+if (__builtin_cpu_supports("avx2")) level = SCAN_LEVEL_AVX2;
+#endif
+
+scan_level = level;
+return level;
+}
+
+
+/* Index of the lowest set bit in a non-zero mask. */
+
+#if defined _MSC_VER
+static int
+scan_ctz(unsigned int mask)
+{
+unsigned long index;
+_BitScanForward(&index, mask);
+return (int)index;
+}
+#else
+#define scan_ctz(mask) __builtin_ctz(mask)
+#endif
+
+
+
+/*************************************************
+*      Vector loops for a code unit or its pair  *
+*************************************************/
+
+/* These loops stop at the first of c1 or c2 (which may be the same), or at
+the point where fewer than a whole vector of subject remains; the caller
+finishes off with the scalar loop.
+
+Arguments:
+  ptr          where to start
+  end          end of the subject
+  c1, c2       the code units to look for
+
+Returns:       pointer to a match, or to the unexamined tail
+*/
+
+static PCRE_PUCHAR
+scan_char_sse2(PCRE_PUCHAR ptr, PCRE_PUCHAR end, pcre_uint32 c1,
+  pcre_uint32 c2)
+{
+const __m128i v1 = _mm_set1_epi8((char)c1);
+const __m128i v2 = _mm_set1_epi8((char)c2);
+
+while (end - ptr >= 16)
+  {
+  __m128i data = _mm_loadu_si128((const __m128i *)ptr);
+  int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(data, v1),
+    _mm_cmpeq_epi8(data, v2)));
+  if (mask != 0) return ptr + scan_ctz((unsigned int)mask);
+  ptr += 16;
+  }
+return ptr;
+}
+
+#ifdef SCAN_AVX2
+static SCAN_TARGET("avx2") PCRE_PUCHAR
+scan_char_avx2(PCRE_PUCHAR ptr, PCRE_PUCHAR end, pcre_uint32 c1,
+  pcre_uint32 c2)
+{
+const __m256i v1 = _mm256_set1_epi8((char)c1);
+const __m256i v2 = _mm256_set1_epi8((char)c2);
+
+while (end - ptr >= 32)
+  {
+  __m256i data = _mm256_loadu_si256((const __m256i *)ptr);
+  unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(
+    _mm256_cmpeq_epi8(data, v1), _mm256_cmpeq_epi8(data, v2)));
+  if (mask != 0) return ptr + scan_ctz(mask);
+  ptr += 32;
+  }
+return ptr;
+}
+#endif  /* SCAN_AVX2 */
+
+
+
+/*************************************************
+*       Vector loops for a start_bits map        *
+*************************************************/
+
+/* Each subject byte is split into nibbles. The low nibble selects a byte from
+each of the two rows in the nibble table, one row holding the map for high
+nibbles 0-7 and the other for 8-15; the high nibble then picks the row and the
+bit within it. The shuffle instruction does all the table lookups at once.
+
+Arguments:
+  ptr          where to start
+  end          end of the subject
+  nibbles      the prepared table (see PRIV(scan_bits_prepare))
+
+Returns:       pointer to a match, or to the unexamined tail
+*/
+
+#ifdef SCAN_SSSE3
+static SCAN_TARGET("ssse3") PCRE_PUCHAR
+scan_bits_ssse3(PCRE_PUCHAR ptr, PCRE_PUCHAR end, const pcre_uint8 *nibbles)
+{
+const __m128i rows_low = _mm_loadu_si128((const __m128i *)nibbles);
+const __m128i rows_high = _mm_loadu_si128((const __m128i *)(nibbles + 16));
+const __m128i bit_select = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+  1, 2, 4, 8, 16, 32, 64, -128);
+const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+const __m128i high_half = _mm_set1_epi8(0x08);
+const __m128i zero = _mm_setzero_si128();
+
+while (end - ptr >= 16)
+  {
+  __m128i data = _mm_loadu_si128((const __m128i *)ptr);
+  __m128i lo = _mm_and_si128(data, nibble_mask);
+  __m128i hi = _mm_and_si128(_mm_srli_epi16(data, 4), nibble_mask);
+  __m128i in_high = _mm_cmpeq_epi8(_mm_and_si128(hi, high_half), high_half);
+  __m128i row = _mm_or_si128(
+    _mm_andnot_si128(in_high, _mm_shuffle_epi8(rows_low, lo)),
+    _mm_and_si128(in_high, _mm_shuffle_epi8(rows_high, lo)));
+  __m128i bit = _mm_shuffle_epi8(bit_select, hi);
+  int mask = _mm_movemask_epi8(
+    _mm_cmpeq_epi8(_mm_and_si128(row, bit), zero)) ^ 0xffff;
+  if (mask != 0) return ptr + scan_ctz((unsigned int)mask);
+  ptr += 16;
+  }
+return ptr;
+}
+#endif  /* SCAN_SSSE3 */
+
+#ifdef SCAN_AVX2
+static SCAN_TARGET("avx2") PCRE_PUCHAR
+scan_bits_avx2(PCRE_PUCHAR ptr, PCRE_PUCHAR end, const pcre_uint8 *nibbles)
+{
+/* The 256-bit shuffle works within each 128-bit lane, so each table is
+repeated in both lanes. */
+
+const __m128i low128 = _mm_loadu_si128((const __m128i *)nibbles);
+const __m128i high128 = _mm_loadu_si128((const __m128i *)(nibbles + 16));
+const __m256i rows_low = _mm256_inserti128_si256(
+  _mm256_castsi128_si256(low128), low128, 1);
+const __m256i rows_high = _mm256_inserti128_si256(
+  _mm256_castsi128_si256(high128), high128, 1);
+const __m256i bit_select = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+  1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+  1, 2, 4, 8, 16, 32, 64, -128);
+const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+const __m256i high_half = _mm256_set1_epi8(0x08);
+const __m256i zero = _mm256_setzero_si256();
+
+while (end - ptr >= 32)
+  {
+  __m256i data = _mm256_loadu_si256((const __m256i *)ptr);
+  __m256i lo = _mm256_and_si256(data, nibble_mask);
+  __m256i hi = _mm256_and_si256(_mm256_srli_epi16(data, 4), nibble_mask);
+  __m256i in_high = _mm256_cmpeq_epi8(_mm256_and_si256(hi, high_half),
+    high_half);
+  __m256i row = _mm256_or_si256(
+    _mm256_andnot_si256(in_high, _mm256_shuffle_epi8(rows_low, lo)),
+    _mm256_and_si256(in_high, _mm256_shuffle_epi8(rows_high, lo)));
+  __m256i bit = _mm256_shuffle_epi8(bit_select, hi);
+  unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(
+    _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), zero));
+  if (mask != 0) return ptr + scan_ctz(mask);
+  ptr += 32;
+  }
+return ptr;
+}
+#endif  /* SCAN_AVX2 */
+
+
+
+/*************************************************
+*        Vector loops for UTF-8 validation       *
+*************************************************/
+
+/* These loops find how much of a subject is certainly valid UTF-8, so that
+PRIV(valid_utf) need only look at the rest. Blocks of ASCII are skipped at
+once. Other blocks are checked by looking up each byte's high nibble and the
+nibbles of the byte before it in three tables; a byte pair is in error if the
+three lookups have a bit in common. Each bit stands for one kind of error:
+
+  TOO_SHORT   lead byte not followed by a continuation byte
+  TOO_LONG    ASCII byte followed by a continuation byte
+  OVERLONG_2  C0 or C1 lead byte
+  OVERLONG_3  E0 followed by 80-9F
+  SURROGATE   ED followed by A0-BF
+  TOO_LARGE   F4 followed by 90-BF, or F5-FF followed by a continuation
+  OVERLONG_4  F0 followed by 80-8F (shares a bit with TOO_LARGE_1000, which is
+              F5-FF followed by 80-8F)
+  TWO_CONTS   two continuation bytes in a row
+
+Two continuation bytes in a row are correct only as the 3rd and 4th bytes of a
+character, so that bit is cancelled against the bytes two and three back.
+Everything else, including the exact reason for an error, is left to the
+scalar code. The loops return the start of the first character that they have
+not fully checked; this is always a character boundary, because the bytes in
+front of it have been checked. */
+
+#define U8_TOO_SHORT   0x01
+#define U8_TOO_LONG    0x02
+#define U8_OVERLONG_3  0x04
+#define U8_TOO_LARGE   0x08
+#define U8_SURROGATE   0x10
+#define U8_OVERLONG_2  0x20
+#define U8_OVERLONG_4  0x40
+#define U8_TOO_LARGE_1000 0x40
+#define U8_TWO_CONTS   0x80
+#define U8_CARRY       (U8_TOO_SHORT|U8_TOO_LONG|U8_TWO_CONTS)
+#define U8_BIG         (U8_CARRY|U8_TOO_LARGE|U8_TOO_LARGE_1000)
+
+static const pcre_uint8 utf8_byte1_high[16] = {
+  U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,       /* 0x */
+  U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,       /* 7x */
+  U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,   /* 8x - Bx */
+  U8_TOO_SHORT|U8_OVERLONG_2,                               /* Cx */
+  U8_TOO_SHORT,                                             /* Dx */
+  U8_TOO_SHORT|U8_OVERLONG_3|U8_SURROGATE,                  /* Ex */
+  U8_TOO_SHORT|U8_TOO_LARGE|U8_TOO_LARGE_1000|U8_OVERLONG_4 /* Fx */
+};
+
+static const pcre_uint8 utf8_byte1_low[16] = {
+  U8_CARRY|U8_OVERLONG_2|U8_OVERLONG_3|U8_OVERLONG_4,       /* x0 */
+  U8_CARRY|U8_OVERLONG_2,                                   /* x1 */
+  U8_CARRY, U8_CARRY,                                       /* x2, x3 */
+  U8_CARRY|U8_TOO_LARGE,                                    /* x4 */
+  U8_BIG, U8_BIG, U8_BIG, U8_BIG, U8_BIG, U8_BIG, U8_BIG,   /* x5 - xB */
+  U8_BIG, U8_BIG|U8_SURROGATE, U8_BIG, U8_BIG               /* xC - xF */
+};
+
+static const pcre_uint8 utf8_byte2_high[16] = {
+  U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,   /* 0x */
+  U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,   /* 7x */
+  U8_TOO_LONG|U8_OVERLONG_2|U8_TWO_CONTS|U8_OVERLONG_3|     /* 8x */
+    U8_TOO_LARGE_1000|U8_OVERLONG_4,
+  U8_TOO_LONG|U8_OVERLONG_2|U8_TWO_CONTS|U8_OVERLONG_3|     /* 9x */
+    U8_TOO_LARGE,
+  U8_TOO_LONG|U8_OVERLONG_2|U8_TWO_CONTS|U8_SURROGATE|      /* Ax */
+    U8_TOO_LARGE,
+  U8_TOO_LONG|U8_OVERLONG_2|U8_TWO_CONTS|U8_SURROGATE|      /* Bx */
+    U8_TOO_LARGE,
+  U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT    /* Cx - Fx */
+};
+
+
+/* Move back from the end of the checked bytes to the start of a character
+that may not have been finished. */
+
+static PCRE_PUCHAR
+utf8_boundary(PCRE_PUCHAR start, PCRE_PUCHAR ptr)
+{
+int i;
+for (i = 1; i <= 3 && ptr - i >= start; i++)
+  {
+  pcre_uint8 c = ptr[-i];
+  if (c < 0x80) break;
+  if (c >= 0xc0) return ptr - i;
+  }
+return ptr;
+}
+
+
+/* Arguments:
+  ptr          the start of the subject
+  end          the end of the subject
+
+Returns:       pointer to the first character not yet checked
+*/
+
+static PCRE_PUCHAR
+scan_utf8_sse2(PCRE_PUCHAR ptr, PCRE_PUCHAR end)
+{
+/* Without SSSE3 there is no byte shuffle for the table lookups, so only the
+leading ASCII is skipped. */
+
+while (end - ptr >= 16 &&
+    _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ptr)) == 0)
+  ptr += 16;
+return ptr;
+}
+
+#ifdef SCAN_SSSE3
+static SCAN_TARGET("ssse3") PCRE_PUCHAR
+scan_utf8_ssse3(PCRE_PUCHAR ptr, PCRE_PUCHAR end)
+{
+PCRE_PUCHAR start = ptr;
+const __m128i byte1_high = _mm_loadu_si128((const __m128i *)utf8_byte1_high);
+const __m128i byte1_low = _mm_loadu_si128((const __m128i *)utf8_byte1_low);
+const __m128i byte2_high = _mm_loadu_si128((const __m128i *)utf8_byte2_high);
+const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+const __m128i third_byte = _mm_set1_epi8((char)(0xe0 - 0x80));
+const __m128i fourth_byte = _mm_set1_epi8((char)(0xf0 - 0x80));
+const __m128i top_bit = _mm_set1_epi8((char)0x80);
+const __m128i zero = _mm_setzero_si128();
+__m128i prev = zero;
+int prev_ascii = TRUE;
+
+while (end - ptr >= 16)
+  {
+  __m128i data = _mm_loadu_si128((const __m128i *)ptr);
+  int ascii = _mm_movemask_epi8(data) == 0;
+
+  /* An ASCII block needs checking only to catch a character that the block
+  before it left unfinished. */
+
+  if (!ascii || !prev_ascii)
+    {
+    __m128i prev1 = _mm_alignr_epi8(data, prev, 15);
+    __m128i prev2 = _mm_alignr_epi8(data, prev, 14);
+    __m128i prev3 = _mm_alignr_epi8(data, prev, 13);
+    __m128i special = _mm_and_si128(_mm_and_si128(
+      _mm_shuffle_epi8(byte1_high,
+        _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble_mask)),
+      _mm_shuffle_epi8(byte1_low, _mm_and_si128(prev1, nibble_mask))),
+      _mm_shuffle_epi8(byte2_high,
+        _mm_and_si128(_mm_srli_epi16(data, 4), nibble_mask)));
+    __m128i continued = _mm_and_si128(_mm_or_si128(
+      _mm_subs_epu8(prev2, third_byte), _mm_subs_epu8(prev3, fourth_byte)),
+      top_bit);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_xor_si128(special, continued),
+        zero)) != 0xffff)
+      break;
+    }
+
+  prev = data;
+  prev_ascii = ascii;
+  ptr += 16;
+  }
+
+return utf8_boundary(start, ptr);
+}
+#endif  /* SCAN_SSSE3 */
+
+#ifdef SCAN_AVX2
+static SCAN_TARGET("avx2") PCRE_PUCHAR
+scan_utf8_avx2(PCRE_PUCHAR ptr, PCRE_PUCHAR end)
+{
+PCRE_PUCHAR start = ptr;
+const __m128i b1h = _mm_loadu_si128((const __m128i *)utf8_byte1_high);
+const __m128i b1l = _mm_loadu_si128((const __m128i *)utf8_byte1_low);
+const __m128i b2h = _mm_loadu_si128((const __m128i *)utf8_byte2_high);
+const __m256i byte1_high = _mm256_inserti128_si256(
+  _mm256_castsi128_si256(b1h), b1h, 1);
+const __m256i byte1_low = _mm256_inserti128_si256(
+  _mm256_castsi128_si256(b1l), b1l, 1);
+const __m256i byte2_high = _mm256_inserti128_si256(
+  _mm256_castsi128_si256(b2h), b2h, 1);
+const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+const __m256i third_byte = _mm256_set1_epi8((char)(0xe0 - 0x80));
+const __m256i fourth_byte = _mm256_set1_epi8((char)(0xf0 - 0x80));
+const __m256i top_bit = _mm256_set1_epi8((char)0x80);
+const __m256i zero = _mm256_setzero_si256();
+__m256i prev = zero;
+int prev_ascii = TRUE;
+
+while (end - ptr >= 32)
+  {
+  __m256i data = _mm256_loadu_si256((const __m256i *)ptr);
+  int ascii = _mm256_movemask_epi8(data) == 0;
+
+  if (!ascii || !prev_ascii)
+    {
+    /* The byte shifts work within each 128-bit lane, so the lane before each
+    lane is made up first: the top of prev, then the bottom of data. */
+
+    __m256i before = _mm256_permute2x128_si256(prev, data, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(data, before, 15);
+    __m256i prev2 = _mm256_alignr_epi8(data, before, 14);
+    __m256i prev3 = _mm256_alignr_epi8(data, before, 13);
+    __m256i special = _mm256_and_si256(_mm256_and_si256(
+      _mm256_shuffle_epi8(byte1_high,
+        _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble_mask)),
+      _mm256_shuffle_epi8(byte1_low, _mm256_and_si256(prev1, nibble_mask))),
+      _mm256_shuffle_epi8(byte2_high,
+        _mm256_and_si256(_mm256_srli_epi16(data, 4), nibble_mask)));
+    __m256i continued = _mm256_and_si256(_mm256_or_si256(
+      _mm256_subs_epu8(prev2, third_byte),
+      _mm256_subs_epu8(prev3, fourth_byte)), top_bit);
+    if (!_mm256_testz_si256(_mm256_xor_si256(special, continued),
+        _mm256_xor_si256(special, continued)))
+      break;
+    }
+
+  prev = data;
+  prev_ascii = ascii;
+  ptr += 32;
+  }
+
+return utf8_boundary(start, ptr);
+}
+#endif  /* SCAN_AVX2 */
+
+
+
+/*************************************************
+*      Skip a valid stretch of UTF-8             *
+*************************************************/
+
+/* This is called by PRIV(valid_utf) for subjects of at least SCAN_SIMD_MIN
+bytes.
+
+Arguments:
+  ptr          the start of the subject
+  end          the end of the subject
+
+Returns:       pointer to the start of a character such that all the bytes
+               before it are valid UTF-8
+*/
+
+PCRE_PUCHAR
+PRIV(scan_utf8)(PCRE_PUCHAR ptr, PCRE_PUCHAR end)
+{
+#ifdef SCAN_AVX2
+if (scan_get_level() >= SCAN_LEVEL_AVX2) return scan_utf8_avx2(ptr, end);
+#endif
+#ifdef SCAN_SSSE3
+if (scan_get_level() >= SCAN_LEVEL_SSSE3) return scan_utf8_ssse3(ptr, end);
+#endif
+return scan_utf8_sse2(ptr, end);
+}
+#endif  /* SCAN_SIMD */
+
+
+
+/*************************************************
+*      Scan for a code unit or its other case    *
+*************************************************/
+
+/* This is used for a pattern's first code unit and for its "required" code
+unit. When there is no other case, c1 and c2 are the same.
+
+Arguments:
+  ptr          where to start
+  end          end of the subject
+  c1, c2       the code units to look for
+
+Returns:       pointer to the first c1 or c2, or end if there is none
+*/
+
+PCRE_PUCHAR
+PRIV(scan_char)(PCRE_PUCHAR ptr, PCRE_PUCHAR end, pcre_uint32 c1,
+  pcre_uint32 c2)
+{
+pcre_uint32 c;
+
+#ifdef SCAN_SIMD
+if (end - ptr >= SCAN_SIMD_MIN)
+  {
+#ifdef SCAN_AVX2
+  if (scan_get_level() >= SCAN_LEVEL_AVX2)
+    ptr = scan_char_avx2(ptr, end, c1, c2);
+  else
+#endif
+  ptr = scan_char_sse2(ptr, end, c1, c2);
+  }
+#endif
+
+if (c1 == c2)
+  {
+  while (ptr < end && UCHAR21TEST(ptr) != c1) ptr++;
+  }
+else
+  {
+  while (ptr < end && (c = UCHAR21TEST(ptr)) != c1 && c != c2) ptr++;
+  }
+return ptr;
+}
+
+
+
+/*************************************************
+*      Set up and prepare a start_bits scanner   *
+*************************************************/
+
+/* PRIV(scan_bits_init) just remembers the map; PRIV(scan_bits_prepare) builds
+the nibble table used by the vector loops. The JIT compiler calls both at
+compile time; the interpreters leave the second to PRIV(scan_bits), which
+calls it only when a long enough stretch of subject turns up.
+
+Arguments:
+  sb           the scanner structure
+  start_bits   the 256-bit map of possible starting code units
+
+Returns:       nothing
+*/
+
+void
+PRIV(scan_bits_init)(pcre_scan_bits *sb, const pcre_uint8 *start_bits)
+{
+sb->start_bits = start_bits;
+sb->prepared = FALSE;
+}
+
+void
+PRIV(scan_bits_prepare)(pcre_scan_bits *sb)
+{
+int c;
+memset(sb->nibbles, 0, sizeof(sb->nibbles));
+for (c = 0; c < 256; c++)
+  {
+  if ((sb->start_bits[c/8] & (1 << (c&7))) != 0)
+    sb->nibbles[(c & 0x0f) + ((c & 0x80) >> 3)] |= 1 << ((c >> 4) & 7);
+  }
+sb->prepared = TRUE;
+}
+
+
+
+/*************************************************
+*        Scan for a code unit in start_bits      *
+*************************************************/
+
+/* In the 16-bit and 32-bit libraries, code units above 255 share the bit for
+255, as they do everywhere else that start_bits is used.
+
+Arguments:
+  ptr          where to start
+  end          end of the subject
+  sb           the scanner structure
+
+Returns:       pointer to the first code unit whose bit is set, or end
+*/
+
+PCRE_PUCHAR
+PRIV(scan_bits)(PCRE_PUCHAR ptr, PCRE_PUCHAR end, pcre_scan_bits *sb)
+{
+const pcre_uint8 *start_bits = sb->start_bits;
+
+#ifdef SCAN_SIMD
+if (end - ptr >= SCAN_SIMD_MIN && scan_get_level() >= SCAN_LEVEL_SSSE3)
+  {
+  if (!sb->prepared) PRIV(scan_bits_prepare)(sb);
+#ifdef SCAN_AVX2
+  if (scan_get_level() >= SCAN_LEVEL_AVX2)
+    ptr = scan_bits_avx2(ptr, end, sb->nibbles);
+  else
+#endif
+#ifdef SCAN_SSSE3
+  ptr = scan_bits_ssse3(ptr, end, sb->nibbles);
+#endif
+  }
+#endif
+
+while (ptr < end)
+  {
+  register pcre_uint32 c = UCHAR21TEST(ptr);
+#ifndef COMPILE_PCRE8
+  if (c > 255) c = 255;
+#endif
+  if ((start_bits[c/8] & (1 << (c&7))) != 0) break;
+  ptr++;
+  }
+return ptr;
+}
+
+/* End of pcre_scan.c */
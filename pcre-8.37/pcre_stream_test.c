@@ -0,0 +1,285 @@
+/*************************************************
+*      Perl-Compatible Regular Expressions       *
+*************************************************/
+
+/* PCRE is a library of functions to support regular expressions whose syntax
+and semantics are as close as possible to those of the Perl 5 language.
+
+                       Written by Philip Hazel
+           Copyright (c) 1997-2015 University of Cambridge
+
+-----------------------------------------------------------------------------
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of the University of Cambridge nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+-----------------------------------------------------------------------------
+*/
+
+
+/* This program checks the DFA stream functions. Each subject is matched in one
+piece with pcre_dfa_exec(), and then passed to a stream in chunks of every
+possible size, and in chunks of varying size. The matches found must be the
+same every time. The patterns avoid the things that cannot see back across a
+chunk boundary (lookbehinds, \b, and ^ in multiline mode). */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include "pcre.h"
+
+#define MAX_MATCHES 64
+
+/* A long run of letters, for unfinished matches that fail far from where they
+started */
+
+#define EIGHT   "abcdefgh"
+#define SIXTY4  EIGHT EIGHT EIGHT EIGHT EIGHT EIGHT EIGHT EIGHT
+#define LETTERS SIXTY4 SIXTY4 SIXTY4 SIXTY4 SIXTY4 SIXTY4
+
+typedef struct stream_test {
+  const char *pattern;
+  int options;
+  const char *subject;
+} stream_test;
+
+static stream_test tests[] = {
+  { "abc", 0, "xxabcxxabcabc" },
+  { "dog(sbody)?", 0, "dogsbody dogsbx dog dogsbod" },
+  { "1234|3789", 0, "ABC1237890 12341234" },
+  { "\\d?\\d(jan|feb|mar|apr)\\d\\d", 0, "23jan05 1feb99 ug23 aug23 12mar1" },
+  { "a+b*", 0, "xaaaabbbyaab a" },
+  { "x*", 0, "abxxcx" },
+  { "", 0, "abc" },
+  { "[a-z]+\\d{2,4}", PCRE_CASELESS, "ab12 CD123456 ef1 gh" },
+  { "line\\d+$", PCRE_MULTILINE, "line1\nline22\nline3x\nline4" },
+  { "(?s)<\\w+>.*?</\\w+>", 0, "<a>x</a> <bb>y\ny</bb> <c>" },
+  { "end\\z", 0, "end end" },
+  { "x[a-z]*y|gha", 0, "x" LETTERS "1 x" LETTERS "y xay" },
+#ifdef SUPPORT_UTF
+  { "\\x{e9}+", PCRE_UTF8, "ab\xc3\xa9\xc3\xa9x\xc3\xa9" },
+  { ".\\x{10400}", PCRE_UTF8, "a\xf0\x90\x90\x80" "b\xc3\xa9\xf0\x90\x90\x80" },
+  { "\\w\\W", PCRE_UTF8, "\xe6\x92\xad\xe2\x80\xa8x\xc2\xa1" },
+#endif
+  { NULL, 0, NULL }
+};
+
+/* Matches found, as pairs of offsets */
+
+typedef struct match_list {
+  int count;
+  unsigned long int offsets[2 * MAX_MATCHES];
+} match_list;
+
+
+
+/*************************************************
+*          Record a match from a stream          *
+*************************************************/
+
+static int
+record_match(void *data, unsigned long int start, unsigned long int end)
+{
+match_list *list = (match_list *)data;
+if (list->count >= MAX_MATCHES) return 1;
+list->offsets[2 * list->count] = start;
+list->offsets[2 * list->count + 1] = end;
+list->count++;
+return 0;
+}
+
+
+
+/*************************************************
+*      Find all the matches in one piece         *
+*************************************************/
+
+static int
+match_whole(const pcre *re, const stream_test *t, match_list *list)
+{
+int workspace[1000];
+int offsets[3];
+int length = (int)strlen(t->subject);
+int start = 0;
+
+list->count = 0;
+while (start <= length)
+  {
+  int rc = pcre_dfa_exec(re, NULL, t->subject, length, start, 0, offsets, 3,
+    workspace, 1000);
+  if (rc == PCRE_ERROR_NOMATCH) break;
+  if (rc < 0) return rc;
+  if (record_match(list, offsets[0], offsets[1]) != 0) return -1;
+  start = offsets[1];
+  if (offsets[0] == offsets[1])
+    {
+    if (start >= length) break;
+    start++;
+    if ((t->options & PCRE_UTF8) != 0)
+      while (start < length && (t->subject[start] & 0xc0) == 0x80) start++;
+    }
+  }
+return 0;
+}
+
+
+
+/*************************************************
+*      Pass a subject to a stream in chunks      *
+*************************************************/
+
+/* Arguments:
+  stream      the stream
+  t           the test
+  sizes       chunk sizes, used in rotation
+  nsizes      number of sizes
+  list        where to put the matches
+
+Returns:      0 or an error code
+*/
+
+static int
+match_stream(pcre_dfa_stream *stream, const stream_test *t, const int *sizes,
+  int nsizes, match_list *list)
+{
+int length = (int)strlen(t->subject);
+int offset = 0;
+int i = 0;
+int rc;
+
+list->count = 0;
+while (offset < length)
+  {
+  int size = sizes[i++ % nsizes];
+  if (size > length - offset) size = length - offset;
+  rc = pcre_dfa_stream_feed(stream, t->subject + offset, size, record_match,
+    list);
+  if (rc != 0) return rc;
+  offset += size;
+  }
+return pcre_dfa_stream_finish(stream, record_match, list);
+}
+
+
+
+/*************************************************
+*          Compare two lists of matches          *
+*************************************************/
+
+static int
+same_matches(const match_list *a, const match_list *b)
+{
+int i;
+if (a->count != b->count) return 0;
+for (i = 0; i < 2 * a->count; i++)
+  if (a->offsets[i] != b->offsets[i]) return 0;
+return 1;
+}
+
+static void
+show_matches(const char *title, const match_list *list)
+{
+int i;
+printf("  %s:", title);
+for (i = 0; i < list->count; i++)
+  printf(" %lu-%lu", list->offsets[2 * i], list->offsets[2 * i + 1]);
+printf("\n");
+}
+
+
+
+/*************************************************
+*                Main program                    *
+*************************************************/
+
+int
+main(void)
+{
+static const int varying[] = { 1, 3, 2, 5, 4, 7 };
+stream_test *t;
+int failed = 0;
+int count = 0;
+
+for (t = tests; t->pattern != NULL; t++)
+  {
+  const char *error;
+  int erroroffset, rc, size;
+  int length = (int)strlen(t->subject);
+  match_list whole, chunked;
+  pcre_dfa_stream *stream;
+  pcre *re = pcre_compile(t->pattern, t->options, &error, &erroroffset, NULL);
+
+  if (re == NULL)
+    {
+    printf("/%s/: compile failed: %s\n", t->pattern, error);
+    failed++;
+    continue;
+    }
+
+  stream = pcre_dfa_stream_create(re, NULL, 0, 0, &rc);
+  if (stream == NULL || match_whole(re, t, &whole) != 0)
+    {
+    printf("/%s/: setup failed (%d)\n", t->pattern, rc);
+    failed++;
+    pcre_free(re);
+    continue;
+    }
+
+  for (size = 0; size <= length; size++)
+    {
+    const int *sizes = (size == 0)? varying : &size;
+    int nsizes = (size == 0)? (int)(sizeof(varying)/sizeof(int)) : 1;
+
+    count++;
+    rc = match_stream(stream, t, sizes, nsizes, &chunked);
+    if (rc != 0 || !same_matches(&whole, &chunked))
+      {
+      if (size == 0) printf("/%s/ in varying chunks: ", t->pattern);
+        else printf("/%s/ in chunks of %d: ", t->pattern, size);
+      if (rc != 0) printf("error %d\n", rc); else printf("mismatch\n");
+      show_matches("whole", &whole);
+      show_matches("stream", &chunked);
+      pcre_dfa_stream_reset(stream);
+      failed++;
+      }
+    }
+
+  pcre_dfa_stream_free(stream);
+  pcre_free(re);
+  }
+
+if (failed > 0)
+  {
+  printf("%d of %d stream tests failed\n", failed, count);
+  return 1;
+  }
+printf("All %d stream tests passed\n", count);
+return 0;
+}
+
+/* End of pcre_stream_test.c */
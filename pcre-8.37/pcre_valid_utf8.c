@@ -115,7 +115,20 @@ if (length < 0)
   length = (int)(p - string);
   }
 
-for (p = string; length-- > 0; p++)
+/* For a long string, let the vector code skip the part that is certainly
+valid. Anything it does not pass, including any error, is then checked here in
+the usual way, so the error codes and offsets are the same as before. */
+
+p = string;
+#ifdef SCAN_SIMD
+if (length >= SCAN_SIMD_MIN)
+  {
+  p = PRIV(scan_utf8)(string, string + length);
+  length -= (int)(p - string);
+  }
+#endif
+
+for (; length-- > 0; p++)
   {
   register pcre_uchar ab, c, d;
 
@@ -298,4 +311,33 @@ for (p = string; length-- > 0; p++)
 return PCRE_UTF8_ERR0;   /* This indicates success */
 }
 
+
+
+/*************************************************
+*    Validate a UTF-8 subject for later use     *
+*************************************************/
+
+/* This is the public interface to the check above. An application that
+matches one subject against many patterns can check it once here, and then
+pass PCRE_NO_UTF8_CHECK to every match, instead of having the whole
+subject checked again for every pattern. Without UTF support, every string is
+accepted, as it is by the matching functions.
+
+Arguments:
+  string       points to the string
+  length       length of string, or -1 if the string is zero-terminated
+  erroroffset  pointer to an error position offset variable
+
+Returns:       = 0    if the string is a valid UTF-8 string
+               > 0    otherwise, setting the offset of the bad character
+               PCRE_ERROR_NULL if string or erroroffset is NULL
+*/
+
+PCRE_EXP_DEFN int PCRE_CALL_CONVENTION
+pcre_valid_utf8(PCRE_SPTR string, int length, int *erroroffset)
+{
+if (string == NULL || erroroffset == NULL) return PCRE_ERROR_NULL;
+return PRIV(valid_utf)((PCRE_PUCHAR)string, length, erroroffset);
+}
+
 /* End of pcre_valid_utf8.c */
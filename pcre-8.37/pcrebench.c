@@ -0,0 +1,1530 @@
+/*************************************************
+*            PCRE performance measurement        *
+*************************************************/
+
+/* This program times the PCRE matching functions on a fixed set of patterns
+and subjects, so that the effect of changes to the library can be measured. It
+is not a test program: it checks only that the different ways of running each
+pattern agree about the number of matches.
+
+The first set of measurements concerns the frames that pcre_exec() uses when
+it is compiled with NO_RECURSE. Each backtracking-heavy pattern is run with the
+frames obtained afresh for each call, and again with a frame arena that is kept
+from one call to the next. When NO_RECURSE is not defined the two figures should
+be the same, because the arena is not used.
+
+The second set compares matching a large log-like text in one piece with
+pcre_dfa_exec() against passing it in chunks to a DFA stream. The throughput
+and the memory needed are shown for each; for the stream, the memory is the
+chunk buffer plus the most that PCRE itself had allocated at any one time.
+
+The third set concerns the UTF-8 check that is done at the start of each match.
+A large UTF-8 text is checked on its own, and then a batch of patterns, each of
+which matches near the start, is run against it, first letting each match check
+the text and then checking it once with pcre_valid_utf8() and passing
+PCRE_NO_UTF8_CHECK. Building with and without SIMD support shows the effect of
+the vector code on the check.
+
+The fourth set concerns the start-up cost of a program that needs a large set
+of patterns. The patterns are compiled and studied, with and without JIT, and
+are then saved in a bundle file. The time to open the bundle and fetch every
+pattern is shown, with JIT compilation for all of them and for only a few, as
+happens when a program uses only some of the patterns it loads.
+
+The fifth set concerns the search for a point at which a match can start, in
+a pattern with a known first character, a known string of first characters,
+fixed characters with others between them (the first of which is rare in one
+case and frequent in another), a caseless first character, or a set of starting
+characters. None of the patterns matches a large log-like text, so each call
+searches the whole of it. Building with and without SIMD support shows the
+effect of the vector scanners.
+
+The sixth set compares the three ways of matching: pcre_exec() interpreting
+the compiled pattern, pcre_exec() running JIT code, and pcre_dfa_exec(). Each
+pattern in a small corpus (literals, alternations, backtracking-heavy patterns,
+Unicode classes, anchored and unanchored) is matched repeatedly across the
+whole of a log-like or UTF-8 text to count every match, as a grep-like program
+would. For each pattern and engine the matches per second, the time per byte
+of subject, the time to compile and study the pattern, and the memory used are
+shown. The memory is the size of the compiled and studied pattern plus the most
+that PCRE allocated during a match (and the workspace, for pcre_dfa_exec()).
+The results can be written as CSV with -c, and a file written in this way can
+be given to a later run with -b, which then shows the change for each result
+and fails if any is worse by more than the threshold set by -t. A compile time
+must also be worse by more than a couple of microseconds, as a percentage of
+so short a time is mostly noise.
+
+-----------------------------------------------------------------------------
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of the University of Cambridge nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+-----------------------------------------------------------------------------
+*/
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "pcre.h"
+
+#define OVECCOUNT 30
+#define WSCOUNT   1000
+
+#define ENGINE_SIZE   (1024*1024)   /* Size of the engine subjects */
+#define ENGINE_TIME   0.2           /* Minimum time for each engine result */
+#define SCAN_PASSES   5             /* Scan times are the best of these */
+#define COMPILE_BATCHES 5           /* Compile times are the best of these */
+#define COMPILE_SLACK 2.0           /* Compile time changes (us) to ignore */
+#define MAX_BASELINE  256           /* Maximum rows in a baseline file */
+
+
+/* Each case is a pattern and a subject that is made by repeating one unit a
+number of times, then a second unit a number of times, and then adding a tail.
+The cases are chosen so that there is no required character that would let
+pcre_exec() give up before doing any real work. */
+
+typedef struct bench_case {
+  const char *name;
+  const char *pattern;
+  const char *unit1;
+  int repeat1;
+  const char *unit2;
+  int repeat2;
+  const char *tail;
+} bench_case;
+
+static bench_case frame_cases[] = {
+  { "nested-recursion", "^(a(?1)?b)$",           "a", 300, "b", 300, "" },
+  { "csv-fields",       "^(.*?,){11}[PQ]",       "1,2,3,", 4, "", 0, "x" },
+  { "alternation-star", "^(?:a|b|ab)*[cd]",      "ab", 12, "", 0, "x" },
+  { "word-list",        "^(\\w+\\s?)*$",         "word ", 4, "", 0, "!" },
+  { "lazy-tags",        "(?s)<(.*?)>(.*?)</\\1>", "<x>xx", 40, "", 0, "</y>" },
+  { "group-repeat",     "^((a+)b?)+$",           "aab", 12, "", 0, "c" },
+  { NULL, NULL, NULL, 0, NULL, 0, NULL }
+};
+
+
+
+/* Patterns for the stream measurements, and the chunk sizes to use */
+
+static const char *stream_patterns[] = {
+  "ERROR [0-9]+",
+  "\\d+\\.\\d+\\.\\d+\\.\\d+ ",
+  "(GET|POST) /[a-z]+/\\d+7 ",
+  NULL
+};
+
+static const int stream_chunks[] = { 512, 4096, 65536, 0 };
+
+/* Words for the UTF-8 text, and patterns for the UTF-8 batch */
+
+static const char *utf8_words[] = {
+  "the", "caf\xc3\xa9", "na\xc3\xafve", "Stra\xc3\x9f" "e", "\xce\xb1\xce\xb2",
+  "\xe6\x97\xa5\xe6\x9c\xac", "price", "\xe2\x82\xac" "42", "\xf0\x9f\x98\x80", "quick",
+  "brown", "fox", NULL
+};
+
+static const char *utf8_patterns[] = {
+  "caf\\x{e9}",
+  "\\x{20ac}\\d+",
+  "[\\x{3b1}-\\x{3c9}]+",
+  "\\x{1f600}",
+  "qu\\w+",
+  "\\x{65e5}.",
+  "(fox|dog) ",
+  "Stra\\x{df}e",
+  NULL
+};
+
+/* Pieces from which the patterns for the bundle measurements are made. Each
+pattern is one prefix, one middle, and one suffix. */
+
+static const char *bundle_prefixes[] = {
+  "^", "\\b", "(?i)", "(?:^|\\s)", "[A-Z]", NULL
+};
+
+static const char *bundle_middles[] = {
+  "user", "host\\d+", "(GET|POST|PUT)", "[a-z]+@[a-z]+\\.com", "id=\\d{4,8}",
+  "(?:error|warn|fatal)", "\\d+\\.\\d+\\.\\d+\\.\\d+", "[0-9a-f]{8}-[0-9a-f]{4}",
+  "(\\w+)=(\\w+)", "https?://[^/\\s]+", NULL
+};
+
+static const char *bundle_suffixes[] = {
+  "$", ":\\s*\\S+", "(?=\\s)", "\\d*", "[.,;]?", "/[a-z]+", "(?:\\s+\\w+){1,3}",
+  "\\b", "+", "\\)", NULL
+};
+
+/* The corpus for the engine comparison. Each case is matched against the
+log-like text or the UTF-8 text. Cases that set PCRE_UTF8 or PCRE_UCP are
+skipped if the library does not support them. */
+
+#define SUBJECT_LOG   0
+#define SUBJECT_UTF8  1
+
+typedef struct engine_case {
+  const char *name;
+  const char *pattern;
+  int options;
+  int subject;
+} engine_case;
+
+static engine_case engine_cases[] = {
+  { "literal",          "ERROR",              0,              SUBJECT_LOG },
+  { "literal-rare",     "/login/999",         0,              SUBJECT_LOG },
+  { "literal-caseless", "post /api/",         PCRE_CASELESS,  SUBJECT_LOG },
+  { "alternation",      "GET|POST|HEAD",      0,              SUBJECT_LOG },
+  { "word-alternation", "\\b(?:index|images|static)/\\d+ [45]",
+                                              0,              SUBJECT_LOG },
+  { "ip-address",       "\\d{1,3}\\.\\d{1,3}\\.\\d{1,3}\\.\\d{1,3}",
+                                              0,              SUBJECT_LOG },
+  { "time",             "[01]\\d:[0-5]\\d:[0-5]\\d",
+                                              0,              SUBJECT_LOG },
+  { "line-backtrack",   "^.*WARN.*images.*[45]\\d\\d$",
+                                              PCRE_MULTILINE, SUBJECT_LOG },
+  { "nested-repeat",    "(?:[a-z]+/?)+\\d{4} 4",
+                                              0,              SUBJECT_LOG },
+  { "backreference",    "(\\d)\\1\\1",        0,              SUBJECT_LOG },
+  { "anchored-start",   "^2015-04-28 0\\d:",  PCRE_MULTILINE, SUBJECT_LOG },
+  { "anchored-end",     " 404$",              PCRE_MULTILINE, SUBJECT_LOG },
+  { "utf8-literal",     "caf\\x{e9}",         PCRE_UTF8,      SUBJECT_UTF8 },
+  { "utf8-class",       "[\\x{3b1}-\\x{3c9}]+",
+                                              PCRE_UTF8,      SUBJECT_UTF8 },
+  { "unicode-letters",  "\\p{L}{6,}",         PCRE_UTF8|PCRE_UCP,
+                                                              SUBJECT_UTF8 },
+  { "unicode-script",   "\\p{Greek}+|\\p{Han}+",
+                                              PCRE_UTF8|PCRE_UCP,
+                                                              SUBJECT_UTF8 },
+  { "unicode-word",     "\\b\\w+e\\b",        PCRE_UTF8|PCRE_UCP,
+                                                              SUBJECT_UTF8 },
+  { NULL, NULL, 0, 0 }
+};
+
+#define ENGINE_INTERP 0
+#define ENGINE_JIT    1
+#define ENGINE_DFA    2
+#define ENGINE_COUNT  3
+
+static const char *engine_names[] = { "interp", "jit", "dfa" };
+
+/* Patterns for the scan measurements. None of them matches the log-like text,
+so each call looks for a starting point over the whole of it. */
+
+static engine_case scan_cases[] = {
+  { "first-char",       "Z\\d+",              0,              SUBJECT_LOG },
+  { "first-chars",      "Zebra\\d",           0,              SUBJECT_LOG },
+  { "spaced-chars",     "Z\\d\\dq",             0,              SUBJECT_LOG },
+  { "spaced-frequent",  ":\\d\\dZ",             0,              SUBJECT_LOG },
+  { "caseless-char",    "q\\d+",              PCRE_CASELESS,  SUBJECT_LOG },
+  { "start-bits",       "[#%&]\\d",           0,              SUBJECT_LOG },
+  { NULL, NULL, 0, 0 }
+};
+
+/* One result of the engine comparison, and a row of a baseline file */
+
+typedef struct engine_result {
+  int matches;
+  double matches_per_sec;
+  double ns_per_byte;
+  double compile_us;
+  unsigned long int memory;
+} engine_result;
+
+typedef struct baseline_row {
+  char name[32];
+  char engine[8];
+  engine_result result;
+} baseline_row;
+
+#define BUNDLE_FILE "pcrebench.bundle"
+#define BUNDLE_SOME 20
+#define BUNDLE_ROUNDS 5
+
+/* The stream measurements count the memory that PCRE obtains. */
+
+typedef union mem_header {
+  size_t size;
+  double align_d;
+  void *align_p;
+} mem_header;
+
+static size_t mem_current = 0;
+static size_t mem_peak = 0;
+
+
+
+/*************************************************
+*             Read a monotonic clock             *
+*************************************************/
+
+/* Returns: the time in seconds from an arbitrary starting point */
+
+static double
+now(void)
+{
+#if defined _WIN32
+LARGE_INTEGER count, frequency;
+QueryPerformanceCounter(&count);
+QueryPerformanceFrequency(&frequency);
+return (double)count.QuadPart / (double)frequency.QuadPart;
+#elif defined CLOCK_MONOTONIC
+struct timespec ts;
+clock_gettime(CLOCK_MONOTONIC, &ts);
+return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#else
+return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+
+
+/*************************************************
+*           Build the subject for a case         *
+*************************************************/
+
+/* Arguments:
+  bc          the case
+  lengthptr   where to return the length
+
+Returns:      a malloc'd subject, or NULL if no memory
+*/
+
+static char *
+make_subject(const bench_case *bc, int *lengthptr)
+{
+size_t len1 = strlen(bc->unit1);
+size_t len2 = strlen(bc->unit2);
+size_t taillen = strlen(bc->tail);
+size_t length = len1 * bc->repeat1 + len2 * bc->repeat2 + taillen;
+char *subject = (char *)malloc(length + 1);
+char *p = subject;
+int i;
+
+if (subject == NULL) return NULL;
+for (i = 0; i < bc->repeat1; i++, p += len1) memcpy(p, bc->unit1, len1);
+for (i = 0; i < bc->repeat2; i++, p += len2) memcpy(p, bc->unit2, len2);
+memcpy(p, bc->tail, taillen + 1);
+*lengthptr = (int)length;
+return subject;
+}
+
+
+
+/*************************************************
+*       Time repeated calls of pcre_exec()       *
+*************************************************/
+
+/* Arguments:
+  re          the compiled pattern
+  extra       extra data, or NULL
+  subject     the subject
+  length      the subject length
+  count       the number of calls
+  matchptr    where to return the number of matching calls
+
+Returns:      the elapsed time in seconds
+*/
+
+static double
+time_exec(const pcre *re, const pcre_extra *extra, const char *subject,
+  int length, int count, int *matchptr)
+{
+int ovector[OVECCOUNT];
+int i, matches = 0;
+double start = now();
+
+for (i = 0; i < count; i++)
+  {
+  if (pcre_exec(re, extra, subject, length, 0, 0, ovector, OVECCOUNT) >= 0)
+    matches++;
+  }
+
+*matchptr = matches;
+return now() - start;
+}
+
+
+
+/*************************************************
+*          Measure the frame arena               *
+*************************************************/
+
+/* Argument:  the number of calls of pcre_exec() for each case
+   Returns:   0 if all went well, 1 otherwise
+*/
+
+static int
+bench_frames(int count)
+{
+bench_case *bc;
+pcre_frame_arena *arena = pcre_frame_arena_alloc();
+int yield = 0;
+
+if (arena == NULL)
+  {
+  fprintf(stderr, "pcre-bench: failed to create a frame arena\n");
+  return 1;
+  }
+
+printf("%-18s %8s %12s %12s %8s\n", "frames", "calls", "fresh us",
+  "arena us", "ratio");
+
+for (bc = frame_cases; bc->name != NULL; bc++)
+  {
+  const char *error;
+  int erroroffset, length, m1, m2;
+  double t1, t2;
+  pcre_extra extra;
+  pcre *re = pcre_compile(bc->pattern, 0, &error, &erroroffset, NULL);
+  char *subject;
+
+  if (re == NULL)
+    {
+    fprintf(stderr, "pcre-bench: %s: %s at offset %d\n", bc->name, error,
+      erroroffset);
+    yield = 1;
+    continue;
+    }
+
+  subject = make_subject(bc, &length);
+  if (subject == NULL)
+    {
+    fprintf(stderr, "pcre-bench: malloc failed\n");
+    pcre_free(re);
+    yield = 1;
+    break;
+    }
+
+  memset(&extra, 0, sizeof(extra));
+  extra.flags = PCRE_EXTRA_FRAME_ARENA;
+  extra.frame_arena = arena;
+
+  t1 = time_exec(re, NULL, subject, length, count, &m1);
+  t2 = time_exec(re, &extra, subject, length, count, &m2);
+
+  if (m1 != m2)
+    {
+    fprintf(stderr, "pcre-bench: %s: %d matches without arena, %d with\n",
+      bc->name, m1, m2);
+    yield = 1;
+    }
+
+  printf("%-18s %8d %12.3f %12.3f %8.2f\n", bc->name, count,
+    t1 * 1e6 / count, t2 * 1e6 / count, (t2 > 0)? t1 / t2 : 0.0);
+
+  free(subject);
+  pcre_free(re);
+  }
+
+pcre_frame_arena_free(arena);
+return yield;
+}
+
+
+
+/*************************************************
+*       Memory functions that keep count         *
+*************************************************/
+
+static void *
+counting_malloc(size_t size)
+{
+mem_header *block = (mem_header *)malloc(sizeof(mem_header) + size);
+if (block == NULL) return NULL;
+block->size = size;
+mem_current += size;
+if (mem_current > mem_peak) mem_peak = mem_current;
+return block + 1;
+}
+
+static void
+counting_free(void *p)
+{
+mem_header *block;
+if (p == NULL) return;
+block = (mem_header *)p - 1;
+mem_current -= block->size;
+free(block);
+}
+
+
+
+/*************************************************
+*           Make a log-like subject              *
+*************************************************/
+
+/* Arguments:
+  size        the approximate size wanted
+  lengthptr   where to return the actual length
+
+Returns:      a malloc'd subject, or NULL if no memory
+*/
+
+static char *
+make_log(int size, int *lengthptr)
+{
+static const char *methods[] = { "GET", "POST", "HEAD" };
+static const char *paths[] = { "index", "images", "api", "login", "static" };
+static const char *levels[] = { "INFO", "INFO", "INFO", "WARN", "ERROR" };
+char *subject = (char *)malloc(size + 128);
+unsigned long int seed = 12345;
+int length = 0;
+
+if (subject == NULL) return NULL;
+while (length < size)
+  {
+  seed = seed * 1103515245UL + 12345UL;
+  length += sprintf(subject + length,
+    "2015-04-28 %02lu:%02lu:%02lu %s 10.%lu.%lu.%lu %s /%s/%lu %lu\n",
+    (seed >> 8) % 24, (seed >> 12) % 60, (seed >> 16) % 60,
+    levels[(seed >> 4) % 5], (seed >> 6) % 256, (seed >> 10) % 256,
+    (seed >> 14) % 256, methods[(seed >> 3) % 3], paths[(seed >> 7) % 5],
+    (seed >> 9) % 10000, 200 + (seed >> 5) % 300);
+  }
+*lengthptr = length;
+return subject;
+}
+
+
+
+/*************************************************
+*      Count matches in one large subject        *
+*************************************************/
+
+static int
+count_whole(const pcre *re, const char *subject, int length)
+{
+int workspace[WSCOUNT];
+int offsets[3];
+int start = 0;
+int count = 0;
+
+while (start < length)
+  {
+  int rc = pcre_dfa_exec(re, NULL, subject, length, start, 0, offsets, 3,
+    workspace, WSCOUNT);
+  if (rc < 0) break;
+  count++;
+  start = (offsets[1] > offsets[0])? offsets[1] : offsets[1] + 1;
+  }
+return count;
+}
+
+static int
+count_match(void *data, unsigned long int start, unsigned long int end)
+{
+(void)start;
+(void)end;
+(*(int *)data)++;
+return 0;
+}
+
+
+
+/*************************************************
+*          Measure the DFA stream                *
+*************************************************/
+
+/* Argument:  the approximate size of the text, in bytes
+   Returns:   0 if all went well, 1 otherwise
+*/
+
+static int
+bench_stream(int size)
+{
+const char **pp;
+int length, yield = 0;
+char *subject = make_log(size, &length);
+void *(*old_malloc)(size_t) = pcre_malloc;
+void (*old_free)(void *) = pcre_free;
+
+if (subject == NULL)
+  {
+  fprintf(stderr, "pcre-bench: malloc failed\n");
+  return 1;
+  }
+
+pcre_malloc = counting_malloc;
+pcre_free = counting_free;
+
+printf("\n%-28s %8s %10s %12s %8s\n", "stream", "chunk", "MB/s",
+  "memory KB", "matches");
+
+for (pp = stream_patterns; *pp != NULL; pp++)
+  {
+  const char *error;
+  const int *cp;
+  int erroroffset, whole_count, rc;
+  double t;
+  pcre_dfa_stream *stream;
+  pcre *re = pcre_compile(*pp, 0, &error, &erroroffset, NULL);
+
+  if (re == NULL)
+    {
+    fprintf(stderr, "pcre-bench: %s: %s at offset %d\n", *pp, error,
+      erroroffset);
+    yield = 1;
+    continue;
+    }
+
+  t = now();
+  whole_count = count_whole(re, subject, length);
+  t = now() - t;
+  printf("%-28s %8s %10.1f %12.1f %8d\n", *pp, "whole",
+    length / t / 1e6, (length + WSCOUNT * sizeof(int)) / 1024.0, whole_count);
+
+  stream = pcre_dfa_stream_create(re, NULL, 0, WSCOUNT, &rc);
+  if (stream == NULL)
+    {
+    fprintf(stderr, "pcre-bench: failed to create a stream (%d)\n", rc);
+    pcre_free(re);
+    yield = 1;
+    continue;
+    }
+
+  for (cp = stream_chunks; *cp != 0; cp++)
+    {
+    int offset, stream_count = 0;
+    size_t base = mem_current;
+
+    mem_peak = mem_current;
+    t = now();
+    for (offset = 0; offset < length; offset += *cp)
+      {
+      int chunk = (length - offset < *cp)? length - offset : *cp;
+      rc = pcre_dfa_stream_feed(stream, subject + offset, chunk, count_match,
+        &stream_count);
+      if (rc != 0) break;
+      }
+    if (rc == 0) rc = pcre_dfa_stream_finish(stream, count_match,
+      &stream_count);
+    t = now() - t;
+
+    if (rc != 0 || stream_count != whole_count)
+      {
+      fprintf(stderr, "pcre-bench: %s: stream gave %d (%d), whole gave %d\n",
+        *pp, stream_count, rc, whole_count);
+      yield = 1;
+      }
+
+    printf("%-28s %8d %10.1f %12.1f %8d\n", "", *cp, length / t / 1e6,
+      (*cp + (mem_peak - base)) / 1024.0, stream_count);
+    }
+
+  pcre_dfa_stream_free(stream);
+  pcre_free(re);
+  }
+
+pcre_malloc = old_malloc;
+pcre_free = old_free;
+free(subject);
+return yield;
+}
+
+
+
+/*************************************************
+*          Make a UTF-8 text to check            *
+*************************************************/
+
+/* Arguments:
+  size        the approximate size wanted
+  lengthptr   where to return the actual length
+
+Returns:      a malloc'd subject, or NULL if no memory
+*/
+
+static char *
+make_utf8(int size, int *lengthptr)
+{
+char *subject = (char *)malloc(size + 32);
+unsigned long int seed = 54321;
+int nwords = 0;
+int length = 0;
+
+if (subject == NULL) return NULL;
+while (utf8_words[nwords] != NULL) nwords++;
+while (length < size)
+  {
+  seed = seed * 1103515245UL + 12345UL;
+  length += sprintf(subject + length, "%s%c", utf8_words[(seed >> 8) % nwords],
+    ((seed >> 4) % 8 == 0)? '\n' : ' ');
+  }
+*lengthptr = length;
+return subject;
+}
+
+
+
+/*************************************************
+*          Measure the UTF-8 check               *
+*************************************************/
+
+/* Argument:  the approximate size of the text, in bytes
+   Returns:   0 if all went well, 1 otherwise
+*/
+
+#define UTF8_ROUNDS 4
+
+static int
+bench_utf8(int size)
+{
+pcre *res[sizeof(utf8_patterns)/sizeof(char *)];
+int ovector[OVECCOUNT];
+int length, erroroffset, rc, i, round, npatterns = 0, utf8 = 0, yield = 0;
+double t, checked, prechecked;
+char *subject;
+
+(void)pcre_config(PCRE_CONFIG_UTF8, &utf8);
+if (!utf8)
+  {
+  printf("\nutf8: not measured because UTF support is not compiled\n");
+  return 0;
+  }
+
+subject = make_utf8(size, &length);
+if (subject == NULL)
+  {
+  fprintf(stderr, "pcre-bench: malloc failed\n");
+  return 1;
+  }
+
+for (i = 0; utf8_patterns[i] != NULL; i++)
+  {
+  const char *error;
+  res[npatterns] = pcre_compile(utf8_patterns[i], PCRE_UTF8, &error,
+    &erroroffset, NULL);
+  if (res[npatterns] == NULL)
+    {
+    fprintf(stderr, "pcre-bench: %s: %s at offset %d\n", utf8_patterns[i],
+      error, erroroffset);
+    yield = 1;
+    }
+  else npatterns++;
+  }
+
+t = now();
+for (round = 0; round < UTF8_ROUNDS; round++)
+  {
+  rc = pcre_valid_utf8(subject, length, &erroroffset);
+  if (rc != 0)
+    {
+    fprintf(stderr, "pcre-bench: bad UTF-8 (%d) at offset %d\n", rc,
+      erroroffset);
+    yield = 1;
+    break;
+    }
+  }
+t = now() - t;
+
+printf("\n%-28s %10s\n", "utf8", "MB/s");
+printf("%-28s %10.1f\n", "pcre_valid_utf8()",
+  (double)length * UTF8_ROUNDS / t / 1e6);
+
+/* Each match is done with and without the check; the number of matches shows
+that the results are the same. */
+
+checked = now();
+for (round = 0; round < UTF8_ROUNDS; round++)
+  for (i = 0; i < npatterns; i++)
+    if (pcre_exec(res[i], NULL, subject, length, 0, 0, ovector,
+        OVECCOUNT) < 0) yield = 1;
+checked = now() - checked;
+
+prechecked = now();
+for (round = 0; round < UTF8_ROUNDS; round++)
+  {
+  if (pcre_valid_utf8(subject, length, &erroroffset) != 0) yield = 1;
+  for (i = 0; i < npatterns; i++)
+    if (pcre_exec(res[i], NULL, subject, length, 0, PCRE_NO_UTF8_CHECK,
+        ovector, OVECCOUNT) < 0) yield = 1;
+  }
+prechecked = now() - prechecked;
+
+if (yield != 0) fprintf(stderr, "pcre-bench: a UTF-8 pattern did not match\n");
+
+printf("\n%-28s %10s %12s\n", "utf8 batch", "patterns", "us/batch");
+printf("%-28s %10d %12.1f\n", "checked by each match", npatterns,
+  checked * 1e6 / UTF8_ROUNDS);
+printf("%-28s %10d %12.1f\n", "checked once", npatterns,
+  prechecked * 1e6 / UTF8_ROUNDS);
+
+for (i = 0; i < npatterns; i++) pcre_free(res[i]);
+free(subject);
+return yield;
+}
+
+
+
+/*************************************************
+*       Measure start-up with a bundle           *
+*************************************************/
+
+/* The patterns are compiled and studied one by one, as a program would do at
+start-up, and then fetched from a bundle. Each figure is the time for the whole
+set, so it includes opening and closing the bundle.
+
+Arguments:
+  rounds      number of times to repeat each measurement
+
+Returns:      0 or 1 if something went wrong
+*/
+
+static int
+bench_bundle(int rounds)
+{
+char sources[500][80];
+PCRE_SPTR sptrs[500];
+pcre *res[500];
+pcre_extra *extras[500];
+const char **p1, **p2, **p3;
+int count = 0, jit = 0, yield = 0;
+int i, round, rc, erroroffset;
+double compiled, jitted, loaded, loaded_jit, loaded_some;
+pcre_bundle *bundle;
+
+for (p1 = bundle_prefixes; *p1 != NULL; p1++)
+  for (p2 = bundle_middles; *p2 != NULL; p2++)
+    for (p3 = bundle_suffixes; *p3 != NULL && count < 500; p3++)
+      {
+      sprintf(sources[count], "%s%s%s", *p1, *p2, *p3);
+      sptrs[count] = sources[count];
+      count++;
+      }
+
+(void)pcre_config(PCRE_CONFIG_JIT, &jit);
+
+/* Compile and study every pattern, and then do the same with JIT. The set
+from the first round is kept for saving. */
+
+compiled = jitted = 0;
+for (round = 0; round < 2 * rounds; round++)
+  {
+  int options = (round & 1)? PCRE_STUDY_JIT_COMPILE : 0;
+  double t;
+  if (options != 0 && !jit) continue;
+  t = now();
+  for (i = 0; i < count; i++)
+    {
+    const char *error;
+    pcre *re = pcre_compile(sources[i], 0, &error, &erroroffset, NULL);
+    pcre_extra *extra;
+    if (re == NULL)
+      {
+      fprintf(stderr, "pcre-bench: %s: %s at offset %d\n", sources[i], error,
+        erroroffset);
+      yield = 1;
+      re = pcre_compile("x", 0, &error, &erroroffset, NULL);
+      }
+    extra = pcre_study(re, options, &error);
+    if (round == 0)
+      {
+      res[i] = re;
+      extras[i] = extra;
+      continue;
+      }
+    pcre_free_study(extra);
+    pcre_free(re);
+    }
+  t = now() - t;
+  if (options != 0) jitted += t; else compiled += t;
+  }
+
+rc = pcre_bundle_save(BUNDLE_FILE, count, sptrs, res, extras);
+for (i = 0; i < count; i++)
+  {
+  pcre_free_study(extras[i]);
+  pcre_free(res[i]);
+  }
+if (rc != 0)
+  {
+  fprintf(stderr, "pcre-bench: failed to save bundle (%d)\n", rc);
+  return 1;
+  }
+
+/* Open the bundle and fetch every pattern, without and with JIT, and then
+with JIT but fetching only a few of the patterns. */
+
+loaded = loaded_jit = loaded_some = 0;
+for (round = 0; round < 3 * rounds; round++)
+  {
+  int kind = round % 3;
+  int fetch = (kind == 2)? BUNDLE_SOME : count;
+  double t;
+  if (kind != 0 && !jit) continue;
+  t = now();
+  bundle = pcre_bundle_open(BUNDLE_FILE,
+    (kind == 0)? 0 : PCRE_STUDY_JIT_COMPILE, &rc);
+  if (bundle == NULL)
+    {
+    fprintf(stderr, "pcre-bench: failed to open bundle (%d)\n", rc);
+    yield = 1;
+    break;
+    }
+  for (i = 0; i < fetch; i++)
+    {
+    pcre *re;
+    pcre_extra *extra;
+    if (pcre_bundle_get(bundle, i * (count / fetch), &re, &extra) != 0)
+      yield = 1;
+    }
+  pcre_bundle_close(bundle);
+  t = now() - t;
+  if (kind == 0) loaded += t;
+    else if (kind == 1) loaded_jit += t;
+    else loaded_some += t;
+  }
+
+remove(BUNDLE_FILE);
+if (yield != 0) fprintf(stderr, "pcre-bench: a bundle pattern failed\n");
+
+printf("\n%-28s %10s %12s\n", "bundle start-up", "patterns", "ms");
+printf("%-28s %10d %12.2f\n", "compile and study", count,
+  compiled * 1e3 / rounds);
+if (jit)
+  printf("%-28s %10d %12.2f\n", "compile and JIT", count,
+    jitted * 1e3 / rounds);
+printf("%-28s %10d %12.2f\n", "bundle, no JIT", count,
+  loaded * 1e3 / rounds);
+if (jit)
+  {
+  printf("%-28s %10d %12.2f\n", "bundle, JIT all", count,
+    loaded_jit * 1e3 / rounds);
+  printf("%-28s %10d %12.2f\n", "bundle, JIT as used", BUNDLE_SOME,
+    loaded_some * 1e3 / rounds);
+  }
+return yield;
+}
+
+
+
+/*************************************************
+*     Compile and study a case for an engine     *
+*************************************************/
+
+/* Arguments:
+  ec          the case
+  engine      the engine
+  reptr       where to return the compiled pattern
+  extraptr    where to return the study data (may be NULL)
+
+Returns:      0 if all went well, 1 if the pattern could not be compiled, or
+              -1 if no JIT code could be made for it
+*/
+
+static int
+engine_compile(const engine_case *ec, int engine, pcre **reptr,
+  pcre_extra **extraptr)
+{
+const char *error;
+int erroroffset, jitted = 0;
+pcre_extra *extra;
+pcre *re = pcre_compile(ec->pattern, ec->options, &error, &erroroffset, NULL);
+
+if (re == NULL)
+  {
+  fprintf(stderr, "pcre-bench: %s: %s at offset %d\n", ec->name, error,
+    erroroffset);
+  return 1;
+  }
+
+extra = pcre_study(re, (engine == ENGINE_JIT)? PCRE_STUDY_JIT_COMPILE : 0,
+  &error);
+if (error != NULL)
+  {
+  fprintf(stderr, "pcre-bench: %s: study failed: %s\n", ec->name, error);
+  pcre_free(re);
+  return 1;
+  }
+
+if (engine == ENGINE_JIT &&
+    (pcre_fullinfo(re, extra, PCRE_INFO_JIT, &jitted) != 0 || !jitted))
+  {
+  pcre_free_study(extra);
+  pcre_free(re);
+  return -1;
+  }
+
+*reptr = re;
+*extraptr = extra;
+return 0;
+}
+
+
+
+/*************************************************
+*     Count the matches in a subject             *
+*************************************************/
+
+/* Each match starts where the previous one ended, or one character further on
+after an empty match.
+
+Arguments:
+  re          the compiled pattern
+  extra       the study data, or NULL
+  engine      the engine
+  utf8        TRUE if the pattern is in UTF-8 mode
+  subject     the subject, already checked if it is UTF-8
+  length      its length
+
+Returns:      the number of matches, or a negative error code
+*/
+
+static int
+engine_count(const pcre *re, const pcre_extra *extra, int engine, int utf8,
+  const char *subject, int length)
+{
+int workspace[WSCOUNT];
+int ovector[OVECCOUNT];
+int options = utf8? PCRE_NO_UTF8_CHECK : 0;
+int start = 0;
+int count = 0;
+
+while (start <= length)
+  {
+  int rc = (engine == ENGINE_DFA)?
+    pcre_dfa_exec(re, extra, subject, length, start, options, ovector,
+      OVECCOUNT, workspace, WSCOUNT) :
+    pcre_exec(re, extra, subject, length, start, options, ovector, OVECCOUNT);
+
+  if (rc == PCRE_ERROR_NOMATCH) break;
+  if (rc < 0) return rc;
+  count++;
+  start = ovector[1];
+  if (ovector[0] == ovector[1])
+    {
+    if (start >= length) break;
+    start++;
+    if (utf8)
+      while (start < length && (subject[start] & 0xc0) == 0x80) start++;
+    }
+  }
+return count;
+}
+
+
+
+/*************************************************
+*        Measure one case with one engine        *
+*************************************************/
+
+/* The first pass over the subject finds the number of matches and the memory
+used; it is then repeated until enough time has passed for a steady figure, and
+the best time is kept. The compile time is found in the same way.
+
+Arguments:
+  ec          the case
+  engine      the engine
+  subject     the subject
+  length      its length
+  result      where to put the result
+
+Returns:      0 if all went well, 1 if something failed, or -1 if the engine
+              cannot be used for this case
+*/
+
+static int
+engine_measure(const engine_case *ec, int engine, const char *subject,
+  int length, engine_result *result)
+{
+pcre *re;
+pcre_extra *extra = NULL;
+int utf8 = (ec->options & PCRE_UTF8) != 0;
+int rc, pass, rounds;
+size_t size = 0, studysize = 0, jitsize = 0, base;
+double t, best, total;
+
+rc = engine_compile(ec, engine, &re, &extra);
+if (rc != 0) return rc;
+
+base = mem_current;
+mem_peak = mem_current;
+rc = engine_count(re, extra, engine, utf8, subject, length);
+if (rc < 0)
+  {
+  pcre_free_study(extra);
+  pcre_free(re);
+  if (engine == ENGINE_DFA &&
+      (rc == PCRE_ERROR_DFA_UITEM || rc == PCRE_ERROR_DFA_UCOND)) return -1;
+  fprintf(stderr, "pcre-bench: %s: %s failed (%d)\n", ec->name,
+    engine_names[engine], rc);
+  return 1;
+  }
+result->matches = rc;
+
+(void)pcre_fullinfo(re, extra, PCRE_INFO_SIZE, &size);
+(void)pcre_fullinfo(re, extra, PCRE_INFO_STUDYSIZE, &studysize);
+if (engine == ENGINE_JIT)
+  (void)pcre_fullinfo(re, extra, PCRE_INFO_JITSIZE, &jitsize);
+result->memory = (unsigned long int)(size + studysize + jitsize +
+  (mem_peak - base));
+if (engine == ENGINE_DFA) result->memory += WSCOUNT * sizeof(int);
+
+best = total = 0;
+for (pass = 0; pass < 3 || (total < ENGINE_TIME && pass < 100); pass++)
+  {
+  t = now();
+  rc = engine_count(re, extra, engine, utf8, subject, length);
+  t = now() - t;
+  if (rc != result->matches)
+    {
+    fprintf(stderr, "pcre-bench: %s: %s found %d matches, then %d\n",
+      ec->name, engine_names[engine], result->matches, rc);
+    pcre_free_study(extra);
+    pcre_free(re);
+    return 1;
+    }
+  total += t;
+  if (pass == 0 || t < best) best = t;
+  }
+
+pcre_free_study(extra);
+pcre_free(re);
+
+if (best <= 0) best = 1e-9;
+result->matches_per_sec = result->matches / best;
+result->ns_per_byte = best * 1e9 / length;
+
+/* A compilation takes only microseconds, so the time of one batch can be far
+off when something else runs at the same time. The best batch is taken. */
+
+for (pass = 0; pass < COMPILE_BATCHES; pass++)
+  {
+  t = now();
+  for (rounds = 0; rounds < 10 || (now() - t < ENGINE_TIME / 20 &&
+       rounds < 10000); rounds++)
+    {
+    if (engine_compile(ec, engine, &re, &extra) != 0) return 1;
+    pcre_free_study(extra);
+    pcre_free(re);
+    }
+  t = (now() - t) * 1e6 / rounds;
+  if (pass == 0 || t < result->compile_us) result->compile_us = t;
+  }
+return 0;
+}
+
+
+
+/*************************************************
+*             Read a baseline file               *
+*************************************************/
+
+/* The file is one written by -c. The header line, and any line that is not a
+result, is ignored.
+
+Arguments:
+  name        the file name
+  rows        where to put the results
+  countptr    where to return the number of results
+
+Returns:      0 if all went well, 1 if the file could not be read
+*/
+
+static int
+read_baseline(const char *name, baseline_row *rows, int *countptr)
+{
+char buffer[256];
+int count = 0;
+FILE *f = fopen(name, "r");
+
+if (f == NULL)
+  {
+  fprintf(stderr, "pcre-bench: failed to open %s\n", name);
+  return 1;
+  }
+
+while (count < MAX_BASELINE && fgets(buffer, sizeof(buffer), f) != NULL)
+  {
+  baseline_row *row = rows + count;
+  if (sscanf(buffer, "%31[^,],%7[^,],%d,%lf,%lf,%lf,%lu", row->name,
+      row->engine, &row->result.matches, &row->result.matches_per_sec,
+      &row->result.ns_per_byte, &row->result.compile_us,
+      &row->result.memory) == 7)
+    count++;
+  }
+
+fclose(f);
+*countptr = count;
+return 0;
+}
+
+static double
+change(double before, double after)
+{
+return (before > 0)? (after - before) * 100.0 / before : 0.0;
+}
+
+
+
+/*************************************************
+*          Compare the matching engines          *
+*************************************************/
+
+/* Arguments:
+  csvname     file for the results as CSV, or NULL
+  basename    file with baseline results, or NULL
+  threshold   the percentage by which a result may be worse than the baseline
+
+Returns:      0 if all went well, 1 otherwise
+*/
+
+static int
+bench_engines(const char *csvname, const char *basename, double threshold)
+{
+static baseline_row baseline[MAX_BASELINE];
+engine_case *ec;
+char *subjects[2];
+int lengths[2];
+int nbaseline = 0, regressions = 0, yield = 0;
+int utf8 = 0, ucp = 0, jit = 0, erroroffset;
+FILE *csv = NULL;
+void *(*old_malloc)(size_t) = pcre_malloc;
+void (*old_free)(void *) = pcre_free;
+void *(*old_stack_malloc)(size_t) = pcre_stack_malloc;
+void (*old_stack_free)(void *) = pcre_stack_free;
+
+if (basename != NULL && read_baseline(basename, baseline, &nbaseline) != 0)
+  return 1;
+
+(void)pcre_config(PCRE_CONFIG_UTF8, &utf8);
+(void)pcre_config(PCRE_CONFIG_UNICODE_PROPERTIES, &ucp);
+(void)pcre_config(PCRE_CONFIG_JIT, &jit);
+
+subjects[SUBJECT_LOG] = make_log(ENGINE_SIZE, &lengths[SUBJECT_LOG]);
+subjects[SUBJECT_UTF8] = make_utf8(ENGINE_SIZE, &lengths[SUBJECT_UTF8]);
+if (subjects[SUBJECT_LOG] == NULL || subjects[SUBJECT_UTF8] == NULL)
+  {
+  fprintf(stderr, "pcre-bench: malloc failed\n");
+  free(subjects[SUBJECT_LOG]);
+  free(subjects[SUBJECT_UTF8]);
+  return 1;
+  }
+
+/* The UTF-8 text is checked once here, so that the matches need not do it. */
+
+if (utf8 && pcre_valid_utf8(subjects[SUBJECT_UTF8], lengths[SUBJECT_UTF8],
+    &erroroffset) != 0)
+  {
+  fprintf(stderr, "pcre-bench: bad UTF-8 at offset %d\n", erroroffset);
+  free(subjects[SUBJECT_LOG]);
+  free(subjects[SUBJECT_UTF8]);
+  return 1;
+  }
+
+if (csvname != NULL)
+  {
+  csv = fopen(csvname, "w");
+  if (csv == NULL)
+    {
+    fprintf(stderr, "pcre-bench: failed to open %s\n", csvname);
+    free(subjects[SUBJECT_LOG]);
+    free(subjects[SUBJECT_UTF8]);
+    return 1;
+    }
+  fprintf(csv, "case,engine,matches,matches_per_sec,ns_per_byte,compile_us,"
+    "memory_bytes\n");
+  }
+
+pcre_malloc = counting_malloc;
+pcre_free = counting_free;
+pcre_stack_malloc = counting_malloc;
+pcre_stack_free = counting_free;
+
+printf("\n%-18s %-6s %8s %12s %8s %10s %10s", "engines", "engine",
+  "matches", "matches/s", "ns/byte", "compile us", "memory KB");
+if (basename != NULL) printf(" %9s %9s", "ns/byte %", "compile %");
+printf("\n");
+
+for (ec = engine_cases; ec->name != NULL; ec++)
+  {
+  int engine;
+  int interp_matches = -1;
+
+  if (((ec->options & PCRE_UTF8) != 0 && !utf8) ||
+      ((ec->options & PCRE_UCP) != 0 && !ucp))
+    {
+    printf("%-18s not measured because Unicode support is not compiled\n",
+      ec->name);
+    continue;
+    }
+
+  for (engine = 0; engine < ENGINE_COUNT; engine++)
+    {
+    engine_result result;
+    int i, rc;
+
+    if (engine == ENGINE_JIT && !jit) continue;
+    rc = engine_measure(ec, engine, subjects[ec->subject],
+      lengths[ec->subject], &result);
+    if (rc < 0)
+      {
+      printf("%-18s %-6s %8s\n", (engine == 0)? ec->name : "",
+        engine_names[engine], "-");
+      continue;
+      }
+    if (rc > 0)
+      {
+      yield = 1;
+      continue;
+      }
+
+    /* The JIT code must find the same matches as the interpreter. The DFA
+    matcher finds the longest match at each point, so its count may differ. */
+
+    if (engine == ENGINE_INTERP) interp_matches = result.matches;
+    else if (engine == ENGINE_JIT && interp_matches >= 0 &&
+        result.matches != interp_matches)
+      {
+      fprintf(stderr, "pcre-bench: %s: %d matches with JIT, %d without\n",
+        ec->name, result.matches, interp_matches);
+      yield = 1;
+      }
+
+    printf("%-18s %-6s %8d %12.0f %8.3f %10.1f %10.1f",
+      (engine == 0)? ec->name : "", engine_names[engine], result.matches,
+      result.matches_per_sec, result.ns_per_byte, result.compile_us,
+      result.memory / 1024.0);
+
+    if (csv != NULL)
+      fprintf(csv, "%s,%s,%d,%.0f,%.4f,%.2f,%lu\n", ec->name,
+        engine_names[engine], result.matches, result.matches_per_sec,
+        result.ns_per_byte, result.compile_us, result.memory);
+
+    for (i = 0; i < nbaseline; i++)
+      {
+      baseline_row *row = baseline + i;
+      double c1, c2;
+      if (strcmp(row->name, ec->name) != 0 ||
+          strcmp(row->engine, engine_names[engine]) != 0) continue;
+      c1 = change(row->result.ns_per_byte, result.ns_per_byte);
+      c2 = change(row->result.compile_us, result.compile_us);
+      printf(" %+8.1f%% %+8.1f%%", c1, c2);
+      if (row->result.matches != result.matches)
+        {
+        printf(" matches were %d", row->result.matches);
+        regressions++;
+        }
+      else if (c1 > threshold || (c2 > threshold &&
+          result.compile_us - row->result.compile_us > COMPILE_SLACK))
+        {
+        printf(" worse");
+        regressions++;
+        }
+      break;
+      }
+    printf("\n");
+    }
+  }
+
+pcre_malloc = old_malloc;
+pcre_free = old_free;
+pcre_stack_malloc = old_stack_malloc;
+pcre_stack_free = old_stack_free;
+
+if (csv != NULL && fclose(csv) != 0)
+  {
+  fprintf(stderr, "pcre-bench: failed to write %s\n", csvname);
+  yield = 1;
+  }
+
+if (regressions > 0)
+  {
+  fflush(stdout);
+  fprintf(stderr, "pcre-bench: %d result%s worse than the baseline by more "
+    "than %.1f%%, or had different matches\n", regressions,
+    (regressions == 1)? " is" : "s are", threshold);
+  yield = 1;
+  }
+
+free(subjects[SUBJECT_LOG]);
+free(subjects[SUBJECT_UTF8]);
+return yield;
+}
+
+
+
+/*************************************************
+*        Measure the start-of-match scan         *
+*************************************************/
+
+/* Argument:  the approximate size of the text, in bytes
+   Returns:   0 if all went well, 1 otherwise
+*/
+
+static int
+bench_scan(int size)
+{
+engine_case *ec;
+int ovector[OVECCOUNT];
+int workspace[WSCOUNT];
+int length, engine, pass, rc, jit = 0, yield = 0;
+double t, best;
+char *subject = make_log(size, &length);
+
+if (subject == NULL)
+  {
+  fprintf(stderr, "pcre-bench: malloc failed\n");
+  return 1;
+  }
+
+(void)pcre_config(PCRE_CONFIG_JIT, &jit);
+
+printf("\n%-18s %-6s %10s\n", "scan", "engine", "MB/s");
+
+for (ec = scan_cases; ec->name != NULL; ec++)
+  {
+  for (engine = 0; engine < ENGINE_COUNT; engine++)
+    {
+    pcre *re;
+    pcre_extra *extra;
+
+    if (engine == ENGINE_JIT && !jit) continue;
+    rc = engine_compile(ec, engine, &re, &extra);
+    if (rc != 0)
+      {
+      if (rc > 0) yield = 1;
+      continue;
+      }
+
+    best = 0;
+    for (pass = 0; pass < SCAN_PASSES; pass++)
+      {
+      t = now();
+      if (engine == ENGINE_DFA)
+        rc = pcre_dfa_exec(re, extra, subject, length, 0, 0, ovector,
+          OVECCOUNT, workspace, WSCOUNT);
+      else
+        rc = pcre_exec(re, extra, subject, length, 0, 0, ovector, OVECCOUNT);
+      t = now() - t;
+      if (rc != PCRE_ERROR_NOMATCH)
+        {
+        fprintf(stderr, "pcre-bench: %s: %s returned %d\n", ec->name,
+          engine_names[engine], rc);
+        yield = 1;
+        break;
+        }
+      if (pass == 0 || t < best) best = t;
+      }
+
+    if (best <= 0) best = 1e-9;
+    printf("%-18s %-6s %10.0f\n", (engine == 0)? ec->name : "",
+      engine_names[engine], length / best / 1e6);
+
+    pcre_free_study(extra);
+    pcre_free(re);
+    }
+  }
+
+free(subject);
+return yield;
+}
+
+
+
+/*************************************************
+*                Main program                    *
+*************************************************/
+
+static void
+usage(void)
+{
+fprintf(stderr, "Usage: pcre-bench [-e] [-n count] [-s size] [-c file] [-b file] [-t percent]\n");
+fprintf(stderr, "  -e          run only the engine comparison\n");
+fprintf(stderr, "  -n count    number of calls for each frames case (default 200)\n");
+fprintf(stderr, "  -s size     size in MB of the stream, UTF-8 and scan texts (default 16)\n");
+fprintf(stderr, "  -c file     write the engine results to a CSV file\n");
+fprintf(stderr, "  -b file     compare the engine results with a CSV file from -c\n");
+fprintf(stderr, "  -t percent  how much worse than the baseline a result may be (default 10)\n");
+}
+
+int
+main(int argc, char **argv)
+{
+int count = 200;
+int size = 16;
+int engines_only = 0;
+double threshold = 10.0;
+const char *csvname = NULL;
+const char *basename = NULL;
+int i;
+
+for (i = 1; i < argc; i++)
+  {
+  if (strcmp(argv[i], "-e") == 0) engines_only = 1;
+  else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+    {
+    count = atoi(argv[++i]);
+    if (count <= 0)
+      {
+      usage();
+      return 2;
+      }
+    }
+  else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+    {
+    size = atoi(argv[++i]);
+    if (size <= 0 || size > 1024)
+      {
+      usage();
+      return 2;
+      }
+    }
+  else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) csvname = argv[++i];
+  else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) basename = argv[++i];
+  else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+    {
+    threshold = atof(argv[++i]);
+    if (threshold <= 0)
+      {
+      usage();
+      return 2;
+      }
+    }
+  else
+    {
+    usage();
+    return 2;
+    }
+  }
+
+if (engines_only) return bench_engines(csvname, basename, threshold);
+
+return bench_frames(count) | bench_stream(size * 1024 * 1024) |
+  bench_utf8(size * 1024 * 1024) | bench_bundle(BUNDLE_ROUNDS) |
+  bench_scan(size * 1024 * 1024) | bench_engines(csvname, basename, threshold);
+}
+
+/* End of pcrebench.c */
@@ -0,0 +1,268 @@
+/*************************************************
+*           pcrebundle program                   *
+*************************************************/
+
+/* This program compiles a list of patterns and saves them in a bundle file,
+from which an application can load them with pcre_bundle_open() instead of
+compiling them each time it starts. It can also list the contents of a bundle.
+
+The list file contains one pattern on each line. Empty lines, and lines that
+start with #, are ignored. Options are given within the patterns, for example
+(?i) or (*UTF8). Each pattern is studied unless -n is given; JIT compilation
+cannot be saved, and is requested when the bundle is opened.
+
+-----------------------------------------------------------------------------
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of the University of Cambridge nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+-----------------------------------------------------------------------------
+*/
+
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcre.h"
+
+#define MAXLINE 32768
+
+
+
+/*************************************************
+*               Usage function                   *
+*************************************************/
+
+static int
+usage(void)
+{
+fprintf(stderr, "Usage: pcrebundle [-n] listfile bundlefile\n");
+fprintf(stderr, "       pcrebundle -l bundlefile\n");
+fprintf(stderr, "  -n   do not study the patterns\n");
+fprintf(stderr, "  -l   list the patterns in a bundle\n");
+return 2;
+}
+
+
+
+/*************************************************
+*          List the contents of a bundle         *
+*************************************************/
+
+/* Argument:  the bundle file
+   Returns:   0 if all went well, 1 otherwise
+*/
+
+static int
+list_bundle(const char *filename)
+{
+int i, count, rc;
+pcre_bundle *bundle = pcre_bundle_open(filename, 0, &rc);
+
+if (bundle == NULL)
+  {
+  fprintf(stderr, "pcrebundle: failed to load %s (error %d)\n", filename, rc);
+  return 1;
+  }
+
+count = pcre_bundle_count(bundle);
+printf("%d pattern%s\n", count, (count == 1)? "" : "s");
+for (i = 0; i < count; i++)
+  {
+  pcre *re;
+  pcre_extra *extra;
+  size_t size;
+  const char *source = (const char *)pcre_bundle_source(bundle, i);
+
+  if (pcre_bundle_get(bundle, i, &re, &extra) != 0 ||
+      pcre_fullinfo(re, NULL, PCRE_INFO_SIZE, &size) != 0)
+    {
+    fprintf(stderr, "pcrebundle: failed to get pattern %d\n", i);
+    pcre_bundle_close(bundle);
+    return 1;
+    }
+  printf("%5d %7d %-7s %s\n", i, (int)size, (extra != NULL)? "studied" : "",
+    (source != NULL)? source : "(no source)");
+  }
+
+pcre_bundle_close(bundle);
+return 0;
+}
+
+
+
+/*************************************************
+*        Compile a list of patterns              *
+*************************************************/
+
+/* Arguments:
+  listname    the list file
+  filename    the bundle file to write
+  study       TRUE to study the patterns
+
+Returns:      0 if all went well, 1 otherwise
+*/
+
+static int
+make_bundle(const char *listname, const char *filename, int study)
+{
+char *line = (char *)malloc(MAXLINE);
+const char **sources = NULL;
+pcre **codes = NULL;
+pcre_extra **extras = NULL;
+int count = 0, size = 0, linenumber = 0, yield = 0, i, rc;
+FILE *f = fopen(listname, "r");
+
+if (f == NULL)
+  {
+  fprintf(stderr, "pcrebundle: failed to open %s\n", listname);
+  free(line);
+  return 1;
+  }
+
+while (line != NULL && fgets(line, MAXLINE, f) != NULL)
+  {
+  const char *error;
+  int erroroffset;
+  size_t length = strlen(line);
+
+  linenumber++;
+  if (length > 0 && line[length-1] != '\n' && !feof(f))
+    {
+    fprintf(stderr, "pcrebundle: %s:%d: line too long\n", listname,
+      linenumber);
+    yield = 1;
+    break;
+    }
+  while (length > 0 && (line[length-1] == '\n' || line[length-1] == '\r'))
+    line[--length] = 0;
+  if (length == 0 || line[0] == '#') continue;
+
+  if (count >= size)
+    {
+    size = (size == 0)? 64 : 2 * size;
+    sources = (const char **)realloc((void *)sources, size * sizeof(char *));
+    codes = (pcre **)realloc(codes, size * sizeof(pcre *));
+    extras = (pcre_extra **)realloc(extras, size * sizeof(pcre_extra *));
+    if (sources == NULL || codes == NULL || extras == NULL)
+      {
+      fprintf(stderr, "pcrebundle: malloc failed\n");
+      yield = 1;
+      break;
+      }
+    }
+
+  codes[count] = pcre_compile(line, 0, &error, &erroroffset, NULL);
+  if (codes[count] == NULL)
+    {
+    fprintf(stderr, "pcrebundle: %s:%d: %s at offset %d\n", listname,
+      linenumber, error, erroroffset);
+    yield = 1;
+    continue;
+    }
+
+  extras[count] = NULL;
+  if (study)
+    {
+    extras[count] = pcre_study(codes[count], 0, &error);
+    if (error != NULL)
+      {
+      fprintf(stderr, "pcrebundle: %s:%d: %s\n", listname, linenumber, error);
+      pcre_free(codes[count]);
+      yield = 1;
+      continue;
+      }
+    }
+
+  sources[count] = strdup(line);
+  if (sources[count] == NULL)
+    {
+    fprintf(stderr, "pcrebundle: malloc failed\n");
+    yield = 1;
+    break;
+    }
+  count++;
+  }
+
+if (line == NULL)
+  {
+  fprintf(stderr, "pcrebundle: malloc failed\n");
+  yield = 1;
+  }
+fclose(f);
+
+if (yield == 0)
+  {
+  rc = pcre_bundle_save(filename, count, (PCRE_SPTR *)sources, codes, extras);
+  if (rc != 0)
+    {
+    fprintf(stderr, "pcrebundle: failed to write %s (error %d)\n", filename,
+      rc);
+    yield = 1;
+    }
+  }
+
+for (i = 0; i < count; i++)
+  {
+  free((void *)sources[i]);
+  pcre_free_study(extras[i]);
+  pcre_free(codes[i]);
+  }
+free((void *)sources);
+free(codes);
+free(extras);
+free(line);
+return yield;
+}
+
+
+
+/*************************************************
+*                Main program                    *
+*************************************************/
+
+int
+main(int argc, char **argv)
+{
+int study = 1;
+int i = 1;
+
+if (argc == 3 && strcmp(argv[1], "-l") == 0) return list_bundle(argv[2]);
+
+if (i < argc && strcmp(argv[i], "-n") == 0)
+  {
+  study = 0;
+  i++;
+  }
+if (argc - i != 2) return usage();
+return make_bundle(argv[i], argv[i+1], study);
+}
+
+/* End of pcrebundle.c */
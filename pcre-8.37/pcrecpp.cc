@@ -58,6 +58,230 @@ static const int kVecSize = (1 + kMaxArgs) * 3;  // results + PCRE workspace
 // Special object that stands-in for no argument
 Arg RE::no_arg((void*)NULL);
 
+// A rewrite string split into pieces: runs of literal text, which point
+// into the rewrite string itself, and references to captured groups.
+// The rewrite is parsed once for each call, however many matches it is
+// then applied to.
+class RewriteTemplate {
+ public:
+  explicit RewriteTemplate(const StringPiece& rewrite);
+  ~RewriteTemplate() {
+    if (pieces_ != space_) delete [] pieces_;
+  }
+
+  // One more than the highest group that the template refers to
+  int pairs() const { return pairs_; }
+
+  // Expand the template for one match into "dest", or just measure it
+  // if "dest" is NULL, and return the length.  "*ok" is set false where
+  // Rewrite() gives up: at a group beyond "matches", or at an invalid
+  // escape.  What comes before that point is still expanded.
+  int Expand(const char* text, const int* vec, int matches,
+             char* dest, bool* ok) const;
+
+ private:
+  struct Piece {
+    const char* data;
+    int length;
+    int group;          // -1 for literal text
+  };
+
+  void Add(const char* data, int length, int group) {
+    pieces_[count_].data = data;
+    pieces_[count_].length = length;
+    pieces_[count_].group = group;
+    count_++;
+  }
+
+  static const int kSpace = 16;
+  Piece space_[kSpace];   // enough for most rewrites, without allocating
+  Piece* pieces_;
+  int count_;
+  int pairs_;
+  bool valid_;            // false if the rewrite has an invalid escape
+
+  // Not copyable
+  RewriteTemplate(const RewriteTemplate&);
+  void operator=(const RewriteTemplate&);
+};
+
+RewriteTemplate::RewriteTemplate(const StringPiece& rewrite)
+    : pieces_(space_), count_(0), pairs_(1), valid_(true) {
+  const char* s = rewrite.data();
+  const char* end = s + rewrite.size();
+
+  // Each backslash adds at most two pieces: a group, and the literal
+  // text before it.
+  int most = 1;
+  for (const char* p = s; p < end; p++) {
+    if (*p == '\\') most += 2;
+  }
+  if (most > kSpace) pieces_ = new Piece[most];
+
+  const char* literal = s;
+  while (s < end) {
+    if (*s != '\\') {
+      s++;
+      continue;
+    }
+    if (s > literal) Add(literal, static_cast<int>(s - literal), -1);
+    if (s + 1 < end && s[1] >= '0' && s[1] <= '9') {
+      int n = s[1] - '0';
+      Add(NULL, 0, n);
+      if (n >= pairs_) pairs_ = n + 1;
+      s += 2;
+      literal = s;
+    } else if (s + 1 < end && s[1] == '\\') {
+      // The second backslash starts the next run of literal text.
+      literal = s + 1;
+      s += 2;
+    } else {
+      valid_ = false;
+      return;
+    }
+  }
+  if (end > literal) Add(literal, static_cast<int>(end - literal), -1);
+}
+
+int RewriteTemplate::Expand(const char* text, const int* vec, int matches,
+                            char* dest, bool* ok) const {
+  int length = 0;
+  *ok = valid_;
+  for (int i = 0; i < count_; i++) {
+    const char* data = pieces_[i].data;
+    int n = pieces_[i].length;
+    const int group = pieces_[i].group;
+    if (group >= 0) {
+      if (group >= matches) {
+        *ok = false;
+        break;
+      }
+      const int start = vec[2 * group];
+      if (start < 0) continue;
+      data = text + start;
+      n = vec[2 * group + 1] - start;
+    }
+    if (dest != NULL && n > 0) memcpy(dest + length, data, n);
+    length += n;
+  }
+  return length;
+}
+
+// Output for GlobalReplace().  The matches are collected in batches;
+// each batch is measured, room is made for it, and it is then written in
+// one pass.  The output is either a string, which grows by an amount
+// estimated from the progress so far, or a fixed buffer, which is
+// written only as far as it has room.
+class ReplaceWriter {
+ public:
+  ReplaceWriter(const RewriteTemplate& rewrite, const StringPiece& text,
+                string* out, char* buf, int bufsize)
+      : rewrite_(rewrite), text_(text), out_(out), buf_(buf),
+        bufsize_(bufsize), stride_(1 + 2 * rewrite.pairs()), used_(0),
+        done_(0), length_(0), overflow_(false) {
+    if (out_ != NULL) out_->resize(0);
+  }
+
+  // Record a match: the number of pairs that matched, and as many pairs
+  // as the template uses.  Pairs beyond "matches" are never read.
+  void Add(const int* vec, int matches) {
+    if (used_ + stride_ > kSpace) Flush();
+    int* record = spans_ + used_;
+    record[0] = matches;
+    for (int i = 0; i < stride_ - 1; i++)
+      record[i + 1] = (i < 2 * matches) ? vec[i] : -1;
+    used_ += stride_;
+  }
+
+  // Write what is left, and return the length of the result.
+  int Finish() {
+    Flush();
+    const int tail = text_.size() - done_;
+    char* dest = Reserve(tail);
+    if (dest != NULL && tail > 0) memcpy(dest, text_.data() + done_, tail);
+    return length_;
+  }
+
+  // True if the result did not fit in the buffer
+  bool overflow() const { return overflow_; }
+
+ private:
+  void Flush();
+
+  // Make room for "n" more bytes, and return where they go, or NULL if
+  // they cannot be written.
+  char* Reserve(int n);
+
+  // Enough for a batch of 48 matches with all ten groups
+  static const int kSpace = 1024;
+
+  const RewriteTemplate& rewrite_;
+  const StringPiece text_;
+  string* out_;
+  char* buf_;
+  int bufsize_;
+  int stride_;
+  int spans_[kSpace];
+  int used_;
+  int done_;              // how much of the text has been dealt with
+  int length_;            // length of the result so far
+  bool overflow_;
+};
+
+char* ReplaceWriter::Reserve(int n) {
+  const int start = length_;
+  length_ += n;
+  if (out_ == NULL) {
+    if (overflow_ || length_ > bufsize_) {
+      overflow_ = true;
+      return NULL;
+    }
+    return buf_ + start;
+  }
+
+  // When the string must grow, make it large enough for the rest of the
+  // text if it changes at the same rate as what has been done so far,
+  // with an eighth to spare.
+  if (static_cast<string::size_type>(length_) > out_->capacity() &&
+      done_ > 0 && done_ < text_.size()) {
+    double rate = static_cast<double>(length_) / done_;
+    out_->reserve(length_ + static_cast<string::size_type>(
+                  rate * (text_.size() - done_) * 1.125));
+  }
+  out_->resize(length_);
+  return (n > 0) ? &(*out_)[start] : NULL;
+}
+
+void ReplaceWriter::Flush() {
+  const char* data = text_.data();
+  bool ok;
+
+  // Measure the batch, then write it.
+  int n = 0;
+  int position = done_;
+  for (int i = 0; i < used_; i += stride_) {
+    const int* vec = spans_ + i + 1;
+    n += vec[0] - position;
+    n += rewrite_.Expand(data, vec, spans_[i], NULL, &ok);
+    position = vec[1];
+  }
+
+  char* dest = Reserve(n);
+  if (dest != NULL) {
+    for (int i = 0; i < used_; i += stride_) {
+      const int* vec = spans_ + i + 1;
+      if (vec[0] > done_) {
+        memcpy(dest, data + done_, vec[0] - done_);
+        dest += vec[0] - done_;
+      }
+      dest += rewrite_.Expand(data, vec, spans_[i], dest, &ok);
+      done_ = vec[1];
+    }
+  }
+  done_ = position;
+  used_ = 0;
+}
+
 // This is for ABI compatibility with old versions of pcre (pre-7.6),
 // which defined a global no_arg variable instead of putting it in the
 // RE class.  This works on GCC >= 3, at least.  It definitely works
@@ -378,15 +602,15 @@ static int NewlineMode(int pcre_options) {
   return newline_mode;
 }
 
-int RE::GlobalReplace(const StringPiece& rewrite,
-                      string *str) const {
+int RE::FindReplacements(const StringPiece& text,
+                         ReplaceWriter* writer) const {
+  const int textlen = text.size();
   int count = 0;
   int vec[kVecSize];
-  string out;
   int start = 0;
   bool last_match_was_empty_string = false;
 
-  while (start <= static_cast<int>(str->length())) {
+  while (start <= textlen) {
     // If the previous match was for the empty string, we shouldn't
     // just match again: we'll match in the same way and get an
     // infinite loop.  Instead, we do the match in a special way:
@@ -399,7 +623,7 @@ int RE::GlobalReplace(const StringPiece& rewrite,
     //    perl -le '$_ = "aa"; s/b*|aa/@/g; print'
     int matches;
     if (last_match_was_empty_string) {
-      matches = TryMatch(*str, start, ANCHOR_START, false, vec, kVecSize);
+      matches = TryMatch(text, start, ANCHOR_START, false, vec, kVecSize);
       if (matches <= 0) {
         int matchend = start + 1;     // advance one character.
         // If the current char is CR and we're in CRLF mode, skip LF too.
@@ -407,8 +631,8 @@ int RE::GlobalReplace(const StringPiece& rewrite,
         // all_options(), since options_ could have changed bewteen
         // compile-time and now, but this is simpler and safe enough.
         // Modified by PH to add ANY and ANYCRLF.
-        if (matchend < static_cast<int>(str->length()) &&
-            (*str)[start] == '\r' && (*str)[matchend] == '\n' &&
+        if (matchend < textlen &&
+            text[start] == '\r' && text[matchend] == '\n' &&
             (NewlineMode(options_.all_options()) == PCRE_NEWLINE_CRLF ||
              NewlineMode(options_.all_options()) == PCRE_NEWLINE_ANY ||
              NewlineMode(options_.all_options()) == PCRE_NEWLINE_ANYCRLF)) {
@@ -417,41 +641,68 @@ int RE::GlobalReplace(const StringPiece& rewrite,
         // We also need to advance more than one char if we're in utf8 mode.
 #ifdef SUPPORT_UTF8
         if (options_.utf8()) {
-          while (matchend < static_cast<int>(str->length()) &&
-                 ((*str)[matchend] & 0xc0) == 0x80)
+          while (matchend < textlen && (text[matchend] & 0xc0) == 0x80)
             matchend++;
         }
 #endif
-        if (start < static_cast<int>(str->length()))
-          out.append(*str, start, matchend - start);
+        // The characters skipped are copied with the text between the
+        // matches, so nothing needs to be recorded for them.
         start = matchend;
         last_match_was_empty_string = false;
         continue;
       }
     } else {
-      matches = TryMatch(*str, start, UNANCHORED, true, vec, kVecSize);
+      matches = TryMatch(text, start, UNANCHORED, true, vec, kVecSize);
       if (matches <= 0)
         break;
     }
     int matchstart = vec[0], matchend = vec[1];
     assert(matchstart >= start);
     assert(matchend >= matchstart);
-    out.append(*str, start, matchstart - start);
-    Rewrite(&out, rewrite, *str, vec, matches);
+
+    writer->Add(vec, matches);
     start = matchend;
     count++;
     last_match_was_empty_string = (matchstart == matchend);
   }
+  return count;
+}
 
+int RE::GlobalReplace(const StringPiece& rewrite,
+                      string *str) const {
+  RewriteTemplate tmpl(rewrite);
+  string out;
+  ReplaceWriter writer(tmpl, *str, &out, NULL, 0);
+  int count = FindReplacements(*str, &writer);
   if (count == 0)
     return 0;
-
-  if (start < static_cast<int>(str->length()))
-    out.append(*str, start, str->length() - start);
+  writer.Finish();
   swap(out, *str);
   return count;
 }
 
+int RE::GlobalReplace(const StringPiece& rewrite,
+                      const StringPiece& text,
+                      string *out) const {
+  RewriteTemplate tmpl(rewrite);
+  ReplaceWriter writer(tmpl, text, out, NULL, 0);
+  int count = FindReplacements(text, &writer);
+  writer.Finish();
+  return count;
+}
+
+int RE::GlobalReplace(const StringPiece& rewrite,
+                      const StringPiece& text,
+                      char *buf,
+                      int bufsize,
+                      int *length) const {
+  RewriteTemplate tmpl(rewrite);
+  ReplaceWriter writer(tmpl, text, NULL, buf, bufsize);
+  int count = FindReplacements(text, &writer);
+  *length = writer.Finish();
+  return writer.overflow() ? -1 : count;
+}
+
 bool RE::Extract(const StringPiece& rewrite,
                  const StringPiece& text,
                  string *out) const {
@@ -463,6 +714,24 @@ bool RE::Extract(const StringPiece& rewrite,
   return Rewrite(out, rewrite, text, vec, matches);
 }
 
+bool RE::Extract(const StringPiece& rewrite,
+                 const StringPiece& text,
+                 char *buf,
+                 int bufsize,
+                 int *length) const {
+  int vec[kVecSize];
+  int matches = TryMatch(text, 0, UNANCHORED, true, vec, kVecSize);
+  if (matches == 0)
+    return false;
+  RewriteTemplate tmpl(rewrite);
+  bool ok;
+  *length = tmpl.Expand(text.data(), vec, matches, NULL, &ok);
+  if (!ok || *length > bufsize)
+    return false;
+  tmpl.Expand(text.data(), vec, matches, buf, &ok);
+  return true;
+}
+
 /*static*/ string RE::QuoteMeta(const StringPiece& unquoted) {
   string result;
 
@@ -511,7 +780,7 @@ int RE::TryMatch(const StringPiece& text,
     return 0;
   }
 
-  pcre_extra extra = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  pcre_extra extra = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
   if (options_.match_limit() > 0) {
     extra.flags |= PCRE_EXTRA_MATCH_LIMIT;
     extra.match_limit = options_.match_limit();
@@ -614,33 +883,15 @@ bool RE::DoMatch(const StringPiece& text,
 
 bool RE::Rewrite(string *out, const StringPiece &rewrite,
                  const StringPiece &text, int *vec, int veclen) const {
-  for (const char *s = rewrite.data(), *end = s + rewrite.size();
-       s < end; s++) {
-    int c = *s;
-    if (c == '\\') {
-      c = *++s;
-      if (isdigit(c)) {
-        int n = (c - '0');
-        if (n >= veclen) {
-          //fprintf(stderr, requested group %d in regexp %.*s\n",
-          //        n, rewrite.size(), rewrite.data());
-          return false;
-        }
-        int start = vec[2 * n];
-        if (start >= 0)
-          out->append(text.data() + start, vec[2 * n + 1] - start);
-      } else if (c == '\\') {
-        *out += '\\';
-      } else {
-        //fprintf(stderr, "invalid rewrite pattern: %.*s\n",
-        //        rewrite.size(), rewrite.data());
-        return false;
-      }
-    } else {
-      *out += c;
-    }
+  RewriteTemplate tmpl(rewrite);
+  bool ok;
+  int length = tmpl.Expand(text.data(), vec, veclen, NULL, &ok);
+  if (length > 0) {
+    string::size_type old = out->size();
+    out->resize(old + length);
+    tmpl.Expand(text.data(), vec, veclen, &(*out)[old], &ok);
   }
-  return true;
+  return ok;
 }
 
 // Return the number of capturing subpatterns, or -1 if the
@@ -328,6 +328,24 @@
 // substitutions.  The non-matching portions of "text" are ignored.
 // Returns true iff a match occurred and the extraction happened
 // successfully.  If no match occurs, the string is left unaffected.
+//
+// GlobalReplace() and Extract() can also take the text separately and
+// put the result in a string or a buffer that the caller provides, so
+// that a program doing many replacements can reuse the same space:
+//
+//   string out;
+//   pcrecpp::RE("b+").GlobalReplace("d", "yabba dabba doo", &out);
+//
+//   char buf[100];
+//   int len;
+//   pcrecpp::RE("b+").GlobalReplace("d", "yabba dabba doo",
+//                                   buf, sizeof(buf), &len);
+//
+// both leave "yada dada doo" in the output, which is a copy of the text
+// if there is no match.  The buffer is not NUL-terminated; "len" is set
+// to the length of the result.  If the buffer is too small, "len" is set
+// to the size needed, -1 is returned, and what is in the buffer is not
+// defined.  The text must not lie in the output string or buffer.
 
 
 #include <string>
@@ -346,6 +364,8 @@ namespace pcrecpp {
 #define PCRE_IS_SET(o)  \
         (all_options_ & o) == o
 
+class ReplaceWriter;     // output for GlobalReplace(), private to pcrecpp.cc
+
 /***** Compiling regular expressions: the RE class *****/
 
 // RE_Options allow you to set options to be passed along to pcre,
@@ -610,10 +630,28 @@ class PCRECPP_EXP_DEFN RE {
   int GlobalReplace(const StringPiece& rewrite,
                     string *str) const;
 
+  int GlobalReplace(const StringPiece& rewrite,
+                    const StringPiece& text,
+                    string *out) const;
+
+  int GlobalReplace(const StringPiece& rewrite,
+                    const StringPiece& text,
+                    char *buf,
+                    int bufsize,
+                    int *length) const;
+
   bool Extract(const StringPiece &rewrite,
                const StringPiece &text,
                string *out) const;
 
+  // As above, but into a buffer; "*length" is set to the size of the
+  // result if there is a match, and false is returned if it does not fit.
+  bool Extract(const StringPiece &rewrite,
+               const StringPiece &text,
+               char *buf,
+               int bufsize,
+               int *length) const;
+
   // Escapes all potentially meaningful regexp characters in
   // 'unquoted'.  The returned string, used as a regular expression,
   // will exactly match the original string.  For example,
@@ -686,6 +724,11 @@ class PCRECPP_EXP_DEFN RE {
                int *vec,
                int veclen) const;
 
+  // Find the matches for GlobalReplace(), pass each one to "writer",
+  // and return the number of matches.
+  int FindReplacements(const StringPiece& text,
+                       ReplaceWriter* writer) const;
+
   // internal implementation for DoMatch
   bool DoMatchImpl(const StringPiece& text,
                    Anchor anchor,
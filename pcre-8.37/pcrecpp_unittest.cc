@@ -39,6 +39,7 @@
 
 #include <stdio.h>
 #include <string.h>      /* for memset and strcmp */
+#include <time.h>        /* for clock */
 #include <cassert>
 #include <vector>
 #include "pcrecpp.h"
@@ -101,6 +102,41 @@ static void Timing3(int num_iters) {
   printf("Matched %d lines\n", counter);
 }
 
+static void Timing4(int num_iters) {
+  // Many replacements in a large text, in place and into a reused buffer
+  string text;
+  for (int j = 0; j < 100000; j++) {
+    char line[80];
+    sprintf(line, "user%d@host%d.example.com visited page %d\n",
+            j, j % 97, j * 7);
+    text += line;
+  }
+
+  RE address("(\\w+)@(\\w+)\\.example\\.com");
+  RE digit("\\d");
+  string out;
+  int count = 0;
+  clock_t start = clock();
+  for (int j = num_iters; j > 0; j--) {
+    string copy(text);
+    count = address.GlobalReplace("\\2!\\1", &copy);
+  }
+  printf("GlobalReplace in place:   %d matches, %.2f ms each\n", count,
+         (clock() - start) * 1000.0 / CLOCKS_PER_SEC / num_iters);
+  start = clock();
+  for (int j = num_iters; j > 0; j--)
+    count = address.GlobalReplace("\\2!\\1", text, &out);
+  printf("GlobalReplace into out:   %d matches, %.2f ms each\n", count,
+         (clock() - start) * 1000.0 / CLOCKS_PER_SEC / num_iters);
+  start = clock();
+  for (int j = num_iters; j > 0; j--) {
+    string copy(text);
+    count = digit.GlobalReplace("<\\0>", &copy);
+  }
+  printf("GlobalReplace of digits:  %d matches, %.2f ms each\n", count,
+         (clock() - start) * 1000.0 / CLOCKS_PER_SEC / num_iters);
+}
+
 #if 0  // uncomment this if you have a way of defining VirtualProcessSize()
 
 static void LeakTest() {
@@ -342,6 +378,56 @@ static void TestReplace() {
     const int replace_count = re.GlobalReplace(t->rewrite, &all);
     CHECK_EQ(all, t->global);
     CHECK_EQ(replace_count, t->global_count);
+
+    // The same into a separate string, and into a buffer
+    string out("left over");
+    CHECK_EQ(re.GlobalReplace(t->rewrite, t->original, &out),
+             t->global_count);
+    CHECK_EQ(out, t->global);
+    char buf[100];
+    int len;
+    CHECK_EQ(re.GlobalReplace(t->rewrite, t->original, buf, sizeof(buf), &len),
+             t->global_count);
+    CHECK_EQ(string(buf, len), t->global);
+  }
+
+  // If the buffer is too small, the size needed is given
+  {
+    RE re("b+");
+    char buf[8];
+    int len;
+    CHECK_EQ(re.GlobalReplace("<\\0>", "abbcbd", buf, sizeof(buf), &len), -1);
+    CHECK_EQ(len, 10);
+    CHECK_EQ(re.GlobalReplace("\\0\\0", "xyz", buf, sizeof(buf), &len), 0);
+    CHECK_EQ(string(buf, len), "xyz");
+  }
+
+  // Enough matches to need several batches, with the output string
+  // reused from one call to the next
+  {
+    string text, expected, out;
+    for (int i = 0; i < 1000; i++) {
+      text += "ab ";
+      expected += "a[b,b] ";
+    }
+    RE re("(b)");
+    for (int i = 0; i < 2; i++) {
+      CHECK_EQ(re.GlobalReplace("[\\0,\\1]", text, &out), 1000);
+      CHECK(out == expected);
+    }
+    string all(text);
+    CHECK_EQ(re.GlobalReplace("[\\0,\\1]", &all), 1000);
+    CHECK(all == expected);
+  }
+
+  // Escaped backslashes, and a rewrite with many pieces
+  {
+    string all("a1b2c3");
+    CHECK_EQ(RE("(\\d)").GlobalReplace("\\\\\\1\\\\", &all), 3);
+    CHECK_EQ(all, "a\\1\\b\\2\\c\\3\\");
+    string many("x");
+    CHECK(RE("(x)").Replace("\\1.\\1.\\1.\\1.\\1.\\1.\\1.\\1.\\1.\\1", &many));
+    CHECK_EQ(many, "x.x.x.x.x.x.x.x.x.x");
   }
 
   // One final test: test \r\n replacement when we're not in CRLF mode
@@ -376,6 +462,16 @@ static void TestExtract() {
   CHECK_EQ(s, "'foo'");
   CHECK(!RE("bar").Extract("'\\0'", "baz", &s));
   CHECK_EQ(s, "'foo'");
+
+  // and into a buffer
+  char buf[16];
+  int len;
+  CHECK(RE("(.*)@([^.]*)").Extract("\\2!\\1", "boris@kremvax.ru", buf,
+                                   sizeof(buf), &len));
+  CHECK_EQ(string(buf, len), "kremvax!boris");
+  CHECK(!RE("(.*)").Extract("\\1\\1", "0123456789", buf, sizeof(buf), &len));
+  CHECK_EQ(len, 20);
+  CHECK(!RE("(.*)").Extract("\\2", "abc", buf, sizeof(buf), &len));
 }
 
 static void TestConsume() {
@@ -810,7 +906,7 @@ static void TestConstructors() {
 int main(int argc, char** argv) {
   // Treat any flag as --help
   if (argc > 1 && argv[1][0] == '-') {
-    printf("Usage: %s [timing1|timing2|timing3 num-iters]\n"
+    printf("Usage: %s [timing1|timing2|timing3|timing4 num-iters]\n"
            "       If 'timingX ###' is specified, run the given timing test\n"
            "       with the given number of iterations, rather than running\n"
            "       the default corectness test.\n", argv[0]);
@@ -828,6 +924,8 @@ int main(int argc, char** argv) {
       Timing2(atoi(argv[2]));
     else if (!strcmp(argv[1], "timing3"))
       Timing3(atoi(argv[2]));
+    else if (!strcmp(argv[1], "timing4"))
+      Timing4(atoi(argv[2]));
     else
       printf("Unknown argument '%s'\n", argv[1]);
     return 0;
@@ -69,6 +69,21 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <bzlib.h>
 #endif
 
+/* The -j option needs POSIX threads; without them it is accepted but ignored.
+When threads are in use, plain files are mapped into memory if possible, except
+in multiline mode. */
+
+#if defined HAVE_PTHREAD && !(defined HAVE_WINDOWS_H && HAVE_WINDOWS_H)
+#define SUPPORT_PCREGREP_THREADS
+#include <pthread.h>
+#ifdef HAVE_SYS_MMAN_H
+#define SUPPORT_PCREGREP_MMAP
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#endif
+#endif
+
 #include "pcre.h"
 
 #define FALSE 0
@@ -86,6 +101,13 @@ typedef int BOOL;
 
 #define PATBUFSIZE (MAXPATLEN + 10)   /* Allows for prefix+suffix */
 
+/* Limits for -j: the number of threads, the number of unwritten jobs per
+thread, and the size of a piece of a split file. */
+
+#define MAXTHREADS 256
+#define JOBS_PER_THREAD 16
+#define MAXPIECE (1024*1024*1024)
+
 /* Values for the "filenames" variable, which specifies options for file name
 output. The order is important; it is assumed that a file name is wanted for
 all values greater than FN_DEFAULT. */
@@ -94,7 +116,7 @@ enum { FN_NONE, FN_DEFAULT, FN_MATCH_ONLY, FN_NOMATCH_ONLY, FN_FORCE };
 
 /* File reading styles */
 
-enum { FR_PLAIN, FR_LIBZ, FR_LIBBZ2 };
+enum { FR_PLAIN, FR_LIBZ, FR_LIBBZ2, FR_MAPPED };
 
 /* Actions for the -d and -D options */
 
@@ -147,7 +169,6 @@ static char *colour_option = NULL;
 static char *dee_option = NULL;
 static char *DEE_option = NULL;
 static char *locale = NULL;
-static char *main_buffer = NULL;
 static char *newline = NULL;
 static char *om_separator = (char *)"";
 static char *stdin_name = (char *)"(standard input)";
@@ -160,6 +181,7 @@ static int binary_files = BIN_BINARY;
 static int both_context = 0;
 static int bufthird = PCREGREP_BUFSIZE;
 static int bufsize = 3*PCREGREP_BUFSIZE;
+static int threads = 1;
 
 #if defined HAVE_WINDOWS_H && HAVE_WINDOWS_H
 static int dee_action = dee_SKIP;
@@ -185,7 +207,6 @@ static unsigned long int match_limit_recursion = 0;
 static BOOL count_only = FALSE;
 static BOOL do_colour = FALSE;
 static BOOL file_offsets = FALSE;
-static BOOL hyphenpending = FALSE;
 static BOOL invert = FALSE;
 static BOOL line_buffered = FALSE;
 static BOOL line_offsets = FALSE;
@@ -287,6 +308,81 @@ static patstr **incexlist[4] = { &include_patterns, &exclude_patterns,
 static const char *incexname[4] = { "--include", "--exclude",
                                     "--include-dir", "--exclude-dir" };
 
+/* Structure for the state of a searcher. Without -j there is just one, which
+writes to stdout, and whose hyphenpending setting carries over from one file to
+the next. With -j, each worker thread has its own, and each job's output is
+collected in memory. The last four fields describe the data for FR_MAPPED. */
+
+typedef struct workstr {
+  char *buffer;
+  FILE *out;
+  BOOL hyphenpending;
+  BOOL startedgroup;
+  char *data;
+  size_t datalength;
+  int linenumber;
+  int filepos;
+} workstr;
+
+static workstr main_work = { NULL, NULL, FALSE, FALSE, NULL, 0, 1, 0 };
+
+#ifdef SUPPORT_PCREGREP_THREADS
+
+/* Structure for a file that has been split into pieces so that they can be
+searched in parallel. The mapping is shared by the pieces. When line numbers
+are wanted, each piece counts its lines and passes on the number of the first
+line of the next piece. */
+
+typedef struct mapstr {
+  char *data;
+  size_t length;
+  int pieces;
+  int linesknown;
+  int *linestart;
+} mapstr;
+
+/* Structure for a job for the worker threads: a whole file, or a piece of a
+split file. Jobs are queued in the order in which the files are found. Workers
+take them from job_next, and the main thread writes out their output, starting
+at job_head, as they are finished. */
+
+typedef struct jobstr {
+  struct jobstr *next;
+  char *pathname;
+  BOOL printname;
+  mapstr *map;
+  int piece;
+  size_t start;
+  size_t length;
+  char *output;
+  size_t outputlength;
+  int rc;
+  BOOL done;
+  BOOL startedgroup;
+  BOOL hyphenpending;
+} jobstr;
+
+static jobstr *job_head = NULL;
+static jobstr *job_tail = NULL;
+static jobstr *job_next = NULL;
+static int job_count = 0;
+static int job_rc = 1;
+static BOOL jobs_ended = FALSE;
+
+static pthread_mutex_t job_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t error_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_queued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_finished = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t lines_counted = PTHREAD_COND_INITIALIZER;
+static pthread_key_t jit_stack_key;
+
+static workstr *workers = NULL;
+static pthread_t *worker_ids = NULL;
+static int worker_count = 0;
+static BOOL split_files = FALSE;
+
+#endif  /* SUPPORT_PCREGREP_THREADS */
+
 /* Structure for options and list of them */
 
 enum { OP_NODATA, OP_STRING, OP_OP_STRING, OP_NUMBER, OP_LONGNUMBER,
@@ -348,6 +444,11 @@ static option_item optionlist[] = {
   { OP_NODATA,     'h',      NULL,              "no-filename",   "suppress the prefixing filename on output" },
   { OP_NODATA,     'I',      NULL,              "",              "treat binary files as not matching (ignore)" },
   { OP_NODATA,     'i',      NULL,              "ignore-case",   "ignore case distinctions" },
+#ifdef SUPPORT_PCREGREP_THREADS
+  { OP_NUMBER,     'j',      &threads,          "threads=number", "search files using number threads" },
+#else
+  { OP_NUMBER,     'j',      &threads,          "threads=number", "ignored: this pcregrep does not support threads" },
+#endif
 #ifdef SUPPORT_PCREGREP_JIT
   { OP_NODATA,     N_NOJIT,  NULL,              "no-jit",        "do not use just-in-time compiler optimization" },
 #else
@@ -1378,6 +1479,7 @@ and at the end of the file. The data in the line is written using fwrite() so
 that a binary zero does not terminate it.
 
 Arguments:
+  w                 the workstr for the searcher
   lastmatchnumber   the number of the last matching line, plus one
   lastmatchrestart  where we restarted after the last match
   endptr            end of available data
@@ -1387,8 +1489,8 @@ Returns:            nothing
 */
 
 static void
-do_after_lines(int lastmatchnumber, char *lastmatchrestart, char *endptr,
-  char *printname)
+do_after_lines(workstr *w, int lastmatchnumber, char *lastmatchrestart,
+  char *endptr, char *printname)
 {
 if (after_context > 0 && lastmatchnumber > 0)
   {
@@ -1397,13 +1499,13 @@ if (after_context > 0 && lastmatchnumber > 0)
     {
     int ellength;
     char *pp = lastmatchrestart;
-    if (printname != NULL) fprintf(stdout, "%s-", printname);
-    if (number) fprintf(stdout, "%d-", lastmatchnumber++);
+    if (printname != NULL) fprintf(w->out, "%s-", printname);
+    if (number) fprintf(w->out, "%d-", lastmatchnumber++);
     pp = end_of_line(pp, endptr, &ellength);
-    FWRITE(lastmatchrestart, 1, pp - lastmatchrestart, stdout);
+    FWRITE(lastmatchrestart, 1, pp - lastmatchrestart, w->out);
     lastmatchrestart = pp;
     }
-  hyphenpending = TRUE;
+  w->hyphenpending = TRUE;
   }
 }
 
@@ -1450,6 +1552,9 @@ for (i = 1; p != NULL; p = p->next, i++)
     startoffset, options, offsets, OFFSET_SIZE);
   if (*mrc >= 0) return TRUE;
   if (*mrc == PCRE_ERROR_NOMATCH) continue;
+#ifdef SUPPORT_PCREGREP_THREADS
+  pthread_mutex_lock(&error_mutex);
+#endif
   fprintf(stderr, "pcregrep: pcre_exec() gave error %d while matching ", *mrc);
   if (patterns->next != NULL) fprintf(stderr, "pattern number %d to ", i);
   fprintf(stderr, "%s", msg);
@@ -1463,6 +1568,9 @@ for (i = 1; p != NULL; p = p->next, i++)
     fprintf(stderr, "pcregrep: Too many errors - abandoned.\n");
     pcregrep_exit(2);
     }
+#ifdef SUPPORT_PCREGREP_THREADS
+  pthread_mutex_unlock(&error_mutex);
+#endif
   return invert;    /* No more matching; don't show the line again */
   }
 
@@ -1482,11 +1590,16 @@ context printing or for multiline scanning. For large files, the pointer will
 be in the middle third most of the time, so the bottom third is available for
 "before" context printing.
 
+When the data is mapped into memory (FR_MAPPED) there is no buffer; the whole
+file, or a piece of it, is available at once, as described in the workstr.
+
 Arguments:
+  w            the workstr for the searcher: buffer, output, etc.
   handle       the fopened FILE stream for a normal file
                the gzFile pointer when reading is via libz
                the BZFILE pointer when reading is via libbz2
-  frtype       FR_PLAIN, FR_LIBZ, or FR_LIBBZ2
+               unused for FR_MAPPED
+  frtype       FR_PLAIN, FR_LIBZ, FR_LIBBZ2, or FR_MAPPED
   filename     the file name or NULL (for errors)
   printname    the file name if it is to be printed for each match
                or NULL if the file name is not to be printed
@@ -1499,7 +1612,7 @@ Returns:       0 if there was at least one match
 */
 
 static int
-pcregrep(void *handle, int frtype, char *filename, char *printname)
+pcregrep(workstr *w, void *handle, int frtype, char *filename, char *printname)
 {
 int rc = 1;
 int linenumber = 1;
@@ -1508,13 +1621,15 @@ int count = 0;
 int filepos = 0;
 int offsets[OFFSET_SIZE];
 char *lastmatchrestart = NULL;
-char *ptr = main_buffer;
+char *main_buffer = w->buffer;
+char *ptr;
 char *endptr;
 size_t bufflength;
 BOOL binary = FALSE;
 BOOL endhyphenpending = FALSE;
 BOOL input_line_buffered = line_buffered;
 FILE *in = NULL;                    /* Ensure initialized */
+FILE *out = w->out;
 
 #ifdef SUPPORT_LIBZ
 gzFile ingz = NULL;
@@ -1528,10 +1643,23 @@ BZFILE *inbz2 = NULL;
 /* Do the first read into the start of the buffer and set up the pointer to end
 of what we have. In the case of libz, a non-zipped .gz file will be read as a
 plain file. However, if a .bz2 file isn't actually bzipped, the first read will
-fail. */
+fail. A mapped file, or piece of one, is all there already, so no reading is
+needed. */
 
 (void)frtype;
 
+#ifdef SUPPORT_PCREGREP_MMAP
+if (frtype == FR_MAPPED)
+  {
+  main_buffer = w->data;
+  bufflength = w->datalength;
+  linenumber = w->linenumber;
+  filepos = w->filepos;
+  input_line_buffered = FALSE;
+  }
+else
+#endif
+
 #ifdef SUPPORT_LIBZ
 if (frtype == FR_LIBZ)
   {
@@ -1559,13 +1687,15 @@ else
     fread(main_buffer, 1, bufsize, in);
   }
 
+ptr = main_buffer;
 endptr = main_buffer + bufflength;
 
 /* Unless binary-files=text, see if we have a binary file. This uses the same
 rule as GNU grep, namely, a search for a binary zero byte near the start of the
-file. */
+file. The pieces of a split file are not checked; a file is not split if it
+looks binary. */
 
-if (binary_files != BIN_TEXT)
+if (binary_files != BIN_TEXT && filepos == 0)
   {
   binary =
     memchr(main_buffer, 0, (bufflength > 1024)? 1024 : bufflength) != NULL;
@@ -1605,9 +1735,9 @@ while (ptr < endptr)
 
   /* Check to see if the line we are looking at extends right to the very end
   of the buffer without a line terminator. This means the line is too long to
-  handle. */
+  handle. This cannot happen for a mapped file. */
 
-  if (endlinelength == 0 && t == main_buffer + bufsize)
+  if (endlinelength == 0 && t == main_buffer + bufsize && frtype != FR_MAPPED)
     {
     fprintf(stderr, "pcregrep: line %d%s%s is too long for the internal buffer\n"
                     "pcregrep: check the --buffer-size option\n",
@@ -1702,7 +1832,7 @@ while (ptr < endptr)
 
     else if (binary)
       {
-      fprintf(stdout, "Binary file %s matches\n", filename);
+      fprintf(out, "Binary file %s matches\n", filename);
       return 0;
       }
 
@@ -1711,7 +1841,7 @@ while (ptr < endptr)
 
     else if (filenames == FN_MATCH_ONLY)
       {
-      fprintf(stdout, "%s\n", printname);
+      fprintf(out, "%s\n", printname);
       return 0;
       }
 
@@ -1746,19 +1876,19 @@ while (ptr < endptr)
           prevoffsets[0] = offsets[0];
           prevoffsets[1] = offsets[1];
 
-          if (printname != NULL) fprintf(stdout, "%s:", printname);
-          if (number) fprintf(stdout, "%d:", linenumber);
+          if (printname != NULL) fprintf(out, "%s:", printname);
+          if (number) fprintf(out, "%d:", linenumber);
 
           /* Handle --line-offsets */
 
           if (line_offsets)
-            fprintf(stdout, "%d,%d\n", (int)(matchptr + offsets[0] - ptr),
+            fprintf(out, "%d,%d\n", (int)(matchptr + offsets[0] - ptr),
               offsets[1] - offsets[0]);
 
           /* Handle --file-offsets */
 
           else if (file_offsets)
-            fprintf(stdout, "%d,%d\n",
+            fprintf(out, "%d,%d\n",
               (int)(filepos + matchptr + offsets[0] - ptr),
               offsets[1] - offsets[0]);
 
@@ -1777,16 +1907,16 @@ while (ptr < endptr)
                 int plen = offsets[2*n + 1] - offsets[2*n];
                 if (plen > 0)
                   {
-                  if (printed) fprintf(stdout, "%s", om_separator);
-                  if (do_colour) fprintf(stdout, "%c[%sm", 0x1b, colour_string);
-                  FWRITE(matchptr + offsets[n*2], 1, plen, stdout);
-                  if (do_colour) fprintf(stdout, "%c[00m", 0x1b);
+                  if (printed) fprintf(out, "%s", om_separator);
+                  if (do_colour) fprintf(out, "%c[%sm", 0x1b, colour_string);
+                  FWRITE(matchptr + offsets[n*2], 1, plen, out);
+                  if (do_colour) fprintf(out, "%c[00m", 0x1b);
                   printed = TRUE;
                   }
                 }
               }
 
-            if (printed || printname != NULL || number) fprintf(stdout, "\n");
+            if (printed || printname != NULL || number) fprintf(out, "\n");
             }
           }
 
@@ -1801,7 +1931,7 @@ while (ptr < endptr)
         (PCRE2 does this better.) */
 
         match = FALSE;
-        if (line_buffered) fflush(stdout);
+        if (line_buffered) fflush(out);
         rc = 0;                      /* Had some success */
         startoffset = offsets[1];    /* Restart after the match */
         if (startoffset <= oldstartoffset)
@@ -1844,24 +1974,30 @@ while (ptr < endptr)
         while (lastmatchrestart < p)
           {
           char *pp = lastmatchrestart;
-          if (printname != NULL) fprintf(stdout, "%s-", printname);
-          if (number) fprintf(stdout, "%d-", lastmatchnumber++);
+          if (printname != NULL) fprintf(out, "%s-", printname);
+          if (number) fprintf(out, "%d-", lastmatchnumber++);
           pp = end_of_line(pp, endptr, &ellength);
-          FWRITE(lastmatchrestart, 1, pp - lastmatchrestart, stdout);
+          FWRITE(lastmatchrestart, 1, pp - lastmatchrestart, out);
           lastmatchrestart = pp;
           }
-        if (lastmatchrestart != ptr) hyphenpending = TRUE;
+        if (lastmatchrestart != ptr) w->hyphenpending = TRUE;
         }
 
       /* If there were non-contiguous lines printed above, insert hyphens. */
 
-      if (hyphenpending)
+      if (w->hyphenpending)
         {
-        fprintf(stdout, "--\n");
-        hyphenpending = FALSE;
+        fprintf(out, "--\n");
+        w->hyphenpending = FALSE;
         hyphenprinted = TRUE;
         }
 
+      /* When running a job for -j, the worker does not know whether hyphens
+      are pending from earlier files. Record that they would have been checked
+      for here, so that they can be added when the output is written. */
+
+      w->startedgroup = TRUE;
+
       /* See if there is a requirement to print some "before" lines for this
       match. Again, don't print overlaps. */
 
@@ -1878,16 +2014,16 @@ while (ptr < endptr)
           }
 
         if (lastmatchnumber > 0 && p > lastmatchrestart && !hyphenprinted)
-          fprintf(stdout, "--\n");
+          fprintf(out, "--\n");
 
         while (p < ptr)
           {
           int ellength;
           char *pp = p;
-          if (printname != NULL) fprintf(stdout, "%s-", printname);
-          if (number) fprintf(stdout, "%d-", linenumber - linecount--);
+          if (printname != NULL) fprintf(out, "%s-", printname);
+          if (number) fprintf(out, "%d-", linenumber - linecount--);
           pp = end_of_line(pp, endptr, &ellength);
-          FWRITE(p, 1, pp - p, stdout);
+          FWRITE(p, 1, pp - p, out);
           p = pp;
           }
         }
@@ -1898,8 +2034,8 @@ while (ptr < endptr)
       if (after_context > 0 || before_context > 0)
         endhyphenpending = TRUE;
 
-      if (printname != NULL) fprintf(stdout, "%s:", printname);
-      if (number) fprintf(stdout, "%d:", linenumber);
+      if (printname != NULL) fprintf(out, "%s:", printname);
+      if (number) fprintf(out, "%d:", linenumber);
 
       /* In multiline mode, we want to print to the end of the line in which
       the end of the matched string is found, so we adjust linelength and the
@@ -1931,9 +2067,9 @@ while (ptr < endptr)
         {
         int first = S_arg * 2;
         int last  = first + 1;
-        FWRITE(ptr, 1, offsets[first], stdout);
-        fprintf(stdout, "X");
-        FWRITE(ptr + offsets[last], 1, linelength - offsets[last], stdout);
+        FWRITE(ptr, 1, offsets[first], out);
+        fprintf(out, "X");
+        FWRITE(ptr + offsets[last], 1, linelength - offsets[last], out);
         }
       else
 #endif
@@ -1944,10 +2080,10 @@ while (ptr < endptr)
       if (do_colour && !invert)
         {
         int plength;
-        FWRITE(ptr, 1, offsets[0], stdout);
-        fprintf(stdout, "%c[%sm", 0x1b, colour_string);
-        FWRITE(ptr + offsets[0], 1, offsets[1] - offsets[0], stdout);
-        fprintf(stdout, "%c[00m", 0x1b);
+        FWRITE(ptr, 1, offsets[0], out);
+        fprintf(out, "%c[%sm", 0x1b, colour_string);
+        FWRITE(ptr + offsets[0], 1, offsets[1] - offsets[0], out);
+        fprintf(out, "%c[00m", 0x1b);
         for (;;)
           {
           startoffset = offsets[1];
@@ -1955,10 +2091,10 @@ while (ptr < endptr)
               !match_patterns(matchptr, length, options, startoffset, offsets,
                 &mrc))
             break;
-          FWRITE(matchptr + startoffset, 1, offsets[0] - startoffset, stdout);
-          fprintf(stdout, "%c[%sm", 0x1b, colour_string);
-          FWRITE(matchptr + offsets[0], 1, offsets[1] - offsets[0], stdout);
-          fprintf(stdout, "%c[00m", 0x1b);
+          FWRITE(matchptr + startoffset, 1, offsets[0] - startoffset, out);
+          fprintf(out, "%c[%sm", 0x1b, colour_string);
+          FWRITE(matchptr + offsets[0], 1, offsets[1] - offsets[0], out);
+          fprintf(out, "%c[00m", 0x1b);
           }
 
         /* In multiline mode, we may have already printed the complete line
@@ -1966,18 +2102,18 @@ while (ptr < endptr)
         may be no more to print. */
 
         plength = (int)((linelength + endlinelength) - startoffset);
-        if (plength > 0) FWRITE(ptr + startoffset, 1, plength, stdout);
+        if (plength > 0) FWRITE(ptr + startoffset, 1, plength, out);
         }
 
       /* Not colouring; no need to search for further matches */
 
-      else FWRITE(ptr, 1, linelength + endlinelength, stdout);
+      else FWRITE(ptr, 1, linelength + endlinelength, out);
       }
 
     /* End of doing what has to be done for a match. If --line-buffered was
     given, flush the output. */
 
-    if (line_buffered) fflush(stdout);
+    if (line_buffered) fflush(out);
     rc = 0;    /* Had some success */
 
     /* Remember where the last match happened for after_context. We remember
@@ -2028,13 +2164,14 @@ while (ptr < endptr)
   1/3 and refill it. Before we do this, if some unprinted "after" lines are
   about to be lost, print them. */
 
-  if (bufflength >= (size_t)bufsize && ptr > main_buffer + 2*bufthird)
+  if (bufflength >= (size_t)bufsize && ptr > main_buffer + 2*bufthird &&
+      frtype != FR_MAPPED)
     {
     if (after_context > 0 &&
         lastmatchnumber > 0 &&
         lastmatchrestart < main_buffer + bufthird)
       {
-      do_after_lines(lastmatchnumber, lastmatchrestart, endptr, printname);
+      do_after_lines(w, lastmatchnumber, lastmatchrestart, endptr, printname);
       lastmatchnumber = 0;
       }
 
@@ -2074,8 +2211,8 @@ hyphenpending if it prints something. */
 
 if (!show_only_matching && !count_only)
   {
-  do_after_lines(lastmatchnumber, lastmatchrestart, endptr, printname);
-  hyphenpending |= endhyphenpending;
+  do_after_lines(w, lastmatchnumber, lastmatchrestart, endptr, printname);
+  w->hyphenpending |= endhyphenpending;
   }
 
 /* Print the file name if we are looking for those without matches and there
@@ -2083,7 +2220,7 @@ were none. If we found a match, we won't have got this far. */
 
 if (filenames == FN_NOMATCH_ONLY)
   {
-  fprintf(stdout, "%s\n", printname);
+  fprintf(out, "%s\n", printname);
   return 0;
   }
 
@@ -2094,8 +2231,8 @@ if (count_only)
   if (count > 0 || !omit_zero_count)
     {
     if (printname != NULL && filenames != FN_NONE)
-      fprintf(stdout, "%s:", printname);
-    fprintf(stdout, "%d\n", count);
+      fprintf(out, "%s:", printname);
+    fprintf(out, "%d\n", count);
     }
   }
 
@@ -2104,33 +2241,82 @@ return rc;
 
 
 
+#ifdef SUPPORT_PCREGREP_MMAP
 /*************************************************
-*     Grep a file or recurse into a directory    *
+*        Grep a file mapped into memory          *
 *************************************************/
 
-/* Given a path name, if it's a directory, scan all the files if we are
-recursing; if it's a file, grep it.
+/* This is used for plain files when -j is in use. Anything that cannot be
+mapped is left for the normal code, which gives any error messages.
 
 Arguments:
-  pathname          the path to investigate
-  dir_recurse       TRUE if recursing is wanted (-r or -drecurse)
-  only_one_at_top   TRUE if the path is the only one at toplevel
+  w            the workstr for the searcher
+  pathname     the file name
+  printname    as for pcregrep()
 
-Returns:  -1 the file/directory was skipped
-           0 if there was at least one match
-           1 if there were no matches
-           2 there was some kind of error
+Returns:      -1 if the file could not be mapped
+               otherwise the yield from pcregrep()
+*/
+
+static int
+grep_mapped_file(workstr *w, char *pathname, char *printname)
+{
+struct stat statbuf;
+char *data;
+int rc;
+int fd = open(pathname, O_RDONLY);
+
+if (fd < 0) return -1;
+if (fstat(fd, &statbuf) != 0 || !S_ISREG(statbuf.st_mode) ||
+    statbuf.st_size == 0 || statbuf.st_size > INT_MAX)
+  {
+  close(fd);
+  return -1;
+  }
+
+data = (char *)mmap(NULL, (size_t)statbuf.st_size, PROT_READ, MAP_PRIVATE,
+  fd, 0);
+close(fd);
+if (data == (char *)MAP_FAILED) return -1;
+
+w->data = data;
+w->datalength = (size_t)statbuf.st_size;
+w->linenumber = 1;
+w->filepos = 0;
+rc = pcregrep(w, NULL, FR_MAPPED, pathname, printname);
+munmap(data, (size_t)statbuf.st_size);
+return rc;
+}
+#endif  /* SUPPORT_PCREGREP_MMAP */
+
+
+
+/*************************************************
+*       Open, grep, and close a single file      *
+*************************************************/
+
+/* This is called from grep_or_recurse() for each file that is to be searched,
+or from a worker thread for each file job when -j is in use. The name "-" means
+stdin.
+
+Arguments:
+  w            the workstr for the searcher
+  pathname     the file name
+  printname    TRUE if the file name is to be printed for each match
+
+Returns:       0 if there was at least one match
+               1 if there were no matches
+               2 there was some kind of error
 
 However, file opening failures are suppressed if "silent" is set.
 */
 
 static int
-grep_or_recurse(char *pathname, BOOL dir_recurse, BOOL only_one_at_top)
+grep_file(workstr *w, char *pathname, BOOL printname)
 {
-int rc = 1;
+int rc;
 int frtype;
 void *handle;
-char *lastcomp;
 FILE *in = NULL;           /* Ensure initialized */
 
 #ifdef SUPPORT_LIBZ
@@ -2145,126 +2331,11 @@ BZFILE *inbz2 = NULL;
 int pathlen;
 #endif
 
-#if defined NATIVE_ZOS
-int zos_type;
-FILE *zos_test_file;
-#endif
-
 /* If the file name is "-" we scan stdin */
 
 if (strcmp(pathname, "-") == 0)
-  {
-  return pcregrep(stdin, FR_PLAIN, stdin_name,
-    (filenames > FN_DEFAULT || (filenames == FN_DEFAULT && !only_one_at_top))?
-      stdin_name : NULL);
-  }
-
-/* Inclusion and exclusion: --include-dir and --exclude-dir apply only to
-directories, whereas --include and --exclude apply to everything else. The test
-is against the final component of the path. */
-
-lastcomp = strrchr(pathname, FILESEP);
-lastcomp = (lastcomp == NULL)? pathname : lastcomp + 1;
-
-/* If the file is a directory, skip if not recursing or if explicitly excluded.
-Otherwise, scan the directory and recurse for each path within it. The scanning
-code is localized so it can be made system-specific. */
-
-
-/* For z/OS, determine the file type. */
-
-#if defined NATIVE_ZOS
-zos_test_file =  fopen(pathname,"rb");
-
-if (zos_test_file == NULL)
-   {
-   if (!silent) fprintf(stderr, "pcregrep: failed to test next file %s\n",
-     pathname, strerror(errno));
-   return -1;
-   }
-zos_type = identifyzosfiletype (zos_test_file);
-fclose (zos_test_file);
-
-/* Handle a PDS in separate code */
-
-if (zos_type == __ZOS_PDS || zos_type == __ZOS_PDSE)
-   {
-   return travelonpdsdir (pathname, only_one_at_top);
-   }
-
-/* Deal with regular files in the normal way below. These types are:
-   zos_type == __ZOS_PDS_MEMBER
-   zos_type == __ZOS_PS
-   zos_type == __ZOS_VSAM_KSDS
-   zos_type == __ZOS_VSAM_ESDS
-   zos_type == __ZOS_VSAM_RRDS
-*/
-
-/* Handle a z/OS directory using common code. */
-
-else if (zos_type == __ZOS_HFS)
- {
-#endif  /* NATIVE_ZOS */
-
-
-/* Handle directories: common code for all OS */
-
-if (isdirectory(pathname))
-  {
-  if (dee_action == dee_SKIP ||
-      !test_incexc(lastcomp, include_dir_patterns, exclude_dir_patterns))
-    return -1;
-
-  if (dee_action == dee_RECURSE)
-    {
-    char buffer[1024];
-    char *nextfile;
-    directory_type *dir = opendirectory(pathname);
-
-    if (dir == NULL)
-      {
-      if (!silent)
-        fprintf(stderr, "pcregrep: Failed to open directory %s: %s\n", pathname,
-          strerror(errno));
-      return 2;
-      }
-
-    while ((nextfile = readdirectory(dir)) != NULL)
-      {
-      int frc;
-      sprintf(buffer, "%.512s%c%.128s", pathname, FILESEP, nextfile);
-      frc = grep_or_recurse(buffer, dir_recurse, FALSE);
-      if (frc > 1) rc = frc;
-       else if (frc == 0 && rc == 1) rc = 0;
-      }
-
-    closedirectory(dir);
-    return rc;
-    }
-  }
-
-#if defined NATIVE_ZOS
- }
-#endif
-
-/* If the file is not a directory, check for a regular file, and if it is not,
-skip it if that's been requested. Otherwise, check for an explicit inclusion or
-exclusion. */
-
-else if (
-#if defined NATIVE_ZOS
-        (zos_type == __ZOS_NOFILE && DEE_action == DEE_SKIP) ||
-#else  /* all other OS */
-        (!isregfile(pathname) && DEE_action == DEE_SKIP) ||
-#endif
-        !test_incexc(lastcomp, include_patterns, exclude_patterns))
-  return -1;  /* File skipped */
-
-/* Control reaches here if we have a regular file, or if we have a directory
-and recursion or skipping was not requested, or if we have anything else and
-skipping was not requested. The scan proceeds. If this is the first and only
-argument at top level, we don't show the file name, unless we are only showing
-the file name, or the filename was forced (-H). */
+  return pcregrep(w, stdin, FR_PLAIN, stdin_name,
+    printname? stdin_name : NULL);
 
 #if defined SUPPORT_LIBZ || defined SUPPORT_LIBBZ2
 pathlen = (int)(strlen(pathname));
@@ -2301,13 +2372,25 @@ if (pathlen > 4 && strcmp(pathname + pathlen - 4, ".bz2") == 0)
 else
 #endif
 
-/* Otherwise use plain fopen(). The label is so that we can come back here if
-an attempt to read a .bz2 file indicates that it really is a plain file. */
+/* Otherwise use plain fopen(), unless the file can be mapped into memory,
+which is done only for the worker threads, and not in multiline mode. There,
+the subject for each line would be the whole rest of the file, which would make
+the matching (and the UTF-8 check) quadratic, and a match could extend beyond
+what the buffer holds when the file is read. The label is so that we can come
+back here if an attempt to read a .bz2 file indicates that it really is a plain
+file. */
 
 #ifdef SUPPORT_LIBBZ2
 PLAIN_FILE:
 #endif
   {
+#ifdef SUPPORT_PCREGREP_MMAP
+  if (w != &main_work && !multiline)
+    {
+    rc = grep_mapped_file(w, pathname, printname? pathname : NULL);
+    if (rc >= 0) return rc;
+    }
+#endif
   in = fopen(pathname, "rb");
   handle = (void *)in;
   frtype = FR_PLAIN;
@@ -2325,8 +2408,7 @@ if (handle == NULL)
 
 /* Now grep the file */
 
-rc = pcregrep(handle, frtype, pathname, (filenames > FN_DEFAULT ||
-  (filenames == FN_DEFAULT && !only_one_at_top))? pathname : NULL);
+rc = pcregrep(w, handle, frtype, pathname, printname? pathname : NULL);
 
 /* Close in an appropriate manner. */
 
@@ -2373,97 +2455,865 @@ return rc;
 
 
 
+#ifdef SUPPORT_PCREGREP_THREADS
 /*************************************************
-*    Handle a single-letter, no data option      *
+*      Find the JIT stack for this thread        *
 *************************************************/
 
-static int
-handle_option(int letter, int options)
-{
-switch(letter)
-  {
-  case N_FOFFSETS: file_offsets = TRUE; break;
-  case N_HELP: help(); pcregrep_exit(0);
-  case N_LBUFFER: line_buffered = TRUE; break;
-  case N_LOFFSETS: line_offsets = number = TRUE; break;
-  case N_NOJIT: study_options &= ~PCRE_STUDY_JIT_COMPILE; break;
-  case 'a': binary_files = BIN_TEXT; break;
-  case 'c': count_only = TRUE; break;
-  case 'F': process_options |= PO_FIXED_STRINGS; break;
-  case 'H': filenames = FN_FORCE; break;
-  case 'I': binary_files = BIN_NOMATCH; break;
-  case 'h': filenames = FN_NONE; break;
-  case 'i': options |= PCRE_CASELESS; break;
-  case 'l': omit_zero_count = TRUE; filenames = FN_MATCH_ONLY; break;
-  case 'L': filenames = FN_NOMATCH_ONLY; break;
-  case 'M': multiline = TRUE; options |= PCRE_MULTILINE|PCRE_FIRSTLINE; break;
-  case 'n': number = TRUE; break;
-
-  case 'o':
-  only_matching_last = add_number(0, only_matching_last);
-  if (only_matching == NULL) only_matching = only_matching_last;
-  break;
-
-  case 'q': quiet = TRUE; break;
-  case 'r': dee_action = dee_RECURSE; break;
-  case 's': silent = TRUE; break;
-  case 'u': options |= PCRE_UTF8; utf8 = TRUE; break;
-  case 'v': invert = TRUE; break;
-  case 'w': process_options |= PO_WORD_MATCH; break;
-  case 'x': process_options |= PO_LINE_MATCH; break;
-
-  case 'V':
-  fprintf(stdout, "pcregrep version %s\n", pcre_version());
-  pcregrep_exit(0);
-  break;
-
-  default:
-  fprintf(stderr, "pcregrep: Unknown option -%c\n", letter);
-  pcregrep_exit(usage(2));
-  }
+/* With -j, this callback is set for all the patterns, so that each thread uses
+its own JIT stack. */
 
-return options;
+#ifdef SUPPORT_PCREGREP_JIT
+static pcre_jit_stack *
+jit_callback(void *data)
+{
+(void)data;
+return (pcre_jit_stack *)pthread_getspecific(jit_stack_key);
 }
+#endif
 
 
 
-
+#ifdef SUPPORT_PCREGREP_MMAP
 /*************************************************
-*          Construct printed ordinal             *
+*         Find where to split a file             *
 *************************************************/
 
-/* This turns a number into "1st", "3rd", etc. */
+/* A file is split only at the start of a line. The line ending that is looked
+for is one that always ends a line in the current newline mode: a linefeed is
+always the end of a line, or of a CRLF pair, except in CR or CRLF mode.
+
+Arguments:
+  p            where to start looking
+  endptr       end of the data
+
+Returns:       the start of the next line, or endptr
+*/
 
 static char *
-ordin(int n)
+split_point(char *p, char *endptr)
 {
-static char buffer[8];
-char *p = buffer;
-sprintf(p, "%d", n);
-while (*p != 0) p++;
-switch (n%10)
+switch(endlinetype)
   {
-  case 1: strcpy(p, "st"); break;
-  case 2: strcpy(p, "nd"); break;
-  case 3: strcpy(p, "rd"); break;
-  default: strcpy(p, "th"); break;
+  case EL_CR:
+  p = (char *)memchr(p, '\r', endptr - p);
+  break;
+
+  case EL_CRLF:
+  for (;;)
+    {
+    p = (char *)memchr(p, '\n', endptr - p);
+    if (p == NULL || p[-1] == '\r') break;
+    p++;
+    }
+  break;
+
+  default:
+  p = (char *)memchr(p, '\n', endptr - p);
+  break;
   }
-return buffer;
+
+return (p == NULL)? endptr : p + 1;
 }
 
 
 
 /*************************************************
-*          Compile a single pattern              *
+*        Count the lines in part of a file       *
 *************************************************/
 
-/* Do nothing if the pattern has already been compiled. This is the case for
-include/exclude patterns read from a file.
+/* This is used for the pieces of a split file when line numbers are wanted.
+Every piece except the last ends with a line ending.
 
-When the -F option has been used, each "pattern" may be a list of strings,
-separated by line breaks. They will be matched literally. We split such a
-string and compile the first substring, inserting an additional block into the
-pattern chain.
+Arguments:
+  p            the start of the data
+  endptr       the end of the data
+
+Returns:       the number of lines
+*/
+
+static int
+count_lines(char *p, char *endptr)
+{
+int count = 0;
+
+if (endlinetype == EL_LF)
+  {
+  while ((p = (char *)memchr(p, '\n', endptr - p)) != NULL)
+    {
+    count++;
+    p++;
+    }
+  return count;
+  }
+
+while (p < endptr)
+  {
+  int ellength;
+  p = end_of_line(p, endptr, &ellength);
+  count++;
+  }
+return count;
+}
+
+
+
+/*************************************************
+*         Grep one piece of a split file         *
+*************************************************/
+
+/* If line numbers are wanted, the piece waits for the previous one to say
+where it ends. The pieces are taken from the queue in order, so the previous
+piece is always in the hands of another worker, or finished.
+
+Arguments:
+  w            the workstr for the searcher
+  job          the job for the piece
+
+Returns:       the yield from pcregrep()
+*/
+
+static int
+grep_piece(workstr *w, jobstr *job)
+{
+mapstr *map = job->map;
+
+w->data = map->data + job->start;
+w->datalength = job->length;
+w->linenumber = 1;
+w->filepos = (int)job->start;
+
+if (number)
+  {
+  int lines = (job->piece < map->pieces - 1)?
+    count_lines(w->data, w->data + w->datalength) : 0;
+  pthread_mutex_lock(&job_mutex);
+  while (map->linesknown <= job->piece)
+    pthread_cond_wait(&lines_counted, &job_mutex);
+  w->linenumber = map->linestart[job->piece];
+  if (job->piece < map->pieces - 1)
+    {
+    map->linestart[job->piece + 1] = w->linenumber + lines;
+    map->linesknown = job->piece + 2;
+    pthread_cond_broadcast(&lines_counted);
+    }
+  pthread_mutex_unlock(&job_mutex);
+  }
+
+return pcregrep(w, NULL, FR_MAPPED, job->pathname,
+  job->printname? job->pathname : NULL);
+}
+#endif  /* SUPPORT_PCREGREP_MMAP */
+
+
+
+/*************************************************
+*            Run a job in a worker               *
+*************************************************/
+
+/* The output is collected in memory, and the worker's hyphen state is saved
+for when the output is written.
+
+Arguments:
+  w            the workstr for the worker
+  job          the job
+
+Returns:       nothing; the yield is saved in the job
+*/
+
+static void
+run_job(workstr *w, jobstr *job)
+{
+FILE *out = open_memstream(&job->output, &job->outputlength);
+
+if (out == NULL)
+  {
+  fprintf(stderr, "pcregrep: Failed to create output stream: %s\n",
+    strerror(errno));
+  job->rc = 2;
+  return;
+  }
+
+w->out = out;
+w->hyphenpending = FALSE;
+w->startedgroup = FALSE;
+
+#ifdef SUPPORT_PCREGREP_MMAP
+if (job->map != NULL) job->rc = grep_piece(w, job); else
+#endif
+job->rc = grep_file(w, job->pathname, job->printname);
+
+fclose(out);
+job->startedgroup = w->startedgroup;
+job->hyphenpending = w->hyphenpending;
+}
+
+
+
+/*************************************************
+*          Main function for a worker            *
+*************************************************/
+
+/* Each worker has its own JIT stack, and takes jobs from the queue until it is
+told that there are no more.
+
+Argument:   the workstr for the worker
+Returns:    NULL
+*/
+
+static void *
+worker(void *arg)
+{
+workstr *w = (workstr *)arg;
+
+#ifdef SUPPORT_PCREGREP_JIT
+pcre_jit_stack *jit_stack = NULL;
+if ((study_options & PCRE_STUDY_JIT_COMPILE) != 0)
+  {
+  jit_stack = pcre_jit_stack_alloc(32*1024, 1024*1024);
+  pthread_setspecific(jit_stack_key, jit_stack);
+  }
+#endif
+
+for (;;)
+  {
+  jobstr *job;
+
+  pthread_mutex_lock(&job_mutex);
+  while (job_next == NULL && !jobs_ended)
+    pthread_cond_wait(&job_queued, &job_mutex);
+  job = job_next;
+  if (job != NULL) job_next = job->next;
+  pthread_mutex_unlock(&job_mutex);
+  if (job == NULL) break;
+
+  run_job(w, job);
+
+  pthread_mutex_lock(&job_mutex);
+  job->done = TRUE;
+  pthread_cond_signal(&job_finished);
+  pthread_mutex_unlock(&job_mutex);
+  }
+
+#ifdef SUPPORT_PCREGREP_JIT
+if (jit_stack != NULL) pcre_jit_stack_free(jit_stack);
+#endif
+return NULL;
+}
+
+
+
+/*************************************************
+*        Write the output of finished jobs       *
+*************************************************/
+
+/* This is called in the main thread. Jobs are written in the order in which
+they were queued. A hyphen line that was pending before a job's first group of
+lines is written ahead of its output, as would have happened without -j.
+
+Argument:   write finished jobs at the front of the queue, then wait and write
+            more until no more than this number are left
+Returns:    nothing
+*/
+
+static void
+write_jobs(int limit)
+{
+for (;;)
+  {
+  jobstr *job;
+
+  pthread_mutex_lock(&job_mutex);
+  while (job_count > limit && !job_head->done)
+    pthread_cond_wait(&job_finished, &job_mutex);
+  job = job_head;
+  if (job == NULL || !job->done)
+    {
+    pthread_mutex_unlock(&job_mutex);
+    return;
+    }
+  job_head = job->next;
+  if (job_head == NULL) job_tail = NULL;
+  job_count--;
+  pthread_mutex_unlock(&job_mutex);
+
+  if (job->startedgroup)
+    {
+    if (main_work.hyphenpending) fprintf(stdout, "--\n");
+    main_work.hyphenpending = job->hyphenpending;
+    }
+  else main_work.hyphenpending |= job->hyphenpending;
+
+  if (job->output != NULL)
+    {
+    FWRITE(job->output, 1, job->outputlength, stdout);
+    free(job->output);
+    }
+  if (line_buffered) fflush(stdout);
+
+  if (job->rc > 1) job_rc = job->rc;
+    else if (job->rc == 0 && job_rc == 1) job_rc = 0;
+
+#ifdef SUPPORT_PCREGREP_MMAP
+  if (job->map != NULL && job->piece == job->map->pieces - 1)
+    {
+    munmap(job->map->data, job->map->length);
+    free(job->map->linestart);
+    free(job->map);
+    }
+#endif
+
+  free(job->pathname);
+  free(job);
+  }
+}
+
+
+
+/*************************************************
+*               Queue a job                      *
+*************************************************/
+
+/* The number of unwritten jobs is limited, so that the memory used for their
+output stays bounded if an early job is slow.
+
+Arguments:
+  pathname     the file name
+  printname    TRUE if the file name is to be printed
+  map          a split file, or NULL for a whole file
+  piece        the piece number
+  start        offset of the piece
+  length       length of the piece
+
+Returns:       nothing
+*/
+
+static void
+queue_job(char *pathname, BOOL printname, mapstr *map, int piece,
+  size_t start, size_t length)
+{
+jobstr *job = (jobstr *)malloc(sizeof(jobstr));
+char *name = (char *)malloc(strlen(pathname) + 1);
+
+if (job == NULL || name == NULL)
+  {
+  fprintf(stderr, "pcregrep: malloc failed\n");
+  pcregrep_exit(2);
+  }
+
+strcpy(name, pathname);
+memset(job, 0, sizeof(jobstr));
+job->pathname = name;
+job->printname = printname;
+job->map = map;
+job->piece = piece;
+job->start = start;
+job->length = length;
+
+pthread_mutex_lock(&job_mutex);
+if (job_tail == NULL) job_head = job; else job_tail->next = job;
+job_tail = job;
+if (job_next == NULL) job_next = job;
+job_count++;
+pthread_cond_signal(&job_queued);
+pthread_mutex_unlock(&job_mutex);
+
+write_jobs(threads * JOBS_PER_THREAD);
+}
+
+
+
+#ifdef SUPPORT_PCREGREP_MMAP
+/*************************************************
+*          Split a large file into jobs          *
+*************************************************/
+
+/* A file is split into pieces of at least the buffer size, aiming for four per
+thread, so that one long file keeps all the threads busy. The file is mapped
+here and unmapped when the output of its last piece is written. Files that look
+binary are not split, because the whole file needs to be treated as one.
+
+Arguments:
+  pathname     the file name
+  printname    TRUE if the file name is to be printed
+
+Returns:       TRUE if the file's jobs have been queued
+               FALSE if it was not split
+*/
+
+static BOOL
+split_file(char *pathname, BOOL printname)
+{
+struct stat statbuf;
+size_t size, piecesize, start, end;
+char *data;
+mapstr *map;
+int pieces, pass;
+int fd = open(pathname, O_RDONLY);
+
+if (fd < 0) return FALSE;
+if (fstat(fd, &statbuf) != 0 || !S_ISREG(statbuf.st_mode))
+  {
+  close(fd);
+  return FALSE;
+  }
+
+size = (size_t)statbuf.st_size;
+piecesize = size/(4*threads);
+if (piecesize < (size_t)bufsize) piecesize = bufsize;
+if (piecesize > MAXPIECE) piecesize = MAXPIECE;
+if (size <= piecesize || (off_t)size != statbuf.st_size)
+  {
+  close(fd);
+  return FALSE;
+  }
+
+data = (char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+close(fd);
+if (data == (char *)MAP_FAILED) return FALSE;
+
+map = (mapstr *)malloc(sizeof(mapstr));
+if (map == NULL ||
+    (binary_files != BIN_TEXT &&
+      memchr(data, 0, (size > 1024)? 1024 : size) != NULL))
+  {
+  free(map);
+  munmap(data, size);
+  return FALSE;
+  }
+
+/* The first pass counts the pieces, so that the number is known before any of
+them can be written out. The second queues them. */
+
+for (pass = 0; pass < 2; pass++)
+  {
+  for (start = 0, pieces = 0; start < size; start = end, pieces++)
+    {
+    end = (size - start > piecesize)?
+      (size_t)(split_point(data + start + piecesize, data + size) - data) :
+      size;
+    if (pass > 0) queue_job(pathname, printname, map, pieces, start,
+      end - start);
+    }
+
+  if (pass == 0)
+    {
+    map->data = data;
+    map->length = size;
+    map->pieces = pieces;
+    map->linesknown = 1;
+    map->linestart = (int *)malloc(pieces * sizeof(int));
+    if (map->linestart == NULL)
+      {
+      fprintf(stderr, "pcregrep: malloc failed\n");
+      pcregrep_exit(2);
+      }
+    map->linestart[0] = 1;
+    }
+  }
+
+return TRUE;
+}
+#endif  /* SUPPORT_PCREGREP_MMAP */
+
+
+
+/*************************************************
+*       Start and stop the worker threads        *
+*************************************************/
+
+/* If no thread can be started, -j is ignored.
+
+Arguments:  none
+Returns:    FALSE if memory could not be obtained
+*/
+
+static BOOL
+start_workers(void)
+{
+int i;
+
+workers = (workstr *)calloc(threads, sizeof(workstr));
+worker_ids = (pthread_t *)malloc(threads * sizeof(pthread_t));
+if (workers == NULL || worker_ids == NULL)
+  {
+  fprintf(stderr, "pcregrep: malloc failed\n");
+  return FALSE;
+  }
+
+for (i = 0; i < threads; i++)
+  {
+  workstr *w = workers + worker_count;
+  w->buffer = (char *)malloc(bufsize);
+  if (w->buffer == NULL)
+    {
+    fprintf(stderr, "pcregrep: malloc failed\n");
+    return FALSE;
+    }
+  if (pthread_create(worker_ids + worker_count, NULL, worker, w) != 0)
+    {
+    free(w->buffer);
+    w->buffer = NULL;
+    break;
+    }
+  worker_count++;
+  }
+
+if (worker_count == 0)
+  {
+  free(workers);
+  free(worker_ids);
+  workers = NULL;
+  worker_ids = NULL;
+  }
+return TRUE;
+}
+
+/* Write any remaining output, then stop the workers.
+
+Arguments:  none
+Returns:    the combined yield of all the jobs
+*/
+
+static int
+end_workers(void)
+{
+int i;
+
+write_jobs(0);
+
+pthread_mutex_lock(&job_mutex);
+jobs_ended = TRUE;
+pthread_cond_broadcast(&job_queued);
+pthread_mutex_unlock(&job_mutex);
+
+for (i = 0; i < worker_count; i++)
+  {
+  pthread_join(worker_ids[i], NULL);
+  free(workers[i].buffer);
+  }
+
+free(workers);
+free(worker_ids);
+workers = NULL;
+worker_ids = NULL;
+return job_rc;
+}
+#endif  /* SUPPORT_PCREGREP_THREADS */
+
+
+
+#ifdef SUPPORT_PCREGREP_MMAP
+/*************************************************
+*       Check for a compressed file name         *
+*************************************************/
+
+/* Files whose names end in .gz or .bz2 are read via a library if it is
+supported, so they cannot be split.
+
+Argument:   the file name
+Returns:    TRUE if the file will be read via libz or libbz2
+*/
+
+static BOOL
+is_compressed(char *pathname)
+{
+#if defined SUPPORT_LIBZ || defined SUPPORT_LIBBZ2
+int pathlen = (int)(strlen(pathname));
+#endif
+
+#ifdef SUPPORT_LIBZ
+if (pathlen > 3 && strcmp(pathname + pathlen - 3, ".gz") == 0) return TRUE;
+#endif
+
+#ifdef SUPPORT_LIBBZ2
+if (pathlen > 4 && strcmp(pathname + pathlen - 4, ".bz2") == 0) return TRUE;
+#endif
+
+(void)pathname;
+return FALSE;
+}
+#endif  /* SUPPORT_PCREGREP_MMAP */
+
+
+
+/*************************************************
+*            Grep or queue a file                *
+*************************************************/
+
+/* With -j, the file is queued for the workers; a large plain file may be split
+into several jobs. Otherwise it is searched straight away.
+
+Arguments:
+  pathname     the file name
+  printname    TRUE if the file name is to be printed for each match
+
+Returns:      -1 if the file was queued
+               otherwise the yield from grep_file()
+*/
+
+static int
+grep_or_queue(char *pathname, BOOL printname)
+{
+#ifdef SUPPORT_PCREGREP_THREADS
+if (workers != NULL)
+  {
+#ifdef SUPPORT_PCREGREP_MMAP
+  if (split_files && strcmp(pathname, "-") != 0 && !is_compressed(pathname) &&
+      split_file(pathname, printname))
+    return -1;
+#endif
+  queue_job(pathname, printname, NULL, 0, 0, 0);
+  return -1;
+  }
+#endif
+
+return grep_file(&main_work, pathname, printname);
+}
+
+
+
+/*************************************************
+*     Grep a file or recurse into a directory    *
+*************************************************/
+
+/* Given a path name, if it's a directory, scan all the files if we are
+recursing; if it's a file, grep it.
+
+Arguments:
+  pathname          the path to investigate
+  dir_recurse       TRUE if recursing is wanted (-r or -drecurse)
+  only_one_at_top   TRUE if the path is the only one at toplevel
+
+Returns:  -1 the file/directory was skipped, or queued for a worker
+           0 if there was at least one match
+           1 if there were no matches
+           2 there was some kind of error
+
+However, file opening failures are suppressed if "silent" is set.
+*/
+
+static int
+grep_or_recurse(char *pathname, BOOL dir_recurse, BOOL only_one_at_top)
+{
+int rc = 1;
+char *lastcomp;
+BOOL printname = filenames > FN_DEFAULT ||
+  (filenames == FN_DEFAULT && !only_one_at_top);
+
+#if defined NATIVE_ZOS
+int zos_type;
+FILE *zos_test_file;
+#endif
+
+/* If the file name is "-" we scan stdin */
+
+if (strcmp(pathname, "-") == 0) return grep_or_queue(pathname, printname);
+
+/* Inclusion and exclusion: --include-dir and --exclude-dir apply only to
+directories, whereas --include and --exclude apply to everything else. The test
+is against the final component of the path. */
+
+lastcomp = strrchr(pathname, FILESEP);
+lastcomp = (lastcomp == NULL)? pathname : lastcomp + 1;
+
+/* If the file is a directory, skip if not recursing or if explicitly excluded.
+Otherwise, scan the directory and recurse for each path within it. The scanning
+code is localized so it can be made system-specific. */
+
+
+/* For z/OS, determine the file type. */
+
+#if defined NATIVE_ZOS
+zos_test_file =  fopen(pathname,"rb");
+
+if (zos_test_file == NULL)
+   {
+   if (!silent) fprintf(stderr, "pcregrep: failed to test next file %s\n",
+     pathname, strerror(errno));
+   return -1;
+   }
+zos_type = identifyzosfiletype (zos_test_file);
+fclose (zos_test_file);
+
+/* Handle a PDS in separate code */
+
+if (zos_type == __ZOS_PDS || zos_type == __ZOS_PDSE)
+   {
+   return travelonpdsdir (pathname, only_one_at_top);
+   }
+
+/* Deal with regular files in the normal way below. These types are:
+   zos_type == __ZOS_PDS_MEMBER
+   zos_type == __ZOS_PS
+   zos_type == __ZOS_VSAM_KSDS
+   zos_type == __ZOS_VSAM_ESDS
+   zos_type == __ZOS_VSAM_RRDS
+*/
+
+/* Handle a z/OS directory using common code. */
+
+else if (zos_type == __ZOS_HFS)
+ {
+#endif  /* NATIVE_ZOS */
+
+
+/* Handle directories: common code for all OS */
+
+if (isdirectory(pathname))
+  {
+  if (dee_action == dee_SKIP ||
+      !test_incexc(lastcomp, include_dir_patterns, exclude_dir_patterns))
+    return -1;
+
+  if (dee_action == dee_RECURSE)
+    {
+    char buffer[1024];
+    char *nextfile;
+    directory_type *dir = opendirectory(pathname);
+
+    if (dir == NULL)
+      {
+      if (!silent)
+        fprintf(stderr, "pcregrep: Failed to open directory %s: %s\n", pathname,
+          strerror(errno));
+      return 2;
+      }
+
+    while ((nextfile = readdirectory(dir)) != NULL)
+      {
+      int frc;
+      sprintf(buffer, "%.512s%c%.128s", pathname, FILESEP, nextfile);
+      frc = grep_or_recurse(buffer, dir_recurse, FALSE);
+      if (frc > 1) rc = frc;
+       else if (frc == 0 && rc == 1) rc = 0;
+      }
+
+    closedirectory(dir);
+    return rc;
+    }
+  }
+
+#if defined NATIVE_ZOS
+ }
+#endif
+
+/* If the file is not a directory, check for a regular file, and if it is not,
+skip it if that's been requested. Otherwise, check for an explicit inclusion or
+exclusion. */
+
+else if (
+#if defined NATIVE_ZOS
+        (zos_type == __ZOS_NOFILE && DEE_action == DEE_SKIP) ||
+#else  /* all other OS */
+        (!isregfile(pathname) && DEE_action == DEE_SKIP) ||
+#endif
+        !test_incexc(lastcomp, include_patterns, exclude_patterns))
+  return -1;  /* File skipped */
+
+/* Control reaches here if we have a regular file, or if we have a directory
+and recursion or skipping was not requested, or if we have anything else and
+skipping was not requested. The scan proceeds. If this is the first and only
+argument at top level, we don't show the file name, unless we are only showing
+the file name, or the filename was forced (-H). With -j, the file is queued
+for searching. */
+
+return grep_or_queue(pathname, printname);
+}
+
+
+
+/*************************************************
+*    Handle a single-letter, no data option      *
+*************************************************/
+
+static int
+handle_option(int letter, int options)
+{
+switch(letter)
+  {
+  case N_FOFFSETS: file_offsets = TRUE; break;
+  case N_HELP: help(); pcregrep_exit(0);
+  case N_LBUFFER: line_buffered = TRUE; break;
+  case N_LOFFSETS: line_offsets = number = TRUE; break;
+  case N_NOJIT: study_options &= ~PCRE_STUDY_JIT_COMPILE; break;
+  case 'a': binary_files = BIN_TEXT; break;
+  case 'c': count_only = TRUE; break;
+  case 'F': process_options |= PO_FIXED_STRINGS; break;
+  case 'H': filenames = FN_FORCE; break;
+  case 'I': binary_files = BIN_NOMATCH; break;
+  case 'h': filenames = FN_NONE; break;
+  case 'i': options |= PCRE_CASELESS; break;
+  case 'l': omit_zero_count = TRUE; filenames = FN_MATCH_ONLY; break;
+  case 'L': filenames = FN_NOMATCH_ONLY; break;
+  case 'M': multiline = TRUE; options |= PCRE_MULTILINE|PCRE_FIRSTLINE; break;
+  case 'n': number = TRUE; break;
+
+  case 'o':
+  only_matching_last = add_number(0, only_matching_last);
+  if (only_matching == NULL) only_matching = only_matching_last;
+  break;
+
+  case 'q': quiet = TRUE; break;
+  case 'r': dee_action = dee_RECURSE; break;
+  case 's': silent = TRUE; break;
+  case 'u': options |= PCRE_UTF8; utf8 = TRUE; break;
+  case 'v': invert = TRUE; break;
+  case 'w': process_options |= PO_WORD_MATCH; break;
+  case 'x': process_options |= PO_LINE_MATCH; break;
+
+  case 'V':
+  fprintf(stdout, "pcregrep version %s\n", pcre_version());
+  pcregrep_exit(0);
+  break;
+
+  default:
+  fprintf(stderr, "pcregrep: Unknown option -%c\n", letter);
+  pcregrep_exit(usage(2));
+  }
+
+return options;
+}
+
+
+
+
+/*************************************************
+*          Construct printed ordinal             *
+*************************************************/
+
+/* This turns a number into "1st", "3rd", etc. */
+
+static char *
+ordin(int n)
+{
+static char buffer[8];
+char *p = buffer;
+sprintf(p, "%d", n);
+while (*p != 0) p++;
+switch (n%10)
+  {
+  case 1: strcpy(p, "st"); break;
+  case 2: strcpy(p, "nd"); break;
+  case 3: strcpy(p, "rd"); break;
+  default: strcpy(p, "th"); break;
+  }
+return buffer;
+}
+
+
+
+/*************************************************
+*          Compile a single pattern              *
+*************************************************/
+
+/* Do nothing if the pattern has already been compiled. This is the case for
+include/exclude patterns read from a file.
+
+When the -F option has been used, each "pattern" may be a list of strings,
+separated by line breaks. They will be matched literally. We split such a
+string and compile the first substring, inserting an additional block into the
+pattern chain.
 
 Arguments:
   p              points to the pattern block
@@ -2975,6 +3825,21 @@ if (both_context > 0)
   if (before_context == 0) before_context = both_context;
   }
 
+/* Check the number of threads for -j, which is ignored if threads are not
+supported. */
+
+if (threads < 1)
+  {
+  fprintf(stderr, "pcregrep: Invalid value %d for -j\n", threads);
+  pcregrep_exit(usage(2));
+  }
+
+#ifdef SUPPORT_PCREGREP_THREADS
+if (threads > MAXTHREADS) threads = MAXTHREADS;
+#else
+threads = 1;
+#endif
+
 /* Only one of --only-matching, --file-offsets, or --line-offsets is permitted.
 However, all three set show_only_matching because they display, each in their
 own way, only the data that has matched. */
@@ -3115,9 +3980,10 @@ if (jfriedl_XT != 0 || jfriedl_XR != 0)
 /* Get memory for the main buffer. */
 
 bufsize = 3*bufthird;
-main_buffer = (char *)malloc(bufsize);
+main_work.buffer = (char *)malloc(bufsize);
+main_work.out = stdout;
 
-if (main_buffer == NULL)
+if (main_work.buffer == NULL)
   {
   fprintf(stderr, "pcregrep: malloc failed\n");
   goto EXIT2;
@@ -3168,6 +4034,18 @@ if ((study_options & PCRE_STUDY_JIT_COMPILE) != 0)
   jit_stack = pcre_jit_stack_alloc(32*1024, 1024*1024);
 #endif
 
+/* With -j, each thread finds its own JIT stack via a thread-specific key. The
+main thread uses the one just allocated. */
+
+#if defined SUPPORT_PCREGREP_JIT && defined SUPPORT_PCREGREP_THREADS
+if (jit_stack != NULL && threads > 1)
+  {
+  if (pthread_key_create(&jit_stack_key, NULL) == 0)
+    pthread_setspecific(jit_stack_key, jit_stack);
+  else threads = 1;
+  }
+#endif
+
 for (j = 1, cp = patterns; cp != NULL; j++, cp = cp->next)
   {
   cp->hint = pcre_study(cp->compiled, study_options, &error);
@@ -3180,7 +4058,14 @@ for (j = 1, cp = patterns; cp != NULL; j++, cp = cp->next)
     }
 #ifdef SUPPORT_PCREGREP_JIT
   if (jit_stack != NULL && cp->hint != NULL)
+    {
+#ifdef SUPPORT_PCREGREP_THREADS
+    if (threads > 1)
+      pcre_assign_jit_stack(cp->hint, jit_callback, NULL);
+    else
+#endif
     pcre_assign_jit_stack(cp->hint, NULL, jit_stack);
+    }
 #endif
   }
 
@@ -3237,11 +4122,25 @@ no file arguments, search stdin, and then exit. */
 
 if (file_lists == NULL && i >= argc)
   {
-  rc = pcregrep(stdin, FR_PLAIN, stdin_name,
+  rc = pcregrep(&main_work, stdin, FR_PLAIN, stdin_name,
     (filenames > FN_DEFAULT)? stdin_name : NULL);
   goto EXIT;
   }
 
+/* With -j, start the worker threads. Large files can be split into pieces
+that are searched in parallel, provided that each line is handled on its own,
+and nothing is output for the file as a whole. */
+
+#ifdef SUPPORT_PCREGREP_THREADS
+if (threads > 1)
+  {
+  split_files = !multiline && before_context == 0 && after_context == 0 &&
+    !count_only && !quiet && filenames != FN_MATCH_ONLY &&
+    filenames != FN_NOMATCH_ONLY;
+  if (!start_workers()) goto EXIT2;
+  }
+#endif
+
 /* If any files that contains a list of files to search have been specified,
 read them line by line and search the given files. */
 
@@ -3290,11 +4189,20 @@ for (; i < argc; i++)
   }
 
 EXIT:
+#ifdef SUPPORT_PCREGREP_THREADS
+if (workers != NULL)
+  {
+  int frc = end_workers();
+  if (frc > 1) rc = frc;
+    else if (frc == 0 && rc == 1) rc = 0;
+  }
+#endif
+
 #ifdef SUPPORT_PCREGREP_JIT
 if (jit_stack != NULL) pcre_jit_stack_free(jit_stack);
 #endif
 
-free(main_buffer);
+free(main_work.buffer);
 free((void *)pcretables);
 
 free_pattern_chain(patterns);
@@ -298,6 +298,12 @@ argument, the casting might be incorrectly applied. */
 #define PCRE_JIT_STACK_FREE8(stack) \
   pcre_jit_stack_free(stack)
 
+#define PCRE_FRAME_ARENA_ALLOC8() \
+  pcre_frame_arena_alloc()
+
+#define PCRE_FRAME_ARENA_FREE8(arena) \
+  pcre_frame_arena_free(arena)
+
 #define pcre8_maketables pcre_maketables
 
 #endif /* SUPPORT_PCRE8 */
@@ -392,6 +398,12 @@ argument, the casting might be incorrectly applied. */
 #define PCRE_JIT_STACK_FREE16(stack) \
   pcre16_jit_stack_free((pcre16_jit_stack *)stack)
 
+#define PCRE_FRAME_ARENA_ALLOC16() \
+  (pcre_frame_arena *)pcre16_frame_arena_alloc()
+
+#define PCRE_FRAME_ARENA_FREE16(arena) \
+  pcre16_frame_arena_free((pcre16_frame_arena *)arena)
+
 #endif /* SUPPORT_PCRE16 */
 
 /* -----------------------------------------------------------*/
@@ -484,6 +496,12 @@ argument, the casting might be incorrectly applied. */
 #define PCRE_JIT_STACK_FREE32(stack) \
   pcre32_jit_stack_free((pcre32_jit_stack *)stack)
 
+#define PCRE_FRAME_ARENA_ALLOC32() \
+  (pcre_frame_arena *)pcre32_frame_arena_alloc()
+
+#define PCRE_FRAME_ARENA_FREE32(arena) \
+  pcre32_frame_arena_free((pcre32_frame_arena *)arena)
+
 #endif /* SUPPORT_PCRE32 */
 
 
@@ -689,6 +707,21 @@ cases separately. */
   else \
     PCRE_JIT_STACK_FREE8(stack)
 
+#define PCRE_FRAME_ARENA_ALLOC() \
+  (pcre_mode == PCRE32_MODE ? \
+     PCRE_FRAME_ARENA_ALLOC32() \
+    : pcre_mode == PCRE16_MODE ? \
+      PCRE_FRAME_ARENA_ALLOC16() \
+      : PCRE_FRAME_ARENA_ALLOC8())
+
+#define PCRE_FRAME_ARENA_FREE(arena) \
+  if (pcre_mode == PCRE32_MODE) \
+    PCRE_FRAME_ARENA_FREE32(arena); \
+  else if (pcre_mode == PCRE16_MODE) \
+    PCRE_FRAME_ARENA_FREE16(arena); \
+  else \
+    PCRE_FRAME_ARENA_FREE8(arena)
+
 #define PCRE_MAKETABLES \
   (pcre_mode == PCRE32_MODE ? pcre32_maketables() : pcre_mode == PCRE16_MODE ? pcre16_maketables() : pcre_maketables())
 
@@ -885,6 +918,17 @@ the three different cases. */
   else \
     G(PCRE_JIT_STACK_FREE,BITTWO)(stack)
 
+#define PCRE_FRAME_ARENA_ALLOC() \
+  (pcre_mode == G(G(PCRE,BITONE),_MODE)) ? \
+     G(PCRE_FRAME_ARENA_ALLOC,BITONE)() \
+    : G(PCRE_FRAME_ARENA_ALLOC,BITTWO)()
+
+#define PCRE_FRAME_ARENA_FREE(arena) \
+  if (pcre_mode == G(G(PCRE,BITONE),_MODE)) \
+    G(PCRE_FRAME_ARENA_FREE,BITONE)(arena); \
+  else \
+    G(PCRE_FRAME_ARENA_FREE,BITTWO)(arena)
+
 #define PCRE_MAKETABLES \
   (pcre_mode == G(G(PCRE,BITONE),_MODE)) ? \
     G(G(pcre,BITONE),_maketables)() : G(G(pcre,BITTWO),_maketables)()
@@ -929,6 +973,8 @@ the three different cases. */
 #define PCRE_COPY_SUBSTRING       PCRE_COPY_SUBSTRING8
 #define PCRE_DFA_EXEC             PCRE_DFA_EXEC8
 #define PCRE_EXEC                 PCRE_EXEC8
+#define PCRE_FRAME_ARENA_ALLOC    PCRE_FRAME_ARENA_ALLOC8
+#define PCRE_FRAME_ARENA_FREE     PCRE_FRAME_ARENA_FREE8
 #define PCRE_FREE_STUDY           PCRE_FREE_STUDY8
 #define PCRE_FREE_SUBSTRING       PCRE_FREE_SUBSTRING8
 #define PCRE_FREE_SUBSTRING_LIST  PCRE_FREE_SUBSTRING_LIST8
@@ -960,6 +1006,8 @@ the three different cases. */
 #define PCRE_COPY_SUBSTRING       PCRE_COPY_SUBSTRING16
 #define PCRE_DFA_EXEC             PCRE_DFA_EXEC16
 #define PCRE_EXEC                 PCRE_EXEC16
+#define PCRE_FRAME_ARENA_ALLOC    PCRE_FRAME_ARENA_ALLOC16
+#define PCRE_FRAME_ARENA_FREE     PCRE_FRAME_ARENA_FREE16
 #define PCRE_FREE_STUDY           PCRE_FREE_STUDY16
 #define PCRE_FREE_SUBSTRING       PCRE_FREE_SUBSTRING16
 #define PCRE_FREE_SUBSTRING_LIST  PCRE_FREE_SUBSTRING_LIST16
@@ -991,6 +1039,8 @@ the three different cases. */
 #define PCRE_COPY_SUBSTRING       PCRE_COPY_SUBSTRING32
 #define PCRE_DFA_EXEC             PCRE_DFA_EXEC32
 #define PCRE_EXEC                 PCRE_EXEC32
+#define PCRE_FRAME_ARENA_ALLOC    PCRE_FRAME_ARENA_ALLOC32
+#define PCRE_FRAME_ARENA_FREE     PCRE_FRAME_ARENA_FREE32
 #define PCRE_FREE_STUDY           PCRE_FREE_STUDY32
 #define PCRE_FREE_SUBSTRING       PCRE_FREE_SUBSTRING32
 #define PCRE_FREE_SUBSTRING_LIST  PCRE_FREE_SUBSTRING_LIST32
@@ -3016,6 +3066,7 @@ int *dfa_workspace = NULL;
 #endif
 
 pcre_jit_stack *jit_stack = NULL;
+pcre_frame_arena *frame_arena = NULL;
 
 /* These vectors store, end-to-end, a list of zero-terminated captured
 substring names, each list itself being terminated by an empty name. Assume
@@ -3469,6 +3520,7 @@ while (!done)
   unsigned long int true_size, true_study_size = 0;
   size_t size;
   int do_allcaps = 0;
+  int do_arena = 0;
   int do_mark = 0;
   int do_study = 0;
   int no_force_study = 0;
@@ -3777,6 +3829,7 @@ while (!done)
       case 'E': options |= PCRE_DOLLAR_ENDONLY; break;
       case 'F': do_flip = 1; break;
       case 'G': do_G = 1; break;
+      case 'H': do_arena = 1; break;
       case 'I': do_showinfo = 1; break;
       case 'J': options |= PCRE_DUPNAMES; break;
       case 'K': do_mark = 1; break;
@@ -4143,6 +4196,27 @@ while (!done)
       extra->flags |= PCRE_EXTRA_MARK;
       }
 
+    /* If /H was present, create a frame arena that is kept for all the
+    matches of this pattern. */
+
+    if (do_arena)
+      {
+      if (extra == NULL)
+        {
+        extra = (pcre_extra *)malloc(sizeof(pcre_extra));
+        extra->flags = 0;
+        }
+      frame_arena = PCRE_FRAME_ARENA_ALLOC();
+      if (frame_arena == NULL)
+        {
+        fprintf(outfile, "** Failed to create a frame arena\n");
+        yield = 1;
+        goto EXIT;
+        }
+      extra->frame_arena = frame_arena;
+      extra->flags |= PCRE_EXTRA_FRAME_ARENA;
+      }
+
     /* Extract and display information from the compiled data if required. */
 
     SHOW_INFO:
@@ -4454,6 +4528,11 @@ while (!done)
         {
         PCRE_FREE_STUDY(extra);
         }
+      if (frame_arena != NULL)
+        {
+        PCRE_FRAME_ARENA_FREE(frame_arena);
+        frame_arena = NULL;
+        }
       if (locale_set)
         {
         new_free((void *)tables);
@@ -5689,6 +5768,11 @@ while (!done)
     PCRE_JIT_STACK_FREE(jit_stack);
     jit_stack = NULL;
     }
+  if (frame_arena != NULL)
+    {
+    PCRE_FRAME_ARENA_FREE(frame_arena);
+    frame_arena = NULL;
+    }
   }
 
 if (infile == stdin) fprintf(outfile, "\n");